@@ -92,6 +92,8 @@ enum
   PROP_GLOBAL_PALETTE,
   PROP_GLOBAL_GRADIENT,
   PROP_GLOBAL_FONT,
+  PROP_BRUSH_CACHE_SIZE,
+  PROP_BRUSH_CACHE_TOLERANCE,
   PROP_DEFAULT_IMAGE,
   PROP_DEFAULT_GRID,
   PROP_UNDO_LEVELS,
@@ -99,6 +101,8 @@ enum
   PROP_UNDO_PREVIEW_SIZE,
   PROP_FILTER_HISTORY_SIZE,
   PROP_PLUGINRC_PATH,
+  PROP_PLUG_IN_POOL_SIZE,
+  PROP_PLUG_IN_IDLE_TIMEOUT,
   PROP_LAYER_PREVIEWS,
   PROP_GROUP_LAYER_PREVIEWS,
   PROP_LAYER_PREVIEW_SIZE,
@@ -111,6 +115,8 @@ enum
   PROP_IMPORT_PROMOTE_DITHER,
   PROP_IMPORT_ADD_ALPHA,
   PROP_IMPORT_RAW_PLUG_IN,
+  PROP_XCF_LAZY_LOAD,
+  PROP_XCF_ZSTD_LEVEL,
   PROP_EXPORT_FILE_TYPE,
   PROP_EXPORT_COLOR_PROFILE,
   PROP_EXPORT_METADATA_EXIF,
@@ -496,6 +502,20 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                             TRUE,
                             GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_BRUSH_CACHE_SIZE,
+                            "brush-cache-size",
+                            "Brush cache size",
+                            BRUSH_CACHE_SIZE_BLURB,
+                            0, GIMP_MAX_MEMSIZE, 1 << 24, /* 16MB */
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_DOUBLE (object_class, PROP_BRUSH_CACHE_TOLERANCE,
+                           "brush-cache-tolerance",
+                           "Brush cache tolerance",
+                           BRUSH_CACHE_TOLERANCE_BLURB,
+                           0.0, 0.1, 0.0,
+                           GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_OBJECT (object_class, PROP_DEFAULT_IMAGE,
                            "default-image",
                            "Default image",
@@ -562,6 +582,20 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_POOL_SIZE,
+                        "plug-in-pool-size",
+                        "Plug-in pool size",
+                        PLUG_IN_POOL_SIZE_BLURB,
+                        0, 64, 4,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_IDLE_TIMEOUT,
+                        "plug-in-idle-timeout",
+                        "Plug-in idle timeout",
+                        PLUG_IN_IDLE_TIMEOUT_BLURB,
+                        1, 3600, 60,
+                        GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_LAYER_PREVIEWS,
                             "layer-previews",
                             "Layer previews",
@@ -651,6 +685,20 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_LAZY_LOAD,
+                            "xcf-lazy-load",
+                            "XCF lazy load",
+                            XCF_LAZY_LOAD_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_XCF_ZSTD_LEVEL,
+                        "xcf-zstd-level",
+                        "XCF zstd level",
+                        XCF_ZSTD_LEVEL_BLURB,
+                        1, 19, 3,
+                        GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_EXPORT_FILE_TYPE,
                          "export-file-type",
                          "Default export file type",
@@ -930,6 +978,12 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_GLOBAL_FONT:
       core_config->global_font = g_value_get_boolean (value);
       break;
+    case PROP_BRUSH_CACHE_SIZE:
+      core_config->brush_cache_size = g_value_get_uint64 (value);
+      break;
+    case PROP_BRUSH_CACHE_TOLERANCE:
+      core_config->brush_cache_tolerance = g_value_get_double (value);
+      break;
     case PROP_DEFAULT_IMAGE:
       if (g_value_get_object (value))
         gimp_config_sync (g_value_get_object (value) ,
@@ -956,6 +1010,12 @@ gimp_core_config_set_property (GObject      *object,
       g_free (core_config->plug_in_rc_path);
       core_config->plug_in_rc_path = g_value_dup_string (value);
       break;
+    case PROP_PLUG_IN_POOL_SIZE:
+      core_config->plug_in_pool_size = g_value_get_int (value);
+      break;
+    case PROP_PLUG_IN_IDLE_TIMEOUT:
+      core_config->plug_in_idle_timeout = g_value_get_int (value);
+      break;
     case PROP_LAYER_PREVIEWS:
       core_config->layer_previews = g_value_get_boolean (value);
       break;
@@ -995,6 +1055,12 @@ gimp_core_config_set_property (GObject      *object,
       g_free (core_config->import_raw_plug_in);
       core_config->import_raw_plug_in = g_value_dup_string (value);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      core_config->xcf_lazy_load = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      core_config->xcf_zstd_level = g_value_get_int (value);
+      break;
     case PROP_EXPORT_FILE_TYPE:
       core_config->export_file_type = g_value_get_enum (value);
       break;
@@ -1146,6 +1212,12 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_GLOBAL_FONT:
       g_value_set_boolean (value, core_config->global_font);
       break;
+    case PROP_BRUSH_CACHE_SIZE:
+      g_value_set_uint64 (value, core_config->brush_cache_size);
+      break;
+    case PROP_BRUSH_CACHE_TOLERANCE:
+      g_value_set_double (value, core_config->brush_cache_tolerance);
+      break;
     case PROP_DEFAULT_IMAGE:
       g_value_set_object (value, core_config->default_image);
       break;
@@ -1167,6 +1239,12 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_PLUGINRC_PATH:
       g_value_set_string (value, core_config->plug_in_rc_path);
       break;
+    case PROP_PLUG_IN_POOL_SIZE:
+      g_value_set_int (value, core_config->plug_in_pool_size);
+      break;
+    case PROP_PLUG_IN_IDLE_TIMEOUT:
+      g_value_set_int (value, core_config->plug_in_idle_timeout);
+      break;
     case PROP_LAYER_PREVIEWS:
       g_value_set_boolean (value, core_config->layer_previews);
       break;
@@ -1203,6 +1281,12 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_IMPORT_RAW_PLUG_IN:
       g_value_set_string (value, core_config->import_raw_plug_in);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      g_value_set_boolean (value, core_config->xcf_lazy_load);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      g_value_set_int (value, core_config->xcf_zstd_level);
+      break;
     case PROP_EXPORT_FILE_TYPE:
       g_value_set_enum (value, core_config->export_file_type);
       break;
@@ -77,6 +77,8 @@ struct _GimpCoreConfig
   gboolean                global_palette;
   gboolean                global_gradient;
   gboolean                global_font;
+  guint64                 brush_cache_size;
+  gdouble                 brush_cache_tolerance;
   GimpTemplate           *default_image;
   GimpGrid               *default_grid;
   gint                    levels_of_undo;
@@ -84,6 +86,8 @@ struct _GimpCoreConfig
   GimpViewSize            undo_preview_size;
   gint                    filter_history_size;
   gchar                  *plug_in_rc_path;
+  gint                    plug_in_pool_size;
+  gint                    plug_in_idle_timeout;
   gboolean                layer_previews;
   gboolean                group_layer_previews;
   GimpViewSize            layer_preview_size;
@@ -96,6 +100,8 @@ struct _GimpCoreConfig
   gboolean                import_promote_dither;
   gboolean                import_add_alpha;
   gchar                  *import_raw_plug_in;
+  gboolean                xcf_lazy_load;
+  gint                    xcf_zstd_level;
   GimpExportFileType      export_file_type;
   gboolean                export_color_profile;
   gboolean                export_metadata_exif;
@@ -14,6 +14,16 @@ _("When enabled, an image will become the active image when its image " \
   "window receives the focus. This is useful for window managers using " \
   "\"click to focus\".")
 
+#define BRUSH_CACHE_SIZE_BLURB \
+"Sets the maximum amount of memory used to cache the transformed masks " \
+"of each brush in use.  The 20 most recently used masks are kept even " \
+"if they exceed it."
+
+#define BRUSH_CACHE_TOLERANCE_BLURB \
+"Sets how closely the size, angle, aspect ratio and hardness of a brush " \
+"dab have to match a cached brush mask to reuse it, relative to the " \
+"range of each.  Zero only reuses exact matches."
+
 #define BRUSH_PATH_BLURB \
 "Sets the brush search path."
 
@@ -204,6 +214,16 @@ _("Add an alpha channel to all layers of imported images.")
 #define IMPORT_RAW_PLUG_IN_BLURB \
 _("Which plug-in to use for importing raw digital camera files.")
 
+#define XCF_LAZY_LOAD_BLURB \
+_("When opening XCF files, read the pixels of layers, masks and channels " \
+  "from the file only when they are first needed, instead of loading " \
+  "them all upfront.  The file must not be modified while the image " \
+  "is open.")
+
+#define XCF_ZSTD_LEVEL_BLURB \
+_("The compression level used for XCF files saved with zstd compression, " \
+  "from 1 (fastest) to 19 (smallest).")
+
 #define EXPORT_FILE_TYPE_BLURB \
 _("Export file type used by default.")
 
@@ -307,6 +327,14 @@ _("Sets how many threads GIMP should use for operations that support it.")
 #define PLUGINRC_PATH_BLURB \
 "Sets the pluginrc search path."
 
+#define PLUG_IN_POOL_SIZE_BLURB \
+"How many idle plug-ins that support it to keep running, so they can " \
+"serve the next call without being started again.  Set to 0 to disable."
+
+#define PLUG_IN_IDLE_TIMEOUT_BLURB \
+"How many seconds an idle plug-in is kept running before it is asked " \
+"to quit."
+
 #define LAYER_PREVIEWS_BLURB \
 _("Sets whether GIMP should create previews of layers and channels. " \
   "Previews in the layers and channels dialog are nice to have but they " \
@@ -213,6 +213,7 @@ typedef struct _GimpWaitable                    GimpWaitable;    /* dummy typede
 /*  non-object types  */
 
 typedef struct _GimpBacktrace                   GimpBacktrace;
+typedef struct _GimpBoundaryCache               GimpBoundaryCache;
 typedef struct _GimpBoundSeg                    GimpBoundSeg;
 typedef struct _GimpChunkIterator               GimpChunkIterator;
 typedef struct _GimpCoords                      GimpCoords;
@@ -25,6 +25,7 @@
 
 #include "core-types.h"
 
+#include "config/gimpcoreconfig.h"
 #include "config/gimprc.h"
 
 #include "gimp.h"
@@ -35,6 +36,7 @@
 #include "gimpcontainer.h"
 #include "gimpbrush-load.h"
 #include "gimpbrush.h"
+#include "gimpbrushcache.h"
 #include "gimpbrushclipboard.h"
 #include "gimpbrushgenerated-load.h"
 #include "gimpbrushpipe-load.h"
@@ -59,6 +61,11 @@
 #include "gimp-intl.h"
 
 
+static void   gimp_data_factories_notify_brush_cache (GimpCoreConfig *config);
+
+
+/*  public functions  */
+
 void
 gimp_data_factories_init (Gimp *gimp)
 {
@@ -224,6 +231,16 @@ gimp_data_factories_add_builtin (Gimp *gimp)
   /*  add the color history palette  */
   gimp_palettes_init (gimp);
 
+  /*  limit the transformed brush caches  */
+  g_signal_connect (gimp->config, "notify::brush-cache-size",
+                    G_CALLBACK (gimp_data_factories_notify_brush_cache),
+                    NULL);
+  g_signal_connect (gimp->config, "notify::brush-cache-tolerance",
+                    G_CALLBACK (gimp_data_factories_notify_brush_cache),
+                    NULL);
+
+  gimp_data_factories_notify_brush_cache (gimp->config);
+
   /*  add the clipboard brushes  */
   data = gimp_brush_clipboard_new (gimp, FALSE);
   gimp_data_make_internal (data, "gimp-brush-clipboard-image");
@@ -431,3 +448,13 @@ gimp_data_factories_save (Gimp *gimp)
 
   gimp_palettes_save (gimp);
 }
+
+
+/*  private functions  */
+
+static void
+gimp_data_factories_notify_brush_cache (GimpCoreConfig *config)
+{
+  gimp_brush_cache_set_limits (config->brush_cache_size,
+                               config->brush_cache_tolerance);
+}
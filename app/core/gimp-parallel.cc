@@ -46,7 +46,18 @@ extern "C"
 
 
 #define GIMP_PARALLEL_MAX_THREADS           64
-#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS  1
+#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS  4
+
+/* the amount of work worth running on a separate thread, in terms of the
+ * time it takes to process it
+ */
+#define GIMP_PARALLEL_THREAD_COST \
+  (/* each thread costs as much as */ 20.0 /* microseconds */)
+
+/* the minimal total time of a parallel loop, for it to be used as a
+ * sample of the loop's cost
+ */
+#define GIMP_PARALLEL_MIN_SAMPLE_TIME 100 /* microseconds */
 
 
 typedef struct
@@ -56,34 +67,52 @@ typedef struct
   GimpParallelRunAsyncFunc  func;
   gpointer                  user_data;
   GDestroyNotify            user_data_destroy_func;
+  gboolean                  concurrent;
 } GimpParallelRunAsyncTask;
 
 typedef struct
 {
   GThread   *thread;
 
-  gboolean   quit;
+  gint       quit;
 
   GimpAsync *current_async;
+
+  /* the thread's own tasks, sorted by priority.  idle threads steal
+   * concurrent tasks from the other threads' queues.
+   */
+  GMutex     mutex;
+  GQueue     queue;
+  gint       n_queued;
 } GimpParallelRunAsyncThread;
 
 
 /*  local function prototypes  */
 
-static void                       gimp_parallel_notify_num_processors   (GimpGeglConfig             *config);
-
-static void                       gimp_parallel_set_n_threads           (gint                        n_threads,
-                                                                         gboolean                    finish_tasks);
-
-static void                       gimp_parallel_run_async_set_n_threads (gint                        n_threads,
-                                                                         gboolean                    finish_tasks);
-static gpointer                   gimp_parallel_run_async_thread_func   (GimpParallelRunAsyncThread *thread);
-static void                       gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncTask   *task);
-static GimpParallelRunAsyncTask * gimp_parallel_run_async_dequeue_task  (void);
-static gboolean                   gimp_parallel_run_async_execute_task  (GimpParallelRunAsyncTask   *task);
-static void                       gimp_parallel_run_async_abort_task    (GimpParallelRunAsyncTask   *task);
-static void                       gimp_parallel_run_async_cancel        (GimpAsync                  *async);
-static void                       gimp_parallel_run_async_waiting       (GimpAsync                  *async);
+static void                         gimp_parallel_notify_num_processors   (GimpGeglConfig             *config);
+
+static void                         gimp_parallel_set_n_threads           (gint                        n_threads,
+                                                                           gboolean                    finish_tasks);
+
+static void                         gimp_parallel_run_async_set_n_threads (gint                        n_threads,
+                                                                           gboolean                    finish_tasks);
+static gpointer                     gimp_parallel_run_async_thread_func   (GimpParallelRunAsyncThread *thread);
+static void                         gimp_parallel_run_async_run_task      (GimpParallelRunAsyncThread *thread,
+                                                                           GimpParallelRunAsyncTask   *task);
+static GimpAsync *                  gimp_parallel_run_async_queue         (GimpParallelRunAsyncTask   *task);
+static GimpParallelRunAsyncThread * gimp_parallel_run_async_get_thread    (GimpParallelRunAsyncTask   *task);
+static void                         gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncThread *thread,
+                                                                           GimpParallelRunAsyncTask   *task);
+static GimpParallelRunAsyncTask *   gimp_parallel_run_async_dequeue_task  (GimpParallelRunAsyncThread *thread);
+static GimpParallelRunAsyncTask *   gimp_parallel_run_async_steal_task    (GimpParallelRunAsyncThread *thread);
+static void                         gimp_parallel_run_async_count_task    (GimpParallelRunAsyncThread *thread,
+                                                                           GimpParallelRunAsyncTask   *task,
+                                                                           gint                        delta);
+static void                         gimp_parallel_run_async_wake          (void);
+static gboolean                     gimp_parallel_run_async_execute_task  (GimpParallelRunAsyncTask   *task);
+static void                         gimp_parallel_run_async_abort_task    (GimpParallelRunAsyncTask   *task);
+static void                         gimp_parallel_run_async_cancel        (GimpAsync                  *async);
+static void                         gimp_parallel_run_async_waiting       (GimpAsync                  *async);
 
 
 /*  local variables  */
@@ -91,9 +120,17 @@ static void                       gimp_parallel_run_async_waiting       (GimpAsy
 static gint                       gimp_parallel_run_async_n_threads = 0;
 static GimpParallelRunAsyncThread gimp_parallel_run_async_threads[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
 
+/* only used for putting idle threads to sleep, and waking them up */
 static GMutex                     gimp_parallel_run_async_mutex;
 static GCond                      gimp_parallel_run_async_cond;
-static GQueue                     gimp_parallel_run_async_queue = G_QUEUE_INIT;
+
+static volatile gint              gimp_parallel_run_async_n_queued    = 0;
+static volatile gint              gimp_parallel_run_async_n_stealable = 0;
+static volatile gint              gimp_parallel_run_async_n_sleeping  = 0;
+static volatile gint              gimp_parallel_run_async_n_stolen    = 0;
+static volatile gint              gimp_parallel_run_async_next_thread = 0;
+
+static GPrivate                   gimp_parallel_loop_depth;
 
 
 /*  public functions  */
@@ -141,44 +178,53 @@ gimp_parallel_run_async_full (gint                     priority,
                               gpointer                 user_data,
                               GDestroyNotify           user_data_destroy_func)
 {
-  GimpAsync                *async;
   GimpParallelRunAsyncTask *task;
 
   g_return_val_if_fail (func != NULL, NULL);
 
-  async = gimp_async_new ();
-
   task = g_slice_new (GimpParallelRunAsyncTask);
 
-  task->async                  = GIMP_ASYNC (g_object_ref (async));
   task->priority               = priority;
   task->func                   = func;
   task->user_data              = user_data;
   task->user_data_destroy_func = user_data_destroy_func;
+  task->concurrent             = FALSE;
 
-  if (gimp_parallel_run_async_n_threads > 0)
-    {
-      g_signal_connect_after (async, "cancel",
-                              G_CALLBACK (gimp_parallel_run_async_cancel),
-                              NULL);
-      g_signal_connect_after (async, "waiting",
-                              G_CALLBACK (gimp_parallel_run_async_waiting),
-                              NULL);
+  return gimp_parallel_run_async_queue (task);
+}
 
-      g_mutex_lock (&gimp_parallel_run_async_mutex);
+GimpAsync *
+gimp_parallel_run_async_concurrent (GimpParallelRunAsyncFunc func,
+                                    gpointer                 user_data)
+{
+  return gimp_parallel_run_async_concurrent_full (0, func, user_data, NULL);
+}
 
-      gimp_parallel_run_async_enqueue_task (task);
+/* like gimp_parallel_run_async_full(), except that the task may run
+ * concurrently with other async tasks.  tasks run through
+ * gimp_parallel_run_async() and gimp_parallel_run_async_full() all run
+ * on the same thread, one at a time, in priority order, and their
+ * callers may rely on that.
+ */
+GimpAsync *
+gimp_parallel_run_async_concurrent_full (gint                     priority,
+                                         GimpParallelRunAsyncFunc func,
+                                         gpointer                 user_data,
+                                         GDestroyNotify           user_data_destroy_func)
+{
+  GimpParallelRunAsyncTask *task;
 
-      g_cond_signal (&gimp_parallel_run_async_cond);
+  g_return_val_if_fail (func != NULL, NULL);
 
-      g_mutex_unlock (&gimp_parallel_run_async_mutex);
-    }
-  else
-    {
-      while (gimp_parallel_run_async_execute_task (task));
-    }
+  task = g_slice_new (GimpParallelRunAsyncTask);
 
-  return async;
+  task->priority               = priority;
+  task->func                   = func;
+  task->user_data              = user_data;
+  task->user_data_destroy_func = user_data_destroy_func;
+  task->concurrent             = TRUE;
+
+  return gimp_parallel_run_async_queue (task);
 }
 
 GimpAsync *
@@ -250,6 +296,93 @@ gimp_parallel_run_async_independent_full (gint                     priority,
 }
 
 
+/*  public functions (stats)  */
+
+
+gint
+gimp_parallel_run_async_get_n_queued (void)
+{
+  return gimp_parallel_run_async_n_queued;
+}
+
+gint
+gimp_parallel_run_async_get_n_stolen (void)
+{
+  return gimp_parallel_run_async_n_stolen;
+}
+
+
+/*  public functions (parallel loops)  */
+
+
+gdouble
+gimp_parallel_cost_get_thread_cost (GimpParallelCost *cost,
+                                    gdouble           thread_cost)
+{
+  gint scale = g_atomic_int_get (&cost->scale);
+
+  if (scale > 0)
+    return thread_cost * scale / GIMP_PARALLEL_COST_SCALE;
+  else
+    return thread_cost;
+}
+
+void
+gimp_parallel_cost_add_sample (GimpParallelCost *cost,
+                               gdouble           thread_cost,
+                               gdouble           n_units,
+                               gint64            time)
+{
+  gdouble scale;
+  gint    old_scale;
+
+  /* ignore samples that are too short to be measured reliably */
+  if (time < GIMP_PARALLEL_MIN_SAMPLE_TIME || n_units <= 0.0 ||
+      thread_cost <= 0.0)
+    {
+      return;
+    }
+
+  /* normalize the measured cost by the caller's estimate, so that the
+   * result applies to invocations with a different estimate
+   */
+  scale = GIMP_PARALLEL_THREAD_COST * n_units / time / thread_cost *
+          GIMP_PARALLEL_COST_SCALE;
+
+  /* smooth the estimate over successive samples */
+  old_scale = g_atomic_int_get (&cost->scale);
+
+  if (old_scale > 0)
+    scale = (3.0 * old_scale + scale) / 4.0;
+
+  scale = CLAMP (scale, 1.0, G_MAXINT / 2);
+
+  g_atomic_int_set (&cost->scale, (gint) scale);
+}
+
+gboolean
+gimp_parallel_loop_is_nested (void)
+{
+  return g_private_get (&gimp_parallel_loop_depth) != NULL;
+}
+
+void
+gimp_parallel_loop_enter (void)
+{
+  gint depth = GPOINTER_TO_INT (g_private_get (&gimp_parallel_loop_depth));
+
+  g_private_set (&gimp_parallel_loop_depth, GINT_TO_POINTER (depth + 1));
+}
+
+void
+gimp_parallel_loop_leave (void)
+{
+  gint depth = GPOINTER_TO_INT (g_private_get (&gimp_parallel_loop_depth));
+
+  g_private_set (&gimp_parallel_loop_depth, GINT_TO_POINTER (depth - 1));
+}
+
+
 /*  private functions  */
 
 
@@ -271,13 +404,14 @@ static void
 gimp_parallel_run_async_set_n_threads (gint     n_threads,
                                        gboolean finish_tasks)
 {
+  gint old_n_threads = gimp_parallel_run_async_n_threads;
   gint i;
 
   n_threads = CLAMP (n_threads, 0, GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS);
 
-  if (n_threads > gimp_parallel_run_async_n_threads) /* need more threads */
+  if (n_threads > old_n_threads) /* need more threads */
     {
-      for (i = gimp_parallel_run_async_n_threads; i < n_threads; i++)
+      for (i = old_n_threads; i < n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
@@ -289,48 +423,67 @@ gimp_parallel_run_async_set_n_threads (gint     n_threads,
             (GThreadFunc) gimp_parallel_run_async_thread_func,
             thread);
         }
+
+      gimp_parallel_run_async_n_threads = n_threads;
     }
-  else if (n_threads < gimp_parallel_run_async_n_threads) /* need less threads */
+  else if (n_threads < old_n_threads) /* need less threads */
     {
-      g_mutex_lock (&gimp_parallel_run_async_mutex);
-
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      for (i = n_threads; i < old_n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
 
-          thread->quit = TRUE;
+          g_atomic_int_set (&thread->quit, TRUE);
+
+          g_mutex_lock (&thread->mutex);
 
           if (thread->current_async && ! finish_tasks)
             gimp_cancelable_cancel (GIMP_CANCELABLE (thread->current_async));
+
+          g_mutex_unlock (&thread->mutex);
         }
 
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
       g_cond_broadcast (&gimp_parallel_run_async_cond);
 
       g_mutex_unlock (&gimp_parallel_run_async_mutex);
 
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      for (i = n_threads; i < old_n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
 
           g_thread_join (thread->thread);
         }
-    }
-
-  gimp_parallel_run_async_n_threads = n_threads;
 
-  if (n_threads == 0)
-    {
-      GimpParallelRunAsyncTask *task;
+      gimp_parallel_run_async_n_threads = n_threads;
 
-      /* finish remaining tasks */
-      while ((task = gimp_parallel_run_async_dequeue_task ()))
+      /* move the tasks of the stopped threads to the remaining threads, or
+       * finish them now, if there are no threads left
+       */
+      for (i = n_threads; i < old_n_threads; i++)
         {
-          if (finish_tasks)
-            while (gimp_parallel_run_async_execute_task (task));
-          else
-            gimp_parallel_run_async_abort_task (task);
+          GimpParallelRunAsyncThread *thread =
+            &gimp_parallel_run_async_threads[i];
+          GimpParallelRunAsyncTask   *task;
+
+          while ((task = gimp_parallel_run_async_dequeue_task (thread)))
+            {
+              if (n_threads > 0)
+                {
+                  gimp_parallel_run_async_enqueue_task (
+                    gimp_parallel_run_async_get_thread (task), task);
+                }
+              else if (finish_tasks)
+                {
+                  while (gimp_parallel_run_async_execute_task (task));
+                }
+              else
+                {
+                  gimp_parallel_run_async_abort_task (task);
+                }
+            }
         }
     }
 }
@@ -338,54 +491,139 @@ gimp_parallel_run_async_set_n_threads (gint     n_threads,
 static gpointer
 gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
 {
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
-
-  while (TRUE)
+  while (! g_atomic_int_get (&thread->quit))
     {
       GimpParallelRunAsyncTask *task;
 
-      while (! thread->quit &&
-             (task = gimp_parallel_run_async_dequeue_task ()))
-        {
-          gboolean resume;
+      task = gimp_parallel_run_async_dequeue_task (thread);
 
-          thread->current_async = GIMP_ASYNC (g_object_ref (task->async));
+      if (! task && thread != &gimp_parallel_run_async_threads[0])
+        task = gimp_parallel_run_async_steal_task (thread);
 
-          do
-            {
-              g_mutex_unlock (&gimp_parallel_run_async_mutex);
+      if (task)
+        {
+          gimp_parallel_run_async_run_task (thread, task);
 
-              resume = gimp_parallel_run_async_execute_task (task);
+          continue;
+        }
 
-              g_mutex_lock (&gimp_parallel_run_async_mutex);
-            }
-          while (resume &&
-                 (g_queue_is_empty (&gimp_parallel_run_async_queue) ||
-                  task->priority <
-                  ((GimpParallelRunAsyncTask *)
-                     g_queue_peek_head (
-                       &gimp_parallel_run_async_queue))->priority));
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-          g_clear_object (&thread->current_async);
+      g_atomic_int_inc (&gimp_parallel_run_async_n_sleeping);
 
-          if (resume)
-            gimp_parallel_run_async_enqueue_task (task);
+      while (! g_atomic_int_get (&thread->quit) &&
+             ! g_atomic_int_get (&thread->n_queued) &&
+             (thread == &gimp_parallel_run_async_threads[0] ||
+              ! g_atomic_int_get (&gimp_parallel_run_async_n_stealable)))
+        {
+          g_cond_wait (&gimp_parallel_run_async_cond,
+                       &gimp_parallel_run_async_mutex);
         }
 
-      if (thread->quit)
+      g_atomic_int_dec_and_test (&gimp_parallel_run_async_n_sleeping);
+
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
+    }
+
+  return NULL;
+}
+
+static void
+gimp_parallel_run_async_run_task (GimpParallelRunAsyncThread *thread,
+                                  GimpParallelRunAsyncTask   *task)
+{
+  gboolean resume;
+
+  g_mutex_lock (&thread->mutex);
+
+  thread->current_async = GIMP_ASYNC (g_object_ref (task->async));
+
+  g_mutex_unlock (&thread->mutex);
+
+  do
+    {
+      GimpParallelRunAsyncTask *next_task;
+
+      resume = gimp_parallel_run_async_execute_task (task);
+
+      if (! resume)
         break;
 
-      g_cond_wait (&gimp_parallel_run_async_cond,
-                   &gimp_parallel_run_async_mutex);
+      /* keep running the task, unless a task of a higher or equal
+       * priority is waiting in our queue
+       */
+      g_mutex_lock (&thread->mutex);
+
+      next_task = (GimpParallelRunAsyncTask *) g_queue_peek_head (
+                                                 &thread->queue);
+
+      g_mutex_unlock (&thread->mutex);
+
+      if (next_task && next_task->priority <= task->priority)
+        break;
     }
+  while (! g_atomic_int_get (&thread->quit));
 
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
+  g_mutex_lock (&thread->mutex);
 
-  return NULL;
+  g_clear_object (&thread->current_async);
+
+  g_mutex_unlock (&thread->mutex);
+
+  if (resume)
+    gimp_parallel_run_async_enqueue_task (thread, task);
+}
+
+static GimpAsync *
+gimp_parallel_run_async_queue (GimpParallelRunAsyncTask *task)
+{
+  GimpAsync *async;
+
+  async = gimp_async_new ();
+
+  task->async = GIMP_ASYNC (g_object_ref (async));
+
+  if (gimp_parallel_run_async_n_threads > 0)
+    {
+      g_signal_connect_after (async, "cancel",
+                              G_CALLBACK (gimp_parallel_run_async_cancel),
+                              NULL);
+      g_signal_connect_after (async, "waiting",
+                              G_CALLBACK (gimp_parallel_run_async_waiting),
+                              NULL);
+
+      gimp_parallel_run_async_enqueue_task (
+        gimp_parallel_run_async_get_thread (task), task);
+    }
+  else
+    {
+      while (gimp_parallel_run_async_execute_task (task));
+    }
+
+  return async;
+}
+
+static GimpParallelRunAsyncThread *
+gimp_parallel_run_async_get_thread (GimpParallelRunAsyncTask *task)
+{
+  gint i;
+
+  /* serial tasks all go to the first thread, which is the only one not
+   * stealing from the others' queues, and concurrent tasks are
+   * distributed between the rest
+   */
+  if (! task->concurrent || gimp_parallel_run_async_n_threads == 1)
+    return &gimp_parallel_run_async_threads[0];
+
+  i = g_atomic_int_add (&gimp_parallel_run_async_next_thread, 1);
+
+  return &gimp_parallel_run_async_threads[
+    1 + (guint) i % (gimp_parallel_run_async_n_threads - 1)];
 }
 
 static void
-gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
+gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncThread *thread,
+                                      GimpParallelRunAsyncTask   *task)
 {
   GList *link;
   GList *iter;
@@ -400,10 +638,14 @@ gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
   link       = g_list_alloc ();
   link->data = task;
 
+  g_mutex_lock (&thread->mutex);
+
   g_object_set_data (G_OBJECT (task->async),
                      "gimp-parallel-run-async-link", link);
+  g_object_set_data (G_OBJECT (task->async),
+                     "gimp-parallel-run-async-thread", thread);
 
-  for (iter = g_queue_peek_tail_link (&gimp_parallel_run_async_queue);
+  for (iter = g_queue_peek_tail_link (&thread->queue);
        iter;
        iter = g_list_previous (iter))
     {
@@ -424,33 +666,135 @@ gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
       if (link->next)
         link->next->prev = link;
       else
-        gimp_parallel_run_async_queue.tail = link;
+        thread->queue.tail = link;
 
-      gimp_parallel_run_async_queue.length++;
+      thread->queue.length++;
     }
   else
     {
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
+      g_queue_push_head_link (&thread->queue, link);
     }
+
+  gimp_parallel_run_async_count_task (thread, task, +1);
+
+  g_mutex_unlock (&thread->mutex);
+
+  gimp_parallel_run_async_wake ();
 }
 
 static GimpParallelRunAsyncTask *
-gimp_parallel_run_async_dequeue_task (void)
+gimp_parallel_run_async_dequeue_task (GimpParallelRunAsyncThread *thread)
 {
   GimpParallelRunAsyncTask *task;
 
-  task = (GimpParallelRunAsyncTask *) g_queue_pop_head (
-                                        &gimp_parallel_run_async_queue);
+  g_mutex_lock (&thread->mutex);
+
+  task = (GimpParallelRunAsyncTask *) g_queue_pop_head (&thread->queue);
 
   if (task)
     {
+      g_object_set_data (G_OBJECT (task->async),
+                         "gimp-parallel-run-async-thread", NULL);
       g_object_set_data (G_OBJECT (task->async),
                          "gimp-parallel-run-async-link", NULL);
+
+      gimp_parallel_run_async_count_task (thread, task, -1);
     }
 
+  g_mutex_unlock (&thread->mutex);
+
   return task;
 }
 
+static GimpParallelRunAsyncTask *
+gimp_parallel_run_async_steal_task (GimpParallelRunAsyncThread *thread)
+{
+  GimpParallelRunAsyncTask *task = NULL;
+  gint                      n_threads;
+  gint                      thread_index;
+  gint                      i;
+
+  if (! g_atomic_int_get (&gimp_parallel_run_async_n_stealable))
+    return NULL;
+
+  n_threads    = gimp_parallel_run_async_n_threads;
+  thread_index = thread - gimp_parallel_run_async_threads;
+
+  /* steal the first concurrent task of the first other thread that has
+   * one.  the queues are sorted by priority, and serial tasks, which
+   * may only be run by the first thread, are skipped.
+   */
+  for (i = 1; ! task && i < n_threads; i++)
+    {
+      GimpParallelRunAsyncThread *other_thread;
+      GList                      *iter;
+
+      other_thread =
+        &gimp_parallel_run_async_threads[(thread_index + i) % n_threads];
+
+      g_mutex_lock (&other_thread->mutex);
+
+      for (iter = g_queue_peek_head_link (&other_thread->queue);
+           iter;
+           iter = g_list_next (iter))
+        {
+          GimpParallelRunAsyncTask *other_task =
+            (GimpParallelRunAsyncTask *) iter->data;
+
+          if (other_task->concurrent)
+            {
+              task = other_task;
+
+              g_object_set_data (G_OBJECT (task->async),
+                                 "gimp-parallel-run-async-thread", NULL);
+              g_object_set_data (G_OBJECT (task->async),
+                                 "gimp-parallel-run-async-link", NULL);
+
+              g_queue_delete_link (&other_thread->queue, iter);
+
+              gimp_parallel_run_async_count_task (other_thread, task, -1);
+
+              g_atomic_int_inc (&gimp_parallel_run_async_n_stolen);
+
+              break;
+            }
+        }
+
+      g_mutex_unlock (&other_thread->mutex);
+    }
+
+  return task;
+}
+
+/* called with the thread's mutex locked */
+static void
+gimp_parallel_run_async_count_task (GimpParallelRunAsyncThread *thread,
+                                    GimpParallelRunAsyncTask   *task,
+                                    gint                        delta)
+{
+  g_atomic_int_add (&thread->n_queued,                     delta);
+  g_atomic_int_add (&gimp_parallel_run_async_n_queued,     delta);
+
+  if (task->concurrent)
+    g_atomic_int_add (&gimp_parallel_run_async_n_stealable, delta);
+}
+
+static void
+gimp_parallel_run_async_wake (void)
+{
+  if (g_atomic_int_get (&gimp_parallel_run_async_n_sleeping))
+    {
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+      /* not all threads can run every task, so wake them all, and let
+       * them go back to sleep if there's nothing for them
+       */
+      g_cond_broadcast (&gimp_parallel_run_async_cond);
+
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
+    }
+}
+
 static gboolean
 gimp_parallel_run_async_execute_task (GimpParallelRunAsyncTask *task)
 {
@@ -491,32 +835,41 @@ gimp_parallel_run_async_abort_task (GimpParallelRunAsyncTask *task)
 static void
 gimp_parallel_run_async_cancel (GimpAsync *async)
 {
-  GList                    *link;
-  GimpParallelRunAsyncTask *task = NULL;
+  GimpParallelRunAsyncThread *thread;
+  GimpParallelRunAsyncTask   *task = NULL;
+
+  /* the task may move between threads while we're looking for it, so
+   * keep looking until it's either found, or no longer queued
+   */
+  while (! task &&
+         (thread = (GimpParallelRunAsyncThread *) g_object_get_data (
+                     G_OBJECT (async), "gimp-parallel-run-async-thread")))
+    {
+      g_mutex_lock (&thread->mutex);
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+      if (g_object_get_data (G_OBJECT (async),
+                             "gimp-parallel-run-async-thread") == thread)
+        {
+          GList *link;
 
-  if (! link)
-    return;
+          link = (GList *) g_object_get_data (G_OBJECT (async),
+                                              "gimp-parallel-run-async-link");
 
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
+          g_object_set_data (G_OBJECT (async),
+                             "gimp-parallel-run-async-thread", NULL);
+          g_object_set_data (G_OBJECT (async),
+                             "gimp-parallel-run-async-link", NULL);
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+          task = (GimpParallelRunAsyncTask *) link->data;
 
-  if (link)
-    {
-      g_object_set_data (G_OBJECT (async),
-                         "gimp-parallel-run-async-link", NULL);
+          g_queue_delete_link (&thread->queue, link);
 
-      task = (GimpParallelRunAsyncTask *) link->data;
+          gimp_parallel_run_async_count_task (thread, task, -1);
+        }
 
-      g_queue_delete_link (&gimp_parallel_run_async_queue, link);
+      g_mutex_unlock (&thread->mutex);
     }
 
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
-
   if (task)
     gimp_parallel_run_async_abort_task (task);
 }
@@ -524,30 +877,36 @@ gimp_parallel_run_async_cancel (GimpAsync *async)
 static void
 gimp_parallel_run_async_waiting (GimpAsync *async)
 {
-  GList *link;
+  GimpParallelRunAsyncThread *thread;
+  gboolean                    found = FALSE;
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  while (! found &&
+         (thread = (GimpParallelRunAsyncThread *) g_object_get_data (
+                     G_OBJECT (async), "gimp-parallel-run-async-thread")))
+    {
+      g_mutex_lock (&thread->mutex);
 
-  if (! link)
-    return;
+      if (g_object_get_data (G_OBJECT (async),
+                             "gimp-parallel-run-async-thread") == thread)
+        {
+          GList                    *link;
+          GimpParallelRunAsyncTask *task;
 
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
+          link = (GList *) g_object_get_data (G_OBJECT (async),
+                                              "gimp-parallel-run-async-link");
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+          task = (GimpParallelRunAsyncTask *) link->data;
 
-  if (link)
-    {
-      GimpParallelRunAsyncTask *task = (GimpParallelRunAsyncTask *) link->data;
+          task->priority = G_MININT;
 
-      task->priority = G_MININT;
+          g_queue_unlink         (&thread->queue, link);
+          g_queue_push_head_link (&thread->queue, link);
 
-      g_queue_unlink         (&gimp_parallel_run_async_queue, link);
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
-    }
+          found = TRUE;
+        }
 
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
+      g_mutex_unlock (&thread->mutex);
+    }
 }
 
 } /* extern "C" */
@@ -26,6 +26,18 @@ typedef void (* GimpParallelRunAsyncFunc) (GimpAsync *async,
                                            gpointer   user_data);
 
 
+typedef struct
+{
+  /* the ratio between the measured amount of work worth running on a
+   * separate thread and the caller's estimate, in units of
+   * 1 / GIMP_PARALLEL_COST_SCALE, or 0 if not measured yet
+   */
+  volatile gint scale;
+} GimpParallelCost;
+
+#define GIMP_PARALLEL_COST_SCALE 4096
+
+
 void        gimp_parallel_init                       (Gimp                     *gimp);
 void        gimp_parallel_exit                       (Gimp                     *gimp);
 
@@ -35,12 +47,32 @@ GimpAsync * gimp_parallel_run_async_full             (gint
                                                       GimpParallelRunAsyncFunc  func,
                                                       gpointer                  user_data,
                                                       GDestroyNotify            user_data_destroy_func);
+GimpAsync * gimp_parallel_run_async_concurrent       (GimpParallelRunAsyncFunc  func,
+                                                      gpointer                  user_data);
+GimpAsync * gimp_parallel_run_async_concurrent_full  (gint                      priority,
+                                                      GimpParallelRunAsyncFunc  func,
+                                                      gpointer                  user_data,
+                                                      GDestroyNotify            user_data_destroy_func);
 GimpAsync * gimp_parallel_run_async_independent      (GimpParallelRunAsyncFunc  func,
                                                       gpointer                  user_data);
 GimpAsync * gimp_parallel_run_async_independent_full (gint                      priority,
                                                       GimpParallelRunAsyncFunc  func,
                                                       gpointer                  user_data);
 
+gint        gimp_parallel_run_async_get_n_queued     (void);
+gint        gimp_parallel_run_async_get_n_stolen     (void);
+
+gdouble     gimp_parallel_cost_get_thread_cost       (GimpParallelCost         *cost,
+                                                      gdouble                   thread_cost);
+void        gimp_parallel_cost_add_sample            (GimpParallelCost         *cost,
+                                                      gdouble                   thread_cost,
+                                                      gdouble                   n_units,
+                                                      gint64                    time);
+
+gboolean    gimp_parallel_loop_is_nested             (void);
+void        gimp_parallel_loop_enter                 (void);
+void        gimp_parallel_loop_leave                 (void);
+
 
 #ifdef __cplusplus
 
@@ -153,6 +185,185 @@ gimp_parallel_run_async_independent (ParallelRunAsyncFunc func)
   return gimp_parallel_run_async_independent_full (0, func);
 }
 
+
+/*  parallel loops
+ *
+ *  gimp_parallel_distribute_area() and gimp_parallel_distribute_range()
+ *  work like their GEGL counterparts, except that @thread_cost is only
+ *  used as an estimate:  the time spent in @func is measured, and the
+ *  ratio between the measured cost and @thread_cost is learned per call
+ *  site, and applied to the @thread_cost of subsequent invocations.
+ *  @thread_cost may therefore vary between invocations of the same call
+ *  site, as long as it's proportional to the actual cost of each item.
+ *  invocations made from within the body of another parallel loop are
+ *  run serially.
+ *
+ *  gimp_parallel_reduce_area() and gimp_parallel_reduce_range() give
+ *  each thread its own accumulator, initialized to @init, which should
+ *  be the identity value of @reduce_func, and combine the accumulators
+ *  using @reduce_func when done.
+ */
+
+template <class DistributeAreaFunc>
+inline void
+gimp_parallel_distribute_area (const GeglRectangle *area,
+                               gdouble              thread_cost,
+                               GeglSplitStrategy    split_strategy,
+                               DistributeAreaFunc   func)
+{
+  static GimpParallelCost cost;
+  volatile gint           elapsed = 0;
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  if (gimp_parallel_loop_is_nested ())
+    {
+      func (area);
+
+      return;
+    }
+
+  gegl_parallel_distribute_area (
+    area, gimp_parallel_cost_get_thread_cost (&cost, thread_cost),
+    split_strategy,
+    [&] (const GeglRectangle *subarea)
+    {
+      gint64 start = g_get_monotonic_time ();
+
+      gimp_parallel_loop_enter ();
+
+      func (subarea);
+
+      gimp_parallel_loop_leave ();
+
+      g_atomic_int_add (&elapsed, (gint) (g_get_monotonic_time () - start));
+    });
+
+  gimp_parallel_cost_add_sample (&cost, thread_cost,
+                                 (gdouble) area->width * area->height,
+                                 elapsed);
+}
+
+template <class DistributeAreaFunc>
+inline void
+gimp_parallel_distribute_area (const GeglRectangle *area,
+                               gdouble              thread_cost,
+                               DistributeAreaFunc   func)
+{
+  gimp_parallel_distribute_area (area, thread_cost,
+                                 GEGL_SPLIT_STRATEGY_AUTO, func);
+}
+
+template <class DistributeRangeFunc>
+inline void
+gimp_parallel_distribute_range (gsize               size,
+                                gdouble             thread_cost,
+                                DistributeRangeFunc func)
+{
+  static GimpParallelCost cost;
+  volatile gint           elapsed = 0;
+
+  if (size == 0)
+    return;
+
+  if (gimp_parallel_loop_is_nested ())
+    {
+      func (0, size);
+
+      return;
+    }
+
+  gegl_parallel_distribute_range (
+    size, gimp_parallel_cost_get_thread_cost (&cost, thread_cost),
+    [&] (gsize suboffset,
+         gsize subsize)
+    {
+      gint64 start = g_get_monotonic_time ();
+
+      gimp_parallel_loop_enter ();
+
+      func (suboffset, subsize);
+
+      gimp_parallel_loop_leave ();
+
+      g_atomic_int_add (&elapsed, (gint) (g_get_monotonic_time () - start));
+    });
+
+  gimp_parallel_cost_add_sample (&cost, thread_cost, size, elapsed);
+}
+
+template <class T,
+          class ReduceAreaFunc,
+          class ReduceFunc>
+inline T
+gimp_parallel_reduce_area (const GeglRectangle *area,
+                           gdouble              thread_cost,
+                           const T             &init,
+                           ReduceAreaFunc       func,
+                           ReduceFunc           reduce_func)
+{
+  T      result = init;
+  GMutex mutex;
+
+  g_mutex_init (&mutex);
+
+  gimp_parallel_distribute_area (
+    area, thread_cost,
+    [&] (const GeglRectangle *subarea)
+    {
+      T accum = init;
+
+      func (subarea, accum);
+
+      g_mutex_lock (&mutex);
+
+      reduce_func (result, accum);
+
+      g_mutex_unlock (&mutex);
+    });
+
+  g_mutex_clear (&mutex);
+
+  return result;
+}
+
+template <class T,
+          class ReduceRangeFunc,
+          class ReduceFunc>
+inline T
+gimp_parallel_reduce_range (gsize            size,
+                            gdouble          thread_cost,
+                            const T         &init,
+                            ReduceRangeFunc  func,
+                            ReduceFunc       reduce_func)
+{
+  T      result = init;
+  GMutex mutex;
+
+  g_mutex_init (&mutex);
+
+  gimp_parallel_distribute_range (
+    size, thread_cost,
+    [&] (gsize suboffset,
+         gsize subsize)
+    {
+      T accum = init;
+
+      func (suboffset, subsize, accum);
+
+      g_mutex_lock (&mutex);
+
+      reduce_func (result, accum);
+
+      g_mutex_unlock (&mutex);
+    });
+
+  g_mutex_clear (&mutex);
+
+  return result;
+}
+
 }
 
 #endif /* __cplusplus */
@@ -43,5 +43,7 @@ void             gimp_bezier_desc_translate           (GimpBezierDesc       *des
 GimpBezierDesc * gimp_bezier_desc_copy                (const GimpBezierDesc *desc);
 void             gimp_bezier_desc_free                (GimpBezierDesc       *desc);
 
+gsize            gimp_bezier_desc_get_memsize         (const GimpBezierDesc *desc);
+
 
 #endif /* __GIMP_BEZIER_DESC_H__ */
@@ -0,0 +1,535 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpboundary-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gegl/gimpmasktiles.h"
+
+#include "gimpboundary.h"
+#include "gimpboundary-cache.h"
+
+
+typedef struct
+{
+  GimpBoundSeg *segs[2];    /*  indexed by GimpBoundaryType  */
+  gint          num_segs[2];
+  gboolean      valid;
+} CacheTile;
+
+struct _GimpBoundaryCache
+{
+  GeglBuffer    *buffer;
+  GimpMaskTiles *mask_tiles;
+
+  GeglRectangle  extent;
+  GeglRectangle  clip;
+  gint           n_cols;
+  gint           n_rows;
+
+  CacheTile     *tiles;
+};
+
+typedef struct
+{
+  GimpBoundaryCache *cache;
+  const gint        *indices;
+} UpdateData;
+
+
+/*  local function prototypes  */
+
+static gint       gimp_boundary_cache_get_uniform  (GimpBoundaryCache *cache,
+                                                    GimpBoundaryType   type,
+                                                    gint               col,
+                                                    gint               row);
+static void       gimp_boundary_cache_add_runs     (GArray            *segs,
+                                                    const guchar      *a,
+                                                    const guchar      *b,
+                                                    gint               stride,
+                                                    gint               n,
+                                                    gint               x,
+                                                    gint               y,
+                                                    gint               dx,
+                                                    gint               dy);
+static void       gimp_boundary_cache_generate     (GimpBoundaryCache *cache,
+                                                    gint               index);
+static void       gimp_boundary_cache_update_range (gsize              offset,
+                                                    gsize              size,
+                                                    UpdateData        *data);
+
+
+/*  public functions  */
+
+GimpBoundaryCache *
+gimp_boundary_cache_new (GeglBuffer    *buffer,
+                         GimpMaskTiles *mask_tiles)
+{
+  GimpBoundaryCache *cache;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (mask_tiles != NULL, NULL);
+
+  cache = g_slice_new0 (GimpBoundaryCache);
+
+  cache->buffer     = g_object_ref (buffer);
+  cache->mask_tiles = mask_tiles;
+  cache->extent     = *gegl_buffer_get_extent (buffer);
+
+  gimp_mask_tiles_get_grid (mask_tiles, &cache->n_cols, &cache->n_rows);
+
+  cache->tiles = g_new0 (CacheTile, cache->n_cols * cache->n_rows);
+
+  return cache;
+}
+
+void
+gimp_boundary_cache_free (GimpBoundaryCache *cache)
+{
+  gint n_tiles;
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  n_tiles = cache->n_cols * cache->n_rows;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      g_free (cache->tiles[i].segs[GIMP_BOUNDARY_WITHIN_BOUNDS]);
+      g_free (cache->tiles[i].segs[GIMP_BOUNDARY_IGNORE_BOUNDS]);
+    }
+
+  g_free (cache->tiles);
+
+  g_object_unref (cache->buffer);
+
+  g_slice_free (GimpBoundaryCache, cache);
+}
+
+gint64
+gimp_boundary_cache_get_memsize (GimpBoundaryCache *cache)
+{
+  gint64 memsize;
+  gint   n_tiles;
+  gint   i;
+
+  g_return_val_if_fail (cache != NULL, 0);
+
+  n_tiles = cache->n_cols * cache->n_rows;
+
+  memsize = sizeof (GimpBoundaryCache) + n_tiles * sizeof (CacheTile);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      memsize += (cache->tiles[i].num_segs[GIMP_BOUNDARY_WITHIN_BOUNDS] +
+                  cache->tiles[i].num_segs[GIMP_BOUNDARY_IGNORE_BOUNDS]) *
+                 sizeof (GimpBoundSeg);
+    }
+
+  return memsize;
+}
+
+void
+gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                const GeglRectangle *rect)
+{
+  GeglRectangle area;
+  gint          col1, row1;
+  gint          col2, row2;
+  gint          row;
+  gint          col;
+
+  g_return_if_fail (cache != NULL);
+
+  if (! rect)
+    rect = &cache->extent;
+
+  /*  a changed pixel also changes the edges on its bottom and right
+   *  side, which may belong to the tiles below and to the right
+   */
+  area.x      = rect->x;
+  area.y      = rect->y;
+  area.width  = rect->width  + 1;
+  area.height = rect->height + 1;
+
+  if (! gimp_mask_tiles_get_range (cache->mask_tiles, &area,
+                                   &col1, &row1, &col2, &row2))
+    return;
+
+  for (row = row1; row < row2; row++)
+    {
+      for (col = col1; col < col2; col++)
+        cache->tiles[row * cache->n_cols + col].valid = FALSE;
+    }
+}
+
+void
+gimp_boundary_cache_update (GimpBoundaryCache   *cache,
+                            const GeglRectangle *clip)
+{
+  GeglRectangle  empty = { 0, };
+  gint          *indices;
+  gint           n_tiles;
+  gint           n_indices = 0;
+  gint           i;
+
+  g_return_if_fail (cache != NULL);
+  g_return_if_fail (clip != NULL);
+
+  if (gegl_rectangle_is_empty (clip))
+    clip = &empty;
+
+  if (! gegl_rectangle_equal (clip, &cache->clip))
+    {
+      cache->clip = *clip;
+
+      gimp_boundary_cache_invalidate (cache, NULL);
+    }
+
+  n_tiles = cache->n_cols * cache->n_rows;
+  indices = g_new (gint, n_tiles);
+
+  /*  mark the tiles valid before generating them, so that a change
+   *  coming in meanwhile invalidates them again
+   */
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (! cache->tiles[i].valid)
+        {
+          cache->tiles[i].valid = TRUE;
+
+          indices[n_indices++] = i;
+        }
+    }
+
+  if (n_indices > 0)
+    {
+      UpdateData data;
+
+      data.cache   = cache;
+      data.indices = indices;
+
+      gegl_parallel_distribute_range (
+        n_indices, 1,
+        (GeglParallelDistributeRangeFunc) gimp_boundary_cache_update_range,
+        &data);
+    }
+
+  g_free (indices);
+}
+
+GimpBoundSeg *
+gimp_boundary_cache_get_segs (GimpBoundaryCache   *cache,
+                              GimpBoundaryType     type,
+                              const GeglRectangle *area,
+                              gint                *num_segs)
+{
+  GimpBoundSeg  *segs;
+  GeglRectangle  rect;
+  gint           col1, row1;
+  gint           col2, row2;
+  gint           row;
+  gint           col;
+  gint           n = 0;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (num_segs != NULL, NULL);
+
+  *num_segs = 0;
+
+  if (! area)
+    area = &cache->extent;
+
+  /*  include the tiles owning the edges on the area's border  */
+  rect.x      = area->x - 1;
+  rect.y      = area->y - 1;
+  rect.width  = area->width  + 2;
+  rect.height = area->height + 2;
+
+  if (! gimp_mask_tiles_get_range (cache->mask_tiles, &rect,
+                                   &col1, &row1, &col2, &row2))
+    return NULL;
+
+  for (row = row1; row < row2; row++)
+    {
+      for (col = col1; col < col2; col++)
+        n += cache->tiles[row * cache->n_cols + col].num_segs[type];
+    }
+
+  if (n == 0)
+    return NULL;
+
+  segs = g_new (GimpBoundSeg, n);
+
+  for (row = row1; row < row2; row++)
+    {
+      for (col = col1; col < col2; col++)
+        {
+          const CacheTile *tile = &cache->tiles[row * cache->n_cols + col];
+
+          if (tile->num_segs[type] > 0)
+            {
+              memcpy (segs + *num_segs, tile->segs[type],
+                      tile->num_segs[type] * sizeof (GimpBoundSeg));
+
+              *num_segs += tile->num_segs[type];
+            }
+        }
+    }
+
+  return segs;
+}
+
+
+/*  private functions  */
+
+/*  returns the value all the tile's pixels have for the given type of
+ *  boundary, or -1 if it isn't known to be uniform
+ */
+static gint
+gimp_boundary_cache_get_uniform (GimpBoundaryCache *cache,
+                                 GimpBoundaryType   type,
+                                 gint               col,
+                                 gint               row)
+{
+  GimpMaskTileState state;
+  GeglRectangle     area;
+  gboolean          inside;
+  gboolean          outside;
+
+  /*  everything outside the mask is unselected  */
+  if (col < 0 || col >= cache->n_cols ||
+      row < 0 || row >= cache->n_rows)
+    {
+      return 0;
+    }
+
+  state = gimp_mask_tiles_get_tile (cache->mask_tiles, col, row, &area);
+
+  if (state == GIMP_MASK_TILE_EMPTY)
+    return 0;
+  else if (state == GIMP_MASK_TILE_UNKNOWN)
+    return -1;
+
+  inside  = gegl_rectangle_contains (&cache->clip, &area);
+  outside = ! gegl_rectangle_intersect (NULL, &cache->clip, &area);
+
+  if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      gboolean tmp = inside;
+
+      inside  = outside;
+      outside = tmp;
+    }
+
+  if (outside)
+    return 0;
+  else if (inside && state == GIMP_MASK_TILE_FULL)
+    return 1;
+
+  return -1;
+}
+
+/*  adds the edges between the n pixel pairs a[i * stride], b[i * stride]
+ *  as segments starting at (x, y) and advancing by (dx, dy), merging
+ *  runs of edges with the same side open
+ */
+static void
+gimp_boundary_cache_add_runs (GArray       *segs,
+                              const guchar *a,
+                              const guchar *b,
+                              gint          stride,
+                              gint          n,
+                              gint          x,
+                              gint          y,
+                              gint          dx,
+                              gint          dy)
+{
+  gint start = -1;
+  gint open  = 0;
+  gint i;
+
+  for (i = 0; i <= n; i++)
+    {
+      gboolean edge = (i < n && a[i * stride] != b[i * stride]);
+
+      if (start >= 0 && (! edge || b[i * stride] != open))
+        {
+          GimpBoundSeg seg = { 0, };
+
+          seg.x1   = x + start * dx;
+          seg.y1   = y + start * dy;
+          seg.x2   = x + i * dx;
+          seg.y2   = y + i * dy;
+          seg.open = open;
+
+          g_array_append_val (segs, seg);
+
+          start = -1;
+        }
+
+      if (edge && start < 0)
+        {
+          start = i;
+          open  = b[i * stride];
+        }
+    }
+}
+
+static void
+gimp_boundary_cache_generate (GimpBoundaryCache *cache,
+                              gint               index)
+{
+  CacheTile     *tile = &cache->tiles[index];
+  gint           col  = index % cache->n_cols;
+  gint           row  = index / cache->n_cols;
+  GeglRectangle  area;
+  GeglRectangle  rect;
+  gboolean       last_col;
+  gboolean       last_row;
+  gboolean       need[2];
+  gfloat        *src;
+  guchar        *values;
+  gint           type;
+
+  for (type = GIMP_BOUNDARY_WITHIN_BOUNDS;
+       type <= GIMP_BOUNDARY_IGNORE_BOUNDS;
+       type++)
+    {
+      g_clear_pointer (&tile->segs[type], g_free);
+      tile->num_segs[type] = 0;
+    }
+
+  gimp_mask_tiles_get_tile (cache->mask_tiles, col, row, &area);
+
+  last_col = (area.x + area.width  == cache->extent.x + cache->extent.width);
+  last_row = (area.y + area.height == cache->extent.y + cache->extent.height);
+
+  /*  a uniform tile has no edges unless its neighbors above and to the
+   *  left, or the outside of the mask below and to the right, differ
+   */
+  for (type = GIMP_BOUNDARY_WITHIN_BOUNDS;
+       type <= GIMP_BOUNDARY_IGNORE_BOUNDS;
+       type++)
+    {
+      gint value = gimp_boundary_cache_get_uniform (cache, type, col, row);
+      gint above = gimp_boundary_cache_get_uniform (cache, type, col, row - 1);
+      gint left  = gimp_boundary_cache_get_uniform (cache, type, col - 1, row);
+
+      need[type] = (value < 0      ||
+                    value != above ||
+                    value != left  ||
+                    (value != 0 && (last_col || last_row)));
+    }
+
+  if (! need[GIMP_BOUNDARY_WITHIN_BOUNDS] &&
+      ! need[GIMP_BOUNDARY_IGNORE_BOUNDS])
+    {
+      return;
+    }
+
+  /*  read the tile along with the pixels around it; the ones outside
+   *  the buffer read as unselected
+   */
+  rect.x      = area.x - 1;
+  rect.y      = area.y - 1;
+  rect.width  = area.width  + 2;
+  rect.height = area.height + 2;
+
+  src    = g_new (gfloat, rect.width * rect.height);
+  values = g_new (guchar, rect.width * rect.height);
+
+  gegl_buffer_get (cache->buffer, &rect, 1.0, babl_format ("Y float"), src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (type = GIMP_BOUNDARY_WITHIN_BOUNDS;
+       type <= GIMP_BOUNDARY_IGNORE_BOUNDS;
+       type++)
+    {
+      const GeglRectangle *clip = &cache->clip;
+      GArray              *segs;
+      gint                 x;
+      gint                 y;
+      gint                 i = 0;
+
+      if (! need[type])
+        continue;
+
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        {
+          gboolean row_inside = (y >= clip->y && y < clip->y + clip->height);
+
+          for (x = rect.x; x < rect.x + rect.width; x++, i++)
+            {
+              gboolean inside = (row_inside &&
+                                 x >= clip->x && x < clip->x + clip->width);
+
+              if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+                inside = ! inside;
+
+              values[i] = (inside && src[i] > GIMP_BOUNDARY_HALF_WAY);
+            }
+        }
+
+      segs = g_array_new (FALSE, FALSE, sizeof (GimpBoundSeg));
+
+      /*  horizontal edges, between each pixel and the one above it  */
+      for (y = area.y; y < area.y + area.height + last_row; y++)
+        {
+          const guchar *below = values + (y - rect.y) * rect.width + 1;
+
+          gimp_boundary_cache_add_runs (segs,
+                                        below - rect.width, below, 1,
+                                        area.width,
+                                        area.x, y, 1, 0);
+        }
+
+      /*  vertical edges, between each pixel and the one to its left  */
+      for (x = area.x; x < area.x + area.width + last_col; x++)
+        {
+          const guchar *right = values + rect.width + (x - rect.x);
+
+          gimp_boundary_cache_add_runs (segs,
+                                        right - 1, right, rect.width,
+                                        area.height,
+                                        x, area.y, 0, 1);
+        }
+
+      tile->num_segs[type] = segs->len;
+      tile->segs[type]     = (GimpBoundSeg *) g_array_free (segs,
+                                                            segs->len == 0);
+    }
+
+  g_free (values);
+  g_free (src);
+}
+
+static void
+gimp_boundary_cache_update_range (gsize       offset,
+                                  gsize       size,
+                                  UpdateData *data)
+{
+  for (; size; offset++, size--)
+    gimp_boundary_cache_generate (data->cache, data->indices[offset]);
+}
@@ -0,0 +1,57 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpboundary-cache.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_BOUNDARY_CACHE_H__
+#define __GIMP_BOUNDARY_CACHE_H__
+
+
+/*  GimpBoundaryCache keeps the boundary segments of a mask per tile of
+ *  the mask's GimpMaskTiles grid, so that only the tiles touched by a
+ *  change need their segments regenerated, and so that the segments of
+ *  an area can be looked up without walking the whole boundary.
+ *
+ *  Each tile owns the pixel edges on its top and left side and in its
+ *  interior, and those on its bottom and right side where it borders
+ *  the mask's extent.  Segments are not sorted.
+ *
+ *  The GIMP_BOUNDARY_WITHIN_BOUNDS segments outline the part of the
+ *  mask inside the clip rectangle, the GIMP_BOUNDARY_IGNORE_BOUNDS
+ *  segments the part outside of it, matching what gimp_boundary_find()
+ *  returns for the same clip.
+ */
+
+
+GimpBoundaryCache * gimp_boundary_cache_new         (GeglBuffer          *buffer,
+                                                     GimpMaskTiles       *mask_tiles);
+void                gimp_boundary_cache_free        (GimpBoundaryCache   *cache);
+
+gint64              gimp_boundary_cache_get_memsize (GimpBoundaryCache   *cache);
+
+void                gimp_boundary_cache_invalidate  (GimpBoundaryCache   *cache,
+                                                     const GeglRectangle *rect);
+void                gimp_boundary_cache_update      (GimpBoundaryCache   *cache,
+                                                     const GeglRectangle *clip);
+
+GimpBoundSeg      * gimp_boundary_cache_get_segs    (GimpBoundaryCache   *cache,
+                                                     GimpBoundaryType     type,
+                                                     const GeglRectangle *area,
+                                                     gint                *num_segs);
+
+
+#endif /* __GIMP_BOUNDARY_CACHE_H__ */
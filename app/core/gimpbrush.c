@@ -448,13 +448,19 @@ static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
   brush->priv->mask_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          (GimpBrushCacheMemsizeFunc) gimp_temp_buf_get_memsize,
+                          'M', 'm');
 
   brush->priv->pixmap_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          (GimpBrushCacheMemsizeFunc) gimp_temp_buf_get_memsize,
+                          'P', 'p');
 
   brush->priv->boundary_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free,
+                          (GimpBrushCacheMemsizeFunc) gimp_bezier_desc_get_memsize,
+                          'B', 'b');
 }
 
 static void
@@ -22,6 +22,8 @@
 
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "core-types.h"
 
 #include "gimpbrushcache.h"
@@ -30,13 +32,18 @@
 #include "gimp-intl.h"
 
 
-#define MAX_CACHED_DATA 20
+/*  the number of units which are kept regardless of the memory budget,
+ *  as many as the cache used to hold in total, so that a small budget
+ *  doesn't make alternating dynamics miss on every dab
+ */
+#define MIN_CACHED_DATA 20
 
 
 enum
 {
   PROP_0,
-  PROP_DATA_DESTROY
+  PROP_DATA_DESTROY,
+  PROP_DATA_MEMSIZE
 };
 
 
@@ -45,6 +52,8 @@ typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
 struct _GimpBrushCacheUnit
 {
   gpointer  data;
+  gsize     memsize;
+  GList     link;
 
   gint      width;
   gint      height;
@@ -57,16 +66,24 @@ struct _GimpBrushCacheUnit
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void       gimp_brush_cache_constructed  (GObject            *object);
+static void       gimp_brush_cache_finalize     (GObject            *object);
+static void       gimp_brush_cache_set_property (GObject            *object,
+                                                 guint               property_id,
+                                                 const GValue       *value,
+                                                 GParamSpec         *pspec);
+static void       gimp_brush_cache_get_property (GObject            *object,
+                                                 guint               property_id,
+                                                 GValue             *value,
+                                                 GParamSpec         *pspec);
+
+static void       gimp_brush_cache_remove_unit  (GimpBrushCache     *cache,
+                                                 GimpBrushCacheUnit *unit);
+
+static guint      gimp_brush_cache_hash_double  (gdouble             value);
+static guint      gimp_brush_cache_unit_hash    (gconstpointer       data);
+static gboolean   gimp_brush_cache_unit_equal   (gconstpointer       data1,
+                                                 gconstpointer       data2);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -74,6 +91,14 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 #define parent_class gimp_brush_cache_parent_class
 
 
+static guintptr gimp_brush_cache_max_memsize   = 1 << 24;
+static gdouble  gimp_brush_cache_tolerance     = 0.0;
+
+static guintptr gimp_brush_cache_total_memsize = 0;
+static gint     gimp_brush_cache_n_hits        = 0;
+static gint     gimp_brush_cache_n_misses      = 0;
+
+
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
@@ -89,11 +114,21 @@ gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
                                                          NULL, NULL,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DATA_MEMSIZE,
+                                   g_param_spec_pointer ("data-memsize",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
-gimp_brush_cache_init (GimpBrushCache *brush)
+gimp_brush_cache_init (GimpBrushCache *cache)
 {
+  cache->cached_units = g_hash_table_new (gimp_brush_cache_unit_hash,
+                                          gimp_brush_cache_unit_equal);
+
+  g_queue_init (&cache->lru);
 }
 
 static void
@@ -104,6 +139,7 @@ gimp_brush_cache_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   gimp_assert (cache->data_destroy != NULL);
+  gimp_assert (cache->data_memsize != NULL);
 }
 
 static void
@@ -113,6 +149,8 @@ gimp_brush_cache_finalize (GObject *object)
 
   gimp_brush_cache_clear (cache);
 
+  g_clear_pointer (&cache->cached_units, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -130,6 +168,10 @@ gimp_brush_cache_set_property (GObject      *object,
       cache->data_destroy = g_value_get_pointer (value);
       break;
 
+    case PROP_DATA_MEMSIZE:
+      cache->data_memsize = g_value_get_pointer (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -150,6 +192,10 @@ gimp_brush_cache_get_property (GObject    *object,
       g_value_set_pointer (value, cache->data_destroy);
       break;
 
+    case PROP_DATA_MEMSIZE:
+      g_value_set_pointer (value, cache->data_memsize);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -160,16 +206,19 @@ gimp_brush_cache_get_property (GObject    *object,
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify             data_destroy,
+                      GimpBrushCacheMemsizeFunc  data_memsize,
+                      gchar                      debug_hit,
+                      gchar                      debug_miss)
 {
   GimpBrushCache *cache;
 
   g_return_val_if_fail (data_destroy != NULL, NULL);
+  g_return_val_if_fail (data_memsize != NULL, NULL);
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
                          "data-destroy", data_destroy,
+                         "data-memsize", data_memsize,
                          NULL);
 
   cache->debug_hit  = debug_hit;
@@ -183,20 +232,8 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->cached_units)
-    {
-      GList *iter;
-
-      for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-        {
-          GimpBrushCacheUnit *unit = iter->data;
-
-          cache->data_destroy (unit->data);
-        }
-
-      g_list_free_full (cache->cached_units, g_free);
-      cache->cached_units = NULL;
-    }
+  while (cache->lru.head)
+    gimp_brush_cache_remove_unit (cache, cache->lru.head->data);
 }
 
 gconstpointer
@@ -210,41 +247,41 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList *iter;
+  GimpBrushCacheUnit  key;
+  GimpBrushCacheUnit *unit;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  key.width        = width;
+  key.height       = height;
+  key.scale        = scale;
+  key.aspect_ratio = aspect_ratio;
+  key.angle        = angle;
+  key.reflect      = reflect;
+  key.hardness     = hardness;
+  key.op           = op;
+
+  unit = g_hash_table_lookup (cache->cached_units, &key);
+
+  if (unit)
     {
-      GimpBrushCacheUnit *unit = iter->data;
-
-      if (unit->data                         &&
-          unit->width        == width        &&
-          unit->height       == height       &&
-          unit->scale        == scale        &&
-          unit->aspect_ratio == aspect_ratio &&
-          unit->angle        == angle        &&
-          unit->reflect      == reflect      &&
-          unit->hardness     == hardness     &&
-          unit->op           == op)
-        {
-          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-            g_printerr ("%c", cache->debug_hit);
+      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+        g_printerr ("%c", cache->debug_hit);
 
-          /* Make the returned cached brush first in the list. */
-          cache->cached_units = g_list_remove_link (cache->cached_units, iter);
-          iter->next = cache->cached_units;
-          if (cache->cached_units)
-            cache->cached_units->prev = iter;
-          cache->cached_units = iter;
+      g_atomic_int_inc (&gimp_brush_cache_n_hits);
 
-          return (gconstpointer) unit->data;
-        }
+      /* Make the returned cached brush first in the list. */
+      g_queue_unlink (&cache->lru, &unit->link);
+      g_queue_push_head_link (&cache->lru, &unit->link);
+
+      return (gconstpointer) unit->data;
     }
 
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
     g_printerr ("%c", cache->debug_miss);
 
+  g_atomic_int_inc (&gimp_brush_cache_n_misses);
+
   return NULL;
 }
 
@@ -260,37 +297,17 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList              *iter;
   GimpBrushCacheUnit *unit;
-  GList              *last   = NULL;
-  gint                length = 0;
+  GimpBrushCacheUnit *old;
 
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-    {
-      unit = iter->data;
-
-      if (data == unit->data)
-        return;
-
-      length++;
-      last = iter;
-    }
-
-  if (length > MAX_CACHED_DATA)
-    {
-      unit = last->data;
-
-      cache->data_destroy (unit->data);
-      cache->cached_units = g_list_delete_link (cache->cached_units, last);
-      g_free (unit);
-    }
-
-  unit = g_new0 (GimpBrushCacheUnit, 1);
+  unit = g_slice_new0 (GimpBrushCacheUnit);
 
   unit->data         = data;
+  unit->memsize      = sizeof (GimpBrushCacheUnit) + cache->data_memsize (data);
+  unit->link.data    = unit;
   unit->width        = width;
   unit->height       = height;
   unit->scale        = scale;
@@ -300,5 +317,157 @@ gimp_brush_cache_add (GimpBrushCache *cache,
   unit->hardness     = hardness;
   unit->op           = op;
 
-  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  /*  replace an older unit with the same key, if there is any  */
+  old = g_hash_table_lookup (cache->cached_units, unit);
+
+  if (old)
+    {
+      if (old->data == data)
+        {
+          g_slice_free (GimpBrushCacheUnit, unit);
+
+          return;
+        }
+
+      gimp_brush_cache_remove_unit (cache, old);
+    }
+
+  g_hash_table_add (cache->cached_units, unit);
+  g_queue_push_head_link (&cache->lru, &unit->link);
+
+  cache->memsize += unit->memsize;
+  g_atomic_pointer_add (&gimp_brush_cache_total_memsize,
+                        +unit->memsize);
+
+  /*  drop the least recently used units until we are within budget,
+   *  but always keep the last MIN_CACHED_DATA, our callers might still
+   *  use them
+   */
+  while (cache->memsize > gimp_brush_cache_max_memsize &&
+         cache->lru.length > MIN_CACHED_DATA)
+    {
+      gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
+    }
+}
+
+void
+gimp_brush_cache_quantize (gdouble *scale,
+                           gdouble *aspect_ratio,
+                           gdouble *angle,
+                           gdouble *hardness)
+{
+  gdouble tolerance = gimp_brush_cache_tolerance;
+
+  g_return_if_fail (scale != NULL && aspect_ratio != NULL);
+  g_return_if_fail (angle != NULL && hardness != NULL);
+
+  if (tolerance <= 0.0)
+    return;
+
+  /*  quantize around each parameter's neutral value, so that the
+   *  untransformed brush is still matched exactly
+   */
+  if (*scale > 0.0)
+    *scale = exp (RINT (log (*scale) / tolerance) * tolerance);
+
+  *aspect_ratio = RINT (*aspect_ratio / (20.0 * tolerance)) * 20.0 * tolerance;
+  *aspect_ratio = CLAMP (*aspect_ratio, -20.0, 20.0);
+
+  *angle        = RINT (*angle / tolerance) * tolerance;
+
+  *hardness     = 1.0 - RINT ((1.0 - *hardness) / tolerance) * tolerance;
+  *hardness     = CLAMP (*hardness, 0.0, 1.0);
+}
+
+
+/*  public functions (settings and stats)  */
+
+void
+gimp_brush_cache_set_limits (guint64 max_memsize,
+                             gdouble tolerance)
+{
+  gimp_brush_cache_max_memsize = MIN (max_memsize, G_MAXSIZE);
+  gimp_brush_cache_tolerance   = MAX (tolerance, 0.0);
+}
+
+guint64
+gimp_brush_cache_get_total_memsize (void)
+{
+  return gimp_brush_cache_total_memsize;
+}
+
+gint
+gimp_brush_cache_get_n_hits (void)
+{
+  return g_atomic_int_get (&gimp_brush_cache_n_hits);
+}
+
+gint
+gimp_brush_cache_get_n_misses (void)
+{
+  return g_atomic_int_get (&gimp_brush_cache_n_misses);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_brush_cache_remove_unit (GimpBrushCache     *cache,
+                              GimpBrushCacheUnit *unit)
+{
+  g_hash_table_remove (cache->cached_units, unit);
+  g_queue_unlink (&cache->lru, &unit->link);
+
+  cache->memsize -= unit->memsize;
+  g_atomic_pointer_add (&gimp_brush_cache_total_memsize,
+                        -unit->memsize);
+
+  cache->data_destroy (unit->data);
+
+  g_slice_free (GimpBrushCacheUnit, unit);
+}
+
+static guint
+gimp_brush_cache_hash_double (gdouble value)
+{
+  /*  make 0.0 and -0.0, which compare equal, hash equally  */
+  if (value == 0.0)
+    value = 0.0;
+
+  return g_double_hash (&value);
+}
+
+static guint
+gimp_brush_cache_unit_hash (gconstpointer data)
+{
+  const GimpBrushCacheUnit *unit = data;
+  guint                     hash;
+
+  hash = unit->width;
+  hash = hash * 31 + unit->height;
+  hash = hash * 31 + gimp_brush_cache_hash_double (unit->scale);
+  hash = hash * 31 + gimp_brush_cache_hash_double (unit->aspect_ratio);
+  hash = hash * 31 + gimp_brush_cache_hash_double (unit->angle);
+  hash = hash * 31 + gimp_brush_cache_hash_double (unit->hardness);
+  hash = hash * 31 + (unit->reflect ? 1 : 0);
+  hash = hash * 31 + g_direct_hash (unit->op);
+
+  return hash;
+}
+
+static gboolean
+gimp_brush_cache_unit_equal (gconstpointer data1,
+                             gconstpointer data2)
+{
+  const GimpBrushCacheUnit *unit1 = data1;
+  const GimpBrushCacheUnit *unit2 = data2;
+
+  return (unit1->width        == unit2->width        &&
+          unit1->height       == unit2->height       &&
+          unit1->scale        == unit2->scale        &&
+          unit1->aspect_ratio == unit2->aspect_ratio &&
+          unit1->angle        == unit2->angle        &&
+          ! unit1->reflect    == ! unit2->reflect    &&
+          unit1->hardness     == unit2->hardness     &&
+          unit1->op           == unit2->op);
 }
@@ -35,16 +35,21 @@
 
 typedef struct _GimpBrushCacheClass GimpBrushCacheClass;
 
+typedef gsize (* GimpBrushCacheMemsizeFunc) (gconstpointer data);
+
 struct _GimpBrushCache
 {
-  GimpObject      parent_instance;
+  GimpObject                 parent_instance;
 
-  GDestroyNotify  data_destroy;
+  GDestroyNotify             data_destroy;
+  GimpBrushCacheMemsizeFunc  data_memsize;
 
-  GList          *cached_units;
+  GHashTable                *cached_units;
+  GQueue                     lru;
+  gsize                      memsize;
 
-  gchar           debug_hit;
-  gchar           debug_miss;
+  gchar                      debug_hit;
+  gchar                      debug_miss;
 };
 
 struct _GimpBrushCacheClass
@@ -55,9 +60,10 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void) G_GNUC_CONST;
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
-                                            gchar           debug_hit,
-                                            gchar           debug_miss);
+GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify             data_destroy,
+                                            GimpBrushCacheMemsizeFunc  data_memsize,
+                                            gchar                      debug_hit,
+                                            gchar                      debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
@@ -81,5 +87,20 @@ void             gimp_brush_cache_add      (GimpBrushCache *cache,
                                             gboolean        reflect,
                                             gdouble         hardness);
 
+void             gimp_brush_cache_quantize (gdouble        *scale,
+                                            gdouble        *aspect_ratio,
+                                            gdouble        *angle,
+                                            gdouble        *hardness);
+
+
+/*  global settings and stats  */
+
+void             gimp_brush_cache_set_limits       (guint64  max_memsize,
+                                                    gdouble  tolerance);
+
+guint64          gimp_brush_cache_get_total_memsize (void);
+gint             gimp_brush_cache_get_n_hits        (void);
+gint             gimp_brush_cache_get_n_misses      (void);
+
 
 #endif  /*  __GIMP_BRUSH_CACHE_H__  */
@@ -29,6 +29,7 @@
 
 #include "gegl/gimp-gegl-mask-combine.h"
 #include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimpmasktiles.h"
 
 #include "gimpchannel.h"
 #include "gimpchannel-combine.h"
@@ -124,6 +125,11 @@ gimp_channel_combine_clear (GimpChannel         *mask,
 
   gegl_buffer_clear (buffer, &area);
 
+  /*  the buffer's "changed" signal is frozen while combining, keep the
+   *  tile states valid for the combine operation
+   */
+  gimp_mask_tiles_fill (mask->tiles, &area, GIMP_MASK_TILE_EMPTY);
+
   gimp_drawable_update (GIMP_DRAWABLE (mask),
                         update_area.x, update_area.y,
                         update_area.width, update_area.height);
@@ -330,6 +336,12 @@ gimp_channel_combine_end (GimpChannel            *mask,
 
   gegl_buffer_thaw_changed (buffer);
 
+  /*  thawing invalidated the combined area, an empty result can be
+   *  told without rescanning it
+   */
+  if (data->bounds_known && data->empty)
+    gimp_mask_tiles_fill (mask->tiles, NULL, GIMP_MASK_TILE_EMPTY);
+
   mask->bounds_known = data->bounds_known;
 
   if (data->bounds_known)
@@ -381,6 +393,27 @@ gimp_channel_combine_rect (GimpChannel    *mask,
     }
 
   gimp_channel_combine_end (mask, &data);
+
+  /*  the tiles inside the rectangle are known to be empty or full now  */
+  switch (op)
+    {
+    case GIMP_CHANNEL_OP_REPLACE:
+      gimp_mask_tiles_fill (mask->tiles, NULL, GIMP_MASK_TILE_EMPTY);
+      /*  fallthrough  */
+
+    case GIMP_CHANNEL_OP_ADD:
+      gimp_mask_tiles_fill (mask->tiles, GEGL_RECTANGLE (x, y, w, h),
+                            GIMP_MASK_TILE_FULL);
+      break;
+
+    case GIMP_CHANNEL_OP_SUBTRACT:
+      gimp_mask_tiles_fill (mask->tiles, GEGL_RECTANGLE (x, y, w, h),
+                            GIMP_MASK_TILE_EMPTY);
+      break;
+
+    case GIMP_CHANNEL_OP_INTERSECT:
+      break;
+    }
 }
 
 void
@@ -416,7 +449,8 @@ gimp_channel_combine_ellipse_rect (GimpChannel    *mask,
     {
       GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
 
-      gimp_gegl_mask_combine_ellipse_rect (buffer, op, x, y, w, h,
+      gimp_gegl_mask_combine_ellipse_rect (buffer, mask->tiles,
+                                           op, x, y, w, h,
                                            rx, ry, antialias);
     }
 
@@ -463,7 +497,8 @@ gimp_channel_combine_buffer (GimpChannel    *mask,
     {
       GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
 
-      gimp_gegl_mask_combine_buffer (buffer, add_on_buffer, op,
+      gimp_gegl_mask_combine_buffer (buffer, mask->tiles,
+                                     add_on_buffer, op,
                                      off_x, off_y);
     }
 
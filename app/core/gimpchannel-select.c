@@ -175,7 +175,8 @@ gimp_channel_select_round_rect (GimpChannel         *channel,
                                                 gimp_item_get_height (item)),
                                 babl_format ("Y float"));
 
-      gimp_gegl_mask_combine_ellipse_rect (add_on, GIMP_CHANNEL_OP_REPLACE,
+      gimp_gegl_mask_combine_ellipse_rect (add_on, NULL,
+                                           GIMP_CHANNEL_OP_REPLACE,
                                            x, y, w, h,
                                            corner_radius_x, corner_radius_y,
                                            antialias);
@@ -337,7 +338,7 @@ gimp_channel_select_buffer (GimpChannel    *channel,
                                                  gimp_item_get_height (item)),
                                  babl_format ("Y float"));
 
-      gimp_gegl_mask_combine_buffer (add_on2, add_on,
+      gimp_gegl_mask_combine_buffer (add_on2, NULL, add_on,
                                      GIMP_CHANNEL_OP_REPLACE,
                                      offset_x, offset_y);
 
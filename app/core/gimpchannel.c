@@ -34,13 +34,14 @@
 
 #include "gegl/gimp-gegl-apply-operation.h"
 #include "gegl/gimp-gegl-loops.h"
-#include "gegl/gimp-gegl-mask.h"
 #include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimpmasktiles.h"
 
 #include "gimp.h"
 #include "gimp-utils.h"
 #include "gimpboundary.h"
+#include "gimpboundary-cache.h"
 #include "gimpcontainer.h"
 #include "gimperror.h"
 #include "gimpimage.h"
@@ -217,6 +218,11 @@ static void      gimp_channel_buffer_changed (GeglBuffer          *buffer,
                                               const GeglRectangle *rect,
                                               GimpChannel         *channel);
 
+static GimpBoundSeg * gimp_channel_cull_segs (const GimpBoundSeg  *segs,
+                                              gint                 num_segs,
+                                              const GeglRectangle *area,
+                                              gint                *num_culled);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpChannel, gimp_channel, GIMP_TYPE_DRAWABLE,
                          G_IMPLEMENT_INTERFACE (GIMP_TYPE_PICKABLE,
@@ -335,6 +341,8 @@ gimp_channel_init (GimpChannel *channel)
   channel->y1             = 0;
   channel->x2             = 0;
   channel->y2             = 0;
+  channel->tiles          = NULL;
+  channel->boundary_cache = NULL;
 }
 
 static void
@@ -360,6 +368,18 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  if (channel->boundary_cache)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache);
+      channel->boundary_cache = NULL;
+    }
+
+  if (channel->tiles)
+    {
+      gimp_mask_tiles_free (channel->tiles);
+      channel->tiles = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -368,11 +388,19 @@ gimp_channel_get_memsize (GimpObject *object,
                           gint64     *gui_size)
 {
   GimpChannel *channel = GIMP_CHANNEL (object);
+  gint64       memsize = 0;
 
   *gui_size += channel->num_segs_in  * sizeof (GimpBoundSeg);
   *gui_size += channel->num_segs_out * sizeof (GimpBoundSeg);
 
-  return GIMP_OBJECT_CLASS (parent_class)->get_memsize (object, gui_size);
+  if (channel->tiles)
+    memsize += gimp_mask_tiles_get_memsize (channel->tiles);
+
+  if (channel->boundary_cache)
+    *gui_size += gimp_boundary_cache_get_memsize (channel->boundary_cache);
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
 }
 
 static gchar *
@@ -487,13 +515,11 @@ gimp_channel_bounds (GimpItem *item,
 
   if (! channel->bounds_known)
     {
-      GeglBuffer *buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
-
-      channel->empty = ! gimp_gegl_mask_bounds (buffer,
-                                                &channel->x1,
-                                                &channel->y1,
-                                                &channel->x2,
-                                                &channel->y2);
+      channel->empty = ! gimp_mask_tiles_bounds (channel->tiles,
+                                                 &channel->x1,
+                                                 &channel->y1,
+                                                 &channel->x2,
+                                                 &channel->y2);
 
       channel->bounds_known = TRUE;
     }
@@ -1029,6 +1055,15 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
                                                   buffer,
                                                   offset_x, offset_y);
 
+  if (channel->boundary_cache)
+    gimp_boundary_cache_free (channel->boundary_cache);
+
+  if (channel->tiles)
+    gimp_mask_tiles_free (channel->tiles);
+
+  channel->tiles          = gimp_mask_tiles_new (buffer);
+  channel->boundary_cache = gimp_boundary_cache_new (buffer, channel->tiles);
+
   gegl_buffer_signal_connect (buffer, "changed",
                               G_CALLBACK (gimp_channel_buffer_changed),
                               channel);
@@ -1096,39 +1131,21 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 
       if (gimp_item_bounds (GIMP_ITEM (channel), &x3, &y3, &x4, &y4))
         {
-          GeglBuffer    *buffer;
-          GeglRectangle  rect = { x3, y3, x4, y4 };
-
-          x4 += x3;
-          y4 += y3;
-
-          buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
-
-          channel->segs_out = gimp_boundary_find (buffer, &rect,
-                                                  babl_format ("Y float"),
-                                                  GIMP_BOUNDARY_IGNORE_BOUNDS,
-                                                  x1, y1, x2, y2,
-                                                  GIMP_BOUNDARY_HALF_WAY,
-                                                  &channel->num_segs_out);
-          x1 = MAX (x1, x3);
-          y1 = MAX (y1, y3);
-          x2 = MIN (x2, x4);
-          y2 = MIN (y2, y4);
-
-          if (x2 > x1 && y2 > y1)
-            {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY,
-                                                     &channel->num_segs_in);
-            }
-          else
-            {
-              channel->segs_in     = NULL;
-              channel->num_segs_in = 0;
-            }
+          GeglRectangle clip = { x1, y1, x2 - x1, y2 - y1 };
+
+          /*  only the tiles which changed since the last time, or all
+           *  of them if the clip did, are regenerated
+           */
+          gimp_boundary_cache_update (channel->boundary_cache, &clip);
+
+          channel->segs_out =
+            gimp_boundary_cache_get_segs (channel->boundary_cache,
+                                          GIMP_BOUNDARY_IGNORE_BOUNDS, NULL,
+                                          &channel->num_segs_out);
+          channel->segs_in =
+            gimp_boundary_cache_get_segs (channel->boundary_cache,
+                                          GIMP_BOUNDARY_WITHIN_BOUNDS, NULL,
+                                          &channel->num_segs_in);
         }
       else
         {
@@ -1152,14 +1169,10 @@ gimp_channel_real_boundary (GimpChannel         *channel,
 static gboolean
 gimp_channel_real_is_empty (GimpChannel *channel)
 {
-  GeglBuffer *buffer;
-
   if (channel->bounds_known)
     return channel->empty;
 
-  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
-
-  if (! gimp_gegl_mask_is_empty (buffer))
+  if (! gimp_mask_tiles_is_empty (channel->tiles))
     return FALSE;
 
   /*  The mask is empty, meaning we can set the bounds as known  */
@@ -1282,7 +1295,9 @@ gimp_channel_real_clear (GimpChannel *channel,
 
   gegl_buffer_clear (buffer, &aligned_rect);
 
-  /*  we know the bounds  */
+  /*  we know the bounds, and the state of every tile  */
+  gimp_mask_tiles_fill (channel->tiles, NULL, GIMP_MASK_TILE_EMPTY);
+
   channel->bounds_known = TRUE;
   channel->empty        = TRUE;
   channel->x1           = 0;
@@ -1298,19 +1313,20 @@ static void
 gimp_channel_real_all (GimpChannel *channel,
                        gboolean     push_undo)
 {
-  GeglColor *color;
+  gfloat one = 1.0f;
 
   if (push_undo)
     gimp_channel_push_undo (channel,
                             GIMP_CHANNEL_GET_CLASS (channel)->all_desc);
 
-  /*  clear the channel  */
-  color = gegl_color_new ("#fff");
-  gegl_buffer_set_color (gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                         NULL, color);
-  g_object_unref (color);
+  /*  fill the channel with exactly 1.0, which is what full tiles hold  */
+  gegl_buffer_set_color_from_pixel (
+    gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
+    NULL, &one, babl_format ("Y float"));
+
+  /*  we know the bounds, and the state of every tile  */
+  gimp_mask_tiles_fill (channel->tiles, NULL, GIMP_MASK_TILE_FULL);
 
-  /*  we know the bounds  */
   channel->bounds_known = TRUE;
   channel->empty        = FALSE;
   channel->x1           = 0;
@@ -1559,9 +1575,44 @@ gimp_channel_buffer_changed (GeglBuffer          *buffer,
                              const GeglRectangle *rect,
                              GimpChannel         *channel)
 {
+  gimp_mask_tiles_invalidate (channel->tiles, rect);
+  gimp_boundary_cache_invalidate (channel->boundary_cache, rect);
+
   gimp_drawable_invalidate_boundary (GIMP_DRAWABLE (channel));
 }
 
+static GimpBoundSeg *
+gimp_channel_cull_segs (const GimpBoundSeg  *segs,
+                        gint                 num_segs,
+                        const GeglRectangle *area,
+                        gint                *num_culled)
+{
+  GimpBoundSeg *culled;
+  gint          i;
+
+  *num_culled = 0;
+
+  if (num_segs == 0)
+    return NULL;
+
+  culled = g_new (GimpBoundSeg, num_segs);
+
+  for (i = 0; i < num_segs; i++)
+    {
+      const GimpBoundSeg *seg = &segs[i];
+
+      if (MAX (seg->x1, seg->x2) >= area->x                 &&
+          MIN (seg->x1, seg->x2) <= area->x + area->width   &&
+          MAX (seg->y1, seg->y2) >= area->y                 &&
+          MIN (seg->y1, seg->y2) <= area->y + area->height)
+        {
+          culled[(*num_culled)++] = *seg;
+        }
+    }
+
+  return culled;
+}
+
 
 /*  public functions  */
 
@@ -1888,6 +1939,64 @@ gimp_channel_boundary (GimpChannel         *channel,
                                                      x2, y2);
 }
 
+/*  returns newly allocated copies of the segments which
+ *  gimp_channel_boundary() returns for an empty clip, limited to (at
+ *  least) those touching @area.
+ */
+gboolean
+gimp_channel_boundary_area (GimpChannel          *channel,
+                            const GeglRectangle  *area,
+                            GimpBoundSeg        **segs_in,
+                            GimpBoundSeg        **segs_out,
+                            gint                 *num_segs_in,
+                            gint                 *num_segs_out)
+{
+  const GimpBoundSeg *all_in;
+  const GimpBoundSeg *all_out;
+  gint                n_in;
+  gint                n_out;
+  gboolean            retval;
+
+  g_return_val_if_fail (GIMP_IS_CHANNEL (channel), FALSE);
+  g_return_val_if_fail (area != NULL, FALSE);
+  g_return_val_if_fail (segs_in != NULL, FALSE);
+  g_return_val_if_fail (segs_out != NULL, FALSE);
+  g_return_val_if_fail (num_segs_in != NULL, FALSE);
+  g_return_val_if_fail (num_segs_out != NULL, FALSE);
+
+  retval = gimp_channel_boundary (channel,
+                                  &all_in, &all_out,
+                                  &n_in, &n_out,
+                                  0, 0, 0, 0);
+
+  /*  subclasses may return segments of their own, which aren't in the
+   *  cache, like the selection does for floating selections
+   */
+  if (n_in > 0 && all_in == channel->segs_in)
+    {
+      *segs_in = gimp_boundary_cache_get_segs (channel->boundary_cache,
+                                               GIMP_BOUNDARY_WITHIN_BOUNDS,
+                                               area, num_segs_in);
+    }
+  else
+    {
+      *segs_in = gimp_channel_cull_segs (all_in, n_in, area, num_segs_in);
+    }
+
+  if (n_out > 0 && all_out == channel->segs_out)
+    {
+      *segs_out = gimp_boundary_cache_get_segs (channel->boundary_cache,
+                                                GIMP_BOUNDARY_IGNORE_BOUNDS,
+                                                area, num_segs_out);
+    }
+  else
+    {
+      *segs_out = gimp_channel_cull_segs (all_out, n_out, area, num_segs_out);
+    }
+
+  return retval;
+}
+
 gboolean
 gimp_channel_is_empty (GimpChannel *channel)
 {
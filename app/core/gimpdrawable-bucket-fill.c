@@ -197,7 +197,7 @@ gimp_drawable_get_bucket_fill_buffer (GimpDrawable         *drawable,
                                                       (gint) seed_y);
   if (mask_buffer && *mask_buffer)
     {
-      gimp_gegl_mask_combine_buffer (new_mask, *mask_buffer,
+      gimp_gegl_mask_combine_buffer (new_mask, NULL, *mask_buffer,
                                      GIMP_CHANNEL_OP_ADD, 0, 0);
       g_object_unref (*mask_buffer);
     }
@@ -374,7 +374,7 @@ gimp_drawable_get_line_art_fill_buffer (GimpDrawable     *drawable,
                                                           (gint) seed_y);
   if (mask_buffer && *mask_buffer)
     {
-      gimp_gegl_mask_combine_buffer (new_mask, *mask_buffer,
+      gimp_gegl_mask_combine_buffer (new_mask, NULL, *mask_buffer,
                                      GIMP_CHANNEL_OP_ADD, 0, 0);
       g_object_unref (*mask_buffer);
     }
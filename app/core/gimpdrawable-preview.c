@@ -411,7 +411,10 @@ gimp_drawable_get_sub_preview_async (GimpDrawable *drawable,
   scaled_x = RINT ((gdouble) src_x * scale);
   scaled_y = RINT ((gdouble) src_y * scale);
 
-  return gimp_parallel_run_async_full (
+  /*  previews only read the buffer, and are delivered independently of
+   *  each other, in whatever order they finish
+   */
+  return gimp_parallel_run_async_concurrent_full (
     +1,
     (GimpParallelRunAsyncFunc) gimp_drawable_get_sub_preview_async_func,
     sub_preview_data_new (
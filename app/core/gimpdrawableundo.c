@@ -17,17 +17,30 @@
 
 #include "config.h"
 
+#include <zlib.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
+#include <gegl-buffer-backend.h>
 
 #include "libgimpbase/gimpbase.h"
 
 #include "core-types.h"
 
+#include "gimp.h"
 #include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
 #include "gimpimage.h"
 #include "gimpdrawable.h"
 #include "gimpdrawableundo.h"
+#include "gimperror.h"
+
+#include "gimp-intl.h"
+
+
+/*  don't keep compressed data that saves less than 1/8 of the size  */
+#define MAX_COMPRESSION_RATIO 0.875
 
 
 enum
@@ -58,11 +71,24 @@ static void     gimp_drawable_undo_pop          (GimpUndo            *undo,
 static void     gimp_drawable_undo_free         (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode);
 
+static gint64   gimp_drawable_undo_get_unshared_size (GimpDrawableUndo *undo);
+static void     gimp_drawable_undo_compress_func     (GimpAsync        *async,
+                                                      GeglBuffer       *buffer);
+static void     gimp_drawable_undo_compress_callback (GimpAsync        *async,
+                                                      GimpDrawableUndo *undo);
+static void     gimp_drawable_undo_cancel_compress   (GimpDrawableUndo *undo);
+static gboolean gimp_drawable_undo_uncompress        (GimpDrawableUndo *undo,
+                                                      GError          **error);
+static void     gimp_drawable_undo_clear_compressed  (GimpDrawableUndo *undo);
+
 
 G_DEFINE_TYPE (GimpDrawableUndo, gimp_drawable_undo, GIMP_TYPE_ITEM_UNDO)
 
 #define parent_class gimp_drawable_undo_parent_class
 
+static guintptr gimp_drawable_undo_total_compressed   = 0;
+static guintptr gimp_drawable_undo_total_uncompressed = 0;
+
 
 static void
 gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
@@ -152,7 +178,17 @@ gimp_drawable_undo_get_property (GObject    *object,
   switch (property_id)
     {
     case PROP_BUFFER:
-      g_value_set_object (value, drawable_undo->buffer);
+      {
+        GError *error = NULL;
+
+        if (! gimp_drawable_undo_uncompress (drawable_undo, &error))
+          {
+            g_warning ("%s: %s", G_STRFUNC, error->message);
+            g_clear_error (&error);
+          }
+
+        g_value_set_object (value, drawable_undo->buffer);
+      }
       break;
     case PROP_X:
       g_value_set_int (value, drawable_undo->x);
@@ -174,7 +210,10 @@ gimp_drawable_undo_get_memsize (GimpObject *object,
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (object);
   gint64            memsize       = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
+  if (drawable_undo->compressed)
+    memsize += g_bytes_get_size (drawable_undo->compressed);
+  else
+    memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -186,9 +225,25 @@ gimp_drawable_undo_pop (GimpUndo            *undo,
                         GimpUndoAccumulator *accum)
 {
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+  GError           *error         = NULL;
+
+  /*  refuse the pop instead of swapping garbage into the drawable,
+   *  the compressed pixels are kept
+   */
+  if (! gimp_drawable_undo_uncompress (drawable_undo, &error))
+    {
+      gimp_message_literal (undo->image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            error->message);
+      g_clear_error (&error);
+
+      return;
+    }
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
+  /*  the buffer gets the pixels of the other direction  */
+  drawable_undo->incompressible = FALSE;
+
   gimp_drawable_swap_pixels (GIMP_DRAWABLE (GIMP_ITEM_UNDO (undo)->item),
                              drawable_undo->buffer,
                              drawable_undo->x,
@@ -201,7 +256,387 @@ gimp_drawable_undo_free (GimpUndo     *undo,
 {
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
 
+  gimp_drawable_undo_clear_compressed (drawable_undo);
+
   g_clear_object (&drawable_undo->buffer);
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+
+/*  public functions  */
+
+/* Moves the undo's pixels to compressed cold storage, in the background.
+ * They are transparently uncompressed when the undo is popped.
+ */
+void
+gimp_drawable_undo_compress (GimpDrawableUndo *undo)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE_UNDO (undo));
+
+  if (! undo->buffer || undo->async || undo->incompressible)
+    return;
+
+  /*  the tiles are all still shared with the drawable, dropping them
+   *  wouldn't free anything
+   */
+  if (gimp_drawable_undo_get_unshared_size (undo) == 0)
+    return;
+
+  /*  compressing only reads the undo's own buffer, and the result is
+   *  handed back on the main thread, so it can run next to other tasks,
+   *  after the ones the user is waiting for
+   */
+  undo->async = gimp_parallel_run_async_concurrent_full (
+    +2,
+    (GimpParallelRunAsyncFunc) gimp_drawable_undo_compress_func,
+    g_object_ref (undo->buffer),
+    (GDestroyNotify) g_object_unref);
+
+  gimp_async_add_callback_for_object (
+    undo->async,
+    (GimpAsyncCallback) gimp_drawable_undo_compress_callback,
+    undo,
+    undo);
+}
+
+guint64
+gimp_drawable_undo_get_total_compressed_size (void)
+{
+  return gimp_drawable_undo_total_compressed;
+}
+
+guint64
+gimp_drawable_undo_get_total_uncompressed_size (void)
+{
+  return gimp_drawable_undo_total_uncompressed;
+}
+
+
+/*  private functions  */
+
+/*  returns the part of the undo's memory size that isn't shared with the
+ *  drawable, which is what compressing it actually frees.  tiles that are
+ *  still copy-on-write clones of the drawable's tiles stay in memory
+ *  either way.
+ */
+static gint64
+gimp_drawable_undo_get_unshared_size (GimpDrawableUndo *undo)
+{
+  GimpDrawable        *drawable;
+  GeglBuffer          *buffer;
+  const GeglRectangle *extent;
+  const Babl          *format;
+  gint64               size;
+  gint                 bpp;
+  gint                 tile_width;
+  gint                 tile_height;
+  gint                 drawable_tile_width;
+  gint                 drawable_tile_height;
+  gint                 x, y;
+
+  drawable = GIMP_DRAWABLE (GIMP_ITEM_UNDO (undo)->item);
+  buffer   = gimp_drawable_get_buffer (drawable);
+  extent   = gegl_buffer_get_extent (undo->buffer);
+  format   = gegl_buffer_get_format (undo->buffer);
+  size     = gimp_gegl_buffer_get_memsize (undo->buffer);
+  bpp      = babl_format_get_bytes_per_pixel (format);
+
+  if (! buffer || gegl_buffer_get_format (buffer) != format)
+    return size;
+
+  g_object_get (undo->buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+  g_object_get (buffer,
+                "tile-width",  &drawable_tile_width,
+                "tile-height", &drawable_tile_height,
+                NULL);
+
+  /*  tiles can only be shared if both tile grids line up  */
+  if (tile_width  != drawable_tile_width     ||
+      tile_height != drawable_tile_height    ||
+      extent->x % tile_width  || undo->x % tile_width ||
+      extent->y % tile_height || undo->y % tile_height)
+    {
+      return size;
+    }
+
+  for (y = 0; y < extent->height; y += tile_height)
+    for (x = 0; x < extent->width; x += tile_width)
+      {
+        GeglTile *tile;
+        GeglTile *drawable_tile;
+
+        tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (undo->buffer),
+                                          (extent->x + x) / tile_width,
+                                          (extent->y + y) / tile_height,
+                                          0);
+        drawable_tile = gegl_tile_source_get_tile (GEGL_TILE_SOURCE (buffer),
+                                                   (undo->x + x) / tile_width,
+                                                   (undo->y + y) / tile_height,
+                                                   0);
+
+        /*  clones share their data until either one is written to  */
+        if (tile && drawable_tile &&
+            gegl_tile_get_data (tile) == gegl_tile_get_data (drawable_tile))
+          {
+            size -= (gint64) MIN (tile_width,  extent->width  - x) *
+                             MIN (tile_height, extent->height - y) * bpp;
+          }
+
+        if (tile)
+          gegl_tile_unref (tile);
+
+        if (drawable_tile)
+          gegl_tile_unref (drawable_tile);
+      }
+
+  if (size <= gimp_g_object_get_memsize (G_OBJECT (undo->buffer)))
+    return 0;
+
+  return size;
+}
+
+static void
+gimp_drawable_undo_compress_func (GimpAsync  *async,
+                                  GeglBuffer *buffer)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  const Babl          *format = gegl_buffer_get_format (buffer);
+  gint                 bpp    = babl_format_get_bytes_per_pixel (format);
+  gsize                size   = (gsize) extent->width * extent->height * bpp;
+  GByteArray          *array;
+  guchar              *strip;
+  z_stream             stream = { 0, };
+  gint                 tile_height;
+  gint                 y;
+
+  g_object_get (buffer,
+                "tile-height", &tile_height,
+                NULL);
+
+  if (deflateInit (&stream, Z_BEST_SPEED) != Z_OK)
+    {
+      gimp_async_abort (async);
+
+      return;
+    }
+
+  array = g_byte_array_sized_new (size / 4);
+  strip = g_malloc ((gsize) extent->width * tile_height * bpp);
+
+  for (y = 0; y < extent->height; y += tile_height)
+    {
+      gint height = MIN (tile_height, extent->height - y);
+      gint flush  = (y + height == extent->height) ? Z_FINISH : Z_NO_FLUSH;
+
+      if (gimp_async_is_canceled (async) ||
+          array->len > size * MAX_COMPRESSION_RATIO)
+        {
+          break;
+        }
+
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (extent->x, extent->y + y,
+                                       extent->width, height),
+                       1.0, format, strip,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      stream.next_in  = strip;
+      stream.avail_in = (gsize) extent->width * height * bpp;
+
+      do
+        {
+          guint len   = array->len;
+          guint chunk = MAX (stream.avail_in / 2, 4096);
+
+          g_byte_array_set_size (array, len + chunk);
+
+          stream.next_out  = array->data + len;
+          stream.avail_out = chunk;
+
+          deflate (&stream, flush);
+
+          g_byte_array_set_size (array, len + chunk - stream.avail_out);
+        }
+      while (stream.avail_out == 0);
+    }
+
+  deflateEnd (&stream);
+  g_free (strip);
+
+  if (y < extent->height || array->len > size * MAX_COMPRESSION_RATIO)
+    {
+      g_byte_array_free (array, TRUE);
+
+      gimp_async_abort (async);
+
+      return;
+    }
+
+  gimp_async_finish_full (async,
+                          g_byte_array_free_to_bytes (array),
+                          (GDestroyNotify) g_bytes_unref);
+}
+
+static void
+gimp_drawable_undo_compress_callback (GimpAsync        *async,
+                                      GimpDrawableUndo *undo)
+{
+  GBytes *result        = NULL;
+  gint64  unshared_size = 0;
+
+  if (gimp_async_is_finished (async) &&
+      ! gimp_async_is_canceled (async))
+    {
+      result        = gimp_async_get_result (async);
+      unshared_size = gimp_drawable_undo_get_unshared_size (undo);
+
+      /*  the drawable may have been painted on meanwhile, only count
+       *  what dropping the buffer really frees
+       */
+      if (g_bytes_get_size (result) > unshared_size * MAX_COMPRESSION_RATIO)
+        result = NULL;
+    }
+
+  if (result)
+    {
+      undo->compressed        = g_bytes_ref (result);
+      undo->extent            = *gegl_buffer_get_extent (undo->buffer);
+      undo->format            = gegl_buffer_get_format (undo->buffer);
+      undo->uncompressed_size = unshared_size;
+
+      g_clear_object (&undo->buffer);
+
+      g_atomic_pointer_add (&gimp_drawable_undo_total_compressed,
+                            +g_bytes_get_size (undo->compressed));
+      g_atomic_pointer_add (&gimp_drawable_undo_total_uncompressed,
+                            +undo->uncompressed_size);
+    }
+  else if (! gimp_async_is_canceled (async))
+    {
+      /*  don't try again, the pixels don't compress well, or are
+       *  mostly still shared with the drawable
+       */
+      undo->incompressible = TRUE;
+    }
+
+  g_clear_object (&undo->async);
+}
+
+static void
+gimp_drawable_undo_cancel_compress (GimpDrawableUndo *undo)
+{
+  if (undo->async)
+    {
+      GimpAsync *async = g_object_ref (undo->async);
+
+      /*  runs the callback, which drops undo->async  */
+      gimp_async_cancel_and_wait (async);
+      g_object_unref (async);
+
+      g_clear_object (&undo->async);
+    }
+}
+
+static gboolean
+gimp_drawable_undo_uncompress (GimpDrawableUndo  *undo,
+                               GError           **error)
+{
+  GeglBuffer *buffer;
+  z_stream    stream = { 0, };
+  guchar     *strip;
+  gint        bpp;
+  gint        tile_height;
+  gint        ret    = Z_OK;
+  gint        y;
+
+  gimp_drawable_undo_cancel_compress (undo);
+
+  if (! undo->compressed)
+    return TRUE;
+
+  stream.next_in  = (guchar *) g_bytes_get_data (undo->compressed, NULL);
+  stream.avail_in = g_bytes_get_size (undo->compressed);
+
+  if (inflateInit (&stream) != Z_OK)
+    {
+      g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                   _("Could not restore the undo pixels: %s"),
+                   stream.msg ? stream.msg : _("out of memory"));
+
+      return FALSE;
+    }
+
+  buffer = gegl_buffer_new (&undo->extent, undo->format);
+
+  g_object_get (buffer,
+                "tile-height", &tile_height,
+                NULL);
+
+  bpp   = babl_format_get_bytes_per_pixel (undo->format);
+  strip = g_malloc ((gsize) undo->extent.width * tile_height * bpp);
+
+  for (y = 0; y < undo->extent.height && ret == Z_OK; y += tile_height)
+    {
+      gint height = MIN (tile_height, undo->extent.height - y);
+
+      stream.next_out  = strip;
+      stream.avail_out = (gsize) undo->extent.width * height * bpp;
+
+      /*  Z_STREAM_END before the last strip is filled, or Z_BUF_ERROR,
+       *  means the data is truncated
+       */
+      while (stream.avail_out > 0 && ret == Z_OK)
+        ret = inflate (&stream, Z_SYNC_FLUSH);
+
+      if (stream.avail_out > 0)
+        break;
+
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (undo->extent.x, undo->extent.y + y,
+                                       undo->extent.width, height),
+                       0, undo->format, strip,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (strip);
+
+  if (y < undo->extent.height)
+    {
+      g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                   _("Could not restore the undo pixels: %s"),
+                   stream.msg ? stream.msg : _("data is truncated"));
+
+      inflateEnd (&stream);
+      g_object_unref (buffer);
+
+      return FALSE;
+    }
+
+  inflateEnd (&stream);
+
+  undo->buffer = buffer;
+
+  gimp_drawable_undo_clear_compressed (undo);
+
+  return TRUE;
+}
+
+static void
+gimp_drawable_undo_clear_compressed (GimpDrawableUndo *undo)
+{
+  gimp_drawable_undo_cancel_compress (undo);
+
+  if (undo->compressed)
+    {
+      g_atomic_pointer_add (&gimp_drawable_undo_total_compressed,
+                            -g_bytes_get_size (undo->compressed));
+      g_atomic_pointer_add (&gimp_drawable_undo_total_uncompressed,
+                            -undo->uncompressed_size);
+
+      g_clear_pointer (&undo->compressed, g_bytes_unref);
+    }
+}
@@ -40,6 +40,14 @@ struct _GimpDrawableUndo
   GeglBuffer   *buffer;
   gint          x;
   gint          y;
+
+  /*  cold storage  */
+  GimpAsync    *async;
+  GBytes       *compressed;
+  GeglRectangle extent;
+  const Babl   *format;
+  gint64        uncompressed_size;
+  gboolean      incompressible;
 };
 
 struct _GimpDrawableUndoClass
@@ -48,7 +56,12 @@ struct _GimpDrawableUndoClass
 };
 
 
-GType   gimp_drawable_undo_get_type (void) G_GNUC_CONST;
+GType     gimp_drawable_undo_get_type                      (void) G_GNUC_CONST;
+
+void      gimp_drawable_undo_compress                      (GimpDrawableUndo *undo);
+
+guint64   gimp_drawable_undo_get_total_compressed_size     (void);
+guint64   gimp_drawable_undo_get_total_uncompressed_size   (void);
 
 
 #endif /* __GIMP_DRAWABLE_UNDO_H__ */
@@ -348,7 +348,11 @@ gimp_histogram_calculate_async (GimpHistogram       *histogram,
                              context->mask, NULL);
     }
 
-  histogram->priv->calculate_async = gimp_parallel_run_async (
+  /*  the calculation only uses its own copy of the buffers, and the
+   *  previous one has been canceled above, so it doesn't need to wait
+   *  for other async tasks
+   */
+  histogram->priv->calculate_async = gimp_parallel_run_async_concurrent (
     (GimpParallelRunAsyncFunc) gimp_histogram_calculate_internal,
     context);
 
@@ -74,6 +74,7 @@ struct _GimpImagePrivate
   GFile             *untitled_file;         /*  a file saying "Untitled"     */
 
   gboolean           xcf_compression;       /*  XCF compression enabled?     */
+  gboolean           xcf_zstd_compression;  /*  ...with zstd instead of zlib */
 
   gint               dirty;                 /*  dirty flag -- # of ops       */
   gint64             dirty_time;            /*  time when image became dirty */
@@ -124,6 +125,7 @@ struct _GimpImagePrivate
   GimpUndoStack     *redo_stack;            /*  stack for redo operations    */
   gint               group_count;           /*  nested undo groups           */
   GimpUndoType       pushing_undo_group;    /*  undo group status flag       */
+  guint              undo_compress_id;      /*  cold undo compression timer  */
 
   /*  Signal emission accumulator  */
   GimpImageFlushAccumulator  flush_accum;
@@ -26,6 +26,7 @@
 
 #include "gimp.h"
 #include "gimp-utils.h"
+#include "gimpdrawableundo.h"
 #include "gimpimage.h"
 #include "gimpimage-private.h"
 #include "gimpimage-undo.h"
@@ -34,6 +35,12 @@
 #include "gimpundostack.h"
 
 
+/*  compress the undo steps of an image which wasn't pushed to, or
+ *  undone, for this many seconds
+ */
+#define UNDO_COMPRESS_DELAY 30
+
+
 /*  local function prototypes  */
 
 static void          gimp_image_undo_pop_stack       (GimpImage     *image,
@@ -43,6 +50,10 @@ static void          gimp_image_undo_pop_stack       (GimpImage     *image,
 static void          gimp_image_undo_free_space      (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
+static void          gimp_image_undo_compress_schedule (GimpImage     *image);
+static gboolean      gimp_image_undo_compress_timeout  (GimpImage     *image);
+static void          gimp_image_undo_compress_undo     (GimpUndo      *undo);
+
 static GimpDirtyMask gimp_image_undo_dirty_from_type (GimpUndoType   undo_type);
 
 
@@ -245,6 +256,12 @@ gimp_image_undo_free (GimpImage *image)
    */
   gimp_image_undo_event (image, GIMP_UNDO_EVENT_UNDO_FREE, NULL);
 
+  if (private->undo_compress_id)
+    {
+      g_source_remove (private->undo_compress_id);
+      private->undo_compress_id = 0;
+    }
+
   gimp_undo_free (GIMP_UNDO (private->undo_stack), GIMP_UNDO_MODE_UNDO);
   gimp_undo_free (GIMP_UNDO (private->redo_stack), GIMP_UNDO_MODE_REDO);
 
@@ -346,6 +363,8 @@ gimp_image_undo_group_end (GimpImage *image)
                              gimp_undo_stack_peek (private->undo_stack));
 
       gimp_image_undo_free_space (image);
+
+      gimp_image_undo_compress_schedule (image);
     }
 
   return TRUE;
@@ -416,6 +435,8 @@ gimp_image_undo_push (GimpImage     *image,
 
       gimp_image_undo_free_space (image);
 
+      gimp_image_undo_compress_schedule (image);
+
       /*  freeing undo space may have freed the newly pushed undo  */
       if (gimp_undo_stack_peek (private->undo_stack) == undo)
         return undo;
@@ -507,6 +528,8 @@ gimp_image_undo_pop_stack (GimpImage     *image,
                              (undo_mode == GIMP_UNDO_MODE_UNDO) ?
                              GIMP_UNDO_EVENT_UNDO : GIMP_UNDO_EVENT_REDO,
                              undo);
+
+      gimp_image_undo_compress_schedule (image);
     }
 
   g_object_thaw_notify (G_OBJECT (image));
@@ -605,6 +628,57 @@ gimp_image_undo_free_redo (GimpImage *image)
     }
 }
 
+static void
+gimp_image_undo_compress_schedule (GimpImage *image)
+{
+  GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  if (private->undo_compress_id)
+    g_source_remove (private->undo_compress_id);
+
+  private->undo_compress_id =
+    g_timeout_add_seconds (UNDO_COMPRESS_DELAY,
+                           (GSourceFunc) gimp_image_undo_compress_timeout,
+                           image);
+}
+
+static gboolean
+gimp_image_undo_compress_timeout (GimpImage *image)
+{
+  GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+  GList            *list;
+
+  private->undo_compress_id = 0;
+
+  /*  keep the most recent step hot, it's the one likely to be undone  */
+  list = GIMP_LIST (private->undo_stack->undos)->queue->head;
+
+  for (list = g_list_next (list); list; list = g_list_next (list))
+    gimp_image_undo_compress_undo (list->data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_image_undo_compress_undo (GimpUndo *undo)
+{
+  if (GIMP_IS_UNDO_STACK (undo))
+    {
+      GList *list;
+
+      for (list = GIMP_LIST (GIMP_UNDO_STACK (undo)->undos)->queue->head;
+           list;
+           list = g_list_next (list))
+        {
+          gimp_image_undo_compress_undo (list->data);
+        }
+    }
+  else if (GIMP_IS_DRAWABLE_UNDO (undo))
+    {
+      gimp_drawable_undo_compress (GIMP_DRAWABLE_UNDO (undo));
+    }
+}
+
 static GimpDirtyMask
 gimp_image_undo_dirty_from_type (GimpUndoType undo_type)
 {
@@ -2608,6 +2608,23 @@ gimp_image_get_xcf_compression (GimpImage *image)
   return GIMP_IMAGE_GET_PRIVATE (image)->xcf_compression;
 }
 
+void
+gimp_image_set_xcf_zstd_compression (GimpImage *image,
+                                     gboolean   zstd_compression)
+{
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  GIMP_IMAGE_GET_PRIVATE (image)->xcf_zstd_compression = zstd_compression;
+}
+
+gboolean
+gimp_image_get_xcf_zstd_compression (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->xcf_zstd_compression;
+}
+
 void
 gimp_image_set_resolution (GimpImage *image,
                            gdouble    xresolution,
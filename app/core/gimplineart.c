@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -45,6 +47,32 @@
 
 #include "gimp-intl.h"
 
+
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+/* The largest part of the image which is recomputed from the previous
+ * results rather than from scratch.
+ */
+#define MAX_INCREMENTAL_AREA_RATIO 0.25
+
+/* The distance over which a change of the strokes can affect the normals
+ * and curvatures computed with a normal estimate mask of size @mask_size:
+ * the normals are smoothed over @mask_size edgels, the curvatures derived
+ * from the neighbor normals and smoothed over 5 more edgels, each edgel
+ * depending on the 3x3 neighborhood of its pixel.
+ */
+#define EDGEL_REACH(mask_size) ((mask_size) + 8)
+
+/* The size of the intermediate results kept for the next computation:
+ * the binary input and the strokes, the normals, and the raw and
+ * smoothed curvatures.  They are only kept while they fit in this
+ * fraction of the tile cache.
+ */
+#define CACHE_PIXEL_SIZE (2 * sizeof (guchar) + 4 * sizeof (gfloat))
+#define MAX_CACHE_RATIO  0.25
+
+
 enum
 {
   COMPUTING_START,
@@ -62,6 +90,26 @@ enum
   PROP_SEGMENT_MAX_LEN,
 };
 
+/* The intermediate results of a computation, which the next one reuses
+ * outside of the area where the input changed.  The next computation
+ * takes them over, and reuses their buffers in place.
+ */
+typedef struct
+{
+  gint      width;
+  gint      height;
+  gboolean  select_transparent;
+  gdouble   threshold;
+  gint      minimal_lineart_area;
+  gint      normal_estimate_mask_size;
+
+  guchar   *binary;
+  guchar   *strokes;
+  gfloat   *normals;
+  gfloat   *curvatures;
+  gfloat   *smoothed_curvatures;
+} LineArtCache;
+
 typedef struct _GimpLineArtPrivate GimpLineArtPrivate;
 
 struct _GimpLineArtPrivate
@@ -76,6 +124,7 @@ struct _GimpLineArtPrivate
   GimpPickable *input;
   GeglBuffer   *closed;
   gfloat       *distmap;
+  LineArtCache *cache;
 
   /* Used in the closing step. */
   gboolean      select_transparent;
@@ -90,18 +139,22 @@ struct _GimpLineArtPrivate
 
 typedef struct
 {
-  GeglBuffer  *buffer;
+  GeglBuffer   *buffer;
 
-  gboolean     select_transparent;
-  gdouble      threshold;
-  gint         spline_max_len;
-  gint         segment_max_len;
+  gboolean      select_transparent;
+  gdouble       threshold;
+  gint          spline_max_len;
+  gint          segment_max_len;
+
+  LineArtCache *cache;
+  gboolean      keep_cache;
 } LineArtData;
 
 typedef struct
 {
-  GeglBuffer *closed;
-  gfloat     *distmap;
+  GeglBuffer   *closed;
+  gfloat       *distmap;
+  LineArtCache *cache;
 } LineArtResult;
 
 static int DeltaX[4] = {+1, -1, 0, 0};
@@ -144,6 +197,43 @@ typedef struct _Edgel
 } Edgel;
 
 
+typedef struct
+{
+  const guchar *mask;
+  guchar       *denoised;
+  gint          width;
+  gint          height;
+  gint          minimum_area;
+  GimpAsync    *async;
+} DenoiseData;
+
+typedef struct
+{
+  const guchar *mask;
+  gint          width;
+  gint          height;
+  GArray       *set;
+  guint        *rows;
+  const gfloat *weights;
+  gint          mask_size;
+  gfloat       *edgel_curvatures;
+  gfloat       *normals;
+  gfloat       *curvatures;
+  gfloat       *smoothed_curvatures;
+  GimpAsync    *async;
+} EdgelSetData;
+
+typedef struct
+{
+  const guchar *mask;
+  const gfloat *dist;
+  gfloat       *thickness;
+  gint          width;
+  gint          height;
+  GimpAsync    *async;
+} RadiiData;
+
+
 static void            gimp_line_art_finalize                  (GObject               *object);
 static void            gimp_line_art_set_property              (GObject                *object,
                                                                 guint                   property_id,
@@ -168,8 +258,11 @@ static LineArtData   * line_art_data_new                       (GeglBuffer
                                                                 GimpLineArt            *line_art);
 static void            line_art_data_free                      (LineArtData            *data);
 static LineArtResult * line_art_result_new                     (GeglBuffer             *line_art,
-                                                                gfloat                 *distmap);
+                                                                gfloat                 *distmap,
+                                                                LineArtCache           *cache);
 static void            line_art_result_free                    (LineArtResult          *result);
+static LineArtCache  * line_art_cache_new                      (void);
+static void            line_art_cache_free                     (LineArtCache           *cache);
 
 static gboolean        gimp_line_art_idle                      (GimpLineArt            *line_art);
 static void            gimp_line_art_input_invalidate_preview  (GimpViewable           *viewable,
@@ -194,19 +287,63 @@ static GeglBuffer    * gimp_line_art_close                     (GeglBuffer
                                                                 gint                    created_regions_minimum_area,
                                                                 gboolean                small_segments_from_spline_sources,
                                                                 gfloat                **lineart_distmap,
+                                                                LineArtCache           *cache,
+                                                                LineArtCache          **new_cache,
                                                                 GimpAsync              *async);
 
-static void            gimp_lineart_denoise                    (GeglBuffer             *buffer,
-                                                                int                     size,
+static gboolean        gimp_line_art_get_changed_bounds        (const guchar           *old_mask,
+                                                                const guchar           *new_mask,
+                                                                gint                    width,
+                                                                gint                    height,
+                                                                GeglRectangle          *bounds);
+static void            gimp_line_art_grow_rect                 (const GeglRectangle    *rect,
+                                                                gint                    margin,
+                                                                gint                    width,
+                                                                gint                    height,
+                                                                GeglRectangle          *dest);
+static void            gimp_line_art_copy_rect                 (gconstpointer           src,
+                                                                gint                    src_width,
+                                                                const GeglRectangle    *src_rect,
+                                                                gpointer                dest,
+                                                                gint                    dest_width,
+                                                                gint                    dest_x,
+                                                                gint                    dest_y,
+                                                                gint                    bpp);
+
+static void            gimp_lineart_denoise                    (const guchar           *mask,
+                                                                guchar                 *denoised,
+                                                                gint                    width,
+                                                                gint                    height,
+                                                                const GeglRectangle    *rect,
+                                                                gint                    minimum_area,
+                                                                GimpAsync              *async);
+static void            gimp_lineart_denoise_area               (const GeglRectangle    *area,
+                                                                DenoiseData            *data);
+static void            gimp_lineart_compute_normals_curvatures (const guchar           *mask,
+                                                                gint                    width,
+                                                                gint                    height,
+                                                                gfloat                 *normals,
+                                                                gfloat                 *curvatures,
+                                                                gfloat                 *smoothed_curvatures,
+                                                                int                     normal_estimate_mask_size,
                                                                 GimpAsync              *async);
-static void            gimp_lineart_compute_normals_curvatures (GeglBuffer             *mask,
+static void            gimp_lineart_update_normals_curvatures  (const guchar           *mask,
+                                                                gint                    width,
+                                                                gint                    height,
+                                                                const GeglRectangle    *rect,
                                                                 gfloat                 *normals,
                                                                 gfloat                 *curvatures,
                                                                 gfloat                 *smoothed_curvatures,
                                                                 int                     normal_estimate_mask_size,
                                                                 GimpAsync              *async);
+static void            gimp_lineart_accumulate_rows            (gsize                   offset,
+                                                                gsize                   size,
+                                                                EdgelSetData           *data);
 static gfloat        * gimp_lineart_get_smooth_curvatures      (GArray                 *edgelset,
                                                                 GimpAsync              *async);
+static void            gimp_lineart_smooth_curvatures_range    (gsize                   offset,
+                                                                gsize                   size,
+                                                                EdgelSetData           *data);
 static GArray        * gimp_lineart_curvature_extremums        (gfloat                 *curvatures,
                                                                 gfloat                 *smoothed_curvatures,
                                                                 gint                    curvatures_width,
@@ -228,29 +365,45 @@ static GArray        * gimp_lineart_discrete_spline            (Pixel
                                                                 GimpVector2             n1);
 
 static gint            gimp_number_of_transitions               (GArray                 *pixels,
-                                                                 GeglBuffer             *buffer);
-static gboolean        gimp_line_art_allow_closure              (GeglBuffer             *mask,
+                                                                 const guchar           *mask,
+                                                                 gint                    width,
+                                                                 gint                    height);
+static gboolean        gimp_line_art_allow_closure              (guchar                 *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
                                                                  GArray                 *pixels,
                                                                  GList                 **fill_pixels,
                                                                  int                     significant_size,
                                                                  int                     minimum_size);
-static GArray        * gimp_lineart_line_segment_until_hit      (const GeglBuffer       *buffer,
+static GArray        * gimp_lineart_line_segment_until_hit      (const guchar           *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
                                                                  Pixel                   start,
                                                                  GimpVector2             direction,
                                                                  int                     size);
-static gfloat        * gimp_lineart_estimate_strokes_radii      (GeglBuffer             *mask,
+static gfloat        * gimp_lineart_estimate_strokes_radii      (const guchar           *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
                                                                  GimpAsync              *async);
-static void            gimp_line_art_simple_fill                (GeglBuffer             *buffer,
+static void            gimp_lineart_estimate_strokes_radii_rows (gsize                   offset,
+                                                                 gsize                   size,
+                                                                 RadiiData              *data);
+static void            gimp_line_art_simple_fill                (guchar                 *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
                                                                  gint                    x,
                                                                  gint                    y);
 
 /* Some callback-type functions. */
 
-static guint           visited_hash_fun                         (Pixel                  *key);
-static gboolean        visited_equal_fun                        (Pixel                  *e1,
-                                                                 Pixel                  *e2);
-
-static inline gboolean border_in_direction                      (GeglBuffer             *mask,
+static inline guchar   mask_value                               (const guchar           *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
+                                                                 gint                    x,
+                                                                 gint                    y);
+static inline gboolean border_in_direction                      (const guchar           *mask,
+                                                                 gint                    width,
+                                                                 gint                    height,
                                                                  Pixel                   p,
                                                                  int                     direction);
 static inline GimpVector2 pair2normal                           (Pixel                   p,
@@ -259,46 +412,62 @@ static inline GimpVector2 pair2normal                           (Pixel
 
 /* Edgel */
 
-static Edgel    * gimp_edgel_new                  (int                x,
-                                                   int                y,
-                                                   Direction          direction);
-static void       gimp_edgel_init                 (Edgel             *edgel);
-static void       gimp_edgel_clear                (Edgel            **edgel);
-static int        gimp_edgel_cmp                  (const Edgel       *e1,
-                                                   const Edgel       *e2);
-static guint      edgel2index_hash_fun            (Edgel              *key);
-static gboolean   edgel2index_equal_fun           (Edgel              *e1,
-                                                   Edgel              *e2);
-
-static glong      gimp_edgel_track_mark           (GeglBuffer         *mask,
-                                                   Edgel               edgel,
-                                                   long                size_limit);
-static glong      gimp_edgel_region_area          (const GeglBuffer   *mask,
-                                                   Edgel               start_edgel);
+static void       gimp_edgel_init                       (Edgel              *edgel);
+static int        gimp_edgel_cmp                        (const Edgel        *e1,
+                                                         const Edgel        *e2);
+
+static glong      gimp_edgel_track_mark                 (guchar             *mask,
+                                                         gint                width,
+                                                         gint                height,
+                                                         Edgel               edgel,
+                                                         long                size_limit);
+static glong      gimp_edgel_region_area                (const guchar       *mask,
+                                                         gint                width,
+                                                         gint                height,
+                                                         Edgel               start_edgel);
 
 /* Edgel set */
 
-static GArray   * gimp_edgelset_new               (GeglBuffer         *buffer,
-                                                   GimpAsync          *async);
-static void       gimp_edgelset_add               (GArray             *set,
-                                                   int                 x,
-                                                   int                 y,
-                                                   Direction           direction,
-                                                   GHashTable         *edgel2index);
-static void       gimp_edgelset_init_normals      (GArray             *set);
-static void       gimp_edgelset_smooth_normals    (GArray             *set,
-                                                   int                 mask_size,
-                                                   GimpAsync          *async);
-static void       gimp_edgelset_compute_curvature (GArray             *set,
-                                                   GimpAsync          *async);
-
-static void       gimp_edgelset_build_graph       (GArray            *set,
-                                                   GeglBuffer        *buffer,
-                                                   GHashTable        *edgel2index,
-                                                   GimpAsync         *async);
-static void       gimp_edgelset_next8             (const GeglBuffer  *buffer,
-                                                   Edgel             *it,
-                                                   Edgel             *n);
+static GArray   * gimp_edgelset_new                     (const guchar       *mask,
+                                                         gint                width,
+                                                         gint                height,
+                                                         guint             **rows,
+                                                         GimpAsync          *async);
+static void       gimp_edgelset_count_rows              (gsize               offset,
+                                                         gsize               size,
+                                                         EdgelSetData       *data);
+static void       gimp_edgelset_fill_rows               (gsize               offset,
+                                                         gsize               size,
+                                                         EdgelSetData       *data);
+static guint      gimp_edgelset_find                    (GArray             *set,
+                                                         const guint        *rows,
+                                                         const Edgel        *edgel);
+static void       gimp_edgelset_smooth_normals          (GArray             *set,
+                                                         int                 mask_size,
+                                                         GimpAsync          *async);
+static void       gimp_edgelset_smooth_normals_range    (gsize               offset,
+                                                         gsize               size,
+                                                         EdgelSetData       *data);
+static void       gimp_edgelset_compute_curvature       (GArray             *set,
+                                                         GimpAsync          *async);
+static void       gimp_edgelset_compute_curvature_range (gsize               offset,
+                                                         gsize               size,
+                                                         EdgelSetData       *data);
+
+static void       gimp_edgelset_build_graph             (GArray             *set,
+                                                         const guint        *rows,
+                                                         const guchar       *mask,
+                                                         gint                width,
+                                                         gint                height,
+                                                         GimpAsync          *async);
+static void       gimp_edgelset_build_graph_range       (gsize               offset,
+                                                         gsize               size,
+                                                         EdgelSetData       *data);
+static void       gimp_edgelset_next8                   (const guchar       *mask,
+                                                         gint                width,
+                                                         gint                height,
+                                                         const Edgel        *it,
+                                                         Edgel              *n);
 
 G_DEFINE_TYPE_WITH_CODE (GimpLineArt, gimp_line_art, GIMP_TYPE_OBJECT,
                          G_ADD_PRIVATE (GimpLineArt))
@@ -496,6 +665,8 @@ gimp_line_art_set_input (GimpLineArt  *line_art,
 
       line_art->priv->input = pickable;
 
+      g_clear_pointer (&line_art->priv->cache, line_art_cache_free);
+
       gimp_line_art_compute (line_art);
 
       if (pickable)
@@ -630,6 +801,10 @@ gimp_line_art_compute_cb (GimpAsync   *async,
       line_art->priv->closed  = g_object_ref (result->closed);
       line_art->priv->distmap = result->distmap;
       result->distmap  = NULL;
+
+      g_clear_pointer (&line_art->priv->cache, line_art_cache_free);
+      line_art->priv->cache = result->cache;
+      result->cache = NULL;
       g_signal_emit (line_art, gimp_line_art_signals[COMPUTING_END], 0);
     }
 
@@ -654,7 +829,10 @@ gimp_line_art_prepare_async (GimpLineArt *line_art,
 
   g_object_unref (buffer);
 
-  async = gimp_parallel_run_async_full (
+  /*  the computation works on its own copy of the input, and a canceled
+   *  one never touches the line art, so it may overlap the next one
+   */
+  async = gimp_parallel_run_async_concurrent_full (
     priority,
     (GimpParallelRunAsyncFunc) gimp_line_art_prepare_async_func,
     data, (GDestroyNotify) line_art_data_free);
@@ -666,10 +844,11 @@ static void
 gimp_line_art_prepare_async_func (GimpAsync   *async,
                                   LineArtData *data)
 {
-  GeglBuffer *closed  = NULL;
-  gfloat     *distmap = NULL;
-  gboolean    has_alpha;
-  gboolean    select_transparent = FALSE;
+  GeglBuffer   *closed  = NULL;
+  gfloat       *distmap = NULL;
+  LineArtCache *cache   = NULL;
+  gboolean      has_alpha;
+  gboolean      select_transparent = FALSE;
 
   has_alpha = babl_format_has_alpha (gegl_buffer_get_format (data->buffer));
 
@@ -750,6 +929,8 @@ gimp_line_art_prepare_async_func (GimpAsync   *async,
                                 /*small_segments_from_spline_sources,*/
                                 TRUE,
                                 &distmap,
+                                data->cache,
+                                data->keep_cache ? &cache : NULL,
                                 async);
 
   GIMP_TIMER_END("close line-art");
@@ -757,7 +938,7 @@ gimp_line_art_prepare_async_func (GimpAsync   *async,
   if (! gimp_async_is_stopped (async))
     {
       gimp_async_finish_full (async,
-                              line_art_result_new (closed, distmap),
+                              line_art_result_new (closed, distmap, cache),
                               (GDestroyNotify) line_art_result_free);
     }
 
@@ -768,13 +949,35 @@ static LineArtData *
 line_art_data_new (GeglBuffer  *buffer,
                    GimpLineArt *line_art)
 {
-  LineArtData *data = g_slice_new (LineArtData);
+  LineArtData         *data = g_slice_new (LineArtData);
+  const GeglRectangle *extent;
+  guint64              tile_cache_size = 0;
 
   data->buffer             = g_object_ref (buffer);
   data->select_transparent = line_art->priv->select_transparent;
   data->threshold          = line_art->priv->threshold;
   data->spline_max_len     = line_art->priv->spline_max_len;
   data->segment_max_len    = line_art->priv->segment_max_len;
+  data->cache              = line_art->priv->cache;
+
+  /* the previous results are handed over to the computation, rather
+   * than copied, and are lost if it is canceled.
+   */
+  line_art->priv->cache = NULL;
+
+  /* the results of this computation are only kept for the next one if
+   * they don't take too much of the memory which the tile cache may
+   * use, a large image computes from scratch each time instead.
+   */
+  g_object_get (gegl_config (),
+                "tile-cache-size", &tile_cache_size,
+                NULL);
+
+  extent = gegl_buffer_get_extent (buffer);
+
+  data->keep_cache = ((gdouble) extent->width * extent->height *
+                      CACHE_PIXEL_SIZE <=
+                      MAX_CACHE_RATIO * tile_cache_size);
 
   return data;
 }
@@ -783,19 +986,22 @@ static void
 line_art_data_free (LineArtData *data)
 {
   g_object_unref (data->buffer);
+  g_clear_pointer (&data->cache, line_art_cache_free);
 
   g_slice_free (LineArtData, data);
 }
 
 static LineArtResult *
-line_art_result_new (GeglBuffer *closed,
-                     gfloat     *distmap)
+line_art_result_new (GeglBuffer   *closed,
+                     gfloat       *distmap,
+                     LineArtCache *cache)
 {
   LineArtResult *data;
 
   data = g_slice_new (LineArtResult);
   data->closed  = closed;
   data->distmap = distmap;
+  data->cache   = cache;
 
   return data;
 }
@@ -805,10 +1011,29 @@ line_art_result_free (LineArtResult *data)
 {
   g_object_unref (data->closed);
   g_clear_pointer (&data->distmap, g_free);
+  g_clear_pointer (&data->cache, line_art_cache_free);
 
   g_slice_free (LineArtResult, data);
 }
 
+static LineArtCache *
+line_art_cache_new (void)
+{
+  return g_slice_new0 (LineArtCache);
+}
+
+static void
+line_art_cache_free (LineArtCache *cache)
+{
+  g_free (cache->binary);
+  g_free (cache->strokes);
+  g_free (cache->normals);
+  g_free (cache->curvatures);
+  g_free (cache->smoothed_curvatures);
+
+  g_slice_free (LineArtCache, cache);
+}
+
 static gboolean
 gimp_line_art_idle (GimpLineArt *line_art)
 {
@@ -861,6 +1086,10 @@ gimp_line_art_input_invalidate_preview (GimpViewable *viewable,
  * @created_regions_minimum_area:
  * @small_segments_from_spline_sources:
  * @closed_distmap: a distance map of the closed line art pixels.
+ * @cache: the intermediate results of a previous computation, or #NULL.
+ *         Its buffers are reused in place, and taken out of it.
+ * @new_cache: return location for the intermediate results of this
+ *             computation, or #NULL.
  * @async: the #GimpAsync associated with the computation
  *
  * Creates a binarized version of the strokes of @buffer, detected either
@@ -876,38 +1105,60 @@ gimp_line_art_input_invalidate_preview (GimpViewable *viewable,
  * Fourey, David Tschumperlé, David Revoy.
  * https://hal.archives-ouvertes.fr/hal-01891876
  *
+ * When @cache comes from the same input size and parameters, only the
+ * strokes, normals and curvatures around the pixels whose thresholded
+ * value changed are recomputed; the closing itself always runs on the
+ * whole line art.
+ *
  * Returns: a new #GeglBuffer of format "Y u8" representing the
  *          binarized @line_art. If @lineart_distmap is not #NULL, a
  *          newly allocated float buffer is returned, which can be used
  *          for overflowing created masks later.
  */
 static GeglBuffer *
-gimp_line_art_close (GeglBuffer  *buffer,
-                     gboolean     select_transparent,
-                     gdouble      stroke_threshold,
-                     gint         spline_max_length,
-                     gint         segment_max_length,
-                     gint         minimal_lineart_area,
-                     gint         normal_estimate_mask_size,
-                     gfloat       end_point_rate,
-                     gfloat       spline_max_angle,
-                     gint         end_point_connectivity,
-                     gfloat       spline_roundness,
-                     gboolean     allow_self_intersections,
-                     gint         created_regions_significant_area,
-                     gint         created_regions_minimum_area,
-                     gboolean     small_segments_from_spline_sources,
-                     gfloat     **closed_distmap,
-                     GimpAsync   *async)
-{
-  const Babl         *gray_format;
-  GeglBufferIterator *gi;
-  GeglBuffer         *closed  = NULL;
-  GeglBuffer         *strokes = NULL;
-  guchar              max_value = 0;
-  gint                width  = gegl_buffer_get_width (buffer);
-  gint                height = gegl_buffer_get_height (buffer);
-  gint                i;
+gimp_line_art_close (GeglBuffer          *buffer,
+                     gboolean             select_transparent,
+                     gdouble              stroke_threshold,
+                     gint                 spline_max_length,
+                     gint                 segment_max_length,
+                     gint                 minimal_lineart_area,
+                     gint                 normal_estimate_mask_size,
+                     gfloat               end_point_rate,
+                     gfloat               spline_max_angle,
+                     gint                 end_point_connectivity,
+                     gfloat               spline_roundness,
+                     gboolean             allow_self_intersections,
+                     gint                 created_regions_significant_area,
+                     gint                 created_regions_minimum_area,
+                     gboolean             small_segments_from_spline_sources,
+                     gfloat             **closed_distmap,
+                     LineArtCache        *cache,
+                     LineArtCache       **new_cache,
+                     GimpAsync           *async)
+{
+  const Babl    *gray_format;
+  GeglRectangle  extent;
+  GeglRectangle  dirty;
+  GeglRectangle  rect;
+  GeglBuffer    *closed_buffer       = NULL;
+  guchar        *binary              = NULL;
+  guchar        *strokes             = NULL;
+  guchar        *closed              = NULL;
+  gfloat        *normals             = NULL;
+  gfloat        *curvatures          = NULL;
+  gfloat        *smoothed_curvatures = NULL;
+  gfloat        *cached_curvatures   = NULL;
+  guchar         max_value           = 0;
+  gboolean       incremental         = FALSE;
+  gint           width;
+  gint           height;
+  gint           x;
+  gint           y;
+  gint           i;
+
+  extent = *gegl_buffer_get_extent (buffer);
+  width  = extent.width;
+  height = extent.height;
 
   if (select_transparent)
     /* Keep alpha channel as gray levels */
@@ -917,111 +1168,163 @@ gimp_line_art_close (GeglBuffer  *buffer,
     gray_format = babl_format ("Y' u8");
 
   /* Transform the line art from any format to gray. */
-  strokes = gegl_buffer_new (gegl_buffer_get_extent (buffer),
-                             gray_format);
-  gimp_gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE, strokes, NULL);
-  gegl_buffer_set_format (strokes, babl_format ("Y' u8"));
+  binary = g_new (guchar, width * height);
+  gegl_buffer_get (buffer, &extent, 1.0, gray_format, binary,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
   if (! select_transparent)
     {
       /* Compute the biggest value */
-      gi = gegl_buffer_iterator_new (strokes, NULL, 0, NULL,
-                                     GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-      while (gegl_buffer_iterator_next (gi))
+      for (y = 0; y < height; y++)
         {
-          guchar *data = (guchar*) gi->items[0].data;
-          gint    k;
+          const guchar *data = binary + y * width;
 
           if (gimp_async_is_canceled (async))
             {
-              gegl_buffer_iterator_stop (gi);
-
               gimp_async_abort (async);
 
               goto end1;
             }
 
-          for (k = 0; k < gi->length; k++)
+          for (x = 0; x < width; x++)
             {
-              if (*data > max_value)
-                max_value = *data;
-              data++;
+              if (data[x] > max_value)
+                max_value = data[x];
             }
         }
     }
 
   /* Make the image binary: 1 is stroke, 0 background */
-  gi = gegl_buffer_iterator_new (strokes, NULL, 0, NULL,
-                                 GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE, 1);
-  while (gegl_buffer_iterator_next (gi))
+  for (y = 0; y < height; y++)
     {
-      guchar *data = (guchar*) gi->items[0].data;
-      gint    k;
+      guchar *data = binary + y * width;
 
       if (gimp_async_is_canceled (async))
         {
-          gegl_buffer_iterator_stop (gi);
-
           gimp_async_abort (async);
 
           goto end1;
         }
 
-      for (k = 0; k < gi->length; k++)
+      for (x = 0; x < width; x++)
         {
           if (! select_transparent)
             /* Negate the value. */
-            *data = max_value - *data;
+            data[x] = max_value - data[x];
           /* Apply a threshold. */
-          if (*data > (guchar) (255.0f * (1.0f - stroke_threshold)))
-            *data = 1;
+          if (data[x] > (guchar) (255.0f * (1.0f - stroke_threshold)))
+            data[x] = 1;
           else
-            *data = 0;
-          data++;
+            data[x] = 0;
         }
     }
 
+  /* Only recompute the strokes, normals and curvatures around the
+   * pixels which changed since the previous computation, unless too
+   * much of the image changed.
+   */
+  if (cache                                                         &&
+      cache->width                     == width                     &&
+      cache->height                    == height                    &&
+      cache->select_transparent        == select_transparent        &&
+      cache->threshold                 == stroke_threshold          &&
+      cache->minimal_lineart_area      == minimal_lineart_area      &&
+      cache->normal_estimate_mask_size == normal_estimate_mask_size)
+    {
+      GeglRectangle affected;
+
+      gimp_line_art_get_changed_bounds (cache->binary, binary,
+                                        width, height, &dirty);
+
+      gimp_line_art_grow_rect (&dirty,
+                               minimal_lineart_area +
+                               EDGEL_REACH (normal_estimate_mask_size),
+                               width, height, &affected);
+
+      incremental = ((gdouble) affected.width * affected.height <=
+                     MAX_INCREMENTAL_AREA_RATIO * width * height);
+    }
+
   /* Denoise (remove small connected components) */
-  gimp_lineart_denoise (strokes, minimal_lineart_area, async);
+  if (incremental)
+    {
+      strokes        = cache->strokes;
+      cache->strokes = NULL;
+
+      gimp_line_art_grow_rect (&dirty, minimal_lineart_area,
+                               width, height, &rect);
+    }
+  else
+    {
+      strokes = g_new (guchar, width * height);
+
+      gegl_rectangle_set (&rect, 0, 0, width, height);
+    }
+
+  gimp_lineart_denoise (binary, strokes, width, height, &rect,
+                        minimal_lineart_area, async);
   if (gimp_async_is_stopped (async))
     goto end1;
 
-  closed = g_object_ref (strokes);
-
   if (spline_max_length > 0 || segment_max_length > 0)
     {
-      GArray     *keypoints           = NULL;
-      GHashTable *visited             = NULL;
-      gfloat     *radii               = NULL;
-      gfloat     *normals             = NULL;
-      gfloat     *curvatures          = NULL;
-      gfloat     *smoothed_curvatures = NULL;
-      gfloat      threshold;
-      gfloat      clamped_threshold;
-      GList      *fill_pixels         = NULL;
-      GList      *iter;
-
-      normals             = g_new0 (gfloat, width * height * 2);
-      curvatures          = g_new0 (gfloat, width * height);
-      smoothed_curvatures = g_new0 (gfloat, width * height);
+      GArray *keypoints   = NULL;
+      guchar *visited     = NULL;
+      gfloat *radii       = NULL;
+      gfloat  threshold;
+      gfloat  clamped_threshold;
+      GList  *fill_pixels = NULL;
+      GList  *iter;
 
       /* Estimate normals & curvature */
-      gimp_lineart_compute_normals_curvatures (strokes, normals, curvatures,
-                                               smoothed_curvatures,
-                                               normal_estimate_mask_size,
-                                               async);
+      if (incremental && cache->normals)
+        {
+          normals             = cache->normals;
+          curvatures          = cache->curvatures;
+          smoothed_curvatures = cache->smoothed_curvatures;
+
+          cache->normals             = NULL;
+          cache->curvatures          = NULL;
+          cache->smoothed_curvatures = NULL;
+
+          gimp_line_art_grow_rect (&rect,
+                                   EDGEL_REACH (normal_estimate_mask_size),
+                                   width, height, &rect);
+
+          gimp_lineart_update_normals_curvatures (strokes, width, height,
+                                                  &rect, normals, curvatures,
+                                                  smoothed_curvatures,
+                                                  normal_estimate_mask_size,
+                                                  async);
+        }
+      else
+        {
+          normals             = g_new0 (gfloat, width * height * 2);
+          curvatures          = g_new0 (gfloat, width * height);
+          smoothed_curvatures = g_new0 (gfloat, width * height);
+
+          gimp_lineart_compute_normals_curvatures (strokes, width, height,
+                                                   normals, curvatures,
+                                                   smoothed_curvatures,
+                                                   normal_estimate_mask_size,
+                                                   async);
+        }
       if (gimp_async_is_stopped (async))
         goto end2;
 
-      radii = gimp_lineart_estimate_strokes_radii (strokes, async);
+      /* The curvatures are thresholded in place below. */
+      if (new_cache)
+        cached_curvatures = g_memdup (curvatures,
+                                      sizeof (gfloat) * width * height);
+
+      radii = gimp_lineart_estimate_strokes_radii (strokes, width, height,
+                                                   async);
       if (gimp_async_is_stopped (async))
         goto end2;
       threshold = 1.0f - end_point_rate;
       clamped_threshold = MAX (0.25f, threshold);
-      for (i = 0; i < width; i++)
+      for (y = 0; y < height; y++)
         {
-          gint j;
-
           if (gimp_async_is_canceled (async))
             {
               gimp_async_abort (async);
@@ -1029,13 +1332,13 @@ gimp_line_art_close (GeglBuffer  *buffer,
               goto end2;
             }
 
-          for (j = 0; j < height; j++)
+          for (x = 0; x < width; x++)
             {
-              if (smoothed_curvatures[i + j * width] >= (threshold / MAX (1.0f, radii[i + j * width])) ||
-                  curvatures[i + j * width] >= clamped_threshold)
-                curvatures[i + j * width] = 1.0;
+              if (smoothed_curvatures[x + y * width] >= (threshold / MAX (1.0f, radii[x + y * width])) ||
+                  curvatures[x + y * width] >= clamped_threshold)
+                curvatures[x + y * width] = 1.0;
               else
-                curvatures[i + j * width] = 0.0;
+                curvatures[x + y * width] = 0.0;
             }
         }
       g_clear_pointer (&radii, g_free);
@@ -1045,9 +1348,12 @@ gimp_line_art_close (GeglBuffer  *buffer,
       if (gimp_async_is_stopped (async))
         goto end2;
 
-      visited = g_hash_table_new_full ((GHashFunc) visited_hash_fun,
-                                       (GEqualFunc) visited_equal_fun,
-                                       (GDestroyNotify) g_free, NULL);
+      /* The number of splines and segments each key point is the end
+       * point of.
+       */
+      visited = g_new0 (guchar, width * height);
+
+      closed = g_memdup (strokes, width * height);
 
       if (spline_max_length > 0)
         {
@@ -1061,15 +1367,13 @@ gimp_line_art_close (GeglBuffer  *buffer,
           if (gimp_async_is_stopped (async))
             goto end3;
 
-          g_object_unref (closed);
-          closed = gegl_buffer_dup (strokes);
-
           /* Draw splines */
           while (candidates)
             {
-              Pixel    *p1;
-              Pixel    *p2;
-              gboolean  inserted = FALSE;
+              Pixel p1;
+              Pixel p2;
+              gint  index1;
+              gint  index2;
 
               if (gimp_async_is_canceled (async))
                 {
@@ -1078,27 +1382,23 @@ gimp_line_art_close (GeglBuffer  *buffer,
                   goto end3;
                 }
 
-              p1 = g_new (Pixel, 1);
-              p2 = g_new (Pixel, 1);
-
               candidate = (SplineCandidate *) candidates->data;
-              p1->x = candidate->p1.x;
-              p1->y = candidate->p1.y;
-              p2->x = candidate->p2.x;
-              p2->y = candidate->p2.y;
+              p1 = candidate->p1;
+              p2 = candidate->p2;
 
               g_free (candidate);
               candidates = g_list_delete_link (candidates, candidates);
 
-              if ((! g_hash_table_contains (visited, p1) ||
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p1)) < end_point_connectivity) &&
-                  (! g_hash_table_contains (visited, p2) ||
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p2)) < end_point_connectivity))
+              index1 = (gint) p1.x + (gint) p1.y * width;
+              index2 = (gint) p2.x + (gint) p2.y * width;
+
+              if (visited[index1] < end_point_connectivity &&
+                  visited[index2] < end_point_connectivity)
                 {
                   GArray      *discrete_curve;
-                  GimpVector2  vect1 = pair2normal (*p1, normals, width);
-                  GimpVector2  vect2 = pair2normal (*p2, normals, width);
-                  gfloat       distance = gimp_vector2_length_val (gimp_vector2_sub_val (*p1, *p2));
+                  GimpVector2  vect1 = pair2normal (p1, normals, width);
+                  GimpVector2  vect2 = pair2normal (p2, normals, width);
+                  gfloat       distance = gimp_vector2_length_val (gimp_vector2_sub_val (p1, p2));
                   gint         transitions;
 
                   gimp_vector2_mul (&vect1, distance);
@@ -1106,14 +1406,15 @@ gimp_line_art_close (GeglBuffer  *buffer,
                   gimp_vector2_mul (&vect2, distance);
                   gimp_vector2_mul (&vect2, spline_roundness);
 
-                  discrete_curve = gimp_lineart_discrete_spline (*p1, vect1, *p2, vect2);
+                  discrete_curve = gimp_lineart_discrete_spline (p1, vect1, p2, vect2);
 
                   transitions = allow_self_intersections ?
-                    gimp_number_of_transitions (discrete_curve, strokes) :
-                    gimp_number_of_transitions (discrete_curve, closed);
+                    gimp_number_of_transitions (discrete_curve, strokes, width, height) :
+                    gimp_number_of_transitions (discrete_curve, closed, width, height);
 
                   if (transitions == 2 &&
-                      gimp_line_art_allow_closure (closed, discrete_curve,
+                      gimp_line_art_allow_closure (closed, width, height,
+                                                   discrete_curve,
                                                    &fill_pixels,
                                                    created_regions_significant_area,
                                                    created_regions_minimum_area - 1))
@@ -1122,28 +1423,17 @@ gimp_line_art_close (GeglBuffer  *buffer,
                         {
                           Pixel p = g_array_index (discrete_curve, Pixel, i);
 
-                          if (p.x >= 0 && p.x < gegl_buffer_get_width (closed) &&
-                              p.y >= 0 && p.y < gegl_buffer_get_height (closed))
+                          if (p.x >= 0 && p.x < width &&
+                              p.y >= 0 && p.y < height)
                             {
-                              guchar val = 2;
-
-                              gegl_buffer_set (closed, GEGL_RECTANGLE ((gint) p.x, (gint) p.y, 1, 1), 0,
-                                               NULL, &val, GEGL_AUTO_ROWSTRIDE);
+                              closed[(gint) p.x + (gint) p.y * width] = 2;
                             }
                         }
-                      g_hash_table_replace (visited, p1,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p1)) + 1));
-                      g_hash_table_replace (visited, p2,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p2)) + 1));
-                      inserted = TRUE;
+                      visited[index1]++;
+                      visited[index2]++;
                     }
                   g_array_free (discrete_curve, TRUE);
                 }
-              if (! inserted)
-                {
-                  g_free (p1);
-                  g_free (p2);
-                }
             }
 
  end3:
@@ -1153,8 +1443,6 @@ gimp_line_art_close (GeglBuffer  *buffer,
             goto end2;
         }
 
-      g_clear_object (&strokes);
-
       /* Draw straight line segments */
       if (segment_max_length > 0)
         {
@@ -1163,8 +1451,7 @@ gimp_line_art_close (GeglBuffer  *buffer,
           point = (Pixel *) keypoints->data;
           for (i = 0; i < keypoints->len; i++)
             {
-              Pixel    *p;
-              gboolean  inserted = FALSE;
+              gint index = (gint) point->x + (gint) point->y * width;
 
               if (gimp_async_is_canceled (async))
                 {
@@ -1173,19 +1460,18 @@ gimp_line_art_close (GeglBuffer  *buffer,
                   goto end2;
                 }
 
-              p  = g_new (Pixel, 1);
-              *p = *point;
-
-              if (! g_hash_table_contains (visited, p) ||
+              if (! visited[index] ||
                   (small_segments_from_spline_sources &&
-                   GPOINTER_TO_INT (g_hash_table_lookup (visited, p)) < end_point_connectivity))
+                   visited[index] < end_point_connectivity))
                 {
-                  GArray *segment = gimp_lineart_line_segment_until_hit (closed, *point,
+                  GArray *segment = gimp_lineart_line_segment_until_hit (closed, width, height,
+                                                                         *point,
                                                                          pair2normal (*point, normals, width),
                                                                          segment_max_length);
 
                   if (segment->len &&
-                      gimp_line_art_allow_closure (closed, segment, &fill_pixels,
+                      gimp_line_art_allow_closure (closed, width, height,
+                                                   segment, &fill_pixels,
                                                    created_regions_significant_area,
                                                    created_regions_minimum_area - 1))
                     {
@@ -1193,20 +1479,14 @@ gimp_line_art_close (GeglBuffer  *buffer,
 
                       for (j = 0; j < segment->len; j++)
                         {
-                          Pixel  p2 = g_array_index (segment, Pixel, j);
-                          guchar val = 2;
+                          Pixel p2 = g_array_index (segment, Pixel, j);
 
-                          gegl_buffer_set (closed, GEGL_RECTANGLE ((gint) p2.x, (gint) p2.y, 1, 1), 0,
-                                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+                          closed[(gint) p2.x + (gint) p2.y * width] = 2;
                         }
-                      g_hash_table_replace (visited, p,
-                                            GINT_TO_POINTER (GPOINTER_TO_INT (g_hash_table_lookup (visited, p)) + 1));
-                      inserted = TRUE;
+                      visited[index]++;
                     }
                   g_array_free (segment, TRUE);
                 }
-              if (! inserted)
-                g_free (p);
               point++;
             }
         }
@@ -1229,26 +1509,24 @@ gimp_line_art_close (GeglBuffer  *buffer,
            * This is mostly a quick'n dirty first implementation which I
            * will improve later.
            */
-          gimp_line_art_simple_fill (closed, (gint) p->x, (gint) p->y);
+          gimp_line_art_simple_fill (closed, width, height,
+                                     (gint) p->x, (gint) p->y);
         }
 
  end2:
       g_list_free_full (fill_pixels, g_free);
-      g_free (normals);
-      g_free (curvatures);
-      g_free (smoothed_curvatures);
       g_clear_pointer (&radii, g_free);
       if (keypoints)
         g_array_free (keypoints, TRUE);
-      g_clear_pointer (&visited, g_hash_table_destroy);
+      g_free (visited);
 
       if (gimp_async_is_stopped (async))
         goto end1;
     }
-  else
-    {
-      g_clear_object (&strokes);
-    }
+
+  closed_buffer = gegl_buffer_new (&extent, babl_format ("Y' u8"));
+  gegl_buffer_set (closed_buffer, &extent, 0, NULL,
+                   closed ? closed : strokes, GEGL_AUTO_ROWSTRIDE);
 
   if (closed_distmap)
     {
@@ -1262,7 +1540,7 @@ gimp_line_art_close (GeglBuffer  *buffer,
       graph = gegl_node_new ();
       input = gegl_node_new_child (graph,
                                    "operation", "gegl:buffer-source",
-                                   "buffer", closed,
+                                   "buffer", closed_buffer,
                                    NULL);
       op  = gegl_node_new_child (graph,
                                  "operation", "gegl:distance-transform",
@@ -1271,253 +1549,274 @@ gimp_line_art_close (GeglBuffer  *buffer,
                                  NULL);
       gegl_node_connect_to (input, "output",
                             op, "input");
-      gegl_node_blit (op, 1.0, gegl_buffer_get_extent (closed),
+      gegl_node_blit (op, 1.0, gegl_buffer_get_extent (closed_buffer),
                       NULL, *closed_distmap,
                       GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
       g_object_unref (graph);
     }
 
+  if (new_cache)
+    {
+      LineArtCache *c = line_art_cache_new ();
+
+      c->width                     = width;
+      c->height                    = height;
+      c->select_transparent        = select_transparent;
+      c->threshold                 = stroke_threshold;
+      c->minimal_lineart_area      = minimal_lineart_area;
+      c->normal_estimate_mask_size = normal_estimate_mask_size;
+
+      c->binary              = binary;
+      c->strokes             = strokes;
+      c->normals             = normals;
+      c->curvatures          = cached_curvatures;
+      c->smoothed_curvatures = smoothed_curvatures;
+
+      binary              = NULL;
+      strokes             = NULL;
+      normals             = NULL;
+      cached_curvatures   = NULL;
+      smoothed_curvatures = NULL;
+
+      *new_cache = c;
+    }
+
  end1:
-  g_clear_object (&strokes);
+  g_free (binary);
+  g_free (strokes);
+  g_free (closed);
+  g_free (normals);
+  g_free (curvatures);
+  g_free (cached_curvatures);
+  g_free (smoothed_curvatures);
 
   if (gimp_async_is_stopped (async))
-    g_clear_object (&closed);
+    g_clear_object (&closed_buffer);
 
-  return closed;
+  return closed_buffer;
+}
+
+/* Returns the bounds of the pixels which differ between @old_mask and
+ * @new_mask in @bounds, or FALSE and an empty rectangle if there are
+ * none.
+ */
+static gboolean
+gimp_line_art_get_changed_bounds (const guchar  *old_mask,
+                                  const guchar  *new_mask,
+                                  gint           width,
+                                  gint           height,
+                                  GeglRectangle *bounds)
+{
+  gint x1 = width;
+  gint y1 = height;
+  gint x2 = 0;
+  gint y2 = 0;
+  gint y;
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *old_row = old_mask + y * width;
+      const guchar *new_row = new_mask + y * width;
+      gint          x;
+
+      if (! memcmp (old_row, new_row, width))
+        continue;
+
+      x = 0;
+      while (old_row[x] == new_row[x])
+        x++;
+      x1 = MIN (x1, x);
+
+      x = width - 1;
+      while (old_row[x] == new_row[x])
+        x--;
+      x2 = MAX (x2, x + 1);
+
+      y1 = MIN (y1, y);
+      y2 = y + 1;
+    }
+
+  if (x1 >= x2)
+    {
+      gegl_rectangle_set (bounds, 0, 0, 0, 0);
+
+      return FALSE;
+    }
+
+  gegl_rectangle_set (bounds, x1, y1, x2 - x1, y2 - y1);
+
+  return TRUE;
 }
 
 static void
-gimp_lineart_denoise (GeglBuffer *buffer,
-                      int         minimum_area,
-                      GimpAsync  *async)
+gimp_line_art_grow_rect (const GeglRectangle *rect,
+                         gint                 margin,
+                         gint                 width,
+                         gint                 height,
+                         GeglRectangle       *dest)
 {
-  /* Keep connected regions with significant area. */
-  GArray   *region;
-  GQueue   *q       = g_queue_new ();
-  gint      width   = gegl_buffer_get_width (buffer);
-  gint      height  = gegl_buffer_get_height (buffer);
-  gboolean *visited = g_new0 (gboolean, width * height);
-  gint      x, y;
+  if (gegl_rectangle_is_empty (rect))
+    {
+      *dest = *rect;
 
-  region = g_array_sized_new (TRUE, TRUE, sizeof (Pixel *), minimum_area);
+      return;
+    }
 
-  for (y = 0; y < height; ++y)
-    for (x = 0; x < width; ++x)
-      {
-        guchar has_stroke;
+  gegl_rectangle_set (dest,
+                      rect->x - margin,
+                      rect->y - margin,
+                      rect->width  + 2 * margin,
+                      rect->height + 2 * margin);
+  gegl_rectangle_intersect (dest, dest, GEGL_RECTANGLE (0, 0, width, height));
+}
 
-        if (gimp_async_is_canceled (async))
-          {
-            gimp_async_abort (async);
+static void
+gimp_line_art_copy_rect (gconstpointer        src,
+                         gint                 src_width,
+                         const GeglRectangle *src_rect,
+                         gpointer             dest,
+                         gint                 dest_width,
+                         gint                 dest_x,
+                         gint                 dest_y,
+                         gint                 bpp)
+{
+  gint y;
 
-            goto end;
-          }
+  for (y = 0; y < src_rect->height; y++)
+    {
+      memcpy ((guchar *) dest +
+              ((dest_y + y) * dest_width + dest_x) * bpp,
+              (const guchar *) src +
+              ((src_rect->y + y) * src_width + src_rect->x) * bpp,
+              src_rect->width * bpp);
+    }
+}
 
-        gegl_buffer_sample (buffer, x, y, NULL, &has_stroke, NULL,
-                            GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-        if (has_stroke && ! visited[x + y * width])
-          {
-            Pixel *p = g_new (Pixel, 1);
-            gint   regionSize = 0;
+/* Keep connected regions with significant area.  Each stroke pixel of
+ * @rect is kept if a search from it finds at least @minimum_area
+ * connected pixels, so that the pixels are processed independently and
+ * only the strokes within @minimum_area of @rect are read.
+ */
+static void
+gimp_lineart_denoise (const guchar        *mask,
+                      guchar              *denoised,
+                      gint                 width,
+                      gint                 height,
+                      const GeglRectangle *rect,
+                      gint                 minimum_area,
+                      GimpAsync           *async)
+{
+  DenoiseData data;
 
-            p->x = x;
-            p->y = y;
+  if (gegl_rectangle_is_empty (rect))
+    return;
 
-            g_queue_push_tail (q, p);
-            visited[x + y * width] = TRUE;
+  data.mask         = mask;
+  data.denoised     = denoised;
+  data.width        = width;
+  data.height       = height;
+  data.minimum_area = MAX (minimum_area, 1);
+  data.async        = async;
 
-            while (! g_queue_is_empty (q))
-              {
-                Pixel *p;
-                gint   p2x;
-                gint   p2y;
+  gegl_parallel_distribute_area (
+    rect, PIXELS_PER_THREAD, GEGL_SPLIT_STRATEGY_AUTO,
+    (GeglParallelDistributeAreaFunc) gimp_lineart_denoise_area,
+    &data);
 
-                if (gimp_async_is_canceled (async))
-                  {
-                    gimp_async_abort (async);
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+}
 
-                    goto end;
-                  }
+static void
+gimp_lineart_denoise_area (const GeglRectangle *area,
+                           DenoiseData         *data)
+{
+  const guchar *mask   = data->mask;
+  gint          width  = data->width;
+  gint          height = data->height;
+  gint         *region = g_new (gint, data->minimum_area);
+  gint          x, y;
 
-                p = (Pixel *) g_queue_pop_head (q);
+  for (y = area->y; y < area->y + area->height; y++)
+    {
+      if (gimp_async_is_canceled (data->async))
+        break;
 
-                p2x = p->x + 1;
-                p2y = p->y;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x +p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x + 1;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x - 1;
-                p2y = p->y + 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
-                p2x = p->x + 1;
-                p2y = p->y - 1;
-                if (p2x >= 0 && p2x < width && p2y >= 0 && p2y < height)
-                  {
-                    gegl_buffer_sample (buffer, p2x, p2y, NULL, &has_stroke, NULL,
-                                        GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                    if (has_stroke && ! visited[p2x + p2y * width])
-                      {
-                        Pixel *p2 = g_new (Pixel, 1);
-
-                        p2->x = p2x;
-                        p2->y = p2y;
-                        g_queue_push_tail (q, p2);
-                        visited[p2x + p2y * width] = TRUE;
-                      }
-                  }
+      for (x = area->x; x < area->x + area->width; x++)
+        {
+          gint region_size = 1;
+          gint k;
 
-                ++regionSize;
-                if (regionSize < minimum_area)
-                  g_array_append_val (region, *p);
-                g_free (p);
-              }
-            if (regionSize < minimum_area)
-              {
-                Pixel *pixel = (Pixel *) region->data;
-                gint   i = 0;
-
-                for (; i < region->len; i++)
+          if (! mask[x + y * width])
+            {
+              data->denoised[x + y * width] = 0;
+              continue;
+            }
+
+          region[0] = x + y * width;
+
+          for (k = 0; k < region_size && region_size < data->minimum_area; k++)
+            {
+              gint px = region[k] % width;
+              gint py = region[k] / width;
+              gint dx, dy;
+
+              for (dy = -1; dy <= 1; dy++)
+                for (dx = -1; dx <= 1; dx++)
                   {
-                    guchar val = 0;
-                    gegl_buffer_set (buffer, GEGL_RECTANGLE (pixel->x, pixel->y, 1, 1), 0,
-                                     NULL, &val, GEGL_AUTO_ROWSTRIDE);
-                    pixel++;
+                    gint p2x = px + dx;
+                    gint p2y = py + dy;
+                    gint p2;
+                    gint j;
+
+                    if (p2x < 0 || p2x >= width  ||
+                        p2y < 0 || p2y >= height ||
+                        region_size == data->minimum_area)
+                      continue;
+
+                    p2 = p2x + p2y * width;
+
+                    if (! mask[p2])
+                      continue;
+
+                    j = 0;
+                    while (j < region_size && region[j] != p2)
+                      j++;
+
+                    if (j == region_size)
+                      region[region_size++] = p2;
                   }
-              }
-            g_array_remove_range (region, 0, region->len);
-          }
-      }
+            }
 
- end:
-  g_array_free (region, TRUE);
-  g_queue_free_full (q, g_free);
-  g_free (visited);
+          if (region_size < data->minimum_area)
+            data->denoised[x + y * width] = 0;
+          else
+            data->denoised[x + y * width] = mask[x + y * width];
+        }
+    }
+
+  g_free (region);
 }
 
 static void
-gimp_lineart_compute_normals_curvatures (GeglBuffer *mask,
-                                         gfloat     *normals,
-                                         gfloat     *curvatures,
-                                         gfloat     *smoothed_curvatures,
-                                         int         normal_estimate_mask_size,
-                                         GimpAsync  *async)
-{
-  gfloat  *edgels_curvatures  = NULL;
-  gfloat  *smoothed_curvature;
-  GArray  *es                 = NULL;
-  Edgel  **e;
-  gint     width              = gegl_buffer_get_width (mask);
-
-  es = gimp_edgelset_new (mask, async);
+gimp_lineart_compute_normals_curvatures (const guchar *mask,
+                                         gint          width,
+                                         gint          height,
+                                         gfloat       *normals,
+                                         gfloat       *curvatures,
+                                         gfloat       *smoothed_curvatures,
+                                         int           normal_estimate_mask_size,
+                                         GimpAsync    *async)
+{
+  EdgelSetData  data;
+  gfloat       *edgels_curvatures = NULL;
+  GArray       *es                = NULL;
+  guint        *rows              = NULL;
+
+  es = gimp_edgelset_new (mask, width, height, &rows, async);
   if (gimp_async_is_stopped (async))
     goto end;
 
-  e = (Edgel **) es->data;
-
   gimp_edgelset_smooth_normals (es, normal_estimate_mask_size, async);
   if (gimp_async_is_stopped (async))
     goto end;
@@ -1526,118 +1825,228 @@ gimp_lineart_compute_normals_curvatures (GeglBuffer *mask,
   if (gimp_async_is_stopped (async))
     goto end;
 
-  while (*e)
-    {
-      const float curvature = ((*e)->curvature > 0.0f) ? (*e)->curvature : 0.0f;
-      const float w         = MAX (1e-8f, curvature * curvature);
+  /* Smooth curvatures on edgels, then take maximum on each pixel. */
+  edgels_curvatures = gimp_lineart_get_smooth_curvatures (es, async);
+  if (gimp_async_is_stopped (async))
+    goto end;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+  data.width               = width;
+  data.height              = height;
+  data.set                 = es;
+  data.rows                = rows;
+  data.edgel_curvatures    = edgels_curvatures;
+  data.normals             = normals;
+  data.curvatures          = curvatures;
+  data.smoothed_curvatures = smoothed_curvatures;
+  data.async               = async;
+
+  /* The edgels of a pixel are contiguous in the set, and those of a row
+   * between two consecutive row offsets, so that rows can be accumulated
+   * independently.
+   */
+  gegl_parallel_distribute_range (
+    height, MAX (1, PIXELS_PER_THREAD / width),
+    (GeglParallelDistributeRangeFunc) gimp_lineart_accumulate_rows,
+    &data);
 
-          goto end;
-        }
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
 
-      normals[((*e)->x + (*e)->y * width) * 2] += w * (*e)->x_normal;
-      normals[((*e)->x + (*e)->y * width) * 2 + 1] += w * (*e)->y_normal;
-      curvatures[(*e)->x + (*e)->y * width] = MAX (curvature,
-                                                   curvatures[(*e)->x + (*e)->y * width]);
-      e++;
-    }
-  for (int y = 0; y < gegl_buffer_get_height (mask); ++y)
-    {
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+ end:
+  g_free (edgels_curvatures);
+  g_free (rows);
 
-          goto end;
-        }
+  if (es)
+    g_array_free (es, TRUE);
+}
 
-      for (int x = 0; x < gegl_buffer_get_width (mask); ++x)
-        {
-          const float _angle = atan2f (normals[(x + y * width) * 2 + 1],
-                                       normals[(x + y * width) * 2]);
-          normals[(x + y * width) * 2] = cosf (_angle);
-          normals[(x + y * width) * 2 + 1] = sinf (_angle);
-        }
+/* Like gimp_lineart_compute_normals_curvatures(), but only updates the
+ * pixels of @rect in the full-image arrays, computing them from the
+ * strokes around @rect which can affect them.
+ */
+static void
+gimp_lineart_update_normals_curvatures (const guchar        *mask,
+                                        gint                 width,
+                                        gint                 height,
+                                        const GeglRectangle *rect,
+                                        gfloat              *normals,
+                                        gfloat              *curvatures,
+                                        gfloat              *smoothed_curvatures,
+                                        int                  normal_estimate_mask_size,
+                                        GimpAsync           *async)
+{
+  GeglRectangle  window;
+  GeglRectangle  roi;
+  guchar        *window_mask;
+  gfloat        *window_normals;
+  gfloat        *window_curvatures;
+  gfloat        *window_smoothed_curvatures;
+  gint           n_pixels;
+
+  if (gegl_rectangle_is_empty (rect))
+    return;
+
+  /* Edgels at the border of the window, where the strokes are cut, are
+   * too far to affect @rect.
+   */
+  gimp_line_art_grow_rect (rect, EDGEL_REACH (normal_estimate_mask_size),
+                           width, height, &window);
+
+  n_pixels = window.width * window.height;
+
+  window_mask                = g_new  (guchar, n_pixels);
+  window_normals             = g_new0 (gfloat, n_pixels * 2);
+  window_curvatures          = g_new0 (gfloat, n_pixels);
+  window_smoothed_curvatures = g_new0 (gfloat, n_pixels);
+
+  gimp_line_art_copy_rect (mask, width, &window,
+                           window_mask, window.width, 0, 0,
+                           sizeof (guchar));
+
+  gimp_lineart_compute_normals_curvatures (window_mask,
+                                           window.width, window.height,
+                                           window_normals,
+                                           window_curvatures,
+                                           window_smoothed_curvatures,
+                                           normal_estimate_mask_size,
+                                           async);
+
+  if (! gimp_async_is_stopped (async))
+    {
+      gegl_rectangle_set (&roi,
+                          rect->x - window.x, rect->y - window.y,
+                          rect->width, rect->height);
+
+      gimp_line_art_copy_rect (window_normals, window.width, &roi,
+                               normals, width, rect->x, rect->y,
+                               sizeof (gfloat) * 2);
+      gimp_line_art_copy_rect (window_curvatures, window.width, &roi,
+                               curvatures, width, rect->x, rect->y,
+                               sizeof (gfloat));
+      gimp_line_art_copy_rect (window_smoothed_curvatures, window.width, &roi,
+                               smoothed_curvatures, width, rect->x, rect->y,
+                               sizeof (gfloat));
     }
 
-  /* Smooth curvatures on edgels, then take maximum on each pixel. */
-  edgels_curvatures = gimp_lineart_get_smooth_curvatures (es, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
+  g_free (window_mask);
+  g_free (window_normals);
+  g_free (window_curvatures);
+  g_free (window_smoothed_curvatures);
+}
 
-  smoothed_curvature = edgels_curvatures;
+static void
+gimp_lineart_accumulate_rows (gsize         offset,
+                              gsize         size,
+                              EdgelSetData *data)
+{
+  const Edgel *edgels = (const Edgel *) data->set->data;
+  gint         width  = data->width;
+  gint         y;
 
-  e = (Edgel **) es->data;
-  while (*e)
+  for (y = offset; y < offset + size; y++)
     {
-      gfloat *pixel_curvature = &smoothed_curvatures[(*e)->x + (*e)->y * width];
+      guint i;
+      gint  x;
 
-      if (*pixel_curvature < *smoothed_curvature)
-        *pixel_curvature = *smoothed_curvature;
+      if (gimp_async_is_canceled (data->async))
+        return;
 
-      ++smoothed_curvature;
-      e++;
-    }
+      for (i = data->rows[y]; i < data->rows[y + 1]; i++)
+        {
+          const Edgel *e         = &edgels[i];
+          const float  curvature = (e->curvature > 0.0f) ? e->curvature : 0.0f;
+          const float  w         = MAX (1e-8f, curvature * curvature);
+          gint         index     = e->x + e->y * width;
+
+          data->normals[index * 2]     += w * e->x_normal;
+          data->normals[index * 2 + 1] += w * e->y_normal;
+          data->curvatures[index] = MAX (curvature,
+                                         data->curvatures[index]);
+
+          if (data->smoothed_curvatures[index] < data->edgel_curvatures[i])
+            data->smoothed_curvatures[index] = data->edgel_curvatures[i];
+        }
 
- end:
-  g_free (edgels_curvatures);
+      for (x = 0; x < width; x++)
+        {
+          gfloat      *normal = &data->normals[(x + y * width) * 2];
+          const float  _angle = atan2f (normal[1], normal[0]);
 
-  if (es)
-    g_array_free (es, TRUE);
+          normal[0] = cosf (_angle);
+          normal[1] = sinf (_angle);
+        }
+    }
 }
 
 static gfloat *
 gimp_lineart_get_smooth_curvatures (GArray    *edgelset,
                                     GimpAsync *async)
 {
-  Edgel  **e;
-  gfloat  *smoothed_curvatures = g_new0 (gfloat, edgelset->len);
-  gfloat   weights[9];
-  gfloat   smoothed_curvature;
-  gfloat   weights_sum;
-  gint     idx = 0;
+  EdgelSetData  data;
+  gfloat       *smoothed_curvatures = g_new0 (gfloat, edgelset->len);
+  gfloat        weights[9];
 
   weights[0] = 1.0f;
   for (int i = 1; i <= 8; ++i)
     weights[i] = expf (-(i * i) / 30.0f);
 
-  e = (Edgel **) edgelset->data;
-  while (*e)
+  data.set              = edgelset;
+  data.weights          = weights;
+  data.edgel_curvatures = smoothed_curvatures;
+  data.async            = async;
+
+  gegl_parallel_distribute_range (
+    edgelset->len, PIXELS_PER_THREAD,
+    (GeglParallelDistributeRangeFunc) gimp_lineart_smooth_curvatures_range,
+    &data);
+
+  if (gimp_async_is_canceled (async))
     {
-      Edgel *edgel_before = g_array_index (edgelset, Edgel*, (*e)->previous);
-      Edgel *edgel_after  = g_array_index (edgelset, Edgel*, (*e)->next);
-      int    n = 5;
-      int    i = 1;
+      gimp_async_abort (async);
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+      g_free (smoothed_curvatures);
 
-          g_free (smoothed_curvatures);
+      return NULL;
+    }
 
-          return NULL;
-        }
+  return smoothed_curvatures;
+}
+
+static void
+gimp_lineart_smooth_curvatures_range (gsize         offset,
+                                      gsize         size,
+                                      EdgelSetData *data)
+{
+  const Edgel *edgels = (const Edgel *) data->set->data;
+  gsize        idx;
 
-      smoothed_curvature = (*e)->curvature;
-      weights_sum = weights[0];
+  if (gimp_async_is_canceled (data->async))
+    return;
+
+  for (idx = offset; idx < offset + size; idx++)
+    {
+      const Edgel *e            = &edgels[idx];
+      const Edgel *edgel_before = &edgels[e->previous];
+      const Edgel *edgel_after  = &edgels[e->next];
+      gfloat       smoothed_curvature;
+      gfloat       weights_sum;
+      int          n = 5;
+      int          i = 1;
+
+      smoothed_curvature = e->curvature;
+      weights_sum = data->weights[0];
       while (n-- && (edgel_after != edgel_before))
         {
-          smoothed_curvature += weights[i] * edgel_before->curvature;
-          smoothed_curvature += weights[i] * edgel_after->curvature;
-          edgel_before = g_array_index (edgelset, Edgel*, edgel_before->previous);
-          edgel_after  = g_array_index (edgelset, Edgel*, edgel_after->next);
-          weights_sum += 2 * weights[i];
+          smoothed_curvature += data->weights[i] * edgel_before->curvature;
+          smoothed_curvature += data->weights[i] * edgel_after->curvature;
+          edgel_before = &edgels[edgel_before->previous];
+          edgel_after  = &edgels[edgel_after->next];
+          weights_sum += 2 * data->weights[i];
           i++;
         }
       smoothed_curvature /= weights_sum;
-      smoothed_curvatures[idx++] = smoothed_curvature;
-
-      e++;
+      data->edgel_curvatures[idx] = smoothed_curvature;
     }
-
-  return smoothed_curvatures;
 }
 
 /**
@@ -2009,31 +2418,33 @@ gimp_lineart_discrete_spline (Pixel       p0,
 }
 
 static gint
-gimp_number_of_transitions (GArray     *pixels,
-                            GeglBuffer *buffer)
+gimp_number_of_transitions (GArray       *pixels,
+                            const guchar *mask,
+                            gint          width,
+                            gint          height)
 {
   int result = 0;
 
   if (pixels->len > 0)
     {
       Pixel    it = g_array_index (pixels, Pixel, 0);
-      guchar   value;
       gboolean previous;
       gint     i;
 
-      gegl_buffer_sample (buffer, (gint) it.x, (gint) it.y, NULL, &value, NULL,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      previous = (gboolean) value;
+      previous = (gboolean) mask_value (mask, width, height,
+                                        (gint) it.x, (gint) it.y);
 
       /* Starts at the second element. */
       for (i = 1; i < pixels->len; i++)
         {
+          gboolean value;
+
           it = g_array_index (pixels, Pixel, i);
 
-          gegl_buffer_sample (buffer, (gint) it.x, (gint) it.y, NULL, &value, NULL,
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          result += ((gboolean) value != previous);
-          previous = (gboolean) value;
+          value = (gboolean) mask_value (mask, width, height,
+                                         (gint) it.x, (gint) it.y);
+          result += (value != previous);
+          previous = value;
         }
     }
 
@@ -2043,6 +2454,8 @@ gimp_number_of_transitions (GArray     *pixels,
 /**
  * gimp_line_art_allow_closure:
  * @mask: the current state of line art closure.
+ * @width: the width of @mask.
+ * @height: the height of @mask.
  * @pixels: the pixels of a candidate closure (spline or segment).
  * @fill_pixels: #GList of unsignificant pixels to bucket fill.
  * @significant_size: number of pixels for area to be considered
@@ -2063,11 +2476,13 @@ gimp_number_of_transitions (GArray     *pixels,
  * Returns: #TRUE if @pixels should be added to @mask, #FALSE otherwise.
  */
 static gboolean
-gimp_line_art_allow_closure (GeglBuffer *mask,
-                             GArray     *pixels,
-                             GList     **fill_pixels,
-                             int         significant_size,
-                             int         minimum_size)
+gimp_line_art_allow_closure (guchar  *mask,
+                             gint     width,
+                             gint     height,
+                             GArray  *pixels,
+                             GList  **fill_pixels,
+                             int      significant_size,
+                             int      minimum_size)
 {
   /* A theorem from the paper is that a zone with more than
    * `2 * (@minimum_size - 1)` edgels (border pixels) will have more
@@ -2084,16 +2499,12 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
   /* Mark pixels */
   for (i = 0; i < pixels->len; i++)
     {
-      if (p->x >= 0 && p->x < gegl_buffer_get_width (mask) &&
-          p->y >= 0 && p->y < gegl_buffer_get_height (mask))
+      if (p->x >= 0 && p->x < width &&
+          p->y >= 0 && p->y < height)
         {
-          guchar val;
+          guchar *val = &mask[(gint) p->x + (gint) p->y * width];
 
-          gegl_buffer_sample (mask, (gint) p->x, (gint) p->y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          val = val ? 3 : 2;
-          gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p->x, (gint) p->y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+          *val = *val ? 3 : 2;
         }
       p++;
     }
@@ -2104,18 +2515,15 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
 
       for (int direction = 0; direction < 4; ++direction)
         {
-          if (p.x >= 0 && p.x < gegl_buffer_get_width (mask) &&
-              p.y >= 0 && p.y < gegl_buffer_get_height (mask) &&
-              border_in_direction (mask, p, direction))
+          if (p.x >= 0 && p.x < width &&
+              p.y >= 0 && p.y < height &&
+              border_in_direction (mask, width, height, p, direction))
             {
               Edgel  e;
-              guchar val;
               glong  count;
               glong  area;
 
-              gegl_buffer_sample (mask, (gint) p.x, (gint) p.y, NULL, &val,
-                                  NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-              if ((gboolean) (val & (4 << direction)))
+              if ((gboolean) (mask[(gint) p.x + (gint) p.y * width] & (4 << direction)))
                 continue;
 
               gimp_edgel_init (&e);
@@ -2123,10 +2531,11 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
               e.y = p.y;
               e.direction = direction;
 
-              count = gimp_edgel_track_mark (mask, e, max_edgel_count);
+              count = gimp_edgel_track_mark (mask, width, height,
+                                             e, max_edgel_count);
               if ((count != -1) && (count <= max_edgel_count))
                 {
-                  area = gimp_edgel_region_area (mask, e);
+                  area = gimp_edgel_region_area (mask, width, height, e);
 
                   if (area >= significant_size && area <= minimum_size)
                     {
@@ -2137,16 +2546,10 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
                         {
                           Pixel p2 = g_array_index (pixels, Pixel, j);
 
-                          if (p2.x >= 0 && p2.x < gegl_buffer_get_width (mask) &&
-                              p2.y >= 0 && p2.y < gegl_buffer_get_height (mask))
+                          if (p2.x >= 0 && p2.x < width &&
+                              p2.y >= 0 && p2.y < height)
                             {
-                              guchar val;
-
-                              gegl_buffer_sample (mask, (gint) p2.x, (gint) p2.y, NULL, &val,
-                                                  NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-                              val &= 1;
-                              gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p2.x, (gint) p2.y, 1, 1), 0,
-                                               NULL, &val, GEGL_AUTO_ROWSTRIDE);
+                              mask[(gint) p2.x + (gint) p2.y * width] &= 1;
                             }
                         }
                       g_list_free_full (fp, g_free);
@@ -2160,8 +2563,8 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
                       np->x = direction == XPlusDirection ? p.x + 1 : (direction == XMinusDirection ? p.x - 1 : p.x);
                       np->y = direction == YPlusDirection ? p.y + 1 : (direction == YMinusDirection ? p.y - 1 : p.y);
 
-                      if (np->x >= 0 && np->x < gegl_buffer_get_width (mask) &&
-                          np->y >= 0 && np->y < gegl_buffer_get_height (mask))
+                      if (np->x >= 0 && np->x < width &&
+                          np->y >= 0 && np->y < height)
                         fp = g_list_prepend (fp, np);
                       else
                         g_free (np);
@@ -2177,28 +2580,23 @@ gimp_line_art_allow_closure (GeglBuffer *mask,
     {
       Pixel p = g_array_index (pixels, Pixel, i);
 
-      if (p.x >= 0 && p.x < gegl_buffer_get_width (mask) &&
-          p.y >= 0 && p.y < gegl_buffer_get_height (mask))
+      if (p.x >= 0 && p.x < width &&
+          p.y >= 0 && p.y < height)
         {
-          guchar val;
-
-          gegl_buffer_sample (mask, (gint) p.x, (gint) p.y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          val &= 1;
-          gegl_buffer_set (mask, GEGL_RECTANGLE ((gint) p.x, (gint) p.y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+          mask[(gint) p.x + (gint) p.y * width] &= 1;
         }
     }
   return TRUE;
 }
 
 static GArray *
-gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
-                                     Pixel             start,
-                                     GimpVector2       direction,
-                                     int               size)
+gimp_lineart_line_segment_until_hit (const guchar *mask,
+                                     gint          width,
+                                     gint          height,
+                                     Pixel         start,
+                                     GimpVector2   direction,
+                                     int           size)
 {
-  GeglBuffer  *buffer = (GeglBuffer *) mask;
   gboolean     out = FALSE;
   GArray      *points = g_array_new (FALSE, TRUE, sizeof (Pixel));
   int          tmax;
@@ -2217,12 +2615,11 @@ gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
 
       p.x = (gint) round (v.x);
       p.y = (gint) round (v.y);
-      if (p.x >= 0 && p.x < gegl_buffer_get_width (buffer) &&
-          p.y >= 0 && p.y < gegl_buffer_get_height (buffer))
+      if (p.x >= 0 && p.x < width &&
+          p.y >= 0 && p.y < height)
         {
-          guchar val;
-          gegl_buffer_sample (buffer, p.x, p.y, NULL, &val,
-                              NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+          guchar val = mask[(gint) p.x + (gint) p.y * width];
+
           if (out && val)
             {
               return points;
@@ -2246,25 +2643,32 @@ gimp_lineart_line_segment_until_hit (const GeglBuffer *mask,
 }
 
 static gfloat *
-gimp_lineart_estimate_strokes_radii (GeglBuffer *mask,
-                                     GimpAsync  *async)
-{
-  GeglBufferIterator *gi;
-  gfloat             *dist;
-  gfloat             *thickness;
-  GeglNode           *graph;
-  GeglNode           *input;
-  GeglNode           *op;
-  gint                width  = gegl_buffer_get_width (mask);
-  gint                height = gegl_buffer_get_height (mask);
+gimp_lineart_estimate_strokes_radii (const guchar *mask,
+                                     gint          width,
+                                     gint          height,
+                                     GimpAsync    *async)
+{
+  RadiiData   data;
+  GeglBuffer *buffer;
+  gfloat     *dist;
+  gfloat     *thickness;
+  GeglNode   *graph;
+  GeglNode   *input;
+  GeglNode   *op;
 
   /* Compute a distance map for the line art. */
   dist = g_new (gfloat, width * height);
 
+  buffer = gegl_buffer_linear_new_from_data ((gpointer) mask,
+                                             babl_format ("Y' u8"),
+                                             GEGL_RECTANGLE (0, 0, width, height),
+                                             GEGL_AUTO_ROWSTRIDE,
+                                             NULL, NULL);
+
   graph = gegl_node_new ();
   input = gegl_node_new_child (graph,
                                "operation", "gegl:buffer-source",
-                               "buffer", mask,
+                               "buffer", buffer,
                                NULL);
   op  = gegl_node_new_child (graph,
                              "operation", "gegl:distance-transform",
@@ -2272,191 +2676,193 @@ gimp_lineart_estimate_strokes_radii (GeglBuffer *mask,
                              "normalize", FALSE,
                              NULL);
   gegl_node_connect_to (input, "output", op, "input");
-  gegl_node_blit (op, 1.0, gegl_buffer_get_extent (mask),
+  gegl_node_blit (op, 1.0, GEGL_RECTANGLE (0, 0, width, height),
                   NULL, dist, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
   g_object_unref (graph);
+  g_object_unref (buffer);
 
   thickness = g_new0 (gfloat, width * height);
-  gi = gegl_buffer_iterator_new (mask, NULL, 0, NULL,
-                                 GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
-  while (gegl_buffer_iterator_next (gi))
-    {
-      guint8 *m = (guint8*) gi->items[0].data;
-      gint    startx = gi->items[0].roi.x;
-      gint    starty = gi->items[0].roi.y;
-      gint    endy   = starty + gi->items[0].roi.height;
-      gint    endx   = startx + gi->items[0].roi.width;
-      gint    x;
-      gint    y;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gegl_buffer_iterator_stop (gi);
-
-          gimp_async_abort (async);
-
-          goto end;
-        }
+  data.mask      = mask;
+  data.dist      = dist;
+  data.thickness = thickness;
+  data.width     = width;
+  data.height    = height;
+  data.async     = async;
 
-      for (y = starty; y < endy; y++)
-        for (x = startx; x < endx; x++)
-          {
-            if (*m && dist[x + y * width] == 1.0)
-              {
-                gint     dx = x;
-                gint     dy = y;
-                gfloat   d  = 1.0;
-                gfloat   nd;
-                gboolean neighbour_thicker = TRUE;
-
-                while (neighbour_thicker)
-                  {
-                    gint px = dx - 1;
-                    gint py = dy - 1;
-                    gint nx = dx + 1;
-                    gint ny = dy + 1;
-
-                    neighbour_thicker = FALSE;
-                    if (px >= 0)
-                      {
-                        if ((nd = dist[px + dy * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (py >= 0 && (nd = dist[px + py * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            dy = py;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (ny < height && (nd = dist[px + ny * width]) > d)
-                          {
-                            d = nd;
-                            dx = px;
-                            dy = ny;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                      }
-                    if (nx < width)
-                      {
-                        if ((nd = dist[nx + dy * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (py >= 0 && (nd = dist[nx + py * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            dy = py;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                        if (ny < height && (nd = dist[nx + ny * width]) > d)
-                          {
-                            d = nd;
-                            dx = nx;
-                            dy = ny;
-                            neighbour_thicker = TRUE;
-                            continue;
-                          }
-                      }
-                    if (py > 0 && (nd = dist[dx + py * width]) > d)
-                      {
-                        d = nd;
-                        dy = py;
-                        neighbour_thicker = TRUE;
-                        continue;
-                      }
-                    if (ny < height && (nd = dist[dx + ny * width]) > d)
-                      {
-                        d = nd;
-                        dy = ny;
-                        neighbour_thicker = TRUE;
-                        continue;
-                      }
-                  }
-                thickness[(gint) x + (gint) y * width] = d;
-              }
-            m++;
-          }
-    }
+  gegl_parallel_distribute_range (
+    height, MAX (1, PIXELS_PER_THREAD / width),
+    (GeglParallelDistributeRangeFunc) gimp_lineart_estimate_strokes_radii_rows,
+    &data);
 
- end:
   g_free (dist);
 
-  if (gimp_async_is_stopped (async))
-    g_clear_pointer (&thickness, g_free);
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      g_clear_pointer (&thickness, g_free);
+    }
 
   return thickness;
 }
 
 static void
-gimp_line_art_simple_fill (GeglBuffer *buffer,
-                           gint        x,
-                           gint        y)
+gimp_lineart_estimate_strokes_radii_rows (gsize      offset,
+                                          gsize      size,
+                                          RadiiData *data)
 {
-  guchar val;
+  const gfloat *dist   = data->dist;
+  gint          width  = data->width;
+  gint          height = data->height;
+  gint          x;
+  gint          y;
 
-  if (x < 0 || x >= gegl_buffer_get_width (buffer) ||
-      y < 0 || y >= gegl_buffer_get_height (buffer))
-    return;
+  for (y = offset; y < offset + size; y++)
+    {
+      const guchar *m = data->mask + y * width;
 
-  gegl_buffer_sample (buffer, x, y, NULL, &val,
-                      NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+      if (gimp_async_is_canceled (data->async))
+        return;
 
-  if (! val)
-    {
-      val = 1;
-      gegl_buffer_set (buffer, GEGL_RECTANGLE (x, y, 1, 1), 0,
-                       NULL, &val, GEGL_AUTO_ROWSTRIDE);
-      gimp_line_art_simple_fill (buffer, x + 1, y);
-      gimp_line_art_simple_fill (buffer, x - 1, y);
-      gimp_line_art_simple_fill (buffer, x, y + 1);
-      gimp_line_art_simple_fill (buffer, x, y - 1);
+      for (x = 0; x < width; x++)
+        {
+          if (*m && dist[x + y * width] == 1.0)
+            {
+              gint     dx = x;
+              gint     dy = y;
+              gfloat   d  = 1.0;
+              gfloat   nd;
+              gboolean neighbour_thicker = TRUE;
+
+              while (neighbour_thicker)
+                {
+                  gint px = dx - 1;
+                  gint py = dy - 1;
+                  gint nx = dx + 1;
+                  gint ny = dy + 1;
+
+                  neighbour_thicker = FALSE;
+                  if (px >= 0)
+                    {
+                      if ((nd = dist[px + dy * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (py >= 0 && (nd = dist[px + py * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          dy = py;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (ny < height && (nd = dist[px + ny * width]) > d)
+                        {
+                          d = nd;
+                          dx = px;
+                          dy = ny;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                    }
+                  if (nx < width)
+                    {
+                      if ((nd = dist[nx + dy * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (py >= 0 && (nd = dist[nx + py * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          dy = py;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                      if (ny < height && (nd = dist[nx + ny * width]) > d)
+                        {
+                          d = nd;
+                          dx = nx;
+                          dy = ny;
+                          neighbour_thicker = TRUE;
+                          continue;
+                        }
+                    }
+                  if (py > 0 && (nd = dist[dx + py * width]) > d)
+                    {
+                      d = nd;
+                      dy = py;
+                      neighbour_thicker = TRUE;
+                      continue;
+                    }
+                  if (ny < height && (nd = dist[dx + ny * width]) > d)
+                    {
+                      d = nd;
+                      dy = ny;
+                      neighbour_thicker = TRUE;
+                      continue;
+                    }
+                }
+              data->thickness[x + y * width] = d;
+            }
+          m++;
+        }
     }
 }
 
-static guint
-visited_hash_fun (Pixel *key)
+static void
+gimp_line_art_simple_fill (guchar *mask,
+                           gint    width,
+                           gint    height,
+                           gint    x,
+                           gint    y)
 {
-  /* Cantor pairing function. */
-  return (key->x + key->y) * (key->x + key->y + 1) / 2 + key->y;
+  if (x < 0 || x >= width ||
+      y < 0 || y >= height)
+    return;
+
+  if (! mask[x + y * width])
+    {
+      mask[x + y * width] = 1;
+      gimp_line_art_simple_fill (mask, width, height, x + 1, y);
+      gimp_line_art_simple_fill (mask, width, height, x - 1, y);
+      gimp_line_art_simple_fill (mask, width, height, x, y + 1);
+      gimp_line_art_simple_fill (mask, width, height, x, y - 1);
+    }
 }
 
-static gboolean
-visited_equal_fun (Pixel *e1,
-                   Pixel *e2)
+static inline guchar
+mask_value (const guchar *mask,
+            gint          width,
+            gint          height,
+            gint          x,
+            gint          y)
 {
-  return (e1->x == e2->x && e1->y == e2->y);
+  if (x >= 0 && x < width &&
+      y >= 0 && y < height)
+    return mask[x + y * width];
+
+  return 0;
 }
 
 static inline gboolean
-border_in_direction (GeglBuffer *mask,
-                     Pixel       p,
-                     int         direction)
+border_in_direction (const guchar *mask,
+                     gint          width,
+                     gint          height,
+                     Pixel         p,
+                     int           direction)
 {
   gint px = (gint) p.x + DeltaX[direction];
   gint py = (gint) p.y + DeltaY[direction];
 
-  if (px >= 0 && px < gegl_buffer_get_width (mask) &&
-      py >= 0 && py < gegl_buffer_get_height (mask))
-    {
-      guchar val;
-
-      gegl_buffer_sample (mask, px, py, NULL, &val,
-                          NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      return ! ((gboolean) val);
-    }
-  return TRUE;
+  return ! ((gboolean) mask_value (mask, width, height, px, py));
 }
 
 static inline GimpVector2
@@ -2469,22 +2875,6 @@ pair2normal (Pixel   p,
 }
 /* Edgel functions */
 
-static Edgel *
-gimp_edgel_new (int       x,
-                int       y,
-                Direction direction)
-{
-  Edgel *edgel = g_new (Edgel, 1);
-
-  edgel->x         = x;
-  edgel->y         = y;
-  edgel->direction = direction;
-
-  gimp_edgel_init (edgel);
-
-  return edgel;
-}
-
 static void
 gimp_edgel_init (Edgel *edgel)
 {
@@ -2494,12 +2884,6 @@ gimp_edgel_init (Edgel *edgel)
   edgel->next      = edgel->previous = G_MAXUINT;
 }
 
-static void
-gimp_edgel_clear (Edgel **edgel)
-{
-  g_clear_pointer (edgel, g_free);
-}
-
 static int
 gimp_edgel_cmp (const Edgel* e1,
                 const Edgel* e2)
@@ -2516,25 +2900,10 @@ gimp_edgel_cmp (const Edgel* e1,
     return 1;
 }
 
-static guint
-edgel2index_hash_fun (Edgel *key)
-{
-  /* Cantor pairing function.
-   * Was not sure how to use the direction though. :-/
-   */
-  return (key->x + key->y) * (key->x + key->y + 1) / 2 + key->y * key->direction;
-}
-
-static gboolean
-edgel2index_equal_fun (Edgel *e1,
-                       Edgel *e2)
-{
-  return (e1->x == e2->x && e1->y == e2->y &&
-          e1->direction == e2->direction);
-}
-
 /**
  * @mask;
+ * @width:
+ * @height:
  * @edgel:
  * @size_limit:
  *
@@ -2546,30 +2915,29 @@ edgel2index_equal_fun (Edgel *e1,
  *          has been encountered.
  */
 static glong
-gimp_edgel_track_mark (GeglBuffer *mask,
-                       Edgel       edgel,
-                       long        size_limit)
+gimp_edgel_track_mark (guchar *mask,
+                       gint    width,
+                       gint    height,
+                       Edgel   edgel,
+                       long    size_limit)
 {
   Edgel start = edgel;
   long  count = 1;
 
   do
     {
-      guchar val;
+      guchar *val;
 
-      gimp_edgelset_next8 (mask, &edgel, &edgel);
-      gegl_buffer_sample (mask, edgel.x, edgel.y, NULL, &val,
-                          NULL, GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-      if (val & 2)
+      gimp_edgelset_next8 (mask, width, height, &edgel, &edgel);
+      val = &mask[edgel.x + edgel.y * width];
+      if (*val & 2)
         {
           /* Only mark pixels of the spline/segment */
-          if (val & (4 << edgel.direction))
+          if (*val & (4 << edgel.direction))
             return -1;
 
           /* Mark edgel in pixel (1 == In Mask, 2 == Spline/Segment) */
-          val |= (4 << edgel.direction);
-          gegl_buffer_set (mask, GEGL_RECTANGLE (edgel.x, edgel.y, 1, 1), 0,
-                           NULL, &val, GEGL_AUTO_ROWSTRIDE);
+          *val |= (4 << edgel.direction);
         }
       if (gimp_edgel_cmp (&edgel, &start) != 0)
         ++count;
@@ -2582,6 +2950,8 @@ gimp_edgel_track_mark (GeglBuffer *mask,
 /**
  * gimp_edgel_region_area:
  * @mask: current state of closed line art buffer.
+ * @width: the width of @mask.
+ * @height: the height of @mask.
  * @start_edgel: edgel to follow.
  *
  * Follows a line border, starting from @start_edgel to compute the area
@@ -2594,8 +2964,10 @@ gimp_edgel_track_mark (GeglBuffer *mask,
  * if the zone is not closed (hence actual area unknown).
  */
 static glong
-gimp_edgel_region_area (const GeglBuffer *mask,
-                        Edgel             start_edgel)
+gimp_edgel_region_area (const guchar *mask,
+                        gint          width,
+                        gint          height,
+                        Edgel         start_edgel)
 {
   Edgel edgel = start_edgel;
   glong area = 0;
@@ -2607,7 +2979,7 @@ gimp_edgel_region_area (const GeglBuffer *mask,
       else if (edgel.direction == XMinusDirection)
         area += edgel.x - 1;
 
-      gimp_edgelset_next8 (mask, &edgel, &edgel);
+      gimp_edgelset_next8 (mask, width, height, &edgel, &edgel);
     }
   while (gimp_edgel_cmp (&edgel, &start_edgel) != 0);
 
@@ -2616,88 +2988,70 @@ gimp_edgel_region_area (const GeglBuffer *mask,
 
 /* Edgel sets */
 
+/* The edgels are stored by value, sorted by row then column, and
+ * @rows receives the index of the first edgel of each row, followed by
+ * the number of edgels, so that the edgels of a pixel can be looked up
+ * without a hash table.
+ */
 static GArray *
-gimp_edgelset_new (GeglBuffer *buffer,
-                   GimpAsync  *async)
+gimp_edgelset_new (const guchar  *mask,
+                   gint           width,
+                   gint           height,
+                   guint        **rows,
+                   GimpAsync     *async)
 {
-  GeglBufferIterator *gi;
-  GArray             *set;
-  GHashTable         *edgel2index;
-  gint                width  = gegl_buffer_get_width (buffer);
-  gint                height = gegl_buffer_get_height (buffer);
+  EdgelSetData  data;
+  GArray       *set;
+  gint          y;
 
-  set = g_array_new (TRUE, TRUE, sizeof (Edgel *));
-  g_array_set_clear_func (set, (GDestroyNotify) gimp_edgel_clear);
+  set   = g_array_new (FALSE, FALSE, sizeof (Edgel));
+  *rows = g_new0 (guint, height + 1);
 
   if (width <= 1 || height <= 1)
     return set;
 
-  edgel2index = g_hash_table_new ((GHashFunc) edgel2index_hash_fun,
-                                  (GEqualFunc) edgel2index_equal_fun);
-
-  gi = gegl_buffer_iterator_new (buffer, GEGL_RECTANGLE (0, 0, width, height),
-                                 0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 5);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (0, -1, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (0, 1, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (-1, 0, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  gegl_buffer_iterator_add (gi, buffer, GEGL_RECTANGLE (1, 0, width, height),
-                            0, NULL, GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-  while (gegl_buffer_iterator_next (gi))
+  data.mask   = mask;
+  data.width  = width;
+  data.height = height;
+  data.set    = set;
+  data.rows   = *rows;
+  data.async  = async;
+
+  /* Count the edgels of each row, so that the rows can then be filled
+   * in parallel.
+   */
+  gegl_parallel_distribute_range (
+    height, MAX (1, PIXELS_PER_THREAD / width),
+    (GeglParallelDistributeRangeFunc) gimp_edgelset_count_rows,
+    &data);
+
+  if (gimp_async_is_canceled (async))
     {
-      guint8 *p      = (guint8*) gi->items[0].data;
-      guint8 *prevy  = (guint8*) gi->items[1].data;
-      guint8 *nexty  = (guint8*) gi->items[2].data;
-      guint8 *prevx  = (guint8*) gi->items[3].data;
-      guint8 *nextx  = (guint8*) gi->items[4].data;
-      gint    startx = gi->items[0].roi.x;
-      gint    starty = gi->items[0].roi.y;
-      gint    endy   = starty + gi->items[0].roi.height;
-      gint    endx   = startx + gi->items[0].roi.width;
-      gint    x;
-      gint    y;
+      gimp_async_abort (async);
 
-      if (gimp_async_is_canceled (async))
-        {
-          gegl_buffer_iterator_stop (gi);
+      goto end;
+    }
 
-          gimp_async_abort (async);
+  for (y = 0; y < height; y++)
+    (*rows)[y + 1] += (*rows)[y];
 
-          goto end;
-        }
+  g_array_set_size (set, (*rows)[height]);
 
-      for (y = starty; y < endy; y++)
-        for (x = startx; x < endx; x++)
-          {
-            if (*(p++))
-              {
-                if (! *prevy)
-                  gimp_edgelset_add (set, x, y, YMinusDirection, edgel2index);
-                if (! *nexty)
-                  gimp_edgelset_add (set, x, y, YPlusDirection, edgel2index);
-                if (! *prevx)
-                  gimp_edgelset_add (set, x, y, XMinusDirection, edgel2index);
-                if (! *nextx)
-                  gimp_edgelset_add (set, x, y, XPlusDirection, edgel2index);
-              }
-            prevy++;
-            nexty++;
-            prevx++;
-            nextx++;
-          }
-    }
+  gegl_parallel_distribute_range (
+    height, MAX (1, PIXELS_PER_THREAD / width),
+    (GeglParallelDistributeRangeFunc) gimp_edgelset_fill_rows,
+    &data);
 
-  gimp_edgelset_build_graph (set, buffer, edgel2index, async);
-  if (gimp_async_is_stopped (async))
-    goto end;
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      goto end;
+    }
 
-  gimp_edgelset_init_normals (set);
+  gimp_edgelset_build_graph (set, *rows, mask, width, height, async);
 
  end:
-  g_hash_table_destroy (edgel2index);
-
   if (gimp_async_is_stopped (async))
     {
       g_array_free (set, TRUE);
@@ -2708,32 +3062,118 @@ gimp_edgelset_new (GeglBuffer *buffer,
 }
 
 static void
-gimp_edgelset_add (GArray     *set,
-                   int         x,
-                   int         y,
-                   Direction   direction,
-                   GHashTable *edgel2index)
+gimp_edgelset_count_rows (gsize         offset,
+                          gsize         size,
+                          EdgelSetData *data)
 {
-  Edgel         *edgel    = gimp_edgel_new (x, y, direction);
-  unsigned long  position = set->len;
+  const guchar *mask   = data->mask;
+  gint          width  = data->width;
+  gint          height = data->height;
+  gint          x;
+  gint          y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      guint count = 0;
+
+      if (gimp_async_is_canceled (data->async))
+        return;
 
-  g_array_append_val (set, edgel);
-  g_hash_table_insert (edgel2index, edgel, GUINT_TO_POINTER (position));
+      for (x = 0; x < width; x++)
+        {
+          if (mask[x + y * width])
+            {
+              count += ! mask_value (mask, width, height, x, y - 1);
+              count += ! mask_value (mask, width, height, x, y + 1);
+              count += ! mask_value (mask, width, height, x - 1, y);
+              count += ! mask_value (mask, width, height, x + 1, y);
+            }
+        }
+
+      data->rows[y + 1] = count;
+    }
 }
 
 static void
-gimp_edgelset_init_normals (GArray *set)
+gimp_edgelset_fill_rows (gsize         offset,
+                         gsize         size,
+                         EdgelSetData *data)
 {
-  Edgel **e = (Edgel**) set->data;
+  static const Direction directions[4] = { YMinusDirection,
+                                           YPlusDirection,
+                                           XMinusDirection,
+                                           XPlusDirection };
+  const guchar *mask   = data->mask;
+  Edgel        *edgels = (Edgel *) data->set->data;
+  gint          width  = data->width;
+  gint          height = data->height;
+  gint          x;
+  gint          y;
+
+  for (y = offset; y < offset + size; y++)
+    {
+      Edgel *e = &edgels[data->rows[y]];
 
-  while (*e)
+      if (gimp_async_is_canceled (data->async))
+        return;
+
+      for (x = 0; x < width; x++)
+        {
+          gint i;
+
+          if (! mask[x + y * width])
+            continue;
+
+          for (i = 0; i < 4; i++)
+            {
+              Direction direction = directions[i];
+
+              if (mask_value (mask, width, height,
+                              x + DeltaX[direction],
+                              y + DeltaY[direction]))
+                continue;
+
+              gimp_edgel_init (e);
+              e->x         = x;
+              e->y         = y;
+              e->direction = direction;
+              e->x_normal  = Direction2Normal[direction].x;
+              e->y_normal  = Direction2Normal[direction].y;
+              e++;
+            }
+        }
+    }
+}
+
+static guint
+gimp_edgelset_find (GArray      *set,
+                    const guint *rows,
+                    const Edgel *edgel)
+{
+  const Edgel *edgels = (const Edgel *) set->data;
+  guint        first  = rows[edgel->y];
+  guint        last   = rows[edgel->y + 1];
+
+  /* Find the first edgel of the pixel, then its direction among the
+   * (at most 4) edgels of the pixel.
+   */
+  while (first < last)
     {
-      GimpVector2 n = Direction2Normal[(*e)->direction];
+      guint middle = first + (last - first) / 2;
 
-      (*e)->x_normal = n.x;
-      (*e)->y_normal = n.y;
-      e++;
+      if (edgels[middle].x < edgel->x)
+        first = middle + 1;
+      else
+        last = middle;
+    }
+
+  for (; first < rows[edgel->y + 1] && edgels[first].x == edgel->x; first++)
+    {
+      if (edgels[first].direction == edgel->direction)
+        return first;
     }
+
+  return G_MAXUINT;
 }
 
 static void
@@ -2741,11 +3181,10 @@ gimp_edgelset_smooth_normals (GArray    *set,
                               int        mask_size,
                               GimpAsync *async)
 {
+  EdgelSetData data;
   const gfloat sigma = mask_size * 0.775;
   const gfloat den   = 2 * sigma * sigma;
   gfloat       weights[65];
-  GimpVector2  smoothed_normal;
-  gint         i;
 
   gimp_assert (mask_size <= 65);
 
@@ -2753,30 +3192,49 @@ gimp_edgelset_smooth_normals (GArray    *set,
   for (int i = 1; i <= mask_size; ++i)
     weights[i] = expf (-(i * i) / den);
 
-  for (i = 0; i < set->len; i++)
-    {
-      Edgel *it           = g_array_index (set, Edgel*, i);
-      Edgel *edgel_before = g_array_index (set, Edgel*, it->previous);
-      Edgel *edgel_after  = g_array_index (set, Edgel*, it->next);
-      int    n = mask_size;
-      int    i = 1;
+  data.set       = set;
+  data.weights   = weights;
+  data.mask_size = mask_size;
+  data.async     = async;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+  gegl_parallel_distribute_range (
+    set->len, PIXELS_PER_THREAD,
+    (GeglParallelDistributeRangeFunc) gimp_edgelset_smooth_normals_range,
+    &data);
 
-          return;
-        }
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+}
+
+static void
+gimp_edgelset_smooth_normals_range (gsize         offset,
+                                    gsize         size,
+                                    EdgelSetData *data)
+{
+  Edgel       *edgels = (Edgel *) data->set->data;
+  GimpVector2  smoothed_normal;
+  gsize        idx;
+
+  if (gimp_async_is_canceled (data->async))
+    return;
+
+  for (idx = offset; idx < offset + size; idx++)
+    {
+      Edgel       *it           = &edgels[idx];
+      const Edgel *edgel_before = &edgels[it->previous];
+      const Edgel *edgel_after  = &edgels[it->next];
+      int          n = data->mask_size;
+      int          i = 1;
 
       smoothed_normal = Direction2Normal[it->direction];
       while (n-- && (edgel_after != edgel_before))
         {
           smoothed_normal = gimp_vector2_add_val (smoothed_normal,
-                                                  gimp_vector2_mul_val (Direction2Normal[edgel_before->direction], weights[i]));
+                                                  gimp_vector2_mul_val (Direction2Normal[edgel_before->direction], data->weights[i]));
           smoothed_normal = gimp_vector2_add_val (smoothed_normal,
-                                                  gimp_vector2_mul_val (Direction2Normal[edgel_after->direction], weights[i]));
-          edgel_before = g_array_index (set, Edgel *, edgel_before->previous);
-          edgel_after  = g_array_index (set, Edgel *, edgel_after->next);
+                                                  gimp_vector2_mul_val (Direction2Normal[edgel_after->direction], data->weights[i]));
+          edgel_before = &edgels[edgel_before->previous];
+          edgel_after  = &edgels[edgel_after->next];
           ++i;
         }
       gimp_vector2_normalize (&smoothed_normal);
@@ -2789,13 +3247,36 @@ static void
 gimp_edgelset_compute_curvature (GArray    *set,
                                  GimpAsync *async)
 {
-  gint i;
+  EdgelSetData data;
+
+  data.set   = set;
+  data.async = async;
+
+  gegl_parallel_distribute_range (
+    set->len, PIXELS_PER_THREAD,
+    (GeglParallelDistributeRangeFunc) gimp_edgelset_compute_curvature_range,
+    &data);
+
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
+}
+
+static void
+gimp_edgelset_compute_curvature_range (gsize         offset,
+                                       gsize         size,
+                                       EdgelSetData *data)
+{
+  Edgel *edgels = (Edgel *) data->set->data;
+  gsize  idx;
+
+  if (gimp_async_is_canceled (data->async))
+    return;
 
-  for (i = 0; i < set->len; i++)
+  for (idx = offset; idx < offset + size; idx++)
     {
-      Edgel       *it       = g_array_index (set, Edgel*, i);
-      Edgel       *previous = g_array_index (set, Edgel *, it->previous);
-      Edgel       *next     = g_array_index (set, Edgel *, it->next);
+      Edgel       *it       = &edgels[idx];
+      const Edgel *previous = &edgels[it->previous];
+      const Edgel *next     = &edgels[it->next];
       GimpVector2  n_prev   = gimp_vector2_new (previous->x_normal, previous->y_normal);
       GimpVector2  n_next   = gimp_vector2_new (next->x_normal, next->y_normal);
       GimpVector2  diff     = gimp_vector2_mul_val (gimp_vector2_sub_val (n_next, n_prev),
@@ -2804,63 +3285,84 @@ gimp_edgelset_compute_curvature (GArray    *set,
       const float  crossp   = n_prev.x * n_next.y - n_prev.y * n_next.x;
 
       it->curvature = (crossp > 0.0f) ? c : -c;
+    }
+}
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+static void
+gimp_edgelset_build_graph (GArray       *set,
+                           const guint  *rows,
+                           const guchar *mask,
+                           gint          width,
+                           gint          height,
+                           GimpAsync    *async)
+{
+  EdgelSetData data;
 
-          return;
-        }
-    }
+  data.mask   = mask;
+  data.width  = width;
+  data.height = height;
+  data.set    = set;
+  data.rows   = (guint *) rows;
+  data.async  = async;
+
+  /* Each edgel is the next one of exactly one edgel, so that the
+   * previous links are all set from different edgels.
+   */
+  gegl_parallel_distribute_range (
+    set->len, PIXELS_PER_THREAD,
+    (GeglParallelDistributeRangeFunc) gimp_edgelset_build_graph_range,
+    &data);
+
+  if (gimp_async_is_canceled (async))
+    gimp_async_abort (async);
 }
 
 static void
-gimp_edgelset_build_graph (GArray     *set,
-                           GeglBuffer *buffer,
-                           GHashTable *edgel2index,
-                           GimpAsync  *async)
+gimp_edgelset_build_graph_range (gsize         offset,
+                                 gsize         size,
+                                 EdgelSetData *data)
 {
-  Edgel edgel;
-  gint  i;
+  Edgel *edgels = (Edgel *) data->set->data;
+  Edgel  edgel;
+  gsize  idx;
+
+  if (gimp_async_is_canceled (data->async))
+    return;
 
-  for (i = 0; i < set->len; i++)
+  for (idx = offset; idx < offset + size; idx++)
     {
-      Edgel *neighbor;
-      Edgel *it = g_array_index (set, Edgel *, i);
+      Edgel *it = &edgels[idx];
       guint  neighbor_pos;
 
-      if (gimp_async_is_canceled (async))
-        {
-          gimp_async_abort (async);
+      gimp_edgelset_next8 (data->mask, data->width, data->height, it, &edgel);
 
-          return;
-        }
-
-      gimp_edgelset_next8 (buffer, it, &edgel);
+      neighbor_pos = gimp_edgelset_find (data->set, data->rows, &edgel);
+      gimp_assert (neighbor_pos != G_MAXUINT);
 
-      gimp_assert (g_hash_table_contains (edgel2index, &edgel));
-      neighbor_pos = GPOINTER_TO_UINT (g_hash_table_lookup (edgel2index, &edgel));
       it->next = neighbor_pos;
-      neighbor = g_array_index (set, Edgel *, neighbor_pos);
-      neighbor->previous = i;
+      edgels[neighbor_pos].previous = idx;
     }
 }
 
 static void
-gimp_edgelset_next8 (const GeglBuffer *buffer,
-                     Edgel            *it,
-                     Edgel            *n)
+gimp_edgelset_next8 (const guchar *mask,
+                     gint          width,
+                     gint          height,
+                     const Edgel  *it,
+                     Edgel        *n)
 {
   guint8 pixels[9];
+  gint   x = it->x;
+  gint   y = it->y;
+  gint   i;
 
   n->x         = it->x;
   n->y         = it->y;
   n->direction = it->direction;
 
-  gegl_buffer_get ((GeglBuffer *) buffer,
-                   GEGL_RECTANGLE (n->x - 1, n->y - 1, 3, 3),
-                   1.0, NULL, pixels, GEGL_AUTO_ROWSTRIDE,
-                   GEGL_ABYSS_NONE);
+  for (i = 0; i < 9; i++)
+    pixels[i] = mask_value (mask, width, height, x - 1 + i % 3, y - 1 + i / 3);
+
   switch (n->direction)
     {
     case XPlusDirection:
@@ -18,6 +18,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <cairo.h>
 #include <gegl.h>
@@ -46,6 +47,11 @@ extern "C"
 #define PIXELS_PER_THREAD \
   (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
 
+/* the largest fraction of the buffer filled serially, before falling
+ * back to labeling the entire buffer in parallel
+ */
+#define MAX_SERIAL_AREA_RATIO (1.0 / 32.0)
+
 
 typedef struct
 {
@@ -54,6 +60,22 @@ typedef struct
   gint   level;
 } BorderPixel;
 
+typedef struct
+{
+  gint   x1;
+  gint   x2;
+} Span;
+
+typedef struct
+{
+  GeglRectangle  rect;
+  Span          *spans;
+  gint           n_spans;
+  gint          *rows;
+  gint          *parent;
+  gint           first;
+} SpanTile;
+
 
 /*  local function prototypes  */
 
@@ -100,7 +122,21 @@ static gboolean find_contiguous_segment   (const gfloat        *col,
                                            gint                *start,
                                            gint                *end,
                                            gfloat              *row);
-static void     find_contiguous_region    (GeglBuffer          *src_buffer,
+static gboolean find_contiguous_region    (GeglBuffer          *src_buffer,
+                                           GeglBuffer          *mask_buffer,
+                                           const Babl          *format,
+                                           gint                 n_components,
+                                           gboolean             has_alpha,
+                                           gboolean             select_transparent,
+                                           GimpSelectCriterion  select_criterion,
+                                           gboolean             antialias,
+                                           gfloat               threshold,
+                                           gboolean             diagonal_neighbors,
+                                           gint                 x,
+                                           gint                 y,
+                                           const gfloat        *col,
+                                           gint64               max_area);
+static void     label_contiguous_region   (GeglBuffer          *src_buffer,
                                            GeglBuffer          *mask_buffer,
                                            const Babl          *format,
                                            gint                 n_components,
@@ -114,6 +150,23 @@ static void     find_contiguous_region    (GeglBuffer          *src_buffer,
                                            gint                 y,
                                            const gfloat        *col);
 
+static gint     span_find                 (gint                *parent,
+                                           gint                 i);
+static void     span_union                (gint                *parent,
+                                           gint                 i,
+                                           gint                 j);
+static void     span_union_rows           (gint                *parent,
+                                           const Span          *a,
+                                           gint                 n_a,
+                                           gint                 a_index,
+                                           const Span          *b,
+                                           gint                 n_b,
+                                           gint                 b_index,
+                                           gint                 d);
+static gint     span_tile_get_edge_span   (const SpanTile      *tile,
+                                           gint                 row,
+                                           gboolean             right);
+
 static void            line_art_queue_pixel (GQueue              *queue,
                                              gint                 x,
                                              gint                 y,
@@ -173,13 +226,29 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
   if (x >= extent.x && x < (extent.x + extent.width) &&
       y >= extent.y && y < (extent.y + extent.height))
     {
+      gint64 max_area;
+
       GIMP_TIMER_START();
 
-      find_contiguous_region (src_buffer, mask_buffer,
-                              format, n_components, has_alpha,
-                              select_transparent, select_criterion,
-                              antialias, threshold, diagonal_neighbors,
-                              x, y, start_col);
+      /*  the serial flood fill only visits the region itself, which is
+       *  cheaper for small regions.  once the region grows past a
+       *  fraction of the buffer, label the entire buffer in parallel
+       *  instead.
+       */
+      max_area = (gint64) extent.width * extent.height * MAX_SERIAL_AREA_RATIO;
+
+      if (! find_contiguous_region (src_buffer, mask_buffer,
+                                    format, n_components, has_alpha,
+                                    select_transparent, select_criterion,
+                                    antialias, threshold, diagonal_neighbors,
+                                    x, y, start_col, max_area))
+        {
+          label_contiguous_region (src_buffer, mask_buffer,
+                                   format, n_components, has_alpha,
+                                   select_transparent, select_criterion,
+                                   antialias, threshold, diagonal_neighbors,
+                                   x, y, start_col);
+        }
 
       GIMP_TIMER_END("foo");
     }
@@ -351,56 +420,56 @@ gimp_pickable_contiguous_region_by_line_art (GimpPickable *pickable,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x - 1, y - 1, &col);
+                                    x - 1, y - 1, &col, -1);
           if (x - 1 >= extent.x && x - 1 < extent.x + extent.width &&
               y >= extent.y && y < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x - 1, y, &col);
+                                    x - 1, y, &col, -1);
           if (x - 1 >= extent.x && x - 1 < extent.x + extent.width &&
               y + 1 >= extent.y && y + 1 < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x - 1, y + 1, &col);
+                                    x - 1, y + 1, &col, -1);
           if (x >= extent.x && x < extent.x + extent.width &&
               y - 1 >= extent.y && y - 1 < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x, y - 1, &col);
+                                    x, y - 1, &col, -1);
           if (x >= extent.x && x < extent.x + extent.width &&
               y + 1 >= extent.y && y + 1 < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x, y + 1, &col);
+                                    x, y + 1, &col, -1);
           if (x + 1 >= extent.x && x + 1 < extent.x + extent.width &&
               y - 1 >= extent.y && y - 1 < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x + 1, y - 1, &col);
+                                    x + 1, y - 1, &col, -1);
           if (x + 1 >= extent.x && x + 1 < extent.x + extent.width &&
               y >= extent.y && y < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x + 1, y, &col);
+                                    x + 1, y, &col, -1);
           if (x + 1 >= extent.x && x + 1 < extent.x + extent.width &&
               y + 1 >= extent.y && y + 1 < (extent.y + extent.height))
             find_contiguous_region (src_buffer, mask_buffer,
                                     format, 1, FALSE,
                                     FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                                     FALSE, 0.0, FALSE,
-                                    x + 1, y + 1, &col);
+                                    x + 1, y + 1, &col, -1);
           filled = TRUE;
         }
     }
@@ -413,7 +482,7 @@ gimp_pickable_contiguous_region_by_line_art (GimpPickable *pickable,
                               format, 1, FALSE,
                               FALSE, GIMP_SELECT_CRITERION_COMPOSITE,
                               FALSE, 0.0, FALSE,
-                              x, y, &col);
+                              x, y, &col, -1);
       filled = TRUE;
     }
 
@@ -986,7 +1055,7 @@ find_contiguous_segment (const gfloat        *col,
   return TRUE;
 }
 
-static void
+static gboolean
 find_contiguous_region (GeglBuffer          *src_buffer,
                         GeglBuffer          *mask_buffer,
                         const Babl          *format,
@@ -999,7 +1068,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                         gboolean             diagonal_neighbors,
                         gint                 x,
                         gint                 y,
-                        const gfloat        *col)
+                        const gfloat        *col,
+                        gint64               max_area)
 {
   const Babl  *mask_format = babl_format ("Y float");
   GeglSampler *src_sampler;
@@ -1007,7 +1077,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
   gint         start, end;
   gint         new_start, new_end;
   GQueue      *segment_queue;
-  gfloat      *row = NULL;
+  gfloat      *row  = NULL;
+  gint64       area = 0;
 
 #ifdef FETCH_ROW
   row = g_new (gfloat, gegl_buffer_get_width (src_buffer) * n_components);
@@ -1057,6 +1128,19 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                                          row))
             continue;
 
+          area += new_end - new_start - 1;
+
+          /* Give up once the region grows larger than `max_area`, leaving
+           * the mask partially filled.
+           */
+          if (max_area >= 0 && area > max_area)
+            {
+              g_queue_free (segment_queue);
+              segment_queue = NULL;
+
+              break;
+            }
+
           /* We can skip directly to `new_end + 1` on the next iteration, since
            * we've just selected all pixels in the range `[x, new_end)`, and
            * the pixel at `new_end` is above threshold.  (Note that we assume
@@ -1090,15 +1174,456 @@ find_contiguous_region (GeglBuffer          *src_buffer,
 
         }
     }
-  while (! g_queue_is_empty (segment_queue));
-
-  g_queue_free (segment_queue);
+  while (segment_queue && ! g_queue_is_empty (segment_queue));
 
   g_object_unref (src_sampler);
 
 #ifdef FETCH_ROW
   g_free (row);
 #endif
+
+  if (! segment_queue)
+    return FALSE;
+
+  g_queue_free (segment_queue);
+
+  return TRUE;
+}
+
+static void
+label_contiguous_region (GeglBuffer          *src_buffer,
+                         GeglBuffer          *mask_buffer,
+                         const Babl          *format,
+                         gint                 n_components,
+                         gboolean             has_alpha,
+                         gboolean             select_transparent,
+                         GimpSelectCriterion  select_criterion,
+                         gboolean             antialias,
+                         gfloat               threshold,
+                         gboolean             diagonal_neighbors,
+                         gint                 x,
+                         gint                 y,
+                         const gfloat        *col)
+{
+  const Babl    *mask_format = babl_format ("Y float");
+  GeglRectangle  extent      = *gegl_buffer_get_extent (src_buffer);
+  SpanTile      *tiles;
+  gint          *parent;
+  gint           d           = diagonal_neighbors ? 1 : 0;
+  gint           shift_x     = 0;
+  gint           shift_y     = 0;
+  gint           tile_width  = 1;
+  gint           tile_height = 1;
+  gint           tile_x1;
+  gint           tile_y1;
+  gint           n_tiles_x;
+  gint           n_tiles_y;
+  gint           n_tiles;
+  gint           n_spans     = 0;
+  gint           seed        = -1;
+  gint           tile_x;
+  gint           tile_y;
+  gint           i;
+
+  /*  Label the pixels within threshold as horizontal spans, one tile of
+   *  the mask at a time, and join the spans of vertically (or
+   *  diagonally) adjacent rows in a union-find forest.  The forests of
+   *  all tiles are then merged along the tile borders, and all spans
+   *  which aren't connected to the seed are cleared.  Each union links
+   *  the larger root to the smaller one, so that a span's parent never
+   *  follows it.
+   */
+
+  g_object_get (mask_buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  tile_x1   = (gint) floor ((gdouble) (extent.x + shift_x) / tile_width);
+  tile_y1   = (gint) floor ((gdouble) (extent.y + shift_y) / tile_height);
+  n_tiles_x = (gint) floor ((gdouble) (extent.x + extent.width  - 1 + shift_x) /
+                            tile_width)  - tile_x1 + 1;
+  n_tiles_y = (gint) floor ((gdouble) (extent.y + extent.height - 1 + shift_y) /
+                            tile_height) - tile_y1 + 1;
+  n_tiles   = n_tiles_x * n_tiles_y;
+
+  tiles = g_new0 (SpanTile, n_tiles);
+
+  gimp_parallel_distribute_range (
+    n_tiles, PIXELS_PER_THREAD / (tile_width * tile_height),
+    [&] (gsize offset,
+         gsize size)
+    {
+      gfloat *src;
+      gfloat *mask;
+      gsize   t;
+
+      src  = g_new (gfloat, tile_width * tile_height * n_components);
+      mask = g_new (gfloat, tile_width * tile_height);
+
+      for (t = offset; t < offset + size; t++)
+        {
+          SpanTile      *tile = &tiles[t];
+          GeglRectangle  rect;
+          GArray        *spans;
+          gint           row;
+          gint           j;
+
+          rect.x      = (tile_x1 + (gint) (t % n_tiles_x)) * tile_width  - shift_x;
+          rect.y      = (tile_y1 + (gint) (t / n_tiles_x)) * tile_height - shift_y;
+          rect.width  = tile_width;
+          rect.height = tile_height;
+
+          gegl_rectangle_intersect (&tile->rect, &rect, &extent);
+
+          gegl_buffer_get (src_buffer, &tile->rect, 1.0,
+                           format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          spans      = g_array_new (FALSE, FALSE, sizeof (Span));
+          tile->rows = g_new (gint, tile->rect.height + 1);
+
+          for (row = 0; row < tile->rect.height; row++)
+            {
+              const gfloat *s = src  + row * tile->rect.width * n_components;
+              gfloat       *m = mask + row * tile->rect.width;
+              Span          span;
+              gint          start = -1;
+              gint          col_x;
+
+              tile->rows[row] = spans->len;
+
+              for (col_x = 0; col_x < tile->rect.width; col_x++)
+                {
+                  m[col_x] = pixel_difference (col, s, antialias, threshold,
+                                               n_components, has_alpha,
+                                               select_transparent,
+                                               select_criterion);
+                  s += n_components;
+
+                  if (m[col_x] != 0.0)
+                    {
+                      if (start < 0)
+                        start = col_x;
+                    }
+                  else if (start >= 0)
+                    {
+                      span.x1 = tile->rect.x + start;
+                      span.x2 = tile->rect.x + col_x;
+
+                      g_array_append_val (spans, span);
+
+                      start = -1;
+                    }
+                }
+
+              if (start >= 0)
+                {
+                  span.x1 = tile->rect.x + start;
+                  span.x2 = tile->rect.x + tile->rect.width;
+
+                  g_array_append_val (spans, span);
+                }
+            }
+
+          tile->rows[tile->rect.height] = spans->len;
+
+          gegl_buffer_set (mask_buffer, &tile->rect, 0,
+                           mask_format, mask, GEGL_AUTO_ROWSTRIDE);
+
+          tile->n_spans = spans->len;
+          tile->spans   = (Span *) g_array_free (spans, FALSE);
+          tile->parent  = g_new (gint, tile->n_spans);
+
+          for (j = 0; j < tile->n_spans; j++)
+            tile->parent[j] = j;
+
+          for (row = 1; row < tile->rect.height; row++)
+            {
+              gint a = tile->rows[row - 1];
+              gint b = tile->rows[row];
+
+              span_union_rows (tile->parent,
+                               tile->spans + a, b - a, a,
+                               tile->spans + b, tile->rows[row + 1] - b, b,
+                               d);
+            }
+        }
+
+      g_free (src);
+      g_free (mask);
+    });
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      tiles[i].first  = n_spans;
+      n_spans        += tiles[i].n_spans;
+    }
+
+  parent = g_new (gint, MAX (n_spans, 1));
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      SpanTile *tile = &tiles[i];
+      gint      j;
+
+      for (j = 0; j < tile->n_spans; j++)
+        parent[tile->first + j] = tile->first + tile->parent[j];
+
+      g_clear_pointer (&tile->parent, g_free);
+    }
+
+  /*  merge the forests along the tile borders  */
+  for (tile_y = 0; tile_y < n_tiles_y; tile_y++)
+    {
+      for (tile_x = 0; tile_x < n_tiles_x; tile_x++)
+        {
+          SpanTile *tile = &tiles[tile_y * n_tiles_x + tile_x];
+          gint      last = tile->rect.height - 1;
+          gint      a;
+          gint      b;
+
+          if (tile_x + 1 < n_tiles_x)
+            {
+              SpanTile *right = tile + 1;
+              gint      row;
+              gint      dy;
+
+              for (row = 0; row < tile->rect.height; row++)
+                {
+                  a = span_tile_get_edge_span (tile, row, TRUE);
+
+                  if (a < 0)
+                    continue;
+
+                  for (dy = -d; dy <= d; dy++)
+                    {
+                      if (row + dy < 0 || row + dy > last)
+                        continue;
+
+                      b = span_tile_get_edge_span (right, row + dy, FALSE);
+
+                      if (b >= 0)
+                        span_union (parent, a, b);
+                    }
+                }
+            }
+
+          if (tile_y + 1 < n_tiles_y)
+            {
+              SpanTile *below = tile + n_tiles_x;
+
+              a = tile->rows[last];
+              b = below->rows[0];
+
+              span_union_rows (parent,
+                               tile->spans + a, tile->rows[last + 1] - a,
+                               tile->first + a,
+                               below->spans + b, below->rows[1] - b,
+                               below->first + b,
+                               d);
+
+              /*  the corners  */
+              if (d && tile_x + 1 < n_tiles_x)
+                {
+                  a = span_tile_get_edge_span (tile,      last, TRUE);
+                  b = span_tile_get_edge_span (below + 1, 0,    FALSE);
+
+                  if (a >= 0 && b >= 0)
+                    span_union (parent, a, b);
+                }
+
+              if (d && tile_x > 0)
+                {
+                  a = span_tile_get_edge_span (tile,      last, FALSE);
+                  b = span_tile_get_edge_span (below - 1, 0,    TRUE);
+
+                  if (a >= 0 && b >= 0)
+                    span_union (parent, a, b);
+                }
+            }
+        }
+    }
+
+  /*  since a span's parent never follows it, a single pass is enough
+   *  to point all spans directly at their root
+   */
+  for (i = 0; i < n_spans; i++)
+    parent[i] = parent[parent[i]];
+
+  tile_x = (gint) floor ((gdouble) (x + shift_x) / tile_width)  - tile_x1;
+  tile_y = (gint) floor ((gdouble) (y + shift_y) / tile_height) - tile_y1;
+
+  if (tile_x >= 0 && tile_x < n_tiles_x &&
+      tile_y >= 0 && tile_y < n_tiles_y)
+    {
+      SpanTile *tile = &tiles[tile_y * n_tiles_x + tile_x];
+      gint      row  = y - tile->rect.y;
+
+      for (i = tile->rows[row]; i < tile->rows[row + 1]; i++)
+        {
+          if (x >= tile->spans[i].x1 && x < tile->spans[i].x2)
+            {
+              seed = parent[tile->first + i];
+
+              break;
+            }
+        }
+    }
+
+  gimp_parallel_distribute_range (
+    n_tiles, PIXELS_PER_THREAD / (tile_width * tile_height),
+    [&] (gsize offset,
+         gsize size)
+    {
+      gfloat *mask = NULL;
+      gsize   t;
+
+      for (t = offset; t < offset + size; t++)
+        {
+          SpanTile *tile       = &tiles[t];
+          gint      n_selected = 0;
+          gint      row;
+          gint      j;
+
+          for (j = 0; j < tile->n_spans; j++)
+            {
+              if (parent[tile->first + j] == seed)
+                n_selected++;
+            }
+
+          if (n_selected == tile->n_spans)
+            continue;
+
+          if (n_selected == 0)
+            {
+              gegl_buffer_clear (mask_buffer, &tile->rect);
+
+              continue;
+            }
+
+          if (! mask)
+            mask = g_new (gfloat, tile_width * tile_height);
+
+          gegl_buffer_get (mask_buffer, &tile->rect, 1.0,
+                           mask_format, mask,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          for (row = 0; row < tile->rect.height; row++)
+            {
+              gfloat *m = mask + row * tile->rect.width;
+
+              for (j = tile->rows[row]; j < tile->rows[row + 1]; j++)
+                {
+                  const Span *span = &tile->spans[j];
+
+                  if (parent[tile->first + j] != seed)
+                    {
+                      memset (m + span->x1 - tile->rect.x, 0,
+                              (span->x2 - span->x1) * sizeof (gfloat));
+                    }
+                }
+            }
+
+          gegl_buffer_set (mask_buffer, &tile->rect, 0,
+                           mask_format, mask, GEGL_AUTO_ROWSTRIDE);
+        }
+
+      g_free (mask);
+    });
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      g_free (tiles[i].spans);
+      g_free (tiles[i].rows);
+    }
+
+  g_free (tiles);
+  g_free (parent);
+}
+
+static gint
+span_find (gint *parent,
+           gint  i)
+{
+  while (parent[i] != i)
+    {
+      parent[i] = parent[parent[i]];
+      i         = parent[i];
+    }
+
+  return i;
+}
+
+static void
+span_union (gint *parent,
+            gint  i,
+            gint  j)
+{
+  i = span_find (parent, i);
+  j = span_find (parent, j);
+
+  if (i < j)
+    parent[j] = i;
+  else if (j < i)
+    parent[i] = j;
+}
+
+static void
+span_union_rows (gint       *parent,
+                 const Span *a,
+                 gint        n_a,
+                 gint        a_index,
+                 const Span *b,
+                 gint        n_b,
+                 gint        b_index,
+                 gint        d)
+{
+  /*  join the overlapping spans of two adjacent rows of the same tile
+   *  column; with diagonal neighbors (d == 1), spans which touch at a
+   *  corner overlap too.  the spans of each row must be sorted, and
+   *  separated by at least one pixel.
+   */
+  gint i = 0;
+  gint j = 0;
+
+  while (i < n_a && j < n_b)
+    {
+      if (a[i].x1 < b[j].x2 + d && b[j].x1 < a[i].x2 + d)
+        span_union (parent, a_index + i, b_index + j);
+
+      if (a[i].x2 < b[j].x2)
+        i++;
+      else
+        j++;
+    }
+}
+
+static gint
+span_tile_get_edge_span (const SpanTile *tile,
+                         gint            row,
+                         gboolean        right)
+{
+  gint first = tile->rows[row];
+  gint last  = tile->rows[row + 1] - 1;
+
+  if (first > last)
+    return -1;
+
+  if (right)
+    {
+      if (tile->spans[last].x2 == tile->rect.x + tile->rect.width)
+        return tile->first + last;
+    }
+  else
+    {
+      if (tile->spans[first].x1 == tile->rect.x)
+        return tile->first + first;
+    }
+
+  return -1;
 }
 
 static void
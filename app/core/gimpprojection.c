@@ -76,6 +76,8 @@ struct _GimpProjectionPrivate
 
   cairo_region_t            *update_region;
   GeglRectangle              priority_rect;
+  GHashTable                *levels;
+  gint                       level;
   GimpChunkIterator         *iter;
   guint                      idle_id;
 
@@ -136,6 +138,7 @@ static void        gimp_projection_flush_whenever        (GimpProjection  *proj,
                                                           gboolean         now,
                                                           gboolean         direct);
 static void        gimp_projection_update_priority_rect  (GimpProjection  *proj);
+static void        gimp_projection_update_level          (GimpProjection  *proj);
 static void        gimp_projection_chunk_render_start    (GimpProjection  *proj);
 static void        gimp_projection_chunk_render_stop     (GimpProjection  *proj,
                                                           gboolean         merge);
@@ -235,6 +238,8 @@ gimp_projection_finalize (GObject *object)
 
   gimp_projection_free_buffer (proj);
 
+  g_clear_pointer (&proj->priv->levels, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -513,6 +518,50 @@ gimp_projection_set_priority_rect (GimpProjection *proj,
   gimp_projection_update_priority_rect (proj);
 }
 
+/*  sets the scale @requester, usually a display, shows the projection
+ *  at.  the projection renders at the mipmap level matching the largest
+ *  scale of all requesters, or at full resolution if there are none.
+ */
+void
+gimp_projection_set_render_scale (GimpProjection *proj,
+                                  gpointer        requester,
+                                  gdouble         scale)
+{
+  gint level = 0;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (requester != NULL);
+  g_return_if_fail (scale > 0.0);
+
+  /*  use the same mipmap level gegl_buffer_get() uses for @scale  */
+  while (scale <= 0.5 && level < GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  if (! proj->priv->levels)
+    proj->priv->levels = g_hash_table_new (NULL, NULL);
+
+  g_hash_table_insert (proj->priv->levels, requester, GINT_TO_POINTER (level));
+
+  gimp_projection_update_level (proj);
+}
+
+void
+gimp_projection_unset_render_scale (GimpProjection *proj,
+                                    gpointer        requester)
+{
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+  g_return_if_fail (requester != NULL);
+
+  if (proj->priv->levels &&
+      g_hash_table_remove (proj->priv->levels, requester))
+    {
+      gimp_projection_update_level (proj);
+    }
+}
+
 void
 gimp_projection_stop_rendering (GimpProjection *proj)
 {
@@ -718,6 +767,66 @@ gimp_projection_update_priority_rect (GimpProjection *proj)
     }
 }
 
+static void
+gimp_projection_update_level (GimpProjection *proj)
+{
+  GHashTableIter iter;
+  gpointer       value;
+  gint           level = 0;
+
+  if (proj->priv->levels && g_hash_table_size (proj->priv->levels) > 0)
+    {
+      level = GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL;
+
+      g_hash_table_iter_init (&iter, proj->priv->levels);
+
+      while (g_hash_table_iter_next (&iter, NULL, &value))
+        level = MIN (level, GPOINTER_TO_INT (value));
+    }
+
+  if (level == proj->priv->level)
+    return;
+
+  proj->priv->level = level;
+
+  /*  queue the dirty areas which haven't been rendered at the new level
+   *  yet.  the areas which are already queued are rendered at the new
+   *  level when they're reached.
+   */
+  if (proj->priv->validate_handler)
+    {
+      cairo_region_t *region;
+      gint            n_rects;
+      gint            i;
+
+      region = gimp_tile_handler_validate_get_dirty_region (
+        proj->priv->validate_handler, level);
+
+      if (proj->priv->update_region)
+        cairo_region_subtract (region, proj->priv->update_region);
+
+      n_rects = cairo_region_num_rectangles (region);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (region, i, &rect);
+
+          gimp_projection_add_update_area (proj,
+                                           rect.x,
+                                           rect.y,
+                                           rect.width,
+                                           rect.height);
+        }
+
+      cairo_region_destroy (region);
+
+      if (n_rects > 0)
+        gimp_projection_flush (proj);
+    }
+}
+
 static void
 gimp_projection_chunk_render_start (GimpProjection *proj)
 {
@@ -892,11 +1001,11 @@ gimp_projection_paint_area (GimpProjection *proj,
     {
       if (now)
         {
-          gimp_tile_handler_validate_validate (
+          gimp_tile_handler_validate_validate_mipmap (
             proj->priv->validate_handler,
             proj->priv->buffer,
             GEGL_RECTANGLE (x, y, w, h),
-            FALSE);
+            proj->priv->level);
         }
       else
         {
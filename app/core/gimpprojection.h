@@ -66,6 +66,12 @@ void             gimp_projection_set_priority_rect (GimpProjection    *proj,
                                                     gint               y,
                                                     gint               width,
                                                     gint               height);
+void             gimp_projection_set_render_scale  (GimpProjection    *proj,
+                                                    gpointer           requester,
+                                                    gdouble            scale);
+void             gimp_projection_unset_render_scale
+                                                   (GimpProjection    *proj,
+                                                    gpointer           requester);
 
 void             gimp_projection_stop_rendering    (GimpProjection    *proj);
 
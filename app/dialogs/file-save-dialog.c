@@ -186,6 +186,10 @@ file_save_dialog_response (GtkWidget *dialog,
         if (GIMP_IS_SAVE_DIALOG (dialog))
           {
             xcf_compression = GIMP_SAVE_DIALOG (dialog)->compression;
+
+            gimp_image_set_xcf_zstd_compression (
+              file_dialog->image,
+              GIMP_SAVE_DIALOG (dialog)->zstd_compression);
           }
 
         if (file_save_dialog_save_image (GIMP_PROGRESS (dialog),
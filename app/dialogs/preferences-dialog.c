@@ -1514,6 +1514,10 @@ prefs_dialog_new (Gimp       *gimp,
                                    _("Add an alpha channel to imported images"),
                                    GTK_BOX (vbox2));
 
+  button = prefs_check_button_add (object, "xcf-lazy-load",
+                                   _("Load XCF layers on demand"),
+                                   GTK_BOX (vbox2));
+
   table = prefs_table_new (1, GTK_CONTAINER (vbox2));
   button = prefs_enum_combo_box_add (object, "color-profile-policy", 0, 0,
                                      _("Color profile policy:"),
@@ -1550,6 +1554,12 @@ prefs_dialog_new (Gimp       *gimp,
                                     */
                                    _("Export IPTC metadata by default when available"),
                                    GTK_BOX (vbox2));
+
+  table = prefs_table_new (1, GTK_CONTAINER (vbox2));
+  prefs_spin_button_add (object, "xcf-zstd-level", 1.0, 3.0, 0,
+                         _("XCF _zstd compression level:"),
+                         GTK_TABLE (table), 0, size_group);
+
   hbox = prefs_hint_box_new (GIMP_ICON_DIALOG_WARNING,
                              _("Metadata can contain sensitive information."));
   gtk_box_pack_start (GTK_BOX (vbox2), hbox, FALSE, FALSE, 0);
@@ -41,6 +41,7 @@
 #include "core/gimpimage-sample-points.h"
 #include "core/gimpitem.h"
 #include "core/gimpitemstack.h"
+#include "core/gimpprojection.h"
 #include "core/gimpsamplepoint.h"
 #include "core/gimptreehandler.h"
 
@@ -409,6 +410,9 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
 
   gimp_display_shell_icon_update_stop (shell);
 
+  gimp_projection_unset_render_scale (gimp_image_get_projection (image),
+                                      shell);
+
   gimp_canvas_layer_boundary_set_layer (GIMP_CANVAS_LAYER_BOUNDARY (shell->layer_boundary),
                                         NULL);
 
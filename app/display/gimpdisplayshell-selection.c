@@ -356,17 +356,23 @@ selection_zoom_segs (Selection          *selection,
 static void
 selection_generate_segs (Selection *selection)
 {
-  GimpImage          *image = gimp_display_get_image (selection->shell->display);
-  const GimpBoundSeg *segs_in;
-  const GimpBoundSeg *segs_out;
-
-  /*  Ask the image for the boundary of its selected region...
-   *  Then transform that information into a new buffer of GimpSegments
+  GimpImage     *image = gimp_display_get_image (selection->shell->display);
+  GimpBoundSeg  *segs_in;
+  GimpBoundSeg  *segs_out;
+  GeglRectangle  area;
+
+  /*  Ask the image for the boundary of the visible part of its selected
+   *  region...  Then transform that information into a new buffer of
+   *  GimpSegments.  Everything is regenerated on each expose anyway, so
+   *  the segments outside the viewport are never needed.
    */
-  gimp_channel_boundary (gimp_image_get_mask (image),
-                         &segs_in, &segs_out,
-                         &selection->n_segs_in, &selection->n_segs_out,
-                         0, 0, 0, 0);
+  gimp_display_shell_untransform_viewport (selection->shell,
+                                           &area.x, &area.y,
+                                           &area.width, &area.height);
+
+  gimp_channel_boundary_area (gimp_image_get_mask (image), &area,
+                              &segs_in, &segs_out,
+                              &selection->n_segs_in, &selection->n_segs_out);
 
   if (selection->n_segs_in)
     {
@@ -392,6 +398,9 @@ selection_generate_segs (Selection *selection)
     {
       selection->segs_out = NULL;
     }
+
+  g_free (segs_in);
+  g_free (segs_out);
 }
 
 static void
@@ -1043,6 +1043,8 @@ gimp_display_shell_set_priority_viewport (GimpDisplayShell *shell)
 
       gimp_display_shell_untransform_viewport (shell, &x, &y, &width, &height);
       gimp_projection_set_priority_rect (projection, x, y, width, height);
+      gimp_projection_set_render_scale (projection, shell,
+                                        MAX (shell->scale_x, shell->scale_y));
     }
 }
 
@@ -42,6 +42,8 @@
 
 #include "plug-in/gimppluginprocedure.h"
 
+#include "xcf/xcf.h"
+
 #include "file-remote.h"
 #include "file-save.h"
 #include "gimp-file.h"
@@ -140,6 +142,12 @@ file_save (Gimp                *gimp,
       g_object_unref (info);
     }
 
+  /*  images loaded from XCF on demand may still be reading their pixels
+   *  from the file we are about to overwrite
+   */
+  if (! xcf_release_file (file, error))
+    goto out;
+
   if (! g_file_is_native (file) &&
       ! file_remote_mount_file (gimp, file, progress, &my_error))
     {
@@ -39,7 +39,7 @@ extern "C"
 #include "gimp-gegl-loops.h"
 #include "gimp-gegl-loops-sse2.h"
 
-#include "core/gimp-atomic.h"
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
@@ -80,7 +80,7 @@ gimp_gegl_buffer_copy (GeglBuffer          *src_buffer,
       if (! dest_rect)
         dest_rect = src_rect;
 
-      gegl_parallel_distribute_area (
+      gimp_parallel_distribute_area (
         src_rect, PIXELS_PER_THREAD,
         [=] (const GeglRectangle *src_area)
         {
@@ -117,7 +117,7 @@ gimp_gegl_clear (GeglBuffer          *buffer,
   bpc          = bpp / n_components;
   alpha_offset = (n_components - 1) * bpc;
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *area)
     {
@@ -212,7 +212,7 @@ gimp_gegl_convolve (GeglBuffer          *src_buffer,
       offset = 0.0;
     }
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     dest_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *dest_area)
     {
@@ -365,7 +365,7 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
   if (! dest_rect)
     dest_rect = gegl_buffer_get_extent (dest_buffer);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     src_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *src_area)
     {
@@ -601,7 +601,7 @@ gimp_gegl_smudge_with_paint (GeglBuffer          *accum_buffer,
       brush_a *= brush_color_ptr[3];
     }
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     accum_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *accum_area)
     {
@@ -670,7 +670,7 @@ gimp_gegl_apply_mask (GeglBuffer          *mask_buffer,
   if (! dest_rect)
     dest_rect = gegl_buffer_get_extent (dest_buffer);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     mask_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *mask_area)
     {
@@ -716,7 +716,7 @@ gimp_gegl_combine_mask (GeglBuffer          *mask_buffer,
   if (! dest_rect)
     dest_rect = gegl_buffer_get_extent (dest_buffer);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     mask_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *mask_area)
     {
@@ -763,7 +763,7 @@ gimp_gegl_combine_mask_weird (GeglBuffer          *mask_buffer,
   if (! dest_rect)
     dest_rect = gegl_buffer_get_extent (dest_buffer);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     mask_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *mask_area)
     {
@@ -824,7 +824,7 @@ gimp_gegl_index_to_mask (GeglBuffer          *indexed_buffer,
   if (! mask_rect)
     mask_rect = gegl_buffer_get_extent (mask_buffer);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     indexed_rect, PIXELS_PER_THREAD,
     [=] (const GeglRectangle *indexed_area)
     {
@@ -915,7 +915,7 @@ gimp_gegl_convert_color_profile (GeglBuffer               *src_buffer,
 
       GIMP_TIMER_START ();
 
-      gegl_parallel_distribute_area (
+      gimp_parallel_distribute_area (
         src_rect, PIXELS_PER_THREAD,
         [=] (const GeglRectangle *src_area)
         {
@@ -954,12 +954,10 @@ gimp_gegl_average_color (GeglBuffer          *buffer,
     gint   n;
   } Sum;
 
-  const Babl        *average_format = babl_format ("RaGaBaA float");
-  GeglRectangle      roi;
-  GSList * volatile  sums           = NULL;
-  GSList            *list;
-  Sum                average        = {};
-  gint               c;
+  const Babl    *average_format = babl_format ("RaGaBaA float");
+  GeglRectangle  roi;
+  Sum            average;
+  gint           c;
 
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
   g_return_if_fail (color != NULL);
@@ -975,14 +973,12 @@ gimp_gegl_average_color (GeglBuffer          *buffer,
   else
     roi = *rect;
 
-  gegl_parallel_distribute_area (
-    &roi, PIXELS_PER_THREAD,
-    [&] (const GeglRectangle *area)
+  average = gimp_parallel_reduce_area (
+    &roi, PIXELS_PER_THREAD, Sum {},
+    [&] (const GeglRectangle *area,
+         Sum                 &sum)
     {
-      Sum                *sum;
       GeglBufferIterator *iter;
-      gfloat              color[4] = {};
-      gint                n        = 0;
 
       iter = gegl_buffer_iterator_new (buffer, area, 0, average_format,
                                        GEGL_BUFFER_READ, abyss_policy, 1);
@@ -997,35 +993,24 @@ gimp_gegl_average_color (GeglBuffer          *buffer,
               gint c;
 
               for (c = 0; c < 4; c++)
-                color[c] += p[c];
+                sum.color[c] += p[c];
 
               p += 4;
             }
 
-          n += iter->length;
+          sum.n += iter->length;
         }
-
-      sum = g_slice_new (Sum);
-
-      memcpy (sum->color, color, sizeof (color));
-      sum->n = n;
-
-      gimp_atomic_slist_push_head (&sums, sum);
-    });
-
-  for (list = sums; list; list = g_slist_next (list))
+    },
+    [] (Sum       &average,
+        const Sum &sum)
     {
-      Sum *sum = (Sum *) list->data;
+      gint c;
 
       for (c = 0; c < 4; c++)
-        average.color[c] += sum->color[c];
+        average.color[c] += sum.color[c];
 
-      average.n += sum->n;
-
-      g_slice_free (Sum, sum);
-    }
-
-  g_slist_free (sums);
+      average.n += sum.n;
+    });
 
   if (average.n > 0)
     {
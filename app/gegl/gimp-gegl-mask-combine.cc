@@ -33,6 +33,11 @@ extern "C"
 #include "gimp-babl.h"
 #include "gimp-gegl-loops.h"
 #include "gimp-gegl-mask-combine.h"
+#include "gimpmasktiles.h"
+
+#include "core/gimp-parallel.h"
+
+} /* extern "C" */
 
 
 #define EPSILON 1e-6
@@ -41,6 +46,79 @@ extern "C"
   (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
 
 
+/*  the state of the mask tiles which combining with @op leaves as they
+ *  are, assuming the combined values are within [0, 1]
+ */
+static GimpMaskTileState
+gimp_gegl_mask_combine_get_skip_state (GimpChannelOps op)
+{
+  switch (op)
+    {
+    case GIMP_CHANNEL_OP_REPLACE:
+      return GIMP_MASK_TILE_UNKNOWN;
+
+    case GIMP_CHANNEL_OP_ADD:
+      return GIMP_MASK_TILE_FULL;
+
+    case GIMP_CHANNEL_OP_SUBTRACT:
+    case GIMP_CHANNEL_OP_INTERSECT:
+      return GIMP_MASK_TILE_EMPTY;
+    }
+
+  g_return_val_if_reached (GIMP_MASK_TILE_UNKNOWN);
+}
+
+/*  calls @func for the runs of tiles in @area whose state isn't
+ *  @skip_state, so that the combine loops never touch the others
+ */
+template <class Func>
+static void
+gimp_gegl_mask_combine_foreach_run (const GimpMaskTiles *mask_tiles,
+                                    GimpMaskTileState    skip_state,
+                                    const GeglRectangle *area,
+                                    Func                 func)
+{
+  GeglRectangle tile;
+  gint          y;
+
+  if (! mask_tiles || skip_state == GIMP_MASK_TILE_UNKNOWN)
+    {
+      func (area);
+
+      return;
+    }
+
+  for (y = area->y; y < area->y + area->height; y = tile.y + tile.height)
+    {
+      GeglRectangle run = {};
+      gint          x;
+
+      for (x = area->x; x < area->x + area->width; x = tile.x + tile.width)
+        {
+          gimp_mask_tiles_get_area (mask_tiles, x, y, &tile);
+
+          if (gimp_mask_tiles_get_state (mask_tiles, x, y) != skip_state)
+            {
+              if (run.width == 0)
+                gegl_rectangle_intersect (&run, &tile, area);
+              else
+                run.width = MIN (tile.x + tile.width, area->x + area->width) -
+                            run.x;
+            }
+          else if (run.width > 0)
+            {
+              func (&run);
+
+              run.width = 0;
+            }
+        }
+
+      if (run.width > 0)
+        func (&run);
+    }
+}
+
+
 gboolean
 gimp_gegl_mask_combine_rect (GeglBuffer     *mask,
                              GimpChannelOps  op,
@@ -91,32 +169,34 @@ gimp_gegl_mask_combine_ellipse (GeglBuffer     *mask,
                                 gint            h,
                                 gboolean        antialias)
 {
-  return gimp_gegl_mask_combine_ellipse_rect (mask, op, x, y, w, h,
+  return gimp_gegl_mask_combine_ellipse_rect (mask, NULL, op, x, y, w, h,
                                               w / 2.0, h / 2.0, antialias);
 }
 
 gboolean
-gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
-                                     GimpChannelOps  op,
-                                     gint            x,
-                                     gint            y,
-                                     gint            w,
-                                     gint            h,
-                                     gdouble         rx,
-                                     gdouble         ry,
-                                     gboolean        antialias)
+gimp_gegl_mask_combine_ellipse_rect (GeglBuffer          *mask,
+                                     const GimpMaskTiles *mask_tiles,
+                                     GimpChannelOps       op,
+                                     gint                 x,
+                                     gint                 y,
+                                     gint                 w,
+                                     gint                 h,
+                                     gdouble              rx,
+                                     gdouble              ry,
+                                     gboolean             antialias)
 {
-  GeglRectangle  rect;
-  const Babl    *format;
-  gint           bpp;
-  gfloat         one_f = 1.0f;
-  gpointer       one;
-  gdouble        cx;
-  gdouble        cy;
-  gint           left;
-  gint           right;
-  gint           top;
-  gint           bottom;
+  GeglRectangle      rect;
+  const Babl        *format;
+  gint               bpp;
+  gfloat             one_f = 1.0f;
+  gpointer           one;
+  gdouble            cx;
+  gdouble            cy;
+  gint               left;
+  gint               right;
+  gint               top;
+  gint               bottom;
+  GimpMaskTileState  skip_state;
 
   g_return_val_if_fail (GEGL_IS_BUFFER (mask), FALSE);
 
@@ -154,6 +234,8 @@ gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
 
   babl_process (babl_fish ("Y float", format), &one_f, one, 1);
 
+  skip_state = gimp_gegl_mask_combine_get_skip_state (op);
+
   /* coordinate-system transforms.  (x, y) coordinates are in the image
    * coordinate-system, and (u, v) coordinates are in a coordinate-system
    * aligned with the center of one of the elliptic corners, with the positive
@@ -374,142 +456,150 @@ gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
     return (gpointer) (p + 1);
   };
 
-  gegl_parallel_distribute_area (
-    &rect, PIXELS_PER_THREAD,
-    [=] (const GeglRectangle *area)
-    {
-      GeglBufferIterator *iter;
+  auto combine_run = [=] (const GeglRectangle *run)
+  {
+    GeglBufferIterator *iter;
 
-      iter = gegl_buffer_iterator_new (
-        mask, area, 0, format,
-        op == GIMP_CHANNEL_OP_REPLACE ? GEGL_ACCESS_WRITE :
-                                        GEGL_ACCESS_READWRITE,
-        GEGL_ABYSS_NONE, 1);
+    iter = gegl_buffer_iterator_new (
+      mask, run, 0, format,
+      op == GIMP_CHANNEL_OP_REPLACE ? GEGL_ACCESS_WRITE :
+                                      GEGL_ACCESS_READWRITE,
+      GEGL_ABYSS_NONE, 1);
 
-      while (gegl_buffer_iterator_next (iter))
-        {
-          const GeglRectangle *roi = &iter->items[0].roi;
-          gpointer             d   = iter->items[0].data;
-          gdouble              tx0, ty0;
-          gdouble              tx1, ty1;
-          gdouble              x0;
-          gdouble              x1;
-          gint                 y;
-
-          /* tile bounds */
-          tx0 = roi->x;
-          ty0 = roi->y;
-
-          tx1 = roi->x + roi->width;
-          ty1 = roi->y + roi->height;
-
-          if (! antialias)
-            {
-              tx0 += 0.5;
-              ty0 += 0.5;
+    while (gegl_buffer_iterator_next (iter))
+      {
+        const GeglRectangle *roi = &iter->items[0].roi;
+        gpointer             d   = iter->items[0].data;
+        gdouble              tx0, ty0;
+        gdouble              tx1, ty1;
+        gdouble              x0;
+        gdouble              x1;
+        gint                 y;
+
+        /* tile bounds */
+        tx0 = roi->x;
+        ty0 = roi->y;
+
+        tx1 = roi->x + roi->width;
+        ty1 = roi->y + roi->height;
+
+        if (! antialias)
+          {
+            tx0 += 0.5;
+            ty0 += 0.5;
 
-              tx1 -= 0.5;
-              ty1 -= 0.5;
-            }
+            tx1 -= 0.5;
+            ty1 -= 0.5;
+          }
 
-          /* if the tile is fully inside/outside the ellipse, fill it with 1/0,
-           * respectively, and skip the rest.
-           */
-          ellipse_range (ty0, &x0, &x1);
+        /* if the tile is fully inside/outside the ellipse, fill it with 1/0,
+         * respectively, and skip the rest.
+         */
+        ellipse_range (ty0, &x0, &x1);
 
-          if (tx0 >= x0 && tx1 <= x1)
-            {
-              ellipse_range (ty1, &x0, &x1);
+        if (tx0 >= x0 && tx1 <= x1)
+          {
+            ellipse_range (ty1, &x0, &x1);
 
-              if (tx0 >= x0 && tx1 <= x1)
-                {
-                  fill1 (d, iter->length);
+            if (tx0 >= x0 && tx1 <= x1)
+              {
+                fill1 (d, iter->length);
 
-                  continue;
-                }
-            }
-          else if (tx1 < x0 || tx0 > x1)
-            {
-              ellipse_range (ty1, &x0, &x1);
+                continue;
+              }
+          }
+        else if (tx1 < x0 || tx0 > x1)
+          {
+            ellipse_range (ty1, &x0, &x1);
 
-              if (tx1 < x0 || tx0 > x1)
-                {
-                  if ((ty0 - cy) * (ty1 - cy) >= 0.0)
-                    {
-                      fill0 (d, iter->length);
+            if (tx1 < x0 || tx0 > x1)
+              {
+                if ((ty0 - cy) * (ty1 - cy) >= 0.0)
+                  {
+                    fill0 (d, iter->length);
 
-                      continue;
-                    }
-                }
-            }
+                    continue;
+                  }
+              }
+          }
 
-          for (y = roi->y; y < roi->y + roi->height; y++)
-            {
-              gint a, b;
+        for (y = roi->y; y < roi->y + roi->height; y++)
+          {
+            gint a, b;
 
-              if (antialias)
-                {
-                  gdouble v  = y_to_v (y + 0.5);
-                  gdouble u0 = v_to_u (v - 0.5);
-                  gdouble u1 = v_to_u (v + 0.5);
-                  gint    x;
+            if (antialias)
+              {
+                gdouble v  = y_to_v (y + 0.5);
+                gdouble u0 = v_to_u (v - 0.5);
+                gdouble u1 = v_to_u (v + 0.5);
+                gint    x;
 
-                  a = floor (u_to_x_left (u0)) - roi->x;
-                  a = CLAMP (a, 0, roi->width);
+                a = floor (u_to_x_left (u0)) - roi->x;
+                a = CLAMP (a, 0, roi->width);
 
-                  b = ceil  (u_to_x_left (u1)) - roi->x;
-                  b = CLAMP (b, a, roi->width);
+                b = ceil  (u_to_x_left (u1)) - roi->x;
+                b = CLAMP (b, a, roi->width);
 
-                  d = fill0 (d, a);
+                d = fill0 (d, a);
 
-                  for (x = roi->x + a; x < roi->x + b; x++)
-                    d = set (d, pixel_value (x, y));
+                for (x = roi->x + a; x < roi->x + b; x++)
+                  d = set (d, pixel_value (x, y));
 
-                  a = floor (u_to_x_right (u1)) - roi->x;
-                  a = CLAMP (a, b, roi->width);
+                a = floor (u_to_x_right (u1)) - roi->x;
+                a = CLAMP (a, b, roi->width);
 
-                  d = fill1 (d, a - b);
+                d = fill1 (d, a - b);
 
-                  b = ceil  (u_to_x_right (u0)) - roi->x;
-                  b = CLAMP (b, a, roi->width);
+                b = ceil  (u_to_x_right (u0)) - roi->x;
+                b = CLAMP (b, a, roi->width);
 
-                  for (x = roi->x + a; x < roi->x + b; x++)
-                    d = set (d, pixel_value (x, y));
+                for (x = roi->x + a; x < roi->x + b; x++)
+                  d = set (d, pixel_value (x, y));
 
-                  d = fill0 (d, roi->width - b);
-                }
-              else
-                {
-                  ellipse_range (y + 0.5, &x0, &x1);
+                d = fill0 (d, roi->width - b);
+              }
+            else
+              {
+                ellipse_range (y + 0.5, &x0, &x1);
 
-                  a = ceil  (x0 - 0.5) - roi->x;
-                  a = CLAMP (a, 0, roi->width);
+                a = ceil  (x0 - 0.5) - roi->x;
+                a = CLAMP (a, 0, roi->width);
 
-                  b = floor (x1 + 0.5) - roi->x;
-                  b = CLAMP (b, 0, roi->width);
+                b = floor (x1 + 0.5) - roi->x;
+                b = CLAMP (b, 0, roi->width);
 
-                  d = fill0 (d, a);
-                  d = fill1 (d, b - a);
-                  d = fill0 (d, roi->width - b);
-                }
-            }
-        }
+                d = fill0 (d, a);
+                d = fill1 (d, b - a);
+                d = fill0 (d, roi->width - b);
+              }
+          }
+      }
+  };
+
+  gimp_parallel_distribute_area (
+    &rect, PIXELS_PER_THREAD,
+    [=] (const GeglRectangle *area)
+    {
+      gimp_gegl_mask_combine_foreach_run (mask_tiles, skip_state, area,
+                                          combine_run);
     });
 
   return TRUE;
 }
 
 gboolean
-gimp_gegl_mask_combine_buffer (GeglBuffer     *mask,
-                               GeglBuffer     *add_on,
-                               GimpChannelOps  op,
-                               gint            off_x,
-                               gint            off_y)
+gimp_gegl_mask_combine_buffer (GeglBuffer          *mask,
+                               const GimpMaskTiles *mask_tiles,
+                               GeglBuffer          *add_on,
+                               GimpChannelOps       op,
+                               gint                 off_x,
+                               gint                 off_y)
 {
-  GeglRectangle  mask_rect;
-  GeglRectangle  add_on_rect;
-  const Babl    *mask_format;
-  const Babl    *add_on_format;
+  GeglRectangle      mask_rect;
+  GeglRectangle      add_on_rect;
+  const Babl        *mask_format;
+  const Babl        *add_on_format;
+  GimpMaskTileState  skip_state;
 
   g_return_val_if_fail (GEGL_IS_BUFFER (mask), FALSE);
   g_return_val_if_fail (GEGL_IS_BUFFER (add_on), FALSE);
@@ -568,85 +658,91 @@ gimp_gegl_mask_combine_buffer (GeglBuffer     *mask,
   add_on_format = gimp_babl_format_change_component_type (
     add_on_format, GIMP_COMPONENT_TYPE_FLOAT);
 
-  gegl_parallel_distribute_area (
-    &mask_rect, PIXELS_PER_THREAD,
-    [=] (const GeglRectangle *mask_area)
+  skip_state = gimp_gegl_mask_combine_get_skip_state (op);
+
+  auto combine_run = [=] (const GeglRectangle *mask_area)
+  {
+    GeglBufferIterator *iter;
+    GeglRectangle       add_on_area;
+
+    add_on_area    = *mask_area;
+    add_on_area.x -= off_x;
+    add_on_area.y -= off_y;
+
+    iter = gegl_buffer_iterator_new (mask, mask_area, 0,
+                                     mask_format,
+                                     op == GIMP_CHANNEL_OP_REPLACE ?
+                                       GEGL_ACCESS_WRITE :
+                                       GEGL_ACCESS_READWRITE,
+                                     GEGL_ABYSS_NONE, 2);
+
+    gegl_buffer_iterator_add (iter, add_on, &add_on_area, 0,
+                              add_on_format,
+                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+    auto process = [=] (auto value)
     {
-      GeglBufferIterator *iter;
-      GeglRectangle       add_on_area;
+      while (gegl_buffer_iterator_next (iter))
+        {
+          gfloat       *mask_data   = (gfloat       *) iter->items[0].data;
+          const gfloat *add_on_data = (const gfloat *) iter->items[1].data;
+          gint          count       = iter->length;
 
-      add_on_area    = *mask_area;
-      add_on_area.x -= off_x;
-      add_on_area.y -= off_y;
+          while (count--)
+            {
+              const gfloat val = value (mask_data, add_on_data);
 
-      iter = gegl_buffer_iterator_new (mask, mask_area, 0,
-                                       mask_format,
-                                       op == GIMP_CHANNEL_OP_REPLACE ?
-                                         GEGL_ACCESS_WRITE :
-                                         GEGL_ACCESS_READWRITE,
-                                       GEGL_ABYSS_NONE, 2);
+              *mask_data = CLAMP (val, 0.0f, 1.0f);
 
-      gegl_buffer_iterator_add (iter, add_on, &add_on_area, 0,
-                                add_on_format,
-                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+              add_on_data++;
+              mask_data++;
+            }
+        }
+    };
 
-      auto process = [=] (auto value)
+    switch (op)
       {
-        while (gegl_buffer_iterator_next (iter))
-          {
-            gfloat       *mask_data   = (gfloat       *) iter->items[0].data;
-            const gfloat *add_on_data = (const gfloat *) iter->items[1].data;
-            gint          count       = iter->length;
+      case GIMP_CHANNEL_OP_REPLACE:
+        process ([] (const gfloat *mask,
+                     const gfloat *add_on)
+                 {
+                   return *add_on;
+                 });
+        break;
 
-            while (count--)
-              {
-                const gfloat val = value (mask_data, add_on_data);
+      case GIMP_CHANNEL_OP_ADD:
+        process ([] (const gfloat *mask,
+                     const gfloat *add_on)
+                 {
+                   return *mask + *add_on;
+                 });
+        break;
 
-                *mask_data = CLAMP (val, 0.0f, 1.0f);
+      case GIMP_CHANNEL_OP_SUBTRACT:
+        process ([] (const gfloat *mask,
+                     const gfloat *add_on)
+                 {
+                   return *mask - *add_on;
+                 });
+        break;
 
-                add_on_data++;
-                mask_data++;
-              }
-          }
-      };
+      case GIMP_CHANNEL_OP_INTERSECT:
+        process ([] (const gfloat *mask,
+                     const gfloat *add_on)
+                 {
+                   return MIN (*mask, *add_on);
+                 });
+        break;
+      }
+  };
 
-      switch (op)
-        {
-        case GIMP_CHANNEL_OP_REPLACE:
-          process ([] (const gfloat *mask,
-                       const gfloat *add_on)
-                   {
-                     return *add_on;
-                   });
-          break;
-
-        case GIMP_CHANNEL_OP_ADD:
-          process ([] (const gfloat *mask,
-                       const gfloat *add_on)
-                   {
-                     return *mask + *add_on;
-                   });
-          break;
-
-        case GIMP_CHANNEL_OP_SUBTRACT:
-          process ([] (const gfloat *mask,
-                       const gfloat *add_on)
-                   {
-                     return *mask - *add_on;
-                   });
-          break;
-
-        case GIMP_CHANNEL_OP_INTERSECT:
-          process ([] (const gfloat *mask,
-                       const gfloat *add_on)
-                   {
-                     return MIN (*mask, *add_on);
-                   });
-          break;
-        }
+  gimp_parallel_distribute_area (
+    &mask_rect, PIXELS_PER_THREAD,
+    [=] (const GeglRectangle *area)
+    {
+      gimp_gegl_mask_combine_foreach_run (mask_tiles, skip_state, area,
+                                          combine_run);
     });
 
   return TRUE;
 }
-
-} /* extern "C" */
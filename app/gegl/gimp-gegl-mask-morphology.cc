@@ -0,0 +1,742 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-mask-morphology.cc
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+extern "C"
+{
+
+#include "gimp-gegl-types.h"
+
+#include "gimp-gegl-mask-morphology.h"
+
+#include "core/gimp-parallel.h"
+
+} /* extern "C" */
+
+
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+/* the number of columns processed at once by a thread */
+#define STRIP_WIDTH 64
+
+
+typedef enum
+{
+  TARGET_SELECTED,   /* pixels which are 1.0                         */
+  TARGET_UNSELECTED, /* pixels which are 0.0                         */
+  TARGET_TRANSITION  /* selected pixels with an unselected neighbor  */
+} Target;
+
+
+/*  local function prototypes  */
+
+static gint       gimp_gegl_mask_get_limit         (const GeglRectangle *rect,
+                                                    gint                 radius_y);
+static void       gimp_gegl_mask_compute_reach     (gint                *reach,
+                                                    gint                 radius_x,
+                                                    gint                 radius_y,
+                                                    gint                 limit);
+template <class Dist>
+static gboolean   gimp_gegl_mask_distance_cover    (GeglBuffer          *src_buffer,
+                                                    GeglBuffer          *dest_buffer,
+                                                    const GeglRectangle *rect,
+                                                    Target               target,
+                                                    gboolean             edge_lock,
+                                                    const gint          *reach,
+                                                    gint                 limit,
+                                                    gint                 edge_reach,
+                                                    gboolean             invert);
+template <class Dist>
+static void       gimp_gegl_mask_distance_border   (GeglBuffer          *src_buffer,
+                                                    GeglBuffer          *dest_buffer,
+                                                    const GeglRectangle *rect,
+                                                    gint                 radius_x,
+                                                    const gdouble       *cost_y,
+                                                    gint                 limit,
+                                                    gboolean             feather,
+                                                    gboolean             edge_lock);
+template <class Dist>
+static gboolean   gimp_gegl_mask_vertical_distance (GeglBuffer          *src_buffer,
+                                                    const GeglRectangle *rect,
+                                                    Target               target,
+                                                    gboolean             edge_lock,
+                                                    gint                 limit,
+                                                    Dist                *dist);
+template <class Dist>
+static void       gimp_gegl_mask_cover             (GeglBuffer          *dest_buffer,
+                                                    const GeglRectangle *rect,
+                                                    const Dist          *dist,
+                                                    const gint          *reach,
+                                                    gint                 limit,
+                                                    gint                 edge_reach,
+                                                    gboolean             invert);
+static void       gimp_gegl_mask_envelope          (const gdouble       *cost,
+                                                    gint                 n,
+                                                    gdouble              offset,
+                                                    gdouble              scale,
+                                                    gint                *v,
+                                                    gdouble             *z,
+                                                    gdouble             *min);
+
+
+/*  public functions  */
+
+gboolean
+gimp_gegl_mask_grow (GeglBuffer          *src_buffer,
+                     GeglBuffer          *dest_buffer,
+                     const GeglRectangle *rect,
+                     gint                 radius_x,
+                     gint                 radius_y)
+{
+  gint     *reach;
+  gint      limit;
+  gboolean  success;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (rect != NULL, FALSE);
+  g_return_val_if_fail (radius_x > 0 && radius_y > 0, FALSE);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return TRUE;
+
+  /*  a pixel is selected iff a selected pixel lies within the
+   *  structuring element around it.  for each column, find the vertical
+   *  distance to the nearest selected pixel; the structuring element
+   *  contains it iff the column is within reach[distance] of the pixel.
+   */
+  limit = gimp_gegl_mask_get_limit (rect, radius_y);
+
+  reach = g_new (gint, limit);
+
+  gimp_gegl_mask_compute_reach (reach, radius_x, radius_y, limit);
+
+  if (limit <= G_MAXUINT16)
+    {
+      success = gimp_gegl_mask_distance_cover<guint16> (
+        src_buffer, dest_buffer, rect,
+        TARGET_SELECTED, FALSE,
+        reach, limit, 0, FALSE);
+    }
+  else
+    {
+      success = gimp_gegl_mask_distance_cover<guint32> (
+        src_buffer, dest_buffer, rect,
+        TARGET_SELECTED, FALSE,
+        reach, limit, 0, FALSE);
+    }
+
+  g_free (reach);
+
+  return success;
+}
+
+gboolean
+gimp_gegl_mask_shrink (GeglBuffer          *src_buffer,
+                       GeglBuffer          *dest_buffer,
+                       const GeglRectangle *rect,
+                       gint                 radius_x,
+                       gint                 radius_y,
+                       gboolean             edge_lock)
+{
+  gint     *reach;
+  gint      limit;
+  gint      edge_reach;
+  gboolean  success;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (rect != NULL, FALSE);
+  g_return_val_if_fail (radius_x > 0 && radius_y > 0, FALSE);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return TRUE;
+
+  /*  the complement of growing the unselected pixels.  without
+   *  edge-lock, the pixels outside of @rect are unselected; with
+   *  edge-lock, they repeat the edge pixels, and are never closer than
+   *  them.
+   */
+  limit = gimp_gegl_mask_get_limit (rect, radius_y);
+
+  reach = g_new (gint, limit);
+
+  gimp_gegl_mask_compute_reach (reach, radius_x, radius_y, limit);
+
+  edge_reach = edge_lock ? 0 : reach[0];
+
+  if (limit <= G_MAXUINT16)
+    {
+      success = gimp_gegl_mask_distance_cover<guint16> (
+        src_buffer, dest_buffer, rect,
+        TARGET_UNSELECTED, edge_lock,
+        reach, limit, edge_reach, TRUE);
+    }
+  else
+    {
+      success = gimp_gegl_mask_distance_cover<guint32> (
+        src_buffer, dest_buffer, rect,
+        TARGET_UNSELECTED, edge_lock,
+        reach, limit, edge_reach, TRUE);
+    }
+
+  g_free (reach);
+
+  return success;
+}
+
+void
+gimp_gegl_mask_border (GeglBuffer          *src_buffer,
+                       GeglBuffer          *dest_buffer,
+                       const GeglRectangle *rect,
+                       gint                 radius_x,
+                       gint                 radius_y,
+                       gboolean             feather,
+                       gboolean             edge_lock)
+{
+  gdouble *cost_y;
+  gint     limit;
+  gint     i;
+
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  g_return_if_fail (rect != NULL);
+  g_return_if_fail (radius_x > 0 && radius_y > 0);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return;
+
+  /*  the border's density at a pixel depends on the normalized squared
+   *  distance to the nearest transition pixel, measured between the
+   *  pixels' near edges:
+   *
+   *    ((|dx| - 0.5)+ / radius_x)^2 + ((|dy| - 0.5)+ / radius_y)^2
+   *
+   *  find the vertical distance to the nearest transition pixel in each
+   *  column, and take the lower envelope of the horizontal terms of all
+   *  columns in each row.  the horizontal term is a parabola centered
+   *  half a pixel to the left of a column for the pixels to its right,
+   *  and half a pixel to the right of it for the pixels to its left,
+   *  and overestimates the distance on its other side, so the minimum
+   *  of both envelopes, and of the column's own term, is exact.
+   */
+  limit = gimp_gegl_mask_get_limit (rect, radius_y);
+
+  cost_y = g_new (gdouble, limit + 1);
+
+  for (i = 0; i < limit; i++)
+    {
+      gdouble tmp = i > 0 ? i - 0.5 : 0.0;
+
+      cost_y[i] = SQR (tmp) / SQR ((gdouble) radius_y);
+    }
+
+  cost_y[limit] = G_MAXDOUBLE;
+
+  if (limit <= G_MAXUINT16)
+    {
+      gimp_gegl_mask_distance_border<guint16> (src_buffer, dest_buffer, rect,
+                                               radius_x, cost_y, limit,
+                                               feather, edge_lock);
+    }
+  else
+    {
+      gimp_gegl_mask_distance_border<guint32> (src_buffer, dest_buffer, rect,
+                                               radius_x, cost_y, limit,
+                                               feather, edge_lock);
+    }
+
+  g_free (cost_y);
+}
+
+
+/*  private functions  */
+
+static gint
+gimp_gegl_mask_get_limit (const GeglRectangle *rect,
+                          gint                 radius_y)
+{
+  /*  the distances are clamped to @limit, which stands for "out of
+   *  reach".  no pixel of a column is farther than rect->height rows
+   *  from a target pixel in it, or outside of it, so a larger radius
+   *  doesn't need larger distances.
+   */
+  return MIN (radius_y, rect->height) + 1;
+}
+
+static void
+gimp_gegl_mask_compute_reach (gint *reach,
+                              gint  radius_x,
+                              gint  radius_y,
+                              gint  limit)
+{
+  gint i;
+  gint v = 0;
+
+  /*  the structuring element used by gimp:grow and gimp:shrink spans
+   *  circ[i] rows above and below its center at column offset i, as
+   *  computed by their compute_border(), which doesn't increase with
+   *  |i|.  reach[v] is the largest |i| at which it spans v rows, so
+   *  that the element contains a pixel v rows away in a given column
+   *  iff the column is within reach[v].  only the first @limit
+   *  entries are computed.
+   */
+  for (i = radius_x; i >= 0; i--)
+    {
+      gdouble tmp  = i > 0 ? i - 0.5 : 0.0;
+      gint    circ = RINT (radius_y / (gdouble) radius_x *
+                           sqrt (SQR ((gdouble) radius_x) - SQR (tmp)));
+
+      for (; v <= MIN (circ, limit - 1); v++)
+        reach[v] = i;
+    }
+}
+
+template <class Dist>
+static gboolean
+gimp_gegl_mask_distance_cover (GeglBuffer          *src_buffer,
+                               GeglBuffer          *dest_buffer,
+                               const GeglRectangle *rect,
+                               Target               target,
+                               gboolean             edge_lock,
+                               const gint          *reach,
+                               gint                 limit,
+                               gint                 edge_reach,
+                               gboolean             invert)
+{
+  Dist     *dist;
+  gboolean  success = FALSE;
+
+  dist = g_new (Dist, (gsize) rect->width * rect->height);
+
+  if (gimp_gegl_mask_vertical_distance (src_buffer, rect,
+                                        target, edge_lock,
+                                        limit, dist))
+    {
+      gimp_gegl_mask_cover (dest_buffer, rect, dist, reach,
+                            limit, edge_reach, invert);
+
+      success = TRUE;
+    }
+
+  g_free (dist);
+
+  return success;
+}
+
+template <class Dist>
+static void
+gimp_gegl_mask_distance_border (GeglBuffer          *src_buffer,
+                                GeglBuffer          *dest_buffer,
+                                const GeglRectangle *rect,
+                                gint                 radius_x,
+                                const gdouble       *cost_y,
+                                gint                 limit,
+                                gboolean             feather,
+                                gboolean             edge_lock)
+{
+  Dist *dist;
+
+  dist = g_new (Dist, (gsize) rect->width * rect->height);
+
+  gimp_gegl_mask_vertical_distance (src_buffer, rect,
+                                    TARGET_TRANSITION, edge_lock,
+                                    limit, dist);
+
+  gimp_parallel_distribute_range (
+    rect->height, PIXELS_PER_THREAD / rect->width,
+    [&] (gsize offset,
+         gsize size)
+    {
+      gdouble *cost = g_new (gdouble, rect->width);
+      gdouble *min  = g_new (gdouble, rect->width);
+      gdouble *z    = g_new (gdouble, rect->width + 1);
+      gint    *v    = g_new (gint,    rect->width);
+      gfloat  *out  = g_new (gfloat,  rect->width);
+      gsize    y;
+
+      for (y = offset; y < offset + size; y++)
+        {
+          const Dist *row = dist + y * rect->width;
+          gint        x;
+
+          for (x = 0; x < rect->width; x++)
+            {
+              cost[x] = cost_y[row[x]];
+              min[x]  = cost[x];
+            }
+
+          gimp_gegl_mask_envelope (cost, rect->width, +0.5,
+                                   1.0 / SQR ((gdouble) radius_x), v, z, min);
+          gimp_gegl_mask_envelope (cost, rect->width, -0.5,
+                                   1.0 / SQR ((gdouble) radius_x), v, z, min);
+
+          for (x = 0; x < rect->width; x++)
+            {
+              if (min[x] < 1.0)
+                out[x] = feather ? 1.0 - sqrt (min[x]) : 1.0;
+              else
+                out[x] = 0.0;
+            }
+
+          gegl_buffer_set (dest_buffer,
+                           GEGL_RECTANGLE (rect->x, rect->y + y,
+                                           rect->width, 1),
+                           0, babl_format ("Y float"), out,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
+
+      g_free (cost);
+      g_free (min);
+      g_free (z);
+      g_free (v);
+      g_free (out);
+    });
+
+  g_free (dist);
+}
+
+template <class Dist>
+static gboolean
+gimp_gegl_mask_vertical_distance (GeglBuffer          *src_buffer,
+                                  const GeglRectangle *rect,
+                                  Target               target,
+                                  gboolean             edge_lock,
+                                  gint                 limit,
+                                  Dist                *dist)
+{
+  const Babl *format = babl_format ("Y float");
+  gint        binary = TRUE;
+  gfloat      edge;
+  Dist        edge_dist;
+
+  /*  the pixels outside of @rect are considered selected with
+   *  edge-lock, and unselected otherwise.  like compute_transition() of
+   *  gimp:border, a single column isn't affected by its sides.
+   */
+  edge      = edge_lock ? 1.0 : 0.0;
+  edge_dist = (target == TARGET_UNSELECTED && ! edge_lock) ? 0 : limit;
+
+  gimp_parallel_distribute_range (
+    (rect->width + STRIP_WIDTH - 1) / STRIP_WIDTH,
+    PIXELS_PER_THREAD / (STRIP_WIDTH * rect->height),
+    [&] (gsize offset,
+         gsize size)
+    {
+      gint     stride = STRIP_WIDTH + 2;
+      gfloat  *src    = g_new (gfloat,  (gsize) stride * (rect->height + 2));
+      guint8  *hits   = g_new (guint8,  (gsize) STRIP_WIDTH * rect->height);
+      Dist    *d      = g_new (Dist,    STRIP_WIDTH);
+      gsize    strip;
+
+      for (strip = offset; strip < offset + size; strip++)
+        {
+          gint x1    = strip * STRIP_WIDTH;
+          gint width = MIN (STRIP_WIDTH, rect->width - x1);
+          gint x;
+          gint y;
+
+          if (! g_atomic_int_get (&binary))
+            break;
+
+          /*  read the strip, surrounded by a one pixel frame, which is
+           *  only used for finding transitions
+           */
+          gegl_buffer_get (src_buffer,
+                           GEGL_RECTANGLE (rect->x + x1, rect->y,
+                                           width, rect->height),
+                           1.0, format, src + stride + 1,
+                           stride * sizeof (gfloat), GEGL_ABYSS_NONE);
+
+          if (target == TARGET_TRANSITION)
+            {
+              gfloat left  = edge;
+              gfloat right = edge;
+
+              if (x1 > 0)
+                {
+                  gegl_buffer_get (src_buffer,
+                                   GEGL_RECTANGLE (rect->x + x1 - 1, rect->y,
+                                                   1, rect->height),
+                                   1.0, format, src + stride,
+                                   stride * sizeof (gfloat), GEGL_ABYSS_NONE);
+                }
+
+              if (x1 + width < rect->width)
+                {
+                  gegl_buffer_get (src_buffer,
+                                   GEGL_RECTANGLE (rect->x + x1 + width,
+                                                   rect->y,
+                                                   1, rect->height),
+                                   1.0, format, src + stride + width + 1,
+                                   stride * sizeof (gfloat), GEGL_ABYSS_NONE);
+                }
+
+              if (rect->width == 1)
+                left = right = 1.0;
+
+              for (y = 0; y < rect->height; y++)
+                {
+                  if (x1 == 0)
+                    src[(y + 1) * stride] = left;
+
+                  if (x1 + width == rect->width)
+                    src[(y + 1) * stride + width + 1] = right;
+                }
+
+              for (x = 0; x < width + 2; x++)
+                {
+                  src[x]                              = edge;
+                  src[(rect->height + 1) * stride + x] = edge;
+                }
+            }
+
+          for (y = 0; y < rect->height; y++)
+            {
+              const gfloat *s = src + (y + 1) * stride + 1;
+              guint8       *h = hits + y * width;
+
+              switch (target)
+                {
+                case TARGET_SELECTED:
+                case TARGET_UNSELECTED:
+                  for (x = 0; x < width; x++)
+                    {
+                      if (s[x] != 0.0 && s[x] != 1.0)
+                        {
+                          g_atomic_int_set (&binary, FALSE);
+
+                          break;
+                        }
+
+                      h[x] = (s[x] == 1.0) == (target == TARGET_SELECTED);
+                    }
+                  break;
+
+                case TARGET_TRANSITION:
+                  for (x = 0; x < width; x++)
+                    {
+                      h[x] = s[x] >= 0.5 &&
+                             (s[x - stride - 1] < 0.5 ||
+                              s[x - stride]     < 0.5 ||
+                              s[x - stride + 1] < 0.5 ||
+                              s[x - 1]          < 0.5 ||
+                              s[x + 1]          < 0.5 ||
+                              s[x + stride - 1] < 0.5 ||
+                              s[x + stride]     < 0.5 ||
+                              s[x + stride + 1] < 0.5);
+                    }
+                  break;
+                }
+            }
+
+          if (! g_atomic_int_get (&binary))
+            break;
+
+          /*  sweep down, and then up the strip  */
+          for (x = 0; x < width; x++)
+            d[x] = edge_dist;
+
+          for (y = 0; y < rect->height; y++)
+            {
+              const guint8 *h   = hits + y * width;
+              Dist         *out = dist + (gsize) y * rect->width + x1;
+
+              for (x = 0; x < width; x++)
+                {
+                  if (h[x])
+                    d[x] = 0;
+                  else if (d[x] < (Dist) limit)
+                    d[x]++;
+
+                  out[x] = d[x];
+                }
+            }
+
+          for (x = 0; x < width; x++)
+            d[x] = edge_dist;
+
+          for (y = rect->height - 1; y >= 0; y--)
+            {
+              const guint8 *h   = hits + y * width;
+              Dist         *out = dist + (gsize) y * rect->width + x1;
+
+              for (x = 0; x < width; x++)
+                {
+                  if (h[x])
+                    d[x] = 0;
+                  else if (d[x] < (Dist) limit)
+                    d[x]++;
+
+                  out[x] = MIN (out[x], d[x]);
+                }
+            }
+        }
+
+      g_free (src);
+      g_free (hits);
+      g_free (d);
+    });
+
+  return binary;
+}
+
+template <class Dist>
+static void
+gimp_gegl_mask_cover (GeglBuffer          *dest_buffer,
+                      const GeglRectangle *rect,
+                      const Dist          *dist,
+                      const gint          *reach,
+                      gint                 limit,
+                      gint                 edge_reach,
+                      gboolean             invert)
+{
+  /*  mark the pixels within reach of a target pixel in each row, or,
+   *  with @invert, the pixels which aren't.  @edge_reach is the reach
+   *  of the columns immediately outside of @rect, when they consist
+   *  of target pixels.
+   */
+  gimp_parallel_distribute_range (
+    rect->height, PIXELS_PER_THREAD / rect->width,
+    [=] (gsize offset,
+         gsize size)
+    {
+      gint   *count = g_new (gint,   rect->width + 1);
+      gfloat *out   = g_new (gfloat, rect->width);
+      gsize   y;
+
+      for (y = offset; y < offset + size; y++)
+        {
+          const Dist *row = dist + y * rect->width;
+          gint        sum = 0;
+          gint        x;
+
+          memset (count, 0, (rect->width + 1) * sizeof (gint));
+
+          if (edge_reach > 0)
+            {
+              count[0]++;
+              count[MIN (edge_reach, rect->width)]--;
+
+              count[MAX (rect->width - edge_reach, 0)]++;
+              count[rect->width]--;
+            }
+
+          for (x = 0; x < rect->width; x++)
+            {
+              if (row[x] < (Dist) limit)
+                {
+                  count[MAX (x - reach[row[x]], 0)]++;
+                  count[MIN (x + reach[row[x]] + 1, rect->width)]--;
+                }
+            }
+
+          for (x = 0; x < rect->width; x++)
+            {
+              sum += count[x];
+
+              out[x] = ((sum > 0) != invert) ? 1.0 : 0.0;
+            }
+
+          gegl_buffer_set (dest_buffer,
+                           GEGL_RECTANGLE (rect->x, rect->y + y,
+                                           rect->width, 1),
+                           0, babl_format ("Y float"), out,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
+
+      g_free (count);
+      g_free (out);
+    });
+}
+
+static void
+gimp_gegl_mask_envelope (const gdouble *cost,
+                         gint           n,
+                         gdouble        offset,
+                         gdouble        scale,
+                         gint          *v,
+                         gdouble       *z,
+                         gdouble       *min)
+{
+  gint k = -1;
+  gint j = 0;
+  gint q;
+  gint x;
+
+  /*  lower the values of @min to the lower envelope of the parabolas
+   *  scale * (x - (q + offset))^2 + cost[q], skipping the columns whose
+   *  cost is G_MAXDOUBLE, following Felzenszwalb and Huttenlocher's
+   *  "Distance Transforms of Sampled Functions".  z[k] is the leftmost
+   *  point at which parabola v[k] is the lowest.
+   */
+  for (q = 0; q < n; q++)
+    {
+      gdouble s = -G_MAXDOUBLE;
+
+      if (cost[q] == G_MAXDOUBLE)
+        continue;
+
+      while (k >= 0)
+        {
+          gint r = v[k];
+
+          s = ((cost[q] / scale + SQR (q + offset)) -
+               (cost[r] / scale + SQR (r + offset))) / (2.0 * (q - r));
+
+          if (s > z[k])
+            break;
+
+          s = -G_MAXDOUBLE;
+          k--;
+        }
+
+      k++;
+
+      v[k] = q;
+      z[k] = s;
+    }
+
+  if (k < 0)
+    return;
+
+  z[k + 1] = G_MAXDOUBLE;
+
+  for (x = 0; x < n; x++)
+    {
+      gdouble value;
+
+      while (z[j + 1] < x)
+        j++;
+
+      value = scale * SQR (x - (v[j] + offset)) + cost[v[j]];
+
+      if (value < min[x])
+        min[x] = value;
+    }
+}
@@ -0,0 +1,50 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-gegl-mask-morphology.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_GEGL_MASK_MORPHOLOGY_H__
+#define __GIMP_GEGL_MASK_MORPHOLOGY_H__
+
+
+/*  Distance based variants of the gimp:grow, gimp:shrink and gimp:border
+ *  operations, whose cost doesn't depend on the radius.  grow and shrink
+ *  only handle masks whose pixels are all either 0.0 or 1.0, and return
+ *  FALSE without touching @dest_buffer otherwise.
+ */
+
+gboolean   gimp_gegl_mask_grow   (GeglBuffer          *src_buffer,
+                                  GeglBuffer          *dest_buffer,
+                                  const GeglRectangle *rect,
+                                  gint                 radius_x,
+                                  gint                 radius_y);
+gboolean   gimp_gegl_mask_shrink (GeglBuffer          *src_buffer,
+                                  GeglBuffer          *dest_buffer,
+                                  const GeglRectangle *rect,
+                                  gint                 radius_x,
+                                  gint                 radius_y,
+                                  gboolean             edge_lock);
+void       gimp_gegl_mask_border (GeglBuffer          *src_buffer,
+                                  GeglBuffer          *dest_buffer,
+                                  const GeglRectangle *rect,
+                                  gint                 radius_x,
+                                  gint                 radius_y,
+                                  gboolean             feather,
+                                  gboolean             edge_lock);
+
+
+#endif /* __GIMP_GEGL_MASK_MORPHOLOGY_H__ */
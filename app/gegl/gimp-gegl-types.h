@@ -29,6 +29,7 @@
 
 
 typedef struct _GimpApplicator GimpApplicator;
+typedef struct _GimpMaskTiles  GimpMaskTiles;
 
 
 #endif /* __GIMP_GEGL_TYPES_H__ */
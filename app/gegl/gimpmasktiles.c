@@ -0,0 +1,566 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpmasktiles.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "gimp-gegl-types.h"
+
+#include "gimpmasktiles.h"
+
+
+#define PIXELS_PER_THREAD \
+  (/* each thread costs as much as */ 64.0 * 64.0 /* pixels */)
+
+/* large enough for a "Y double" pixel */
+#define MAX_BPP 16
+
+
+struct _GimpMaskTiles
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  gint           bpp;
+  guint8         one[MAX_BPP];
+
+  GeglRectangle  extent;
+  gint           origin_x;
+  gint           origin_y;
+  gint           tile_width;
+  gint           tile_height;
+  gint           n_cols;
+  gint           n_rows;
+
+  guint8        *states;
+  GeglRectangle *bounds;
+};
+
+typedef struct
+{
+  GimpMaskTiles *tiles;
+  const gint    *indices;
+} ValidateData;
+
+
+/*  local function prototypes  */
+
+static void                gimp_mask_tiles_get_tile_area  (const GimpMaskTiles *tiles,
+                                                           gint                 index,
+                                                           GeglRectangle       *area);
+
+static GimpMaskTileState   gimp_mask_tiles_scan           (GimpMaskTiles       *tiles,
+                                                           const GeglRectangle *area,
+                                                           GeglRectangle       *bounds);
+static void                gimp_mask_tiles_validate_range (gsize                offset,
+                                                           gsize                size,
+                                                           ValidateData        *data);
+static void                gimp_mask_tiles_validate       (GimpMaskTiles       *tiles);
+
+
+/*  public functions  */
+
+GimpMaskTiles *
+gimp_mask_tiles_new (GeglBuffer *buffer)
+{
+  GimpMaskTiles *tiles;
+  const Babl    *format;
+  gfloat         one_f = 1.0f;
+  gint           shift_x;
+  gint           shift_y;
+  gint           col1, row1;
+  gint           col2, row2;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+
+  format = gegl_buffer_get_format (buffer);
+
+  g_return_val_if_fail (babl_format_get_bytes_per_pixel (format) <= MAX_BPP,
+                        NULL);
+
+  tiles = g_slice_new0 (GimpMaskTiles);
+
+  tiles->buffer = g_object_ref (buffer);
+  tiles->format = format;
+  tiles->bpp    = babl_format_get_bytes_per_pixel (format);
+  tiles->extent = *gegl_buffer_get_extent (buffer);
+
+  babl_process (babl_fish ("Y float", tiles->format), &one_f, tiles->one, 1);
+
+  g_object_get (buffer,
+                "shift-x",     &shift_x,
+                "shift-y",     &shift_y,
+                "tile-width",  &tiles->tile_width,
+                "tile-height", &tiles->tile_height,
+                NULL);
+
+  /*  follow the buffer's own tile grid, so that tiles map to whole
+   *  GEGL tiles
+   */
+  col1 = floor ((gdouble) (tiles->extent.x + shift_x) / tiles->tile_width);
+  row1 = floor ((gdouble) (tiles->extent.y + shift_y) / tiles->tile_height);
+  col2 = ceil  ((gdouble) (tiles->extent.x + tiles->extent.width  + shift_x) /
+                tiles->tile_width);
+  row2 = ceil  ((gdouble) (tiles->extent.y + tiles->extent.height + shift_y) /
+                tiles->tile_height);
+
+  tiles->origin_x = col1 * tiles->tile_width  - shift_x;
+  tiles->origin_y = row1 * tiles->tile_height - shift_y;
+  tiles->n_cols   = MAX (col2 - col1, 0);
+  tiles->n_rows   = MAX (row2 - row1, 0);
+
+  /*  GIMP_MASK_TILE_UNKNOWN is 0  */
+  tiles->states = g_new0 (guint8, tiles->n_cols * tiles->n_rows);
+  tiles->bounds = g_new0 (GeglRectangle, tiles->n_cols * tiles->n_rows);
+
+  return tiles;
+}
+
+void
+gimp_mask_tiles_free (GimpMaskTiles *tiles)
+{
+  g_return_if_fail (tiles != NULL);
+
+  g_object_unref (tiles->buffer);
+
+  g_free (tiles->states);
+  g_free (tiles->bounds);
+
+  g_slice_free (GimpMaskTiles, tiles);
+}
+
+gint64
+gimp_mask_tiles_get_memsize (const GimpMaskTiles *tiles)
+{
+  g_return_val_if_fail (tiles != NULL, 0);
+
+  return sizeof (GimpMaskTiles) +
+         (gint64) tiles->n_cols * tiles->n_rows *
+         (sizeof (guint8) + sizeof (GeglRectangle));
+}
+
+void
+gimp_mask_tiles_invalidate (GimpMaskTiles       *tiles,
+                            const GeglRectangle *rect)
+{
+  gint col1, row1;
+  gint col2, row2;
+  gint row;
+
+  g_return_if_fail (tiles != NULL);
+
+  /*  this is called from the buffer's "changed" signal, which may be
+   *  emitted from any thread.  it only ever stores
+   *  GIMP_MASK_TILE_UNKNOWN, so concurrent invalidations don't race in
+   *  any way that matters.
+   */
+  if (! gimp_mask_tiles_get_range (tiles, rect, &col1, &row1, &col2, &row2))
+    return;
+
+  for (row = row1; row < row2; row++)
+    {
+      memset (tiles->states + row * tiles->n_cols + col1,
+              GIMP_MASK_TILE_UNKNOWN, col2 - col1);
+    }
+}
+
+void
+gimp_mask_tiles_fill (GimpMaskTiles       *tiles,
+                      const GeglRectangle *rect,
+                      GimpMaskTileState    state)
+{
+  gint col1, row1;
+  gint col2, row2;
+  gint row;
+  gint col;
+
+  g_return_if_fail (tiles != NULL);
+  g_return_if_fail (state == GIMP_MASK_TILE_EMPTY ||
+                    state == GIMP_MASK_TILE_FULL);
+
+  if (! rect)
+    rect = &tiles->extent;
+
+  if (! gimp_mask_tiles_get_range (tiles, rect, &col1, &row1, &col2, &row2))
+    return;
+
+  for (row = row1; row < row2; row++)
+    {
+      for (col = col1; col < col2; col++)
+        {
+          gint          index = row * tiles->n_cols + col;
+          GeglRectangle area;
+
+          gimp_mask_tiles_get_tile_area (tiles, index, &area);
+
+          if (gegl_rectangle_contains (rect, &area))
+            {
+              tiles->states[index] = state;
+              tiles->bounds[index] = area;
+            }
+          else if (tiles->states[index] != state)
+            {
+              /*  a partially covered tile keeps its state only if it
+               *  already had the filled state
+               */
+              tiles->states[index] = GIMP_MASK_TILE_UNKNOWN;
+            }
+        }
+    }
+}
+
+void
+gimp_mask_tiles_get_area (const GimpMaskTiles *tiles,
+                          gint                 x,
+                          gint                 y,
+                          GeglRectangle       *area)
+{
+  gint col;
+  gint row;
+
+  g_return_if_fail (tiles != NULL);
+  g_return_if_fail (area != NULL);
+
+  col = (x - tiles->origin_x) / tiles->tile_width;
+  row = (y - tiles->origin_y) / tiles->tile_height;
+
+  area->x      = tiles->origin_x + col * tiles->tile_width;
+  area->y      = tiles->origin_y + row * tiles->tile_height;
+  area->width  = tiles->tile_width;
+  area->height = tiles->tile_height;
+
+  gegl_rectangle_intersect (area, area, &tiles->extent);
+}
+
+GimpMaskTileState
+gimp_mask_tiles_get_state (const GimpMaskTiles *tiles,
+                           gint                 x,
+                           gint                 y)
+{
+  gint col;
+  gint row;
+
+  g_return_val_if_fail (tiles != NULL, GIMP_MASK_TILE_UNKNOWN);
+
+  if (x <  tiles->extent.x                        ||
+      y <  tiles->extent.y                        ||
+      x >= tiles->extent.x + tiles->extent.width  ||
+      y >= tiles->extent.y + tiles->extent.height)
+    {
+      return GIMP_MASK_TILE_UNKNOWN;
+    }
+
+  col = (x - tiles->origin_x) / tiles->tile_width;
+  row = (y - tiles->origin_y) / tiles->tile_height;
+
+  return tiles->states[row * tiles->n_cols + col];
+}
+
+void
+gimp_mask_tiles_get_grid (const GimpMaskTiles *tiles,
+                          gint                *n_cols,
+                          gint                *n_rows)
+{
+  g_return_if_fail (tiles != NULL);
+
+  if (n_cols) *n_cols = tiles->n_cols;
+  if (n_rows) *n_rows = tiles->n_rows;
+}
+
+gboolean
+gimp_mask_tiles_get_range (const GimpMaskTiles *tiles,
+                           const GeglRectangle *rect,
+                           gint                *col1,
+                           gint                *row1,
+                           gint                *col2,
+                           gint                *row2)
+{
+  GeglRectangle area;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+  g_return_val_if_fail (col1 != NULL && row1 != NULL, FALSE);
+  g_return_val_if_fail (col2 != NULL && row2 != NULL, FALSE);
+
+  if (! rect)
+    rect = &tiles->extent;
+
+  if (! gegl_rectangle_intersect (&area, rect, &tiles->extent))
+    return FALSE;
+
+  *col1 = (area.x - tiles->origin_x) / tiles->tile_width;
+  *row1 = (area.y - tiles->origin_y) / tiles->tile_height;
+  *col2 = (area.x + area.width  - tiles->origin_x + tiles->tile_width  - 1) /
+          tiles->tile_width;
+  *row2 = (area.y + area.height - tiles->origin_y + tiles->tile_height - 1) /
+          tiles->tile_height;
+
+  return TRUE;
+}
+
+GimpMaskTileState
+gimp_mask_tiles_get_tile (const GimpMaskTiles *tiles,
+                          gint                 col,
+                          gint                 row,
+                          GeglRectangle       *area)
+{
+  g_return_val_if_fail (tiles != NULL, GIMP_MASK_TILE_UNKNOWN);
+  g_return_val_if_fail (col >= 0 && col < tiles->n_cols,
+                        GIMP_MASK_TILE_UNKNOWN);
+  g_return_val_if_fail (row >= 0 && row < tiles->n_rows,
+                        GIMP_MASK_TILE_UNKNOWN);
+
+  if (area)
+    gimp_mask_tiles_get_tile_area (tiles, row * tiles->n_cols + col, area);
+
+  return tiles->states[row * tiles->n_cols + col];
+}
+
+gboolean
+gimp_mask_tiles_is_empty (GimpMaskTiles *tiles)
+{
+  gint n_tiles;
+  gint i;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+
+  n_tiles = tiles->n_cols * tiles->n_rows;
+
+  /*  any known non-empty tile answers the question without a scan  */
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (tiles->states[i] == GIMP_MASK_TILE_PARTIAL ||
+          tiles->states[i] == GIMP_MASK_TILE_FULL)
+        {
+          return FALSE;
+        }
+    }
+
+  gimp_mask_tiles_validate (tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (tiles->states[i] != GIMP_MASK_TILE_EMPTY)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+gimp_mask_tiles_bounds (GimpMaskTiles *tiles,
+                        gint          *x1,
+                        gint          *y1,
+                        gint          *x2,
+                        gint          *y2)
+{
+  GeglRectangle bounds = { 0, };
+  gboolean      empty  = TRUE;
+  gint          n_tiles;
+  gint          i;
+
+  g_return_val_if_fail (tiles != NULL, FALSE);
+  g_return_val_if_fail (x1 != NULL, FALSE);
+  g_return_val_if_fail (y1 != NULL, FALSE);
+  g_return_val_if_fail (x2 != NULL, FALSE);
+  g_return_val_if_fail (y2 != NULL, FALSE);
+
+  gimp_mask_tiles_validate (tiles);
+
+  n_tiles = tiles->n_cols * tiles->n_rows;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (tiles->states[i] == GIMP_MASK_TILE_EMPTY)
+        continue;
+
+      if (empty)
+        bounds = tiles->bounds[i];
+      else
+        gegl_rectangle_bounding_box (&bounds, &bounds, &tiles->bounds[i]);
+
+      empty = FALSE;
+    }
+
+  if (empty)
+    {
+      *x1 = tiles->extent.x;
+      *y1 = tiles->extent.y;
+      *x2 = tiles->extent.x + tiles->extent.width;
+      *y2 = tiles->extent.y + tiles->extent.height;
+
+      return FALSE;
+    }
+
+  *x1 = bounds.x;
+  *y1 = bounds.y;
+  *x2 = bounds.x + bounds.width;
+  *y2 = bounds.y + bounds.height;
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_mask_tiles_get_tile_area (const GimpMaskTiles *tiles,
+                               gint                 index,
+                               GeglRectangle       *area)
+{
+  area->x      = tiles->origin_x + (index % tiles->n_cols) * tiles->tile_width;
+  area->y      = tiles->origin_y + (index / tiles->n_cols) * tiles->tile_height;
+  area->width  = tiles->tile_width;
+  area->height = tiles->tile_height;
+
+  gegl_rectangle_intersect (area, area, &tiles->extent);
+}
+
+static GimpMaskTileState
+gimp_mask_tiles_scan (GimpMaskTiles       *tiles,
+                      const GeglRectangle *area,
+                      GeglRectangle       *bounds)
+{
+  GeglBufferIterator *iter;
+  const gint          bpp  = tiles->bpp;
+  gint                x1   = G_MAXINT;
+  gint                y1   = G_MAXINT;
+  gint                x2   = G_MININT;
+  gint                y2   = G_MININT;
+  gboolean            full = TRUE;
+
+  iter = gegl_buffer_iterator_new (tiles->buffer, area, 0, tiles->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE, 1);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi  = &iter->items[0].roi;
+      const guint8        *data = iter->items[0].data;
+      gint                 y;
+
+      if (gegl_memeq_zero (data, bpp * iter->length))
+        {
+          full = FALSE;
+
+          continue;
+        }
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        {
+          gint a;
+          gint b;
+
+          if (gegl_memeq_zero (data, bpp * roi->width))
+            {
+              full  = FALSE;
+              data += bpp * roi->width;
+
+              continue;
+            }
+
+          a = 0;
+          while (gegl_memeq_zero (data + a * bpp, bpp))
+            a++;
+
+          b = roi->width - 1;
+          while (gegl_memeq_zero (data + b * bpp, bpp))
+            b--;
+
+          x1 = MIN (x1, roi->x + a);
+          x2 = MAX (x2, roi->x + b + 1);
+          y1 = MIN (y1, y);
+          y2 = MAX (y2, y + 1);
+
+          if (full)
+            {
+              gint x;
+
+              for (x = 0; x < roi->width && full; x++)
+                full = ! memcmp (data + x * bpp, tiles->one, bpp);
+            }
+
+          data += bpp * roi->width;
+        }
+    }
+
+  if (x1 > x2)
+    return GIMP_MASK_TILE_EMPTY;
+
+  bounds->x      = x1;
+  bounds->y      = y1;
+  bounds->width  = x2 - x1;
+  bounds->height = y2 - y1;
+
+  return full ? GIMP_MASK_TILE_FULL : GIMP_MASK_TILE_PARTIAL;
+}
+
+static void
+gimp_mask_tiles_validate_range (gsize         offset,
+                                gsize         size,
+                                ValidateData *data)
+{
+  GimpMaskTiles *tiles = data->tiles;
+
+  for (; size; offset++, size--)
+    {
+      gint          index = data->indices[offset];
+      GeglRectangle area;
+
+      gimp_mask_tiles_get_tile_area (tiles, index, &area);
+
+      tiles->states[index] = gimp_mask_tiles_scan (tiles, &area,
+                                                   &tiles->bounds[index]);
+    }
+}
+
+static void
+gimp_mask_tiles_validate (GimpMaskTiles *tiles)
+{
+  ValidateData  data;
+  gint         *indices;
+  gint          n_tiles;
+  gint          n_indices = 0;
+  gint          i;
+
+  n_tiles = tiles->n_cols * tiles->n_rows;
+  indices = g_new (gint, n_tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (tiles->states[i] == GIMP_MASK_TILE_UNKNOWN)
+        indices[n_indices++] = i;
+    }
+
+  if (n_indices > 0)
+    {
+      data.tiles   = tiles;
+      data.indices = indices;
+
+      gegl_parallel_distribute_range (
+        n_indices,
+        MAX (PIXELS_PER_THREAD / (tiles->tile_width * tiles->tile_height), 1),
+        (GeglParallelDistributeRangeFunc) gimp_mask_tiles_validate_range,
+        &data);
+    }
+
+  g_free (indices);
+}
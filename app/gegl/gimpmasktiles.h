@@ -0,0 +1,83 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpmasktiles.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_MASK_TILES_H__
+#define __GIMP_MASK_TILES_H__
+
+
+/*  GimpMaskTiles keeps the occupancy of each tile of a mask buffer, so
+ *  that emptiness and bounds only need to look at the tiles which
+ *  changed since they were last asked for, and so that combine
+ *  operations can skip tiles they wouldn't change.
+ *
+ *  Tiles are invalidated from the buffer's "changed" signal and
+ *  rescanned lazily.
+ */
+
+typedef enum
+{
+  GIMP_MASK_TILE_UNKNOWN,
+  GIMP_MASK_TILE_EMPTY,
+  GIMP_MASK_TILE_PARTIAL,
+  GIMP_MASK_TILE_FULL
+} GimpMaskTileState;
+
+
+GimpMaskTiles     * gimp_mask_tiles_new         (GeglBuffer          *buffer);
+void                gimp_mask_tiles_free        (GimpMaskTiles       *tiles);
+
+gint64              gimp_mask_tiles_get_memsize (const GimpMaskTiles *tiles);
+
+void                gimp_mask_tiles_invalidate  (GimpMaskTiles       *tiles,
+                                                 const GeglRectangle *rect);
+void                gimp_mask_tiles_fill        (GimpMaskTiles       *tiles,
+                                                 const GeglRectangle *rect,
+                                                 GimpMaskTileState    state);
+
+void                gimp_mask_tiles_get_area    (const GimpMaskTiles *tiles,
+                                                 gint                 x,
+                                                 gint                 y,
+                                                 GeglRectangle       *area);
+GimpMaskTileState   gimp_mask_tiles_get_state   (const GimpMaskTiles *tiles,
+                                                 gint                 x,
+                                                 gint                 y);
+
+void                gimp_mask_tiles_get_grid    (const GimpMaskTiles *tiles,
+                                                 gint                *n_cols,
+                                                 gint                *n_rows);
+gboolean            gimp_mask_tiles_get_range   (const GimpMaskTiles *tiles,
+                                                 const GeglRectangle *rect,
+                                                 gint                *col1,
+                                                 gint                *row1,
+                                                 gint                *col2,
+                                                 gint                *row2);
+GimpMaskTileState   gimp_mask_tiles_get_tile    (const GimpMaskTiles *tiles,
+                                                 gint                 col,
+                                                 gint                 row,
+                                                 GeglRectangle       *area);
+
+gboolean            gimp_mask_tiles_is_empty    (GimpMaskTiles       *tiles);
+gboolean            gimp_mask_tiles_bounds      (GimpMaskTiles       *tiles,
+                                                 gint                *x1,
+                                                 gint                *y1,
+                                                 gint                *x2,
+                                                 gint                *y2);
+
+
+#endif /* __GIMP_MASK_TILES_H__ */
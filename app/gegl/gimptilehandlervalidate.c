@@ -17,6 +17,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <cairo.h>
 #include <gegl.h>
 
@@ -57,6 +59,13 @@ static void     gimp_tile_handler_validate_real_validate_buffer (GimpTileHandler
                                                                  const GeglRectangle     *rect,
                                                                  GeglBuffer              *buffer);
 
+static gboolean gimp_tile_handler_validate_can_validate_mipmap  (GimpTileHandlerValidate *validate);
+static gboolean gimp_tile_handler_validate_is_mipmap_dirty      (GimpTileHandlerValidate *validate,
+                                                                 gint                     level,
+                                                                 const cairo_rectangle_int_t *rect);
+static void     gimp_tile_handler_validate_invalidate_mipmaps   (GimpTileHandlerValidate *validate,
+                                                                 const GeglRectangle     *rect);
+
 static gpointer gimp_tile_handler_validate_command              (GeglTileSource  *source,
                                                                  GeglTileCommand  command,
                                                                  gint             x,
@@ -122,10 +131,14 @@ static void
 gimp_tile_handler_validate_finalize (GObject *object)
 {
   GimpTileHandlerValidate *validate = GIMP_TILE_HANDLER_VALIDATE (object);
+  gint                     i;
 
   g_clear_object (&validate->graph);
   g_clear_pointer (&validate->dirty_region, cairo_region_destroy);
 
+  for (i = 0; i < GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL; i++)
+    g_clear_pointer (&validate->mipmap_regions[i], cairo_region_destroy);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -376,6 +389,71 @@ gimp_tile_handler_validate_validate_tile (GeglTileSource *source,
   return tile;
 }
 
+/*  renders a dirty mipmap tile directly at its level, instead of letting
+ *  the zoom handler build it out of full-resolution tiles, which would
+ *  have to be rendered first.  the full-resolution area remains dirty.
+ */
+static GeglTile *
+gimp_tile_handler_validate_validate_mipmap_tile (GeglTileSource *source,
+                                                 gint            x,
+                                                 gint            y,
+                                                 gint            z)
+{
+  GimpTileHandlerValidate *validate = GIMP_TILE_HANDLER_VALIDATE (source);
+  GeglTile                *tile;
+  cairo_rectangle_int_t    tile_rect;
+  gint                     tile_stride;
+
+  if (validate->suspend_validate                     ||
+      cairo_region_is_empty (validate->dirty_region) ||
+      ! gimp_tile_handler_validate_can_validate_mipmap (validate))
+    {
+      return gegl_tile_handler_source_command (source,
+                                               GEGL_TILE_GET, x, y, z, NULL);
+    }
+
+  tile_rect.x      = (x * validate->tile_width)  << z;
+  tile_rect.y      = (y * validate->tile_height) << z;
+  tile_rect.width  = validate->tile_width  << z;
+  tile_rect.height = validate->tile_height << z;
+
+  if (! gimp_tile_handler_validate_is_mipmap_dirty (validate, z, &tile_rect))
+    {
+      return gegl_tile_handler_source_command (source,
+                                               GEGL_TILE_GET, x, y, z, NULL);
+    }
+
+  tile_stride = babl_format_get_bytes_per_pixel (validate->format) *
+                validate->tile_width;
+
+  tile = gegl_tile_handler_get_source_tile (GEGL_TILE_HANDLER (source),
+                                            x, y, z, FALSE);
+
+  gimp_tile_handler_validate_begin_validate (validate);
+
+  gegl_tile_lock (tile);
+
+  gegl_node_blit (validate->graph, 1.0 / (1 << z),
+                  GEGL_RECTANGLE (x * validate->tile_width,
+                                  y * validate->tile_height,
+                                  validate->tile_width,
+                                  validate->tile_height),
+                  validate->format,
+                  gegl_tile_get_data (tile), tile_stride,
+                  GEGL_BLIT_DEFAULT);
+
+  gegl_tile_unlock (tile);
+
+  gimp_tile_handler_validate_end_validate (validate);
+
+  if (! validate->mipmap_regions[z - 1])
+    validate->mipmap_regions[z - 1] = cairo_region_create ();
+
+  cairo_region_union_rectangle (validate->mipmap_regions[z - 1], &tile_rect);
+
+  return tile;
+}
+
 static gpointer
 gimp_tile_handler_validate_command (GeglTileSource  *source,
                                     GeglTileCommand  command,
@@ -384,12 +462,62 @@ gimp_tile_handler_validate_command (GeglTileSource  *source,
                                     gint             z,
                                     gpointer         data)
 {
-  if (command == GEGL_TILE_GET && z == 0)
-    return gimp_tile_handler_validate_validate_tile (source, x, y);
+  if (command == GEGL_TILE_GET)
+    {
+      if (z == 0)
+        return gimp_tile_handler_validate_validate_tile (source, x, y);
+      else if (z <= GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL)
+        return gimp_tile_handler_validate_validate_mipmap_tile (source,
+                                                                x, y, z);
+    }
 
   return gegl_tile_handler_source_command (source, command, x, y, z, data);
 }
 
+static gboolean
+gimp_tile_handler_validate_can_validate_mipmap (GimpTileHandlerValidate *validate)
+{
+  /* subclasses that override validate() can only render at full
+   * resolution.
+   */
+  return GIMP_TILE_HANDLER_VALIDATE_GET_CLASS (validate)->validate ==
+         gimp_tile_handler_validate_real_validate;
+}
+
+static gboolean
+gimp_tile_handler_validate_is_mipmap_dirty (GimpTileHandlerValidate     *validate,
+                                            gint                         level,
+                                            const cairo_rectangle_int_t *rect)
+{
+  cairo_region_t *region = validate->mipmap_regions[level - 1];
+
+  if (cairo_region_contains_rectangle (validate->dirty_region, rect) ==
+      CAIRO_REGION_OVERLAP_OUT)
+    {
+      return FALSE;
+    }
+
+  return ! region ||
+         cairo_region_contains_rectangle (region, rect) !=
+         CAIRO_REGION_OVERLAP_IN;
+}
+
+static void
+gimp_tile_handler_validate_invalidate_mipmaps (GimpTileHandlerValidate *validate,
+                                               const GeglRectangle     *rect)
+{
+  gint i;
+
+  for (i = 0; i < GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL; i++)
+    {
+      if (validate->mipmap_regions[i])
+        {
+          cairo_region_subtract_rectangle (validate->mipmap_regions[i],
+                                           (cairo_rectangle_int_t *) rect);
+        }
+    }
+}
+
 
 /*  public functions  */
 
@@ -460,6 +588,8 @@ gimp_tile_handler_validate_invalidate (GimpTileHandlerValidate *validate,
   cairo_region_union_rectangle (validate->dirty_region,
                                 (cairo_rectangle_int_t *) rect);
 
+  gimp_tile_handler_validate_invalidate_mipmaps (validate, rect);
+
   gegl_tile_handler_damage_rect (GEGL_TILE_HANDLER (validate), rect);
 }
 
@@ -493,6 +623,20 @@ gimp_tile_handler_validate_end_validate (GimpTileHandlerValidate *validate)
     GIMP_TILE_HANDLER_VALIDATE_GET_CLASS (validate)->end_validate (validate);
 }
 
+/**
+ * gimp_tile_handler_validate_validate:
+ * @validate:  a #GimpTileHandlerValidate.
+ * @buffer:    the buffer @validate is assigned to.
+ * @rect:      the area to validate.
+ * @intersect: whether to only render the dirty parts of @rect.
+ *
+ * Renders @rect of @validate's graph into @buffer, and marks it as valid.
+ *
+ * The graph is processed by a single gegl_node_blit_buffer() call, which
+ * may use multiple threads internally; the graph itself must not be
+ * processed concurrently, and must not be modified while it's being
+ * processed.
+ **/
 void
 gimp_tile_handler_validate_validate (GimpTileHandlerValidate *validate,
                                      GeglBuffer              *buffer,
@@ -557,6 +701,197 @@ gimp_tile_handler_validate_validate (GimpTileHandlerValidate *validate,
     }
 }
 
+/**
+ * gimp_tile_handler_validate_validate_mipmap:
+ * @validate: a #GimpTileHandlerValidate.
+ * @buffer:   the buffer @validate is assigned to.
+ * @rect:     the area to validate, in full-resolution coordinates.
+ * @level:    the mipmap level to render.
+ *
+ * Renders the dirty parts of @rect directly at mipmap @level of
+ * @buffer.  The full-resolution pixels are not rendered, and remain
+ * dirty until they are requested, or validated explicitly.
+ *
+ * If @level is 0, or if @validate can't render at a reduced level,
+ * this is equivalent to gimp_tile_handler_validate_validate().
+ **/
+void
+gimp_tile_handler_validate_validate_mipmap (GimpTileHandlerValidate *validate,
+                                            GeglBuffer              *buffer,
+                                            const GeglRectangle     *rect,
+                                            gint                     level)
+{
+  const GeglRectangle *extent;
+  GeglRectangle        level_extent;
+  GArray              *tiles;
+  gint                 tile_width;
+  gint                 tile_height;
+  gint                 x1, y1;
+  gint                 x2, y2;
+  gint                 x, y;
+
+  g_return_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate));
+  g_return_if_fail (gimp_tile_handler_validate_get_assigned (buffer) ==
+                    validate);
+  g_return_if_fail (rect != NULL);
+  g_return_if_fail (level >= 0);
+
+  if (level == 0 ||
+      ! gimp_tile_handler_validate_can_validate_mipmap (validate))
+    {
+      gimp_tile_handler_validate_validate (validate, buffer, rect, FALSE);
+
+      return;
+    }
+
+  level = MIN (level, GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL);
+
+  if (cairo_region_contains_rectangle (validate->dirty_region,
+                                       (const cairo_rectangle_int_t *) rect) ==
+      CAIRO_REGION_OVERLAP_OUT)
+    {
+      return;
+    }
+
+  extent = gegl_buffer_get_extent (buffer);
+
+  level_extent.x      = floor ((gdouble) extent->x / (1 << level));
+  level_extent.y      = floor ((gdouble) extent->y / (1 << level));
+  level_extent.width  = ceil  ((gdouble) (extent->x + extent->width)  /
+                               (1 << level)) - level_extent.x;
+  level_extent.height = ceil  ((gdouble) (extent->y + extent->height) /
+                               (1 << level)) - level_extent.y;
+
+  /*  the size of a tile at @level, in full-resolution coordinates  */
+  tile_width  = validate->tile_width  << level;
+  tile_height = validate->tile_height << level;
+
+  x1 = floor ((gdouble) rect->x                  / tile_width);
+  y1 = floor ((gdouble) rect->y                  / tile_height);
+  x2 = ceil  ((gdouble) (rect->x + rect->width)  / tile_width);
+  y2 = ceil  ((gdouble) (rect->y + rect->height) / tile_height);
+
+  tiles = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+
+  /*  collect the dirty tiles at @level, so that each of them is written
+   *  as a whole, and doesn't have to be fetched first.
+   */
+  for (y = y1; y < y2; y++)
+    {
+      for (x = x1; x < x2; x++)
+        {
+          cairo_rectangle_int_t tile_rect;
+          GeglRectangle         tile;
+
+          tile_rect.x      = x * tile_width;
+          tile_rect.y      = y * tile_height;
+          tile_rect.width  = tile_width;
+          tile_rect.height = tile_height;
+
+          if (gimp_tile_handler_validate_is_mipmap_dirty (validate, level,
+                                                          &tile_rect) &&
+              gegl_rectangle_intersect (
+                &tile,
+                GEGL_RECTANGLE (x * validate->tile_width,
+                                y * validate->tile_height,
+                                validate->tile_width,
+                                validate->tile_height),
+                &level_extent))
+            {
+              g_array_append_val (tiles, tile);
+            }
+        }
+    }
+
+  if (tiles->len > 0)
+    {
+      cairo_region_t *region;
+      gint            bpp;
+      guchar         *buf;
+      gint            i;
+
+      bpp = babl_format_get_bytes_per_pixel (validate->format);
+      buf = g_malloc (validate->tile_width * validate->tile_height * bpp);
+
+      /*  the tiles are rendered one at a time:  the graph may not be
+       *  processed concurrently.
+       */
+      gimp_tile_handler_validate_begin_validate (validate);
+
+      for (i = 0; i < tiles->len; i++)
+        {
+          const GeglRectangle *tile = &g_array_index (tiles, GeglRectangle, i);
+
+          gegl_node_blit (validate->graph, 1.0 / (1 << level), tile,
+                          validate->format, buf, tile->width * bpp,
+                          GEGL_BLIT_DEFAULT);
+
+          gegl_buffer_set (buffer, tile, level,
+                           validate->format, buf, tile->width * bpp);
+        }
+
+      gimp_tile_handler_validate_end_validate (validate);
+
+      g_free (buf);
+
+      if (! validate->mipmap_regions[level - 1])
+        validate->mipmap_regions[level - 1] = cairo_region_create ();
+
+      region = validate->mipmap_regions[level - 1];
+
+      for (i = 0; i < tiles->len; i++)
+        {
+          const GeglRectangle   *tile = &g_array_index (tiles,
+                                                        GeglRectangle, i);
+          cairo_rectangle_int_t  tile_rect;
+
+          tile_rect.x      = floor ((gdouble) tile->x / validate->tile_width) *
+                             tile_width;
+          tile_rect.y      = floor ((gdouble) tile->y / validate->tile_height) *
+                             tile_height;
+          tile_rect.width  = tile_width;
+          tile_rect.height = tile_height;
+
+          cairo_region_union_rectangle (region, &tile_rect);
+        }
+    }
+
+  g_array_free (tiles, TRUE);
+}
+
+/**
+ * gimp_tile_handler_validate_get_dirty_region:
+ * @validate: a #GimpTileHandlerValidate.
+ * @level:    a mipmap level.
+ *
+ * Returns the part of the dirty region of @validate that hasn't been
+ * rendered at mipmap @level yet, in full-resolution coordinates.  For
+ * @level 0, this is the whole dirty region.
+ *
+ * Return value: a new #cairo_region_t, free with cairo_region_destroy().
+ **/
+cairo_region_t *
+gimp_tile_handler_validate_get_dirty_region (GimpTileHandlerValidate *validate,
+                                             gint                     level)
+{
+  cairo_region_t *region;
+
+  g_return_val_if_fail (GIMP_IS_TILE_HANDLER_VALIDATE (validate), NULL);
+  g_return_val_if_fail (level >= 0, NULL);
+
+  region = cairo_region_copy (validate->dirty_region);
+
+  if (level > 0 && gimp_tile_handler_validate_can_validate_mipmap (validate))
+    {
+      level = MIN (level, GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL);
+
+      if (validate->mipmap_regions[level - 1])
+        cairo_region_subtract (region, validate->mipmap_regions[level - 1]);
+    }
+
+  return region;
+}
+
 void
 gimp_tile_handler_validate_buffer_copy (GeglBuffer          *src_buffer,
                                         const GeglRectangle *src_rect,
@@ -625,6 +960,8 @@ gimp_tile_handler_validate_buffer_copy (GeglBuffer          *src_buffer,
   cairo_region_subtract_rectangle (dst_validate->dirty_region,
                                    (cairo_rectangle_int_t *) &real_dst_rect);
 
+  gimp_tile_handler_validate_invalidate_mipmaps (dst_validate, &real_dst_rect);
+
   if (src_validate)
     {
       if (real_src_rect.x == real_dst_rect.x &&
@@ -27,6 +27,9 @@
 
 G_BEGIN_DECLS
 
+#define GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL 8
+
+
 #define GIMP_TYPE_TILE_HANDLER_VALIDATE            (gimp_tile_handler_validate_get_type ())
 #define GIMP_TILE_HANDLER_VALIDATE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_TILE_HANDLER_VALIDATE, GimpTileHandlerValidate))
 #define GIMP_TILE_HANDLER_VALIDATE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GIMP_TYPE_TILE_HANDLER_VALIDATE, GimpTileHandlerValidateClass))
@@ -50,6 +53,11 @@ struct _GimpTileHandlerValidate
   gboolean         whole_tile;
   gint             validating;
   gint             suspend_validate;
+
+  /* the areas of the dirty region that have been rendered at each
+   * mipmap level, in level-0 coordinates.  level N is at index N - 1.
+   */
+  cairo_region_t  *mipmap_regions[GIMP_TILE_HANDLER_VALIDATE_MAX_LEVEL];
 };
 
 struct _GimpTileHandlerValidateClass
@@ -91,6 +99,12 @@ void                      gimp_tile_handler_validate_validate        (GimpTileHa
                                                                       GeglBuffer              *buffer,
                                                                       const GeglRectangle     *rect,
                                                                       gboolean                 intersect);
+void                      gimp_tile_handler_validate_validate_mipmap (GimpTileHandlerValidate *validate,
+                                                                      GeglBuffer              *buffer,
+                                                                      const GeglRectangle     *rect,
+                                                                      gint                     level);
+cairo_region_t          * gimp_tile_handler_validate_get_dirty_region (GimpTileHandlerValidate *validate,
+                                                                      gint                     level);
 
 void                      gimp_tile_handler_validate_buffer_copy     (GeglBuffer              *src_buffer,
                                                                       const GeglRectangle     *src_rect,
@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-mask-morphology.h"
+
 #include "gimpoperationgrow.h"
 
 
@@ -247,6 +249,13 @@ gimp_operation_grow_process (GeglOperation       *operation,
   gint16             last_index;
   gfloat            *buffer;
 
+  /* binary masks are grown using their distance transform, whose cost
+   * doesn't depend on the radius, and which gives the same result
+   */
+  if (gimp_gegl_mask_grow (input, output, roi,
+                           self->radius_x, self->radius_y))
+    return TRUE;
+
   max = g_new (gfloat *, roi->width + 2 * self->radius_x);
   buf = g_new (gfloat *, self->radius_y + 1);
 
@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-mask-morphology.h"
+
 #include "gimpoperationshrink.h"
 
 
@@ -269,6 +271,14 @@ gimp_operation_shrink_process (GeglOperation       *operation,
   gfloat              *buffer;
   gint                 buffer_size;
 
+  /* binary masks are shrunk using their distance transform, whose cost
+   * doesn't depend on the radius, and which gives the same result
+   */
+  if (gimp_gegl_mask_shrink (input, output, roi,
+                             self->radius_x, self->radius_y,
+                             self->edge_lock))
+    return TRUE;
+
   max = g_new (gfloat *, roi->width + 2 * self->radius_x);
   buf = g_new (gfloat *, self->radius_y + 1);
 
@@ -0,0 +1,650 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+#define EPSILON      1e-6f
+
+#define SAFE_DIV_MIN EPSILON
+#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+
+
+/*  the vectorized blend functions process two pixels at a time.  they
+ *  mirror the corresponding generic functions in
+ *  gimpoperationlayermode-blend.c, and must produce the same results.
+ *  since the value of comp[RED..BLUE] is unconstrained when in[ALPHA] or
+ *  layer[ALPHA] are zero, the color components are calculated
+ *  unconditionally, and comp[ALPHA] is copied from layer[ALPHA].
+ */
+
+
+typedef __m256 (* BlendFunc) (__m256 in,
+                              __m256 layer);
+
+
+/*  local function prototypes  */
+
+static inline __m256   v_set1      (gfloat                  value);
+static inline __m256   v_safe_div  (__m256                  a,
+                                    __m256                  b);
+static inline __m256   v_select    (__m256                  mask,
+                                    __m256                  a,
+                                    __m256                  b);
+static inline __m256   v_min_rgb   (__m256                  v);
+static inline __m256   v_max_rgb   (__m256                  v);
+static inline __m256   v_chroma    (__m256                  v);
+
+static inline void     blend_avx2  (const gfloat           *in,
+                                    const gfloat           *layer,
+                                    gfloat                 *comp,
+                                    gint                    samples,
+                                    BlendFunc               blend_func,
+                                    GimpLayerModeBlendFunc  generic_func);
+
+
+/*  private functions  */
+
+
+static inline __m256
+v_set1 (gfloat value)
+{
+  return _mm256_set1_ps (value);
+}
+
+/* vectorized version of safe_div():  returns a / b, clamped to
+ * [-SAFE_DIV_MAX, SAFE_DIV_MAX].  if -SAFE_DIV_MIN <= a <= SAFE_DIV_MIN,
+ * returns 0.
+ */
+static inline __m256
+v_safe_div (__m256 a,
+            __m256 b)
+{
+  __m256 abs_a;
+  __m256 result;
+
+  abs_a  = _mm256_andnot_ps (v_set1 (-0.0f), a);
+
+  result = _mm256_div_ps (a, b);
+  result = _mm256_min_ps (result, v_set1 (SAFE_DIV_MAX));
+  result = _mm256_max_ps (result, v_set1 (-SAFE_DIV_MAX));
+
+  return _mm256_and_ps (_mm256_cmp_ps (abs_a, v_set1 (SAFE_DIV_MIN),
+                                       _CMP_GT_OQ),
+                        result);
+}
+
+/* returns mask ? a : b, per component */
+static inline __m256
+v_select (__m256 mask,
+          __m256 a,
+          __m256 b)
+{
+  return _mm256_blendv_ps (b, a, mask);
+}
+
+/* returns MIN (MIN (v[0], v[1]), v[2]) of each pixel, in all of the
+ * pixel's components
+ */
+static inline __m256
+v_min_rgb (__m256 v)
+{
+  return _mm256_min_ps (
+    _mm256_min_ps (_mm256_permute_ps (v, _MM_SHUFFLE (0, 0, 0, 0)),
+                   _mm256_permute_ps (v, _MM_SHUFFLE (1, 1, 1, 1))),
+    _mm256_permute_ps (v, _MM_SHUFFLE (2, 2, 2, 2)));
+}
+
+/* returns MAX (MAX (v[0], v[1]), v[2]) of each pixel, in all of the
+ * pixel's components
+ */
+static inline __m256
+v_max_rgb (__m256 v)
+{
+  return _mm256_max_ps (
+    _mm256_max_ps (_mm256_permute_ps (v, _MM_SHUFFLE (0, 0, 0, 0)),
+                   _mm256_permute_ps (v, _MM_SHUFFLE (1, 1, 1, 1))),
+    _mm256_permute_ps (v, _MM_SHUFFLE (2, 2, 2, 2)));
+}
+
+/* returns hypotf (v[1], v[2]) of each pixel, in all of the pixel's
+ * components.  like glibc's hypotf(), the sum of squares and its square
+ * root are calculated in double precision, and rounded to float once.
+ */
+static inline __m256
+v_chroma (__m256 v)
+{
+  __m256d lo = _mm256_cvtps_pd (_mm256_castps256_ps128 (v));
+  __m256d hi = _mm256_cvtps_pd (_mm256_extractf128_ps (v, 1));
+
+  lo = _mm256_mul_pd (lo, lo);
+  hi = _mm256_mul_pd (hi, hi);
+
+  /* v[1]^2 + v[2]^2, in element 1 */
+  lo = _mm256_add_pd (lo, _mm256_permute4x64_pd (lo, _MM_SHUFFLE (3, 3, 2, 2)));
+  hi = _mm256_add_pd (hi, _mm256_permute4x64_pd (hi, _MM_SHUFFLE (3, 3, 2, 2)));
+
+  lo = _mm256_sqrt_pd (_mm256_permute4x64_pd (lo, _MM_SHUFFLE (1, 1, 1, 1)));
+  hi = _mm256_sqrt_pd (_mm256_permute4x64_pd (hi, _MM_SHUFFLE (1, 1, 1, 1)));
+
+  return _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm256_cvtpd_ps (lo)),
+                               _mm256_cvtpd_ps (hi), 1);
+}
+
+static inline void
+blend_avx2 (const gfloat           *in,
+            const gfloat           *layer,
+            gfloat                 *comp,
+            gint                    samples,
+            BlendFunc               blend_func,
+            GimpLayerModeBlendFunc  generic_func)
+{
+  for (; samples >= 2; samples -= 2)
+    {
+      __m256 v_in    = _mm256_loadu_ps (in);
+      __m256 v_layer = _mm256_loadu_ps (layer);
+      __m256 v_comp;
+
+      v_comp = blend_func (v_in, v_layer);
+
+      /* comp[ALPHA] = layer[ALPHA] */
+      v_comp = _mm256_blend_ps (v_comp, v_layer, 0x88);
+
+      _mm256_storeu_ps (comp, v_comp);
+
+      comp  += 8;
+      layer += 8;
+      in    += 8;
+    }
+
+  if (samples)
+    generic_func (in, layer, comp, samples);
+}
+
+
+/*  blend kernels  */
+
+
+static inline __m256
+blend_addition (__m256 in,
+                __m256 layer)
+{
+  return _mm256_add_ps (in, layer);
+}
+
+static inline __m256
+blend_burn (__m256 in,
+            __m256 layer)
+{
+  return _mm256_sub_ps (v_set1 (1.0f),
+                        v_safe_div (_mm256_sub_ps (v_set1 (1.0f), in),
+                                    layer));
+}
+
+static inline __m256
+blend_darken_only (__m256 in,
+                   __m256 layer)
+{
+  /* MIN (in, layer) */
+  return _mm256_min_ps (in, layer);
+}
+
+static inline __m256
+blend_difference (__m256 in,
+                  __m256 layer)
+{
+  return _mm256_andnot_ps (v_set1 (-0.0f), _mm256_sub_ps (in, layer));
+}
+
+static inline __m256
+blend_divide (__m256 in,
+              __m256 layer)
+{
+  return v_safe_div (in, layer);
+}
+
+static inline __m256
+blend_dodge (__m256 in,
+             __m256 layer)
+{
+  return v_safe_div (in, _mm256_sub_ps (v_set1 (1.0f), layer));
+}
+
+static inline __m256
+blend_exclusion (__m256 in,
+                 __m256 layer)
+{
+  return _mm256_sub_ps (
+    v_set1 (0.5f),
+    _mm256_mul_ps (_mm256_mul_ps (v_set1 (2.0f),
+                                  _mm256_sub_ps (in, v_set1 (0.5f))),
+                   _mm256_sub_ps (layer, v_set1 (0.5f))));
+}
+
+static inline __m256
+blend_grain_extract (__m256 in,
+                     __m256 layer)
+{
+  return _mm256_add_ps (_mm256_sub_ps (in, layer), v_set1 (0.5f));
+}
+
+static inline __m256
+blend_grain_merge (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_sub_ps (_mm256_add_ps (in, layer), v_set1 (0.5f));
+}
+
+static inline __m256
+blend_hard_mix (__m256 in,
+                __m256 layer)
+{
+  return _mm256_andnot_ps (_mm256_cmp_ps (_mm256_add_ps (in, layer),
+                                          v_set1 (1.0f),
+                                          _CMP_LT_OQ),
+                           v_set1 (1.0f));
+}
+
+static inline __m256
+blend_hardlight (__m256 in,
+                 __m256 layer)
+{
+  __m256 screen;
+  __m256 multiply;
+
+  screen = _mm256_mul_ps (
+    _mm256_sub_ps (v_set1 (1.0f), in),
+    _mm256_sub_ps (v_set1 (1.0f),
+                   _mm256_mul_ps (_mm256_sub_ps (layer, v_set1 (0.5f)),
+                                  v_set1 (2.0f))));
+  screen = _mm256_min_ps (_mm256_sub_ps (v_set1 (1.0f), screen),
+                          v_set1 (1.0f));
+
+  multiply = _mm256_mul_ps (in, _mm256_mul_ps (layer, v_set1 (2.0f)));
+  multiply = _mm256_min_ps (multiply, v_set1 (1.0f));
+
+  return v_select (_mm256_cmp_ps (layer, v_set1 (0.5f), _CMP_GT_OQ),
+                   screen, multiply);
+}
+
+static inline __m256
+blend_hsv_hue (__m256 in,
+               __m256 layer)
+{
+  __m256 src_max,  src_delta;
+  __m256 dest_max, dest_delta, dest_s;
+  __m256 ratio;
+  __m256 offset;
+
+  src_max    = v_max_rgb (layer);
+  src_delta  = _mm256_sub_ps (src_max, v_min_rgb (layer));
+
+  dest_max   = v_max_rgb (in);
+  dest_delta = _mm256_sub_ps (dest_max, v_min_rgb (in));
+  dest_s     = v_select (_mm256_cmp_ps (dest_max, v_set1 (0.0f), _CMP_NEQ_UQ),
+                         _mm256_div_ps (dest_delta, dest_max),
+                         v_set1 (0.0f));
+
+  ratio  = _mm256_div_ps (_mm256_mul_ps (dest_s, dest_max), src_delta);
+  offset = _mm256_sub_ps (dest_max, _mm256_mul_ps (src_max, ratio));
+
+  return v_select (_mm256_cmp_ps (src_delta, v_set1 (EPSILON), _CMP_GT_OQ),
+                   _mm256_add_ps (_mm256_mul_ps (layer, ratio), offset),
+                   in);
+}
+
+static inline __m256
+blend_hsv_saturation (__m256 in,
+                      __m256 layer)
+{
+  __m256 src_max,  src_delta, src_s;
+  __m256 dest_max, dest_delta;
+  __m256 ratio;
+  __m256 offset;
+
+  dest_max   = v_max_rgb (in);
+  dest_delta = _mm256_sub_ps (dest_max, v_min_rgb (in));
+
+  src_max    = v_max_rgb (layer);
+  src_delta  = _mm256_sub_ps (src_max, v_min_rgb (layer));
+  src_s      = v_select (_mm256_cmp_ps (src_max, v_set1 (0.0f), _CMP_NEQ_UQ),
+                         _mm256_div_ps (src_delta, src_max),
+                         v_set1 (0.0f));
+
+  ratio  = _mm256_div_ps (_mm256_mul_ps (src_s, dest_max), dest_delta);
+  offset = _mm256_mul_ps (_mm256_sub_ps (v_set1 (1.0f), ratio), dest_max);
+
+  return v_select (_mm256_cmp_ps (dest_delta, v_set1 (EPSILON), _CMP_GT_OQ),
+                   _mm256_add_ps (_mm256_mul_ps (in, ratio), offset),
+                   dest_max);
+}
+
+static inline __m256
+blend_hsv_value (__m256 in,
+                 __m256 layer)
+{
+  __m256 dest_v;
+  __m256 src_v;
+
+  dest_v = v_max_rgb (in);
+  src_v  = v_max_rgb (layer);
+
+  return v_select (_mm256_cmp_ps (_mm256_andnot_ps (v_set1 (-0.0f), dest_v),
+                                  v_set1 (EPSILON), _CMP_GT_OQ),
+                   _mm256_mul_ps (in, _mm256_div_ps (src_v, dest_v)),
+                   src_v);
+}
+
+static inline __m256
+blend_lch_chroma (__m256 in,
+                  __m256 layer)
+{
+  __m256 c1 = v_chroma (in);
+  __m256 c2 = v_chroma (layer);
+  __m256 comp;
+
+  /* comp[0] = in[0], comp[1..2] = c2 * in[1..2] / c1 */
+  comp = _mm256_div_ps (_mm256_mul_ps (c2, in), c1);
+  comp = _mm256_blend_ps (comp, in, 0x11);
+
+  return v_select (_mm256_cmp_ps (c1, v_set1 (EPSILON), _CMP_GT_OQ),
+                   comp, in);
+}
+
+static inline __m256
+blend_lch_color (__m256 in,
+                 __m256 layer)
+{
+  /* comp[0] = in[0], comp[1..2] = layer[1..2] */
+  return _mm256_blend_ps (layer, in, 0x11);
+}
+
+static inline __m256
+blend_lch_hue (__m256 in,
+               __m256 layer)
+{
+  __m256 c1 = v_chroma (in);
+  __m256 c2 = v_chroma (layer);
+  __m256 comp;
+
+  /* comp[0] = in[0], comp[1..2] = c1 * layer[1..2] / c2 */
+  comp = _mm256_div_ps (_mm256_mul_ps (c1, layer), c2);
+  comp = _mm256_blend_ps (comp, in, 0x11);
+
+  return v_select (_mm256_cmp_ps (c2, v_set1 (EPSILON), _CMP_GT_OQ),
+                   comp, in);
+}
+
+static inline __m256
+blend_lch_lightness (__m256 in,
+                     __m256 layer)
+{
+  /* comp[0] = layer[0], comp[1..2] = in[1..2] */
+  return _mm256_blend_ps (in, layer, 0x11);
+}
+
+static inline __m256
+blend_lighten_only (__m256 in,
+                    __m256 layer)
+{
+  /* MAX (in, layer) */
+  return _mm256_max_ps (in, layer);
+}
+
+static inline __m256
+blend_linear_burn (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_sub_ps (_mm256_add_ps (in, layer), v_set1 (1.0f));
+}
+
+static inline __m256
+blend_linear_light (__m256 in,
+                    __m256 layer)
+{
+  __m256 low;
+  __m256 high;
+
+  low  = _mm256_sub_ps (_mm256_add_ps (in,
+                                       _mm256_mul_ps (v_set1 (2.0f), layer)),
+                        v_set1 (1.0f));
+  high = _mm256_add_ps (in,
+                        _mm256_mul_ps (v_set1 (2.0f),
+                                       _mm256_sub_ps (layer, v_set1 (0.5f))));
+
+  return v_select (_mm256_cmp_ps (layer, v_set1 (0.5f), _CMP_LE_OQ),
+                   low, high);
+}
+
+static inline __m256
+blend_multiply (__m256 in,
+                __m256 layer)
+{
+  return _mm256_mul_ps (in, layer);
+}
+
+static inline __m256
+blend_overlay (__m256 in,
+               __m256 layer)
+{
+  __m256 low;
+  __m256 high;
+
+  low  = _mm256_mul_ps (_mm256_mul_ps (v_set1 (2.0f), in), layer);
+  high = _mm256_sub_ps (
+    v_set1 (1.0f),
+    _mm256_mul_ps (_mm256_mul_ps (v_set1 (2.0f),
+                                  _mm256_sub_ps (v_set1 (1.0f), layer)),
+                   _mm256_sub_ps (v_set1 (1.0f), in)));
+
+  return v_select (_mm256_cmp_ps (in, v_set1 (0.5f), _CMP_LT_OQ),
+                   low, high);
+}
+
+static inline __m256
+blend_pin_light (__m256 in,
+                 __m256 layer)
+{
+  __m256 low;
+  __m256 high;
+
+  low  = _mm256_min_ps (in, _mm256_mul_ps (v_set1 (2.0f), layer));
+  high = _mm256_max_ps (in,
+                        _mm256_mul_ps (v_set1 (2.0f),
+                                       _mm256_sub_ps (layer, v_set1 (0.5f))));
+
+  return v_select (_mm256_cmp_ps (layer, v_set1 (0.5f), _CMP_GT_OQ),
+                   high, low);
+}
+
+static inline __m256
+blend_screen (__m256 in,
+              __m256 layer)
+{
+  return _mm256_sub_ps (v_set1 (1.0f),
+                        _mm256_mul_ps (_mm256_sub_ps (v_set1 (1.0f), in),
+                                       _mm256_sub_ps (v_set1 (1.0f), layer)));
+}
+
+static inline __m256
+blend_softlight (__m256 in,
+                 __m256 layer)
+{
+  __m256 multiply = blend_multiply (in, layer);
+  __m256 screen   = blend_screen   (in, layer);
+
+  return _mm256_add_ps (
+    _mm256_mul_ps (_mm256_sub_ps (v_set1 (1.0f), in), multiply),
+    _mm256_mul_ps (in, screen));
+}
+
+static inline __m256
+blend_subtract (__m256 in,
+                __m256 layer)
+{
+  return _mm256_sub_ps (in, layer);
+}
+
+static inline __m256
+blend_vivid_light (__m256 in,
+                   __m256 layer)
+{
+  __m256 low;
+  __m256 high;
+
+  low  = _mm256_sub_ps (
+    v_set1 (1.0f),
+    v_safe_div (_mm256_sub_ps (v_set1 (1.0f), in),
+                _mm256_mul_ps (v_set1 (2.0f), layer)));
+  low  = _mm256_max_ps (low, v_set1 (0.0f));
+
+  high = v_safe_div (in,
+                     _mm256_mul_ps (v_set1 (2.0f),
+                                    _mm256_sub_ps (v_set1 (1.0f), layer)));
+  high = _mm256_min_ps (high, v_set1 (1.0f));
+
+  return v_select (_mm256_cmp_ps (layer, v_set1 (0.5f), _CMP_LE_OQ),
+                   low, high);
+}
+
+
+/*  blend functions  */
+
+
+#define DEFINE_BLEND_FUNCTION_AVX2(name)                                     \
+static void                                                                  \
+gimp_operation_layer_mode_blend_##name##_avx2 (const gfloat *in,             \
+                                               const gfloat *layer,          \
+                                               gfloat       *comp,           \
+                                               gint          samples)        \
+{                                                                            \
+  blend_avx2 (in, layer, comp, samples,                                      \
+              blend_##name,                                                  \
+              gimp_operation_layer_mode_blend_##name);                       \
+}
+
+DEFINE_BLEND_FUNCTION_AVX2 (addition)
+DEFINE_BLEND_FUNCTION_AVX2 (burn)
+DEFINE_BLEND_FUNCTION_AVX2 (darken_only)
+DEFINE_BLEND_FUNCTION_AVX2 (difference)
+DEFINE_BLEND_FUNCTION_AVX2 (divide)
+DEFINE_BLEND_FUNCTION_AVX2 (dodge)
+DEFINE_BLEND_FUNCTION_AVX2 (exclusion)
+DEFINE_BLEND_FUNCTION_AVX2 (grain_extract)
+DEFINE_BLEND_FUNCTION_AVX2 (grain_merge)
+DEFINE_BLEND_FUNCTION_AVX2 (hard_mix)
+DEFINE_BLEND_FUNCTION_AVX2 (hardlight)
+DEFINE_BLEND_FUNCTION_AVX2 (hsv_hue)
+DEFINE_BLEND_FUNCTION_AVX2 (hsv_saturation)
+DEFINE_BLEND_FUNCTION_AVX2 (hsv_value)
+DEFINE_BLEND_FUNCTION_AVX2 (lch_chroma)
+DEFINE_BLEND_FUNCTION_AVX2 (lch_color)
+DEFINE_BLEND_FUNCTION_AVX2 (lch_hue)
+DEFINE_BLEND_FUNCTION_AVX2 (lch_lightness)
+DEFINE_BLEND_FUNCTION_AVX2 (lighten_only)
+DEFINE_BLEND_FUNCTION_AVX2 (linear_burn)
+DEFINE_BLEND_FUNCTION_AVX2 (linear_light)
+DEFINE_BLEND_FUNCTION_AVX2 (multiply)
+DEFINE_BLEND_FUNCTION_AVX2 (overlay)
+DEFINE_BLEND_FUNCTION_AVX2 (pin_light)
+DEFINE_BLEND_FUNCTION_AVX2 (screen)
+DEFINE_BLEND_FUNCTION_AVX2 (softlight)
+DEFINE_BLEND_FUNCTION_AVX2 (subtract)
+DEFINE_BLEND_FUNCTION_AVX2 (vivid_light)
+
+#undef DEFINE_BLEND_FUNCTION_AVX2
+
+
+/*  public functions  */
+
+
+/* returns the AVX2 version of @blend_function, or @blend_function itself,
+ * if it doesn't have one.
+ */
+GimpLayerModeBlendFunc
+gimp_operation_layer_mode_blend_get_function_avx2 (GimpLayerModeBlendFunc blend_function)
+{
+  static const struct
+  {
+    GimpLayerModeBlendFunc generic;
+    GimpLayerModeBlendFunc avx2;
+  } functions[] =
+  {
+#define FUNCTION(name)                                   \
+    { gimp_operation_layer_mode_blend_##name,            \
+      gimp_operation_layer_mode_blend_##name##_avx2 }
+
+    FUNCTION (addition),
+    FUNCTION (burn),
+    FUNCTION (darken_only),
+    FUNCTION (difference),
+    FUNCTION (divide),
+    FUNCTION (dodge),
+    FUNCTION (exclusion),
+    FUNCTION (grain_extract),
+    FUNCTION (grain_merge),
+    FUNCTION (hard_mix),
+    FUNCTION (hardlight),
+    FUNCTION (hsv_hue),
+    FUNCTION (hsv_saturation),
+    FUNCTION (hsv_value),
+    FUNCTION (lch_chroma),
+    FUNCTION (lch_color),
+    FUNCTION (lch_hue),
+    FUNCTION (lch_lightness),
+    FUNCTION (lighten_only),
+    FUNCTION (linear_burn),
+    FUNCTION (linear_light),
+    FUNCTION (multiply),
+    FUNCTION (overlay),
+    FUNCTION (pin_light),
+    FUNCTION (screen),
+    FUNCTION (softlight),
+    FUNCTION (subtract),
+    FUNCTION (vivid_light)
+
+#undef FUNCTION
+  };
+
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (functions); i++)
+    {
+      if (functions[i].generic == blend_function)
+        return functions[i].avx2;
+    }
+
+  return blend_function;
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
@@ -164,4 +164,14 @@ void gimp_operation_layer_mode_blend_color_erase       (const gfloat *in,
                                                         gint          samples);
 
 
+/*  vectorized blend functions  */
+
+#if COMPILE_AVX2_INTRINISICS
+
+GimpLayerModeBlendFunc
+     gimp_operation_layer_mode_blend_get_function_avx2 (GimpLayerModeBlendFunc blend_function);
+
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+
 #endif /* __GIMP_OPERATION_LAYER_MODE_BLEND_H__ */
@@ -31,15 +31,15 @@
 
 #include "gimp-layer-modes.h"
 #include "gimpoperationlayermode.h"
+#include "gimpoperationlayermode-blend.h"
 #include "gimpoperationlayermode-composite.h"
 
 
-/* the maximum number of samples to process in one go.  used to limit
- * the size of the buffers we allocate on the stack.
+/* the number of samples to blend and composite in one go.  the temporary
+ * buffers we allocate on the stack are small enough to stay in the L1 cache.
  */
-#define GIMP_COMPOSITE_BLEND_MAX_SAMPLES ((1 << 18) /* 256 KiB */  /      \
-                                          16 /* bytes per pixel */ /      \
-                                          2  /* max number of buffers */)
+#define GIMP_COMPOSITE_BLEND_BLOCK_SIZE ((1 << 12) /* 4 KiB */      /  \
+                                         16 /* bytes per pixel */)
 
 /* number of consecutive unblended samples (whose source or destination alpha
  * is zero) above which to split the blending process, in order to avoid
@@ -323,6 +323,15 @@ gimp_operation_layer_mode_prepare (GeglOperation *operation)
   self->function       = gimp_layer_mode_get_function       (self->layer_mode);
   self->blend_function = gimp_layer_mode_get_blend_function (self->layer_mode);
 
+#if COMPILE_AVX2_INTRINISICS
+  if (self->blend_function &&
+      (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2))
+    {
+      self->blend_function =
+        gimp_operation_layer_mode_blend_get_function_avx2 (self->blend_function);
+    }
+#endif
+
   input_extent = gegl_operation_source_get_bounding_box (operation, "input");
 
   /* if the input pad has data, work as usual. */
@@ -521,6 +530,106 @@ gimp_operation_layer_mode_process (GeglOperation       *operation,
     operation, in, layer, mask, out, samples, roi, level);
 }
 
+static inline void
+gimp_operation_layer_mode_blend_block (GimpLayerModeBlendFunc  blend_function,
+                                       const Babl             *composite_to_blend_fish,
+                                       const Babl             *blend_to_composite_fish,
+                                       const gfloat           *in,
+                                       const gfloat           *layer,
+                                       gfloat                 *blend_out,
+                                       gint                    samples)
+{
+  gfloat blend_in[4 * GIMP_COMPOSITE_BLEND_BLOCK_SIZE];
+  gfloat blend_layer[4 * GIMP_COMPOSITE_BLEND_BLOCK_SIZE];
+  gint   i;
+  gint   end;
+
+  /* if both blending and compositing use the same color space, things are
+   * much simpler.
+   */
+  if (! composite_to_blend_fish)
+    {
+      blend_function (in, layer, blend_out, samples);
+
+      return;
+    }
+
+  /* samples whose the source or destination alpha is zero are not blended,
+   * and therefore do not need to be converted.  while it's generally
+   * desirable to perform conversion and blending in bulk, when we have
+   * more than a certain number of consecutive unblended samples, the cost
+   * of converting them outweighs the cost of splitting the process around
+   * them to avoid the conversion.
+   */
+
+  i   = ALPHA;
+  end = 4 * samples + ALPHA;
+
+  while (TRUE)
+    {
+      gint first;
+      gint last;
+      gint count;
+
+      /* skip any unblended samples.  the color values of `blend_out` for
+       * these samples are unconstrained, in particular, they may be NaN,
+       * but the alpha values should generally be finite, and specifically
+       * 0 when the source alpha is 0.
+       */
+      while (i < end && (in[i] == 0.0f || layer[i] == 0.0f))
+        {
+          blend_out[i] = 0.0f;
+          i += 4;
+        }
+
+      /* stop if there are no more samples */
+      if (i == end)
+        break;
+
+      /* otherwise, keep scanning the samples until we find
+       * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD consecutive unblended
+       * samples.
+       */
+
+      first  = i;
+      i     += 4;
+      last   = i;
+
+      while (i < end && i - last < 4 * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD)
+        {
+          gboolean blended;
+
+          blended = (in[i] != 0.0f && layer[i] != 0.0f);
+
+          i += 4;
+          if (blended)
+            last = i;
+        }
+
+      /* convert and blend the samples in the range [first, last) */
+
+      count  = (last - first) / 4;
+      first -= ALPHA;
+
+      babl_process (composite_to_blend_fish,
+                    in + first, blend_in + first, count);
+      babl_process (composite_to_blend_fish,
+                    layer + first, blend_layer + first, count);
+
+      blend_function (blend_in + first, blend_layer + first,
+                      blend_out + first, count);
+
+      babl_process (blend_to_composite_fish,
+                    blend_out + first, blend_out + first, count);
+
+      /* make sure the alpha values of `blend_out` are valid for the
+       * trailing unblended samples.
+       */
+      for (; last < i; last += 4)
+        blend_out[last] = 0.0f;
+    }
+}
+
 static gboolean
 gimp_operation_layer_mode_real_process (GeglOperation       *operation,
                                         void                *in_p,
@@ -541,42 +650,11 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
   GimpLayerColorSpace     composite_space         = layer_mode->composite_space;
   GimpLayerCompositeMode  composite_mode          = layer_mode->real_composite_mode;
   GimpLayerModeBlendFunc  blend_function          = layer_mode->blend_function;
-  gboolean                composite_needs_in_color;
-  gfloat                 *blend_in;
-  gfloat                 *blend_layer;
-  gfloat                 *blend_out;
+  CompositeFunc           composite_function      = NULL;
+  gfloat                  blend_out[4 * GIMP_COMPOSITE_BLEND_BLOCK_SIZE];
   const Babl             *composite_to_blend_fish = NULL;
   const Babl             *blend_to_composite_fish = NULL;
 
-  /* make sure we don't process more than GIMP_COMPOSITE_BLEND_MAX_SAMPLES
-   * at a time, so that we don't overflow the stack if we allocate buffers
-   * on it.  note that this has to be done with a nested function call,
-   * because alloca'd buffers remain for the duration of the stack frame.
-   */
-  while (samples > GIMP_COMPOSITE_BLEND_MAX_SAMPLES)
-    {
-      gimp_operation_layer_mode_real_process (operation,
-                                              in, layer, mask, out,
-                                              GIMP_COMPOSITE_BLEND_MAX_SAMPLES,
-                                              roi, level);
-
-      in      += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      layer   += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      if (mask)
-        mask  +=     GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      out     += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-
-      samples -= GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-    }
-
-  composite_needs_in_color =
-    composite_mode == GIMP_LAYER_COMPOSITE_UNION ||
-    composite_mode == GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP;
-
-  blend_in    = in;
-  blend_layer = layer;
-  blend_out   = out;
-
   if (blend_space != GIMP_LAYER_COLOR_SPACE_AUTO)
     {
       gimp_assert (composite_space >= 1 && composite_space < 4);
@@ -589,145 +667,25 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
                                                             [composite_space - 1];
     }
 
-  /* if we need to convert the samples between the composite and blend
-   * spaces...
-   */
-  if (composite_to_blend_fish)
-    {
-      gint i;
-      gint end;
-
-      if (in != out || composite_needs_in_color)
-        {
-          /* don't convert input in-place if we're not doing in-place output,
-           * or if we're going to need the original input for compositing.
-           */
-          blend_in = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-      blend_layer  = g_alloca (sizeof (gfloat) * 4 * samples);
-
-      if (in == out) /* in-place detected, avoid clobbering since we need to
-                        read 'in' for the compositing stage  */
-        {
-          if (blend_layer != layer)
-            blend_out = blend_layer;
-          else
-            blend_out = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-
-      /* samples whose the source or destination alpha is zero are not blended,
-       * and therefore do not need to be converted.  while it's generally
-       * desirable to perform conversion and blending in bulk, when we have
-       * more than a certain number of consecutive unblended samples, the cost
-       * of converting them outweighs the cost of splitting the process around
-       * them to avoid the conversion.
-       */
-
-      i   = ALPHA;
-      end = 4 * samples + ALPHA;
-
-      while (TRUE)
-        {
-          gint first;
-          gint last;
-          gint count;
-
-          /* skip any unblended samples.  the color values of `blend_out` for
-           * these samples are unconstrained, in particular, they may be NaN,
-           * but the alpha values should generally be finite, and specifically
-           * 0 when the source alpha is 0.
-           */
-          while (i < end && (in[i] == 0.0f || layer[i] == 0.0f))
-            {
-              blend_out[i] = 0.0f;
-              i += 4;
-            }
-
-          /* stop if there are no more samples */
-          if (i == end)
-            break;
-
-          /* otherwise, keep scanning the samples until we find
-           * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD consecutive unblended
-           * samples.
-           */
-
-          first  = i;
-          i     += 4;
-          last   = i;
-
-          while (i < end && i - last < 4 * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD)
-            {
-              gboolean blended;
-
-              blended = (in[i] != 0.0f && layer[i] != 0.0f);
-
-              i += 4;
-              if (blended)
-                last = i;
-            }
-
-          /* convert and blend the samples in the range [first, last) */
-
-          count  = (last - first) / 4;
-          first -= ALPHA;
-
-          babl_process (composite_to_blend_fish,
-                        in + first, blend_in + first, count);
-          babl_process (composite_to_blend_fish,
-                        layer + first, blend_layer + first, count);
-
-          blend_function (blend_in + first, blend_layer + first,
-                          blend_out + first, count);
-
-          babl_process (blend_to_composite_fish,
-                        blend_out + first, blend_out + first, count);
-
-          /* make sure the alpha values of `blend_out` are valid for the
-           * trailing unblended samples.
-           */
-          for (; last < i; last += 4)
-            blend_out[last] = 0.0f;
-        }
-    }
-  else
-    {
-      /* if both blending and compositing use the same color space, things are
-       * much simpler.
-       */
-
-      if (in == out) /* in-place detected, avoid clobbering since we need to
-                        read 'in' for the compositing stage  */
-        {
-          blend_out = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-
-      blend_function (blend_in, blend_layer, blend_out, samples);
-    }
-
   if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode))
     {
       switch (composite_mode)
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union (in, layer, blend_out, mask, opacity,
-                           out, samples);
+          composite_function = composite_union;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop (in, layer, blend_out, mask, opacity,
-                                      out, samples);
+          composite_function = composite_clip_to_backdrop;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer (in, layer, blend_out, mask, opacity,
-                                   out, samples);
+          composite_function = composite_clip_to_layer;
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection (in, layer, blend_out, mask, opacity,
-                                  out, samples);
+          composite_function = composite_intersection;
           break;
         }
     }
@@ -737,27 +695,51 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union_sub (in, layer, blend_out, mask, opacity,
-                               out, samples);
+          composite_function = composite_union_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop_sub (in, layer, blend_out, mask, opacity,
-                                          out, samples);
+          composite_function = composite_clip_to_backdrop_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer_sub (in, layer, blend_out, mask, opacity,
-                                       out, samples);
+          composite_function = composite_clip_to_layer_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection_sub (in, layer, blend_out, mask, opacity,
-                                      out, samples);
+          composite_function = composite_intersection_sub;
           break;
         }
     }
 
+  g_return_val_if_fail (composite_function != NULL, FALSE);
+
+  /* blend and composite the samples one block at a time, so that the
+   * intermediate results stay in the cache between the conversion,
+   * blending, and compositing stages, instead of making a separate pass
+   * over all the samples for each stage.  since `blend_out` is never
+   * aliased with the input, this works for in-place processing as well.
+   */
+  while (samples > 0)
+    {
+      gint count = MIN (samples, GIMP_COMPOSITE_BLEND_BLOCK_SIZE);
+
+      gimp_operation_layer_mode_blend_block (blend_function,
+                                             composite_to_blend_fish,
+                                             blend_to_composite_fish,
+                                             in, layer, blend_out, count);
+
+      composite_function (in, layer, blend_out, mask, opacity, out, count);
+
+      in      += 4 * count;
+      layer   += 4 * count;
+      if (mask)
+        mask  +=     count;
+      out     += 4 * count;
+
+      samples -= count;
+    }
+
   return TRUE;
 }
 
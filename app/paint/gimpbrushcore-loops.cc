@@ -29,6 +29,7 @@ extern "C"
 
 #include "paint-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimptempbuf.h"
 
 #include "gimpbrushcore.h"
@@ -128,7 +129,7 @@ gimp_brush_core_subsample_mask_impl (const GimpTempBuf *mask,
   gint               dest_width  = gimp_temp_buf_get_width  (dest);
   gint               dest_height = gimp_temp_buf_get_height (dest);
 
-  gegl_parallel_distribute_range (
+  gimp_parallel_distribute_range (
     mask_height, PIXELS_PER_THREAD / mask_width,
     [=] (gint y, gint height)
     {
@@ -457,7 +458,7 @@ gimp_brush_core_pressurize_mask_impl (const GimpTempBuf *mask,
                                       GimpTempBuf       *dest,
                                       Pressure           pressure)
 {
-  gegl_parallel_distribute_range (
+  gimp_parallel_distribute_range (
     gimp_temp_buf_get_width (mask) * gimp_temp_buf_get_height (mask),
     PIXELS_PER_THREAD,
     [=] (gint offset, gint size)
@@ -544,7 +545,7 @@ gimp_brush_core_solidify_mask_impl (const GimpTempBuf *mask,
   gint dest_width  = gimp_temp_buf_get_width  (dest);
   gint dest_height = gimp_temp_buf_get_height (dest);
 
-  gegl_parallel_distribute_area (
+  gimp_parallel_distribute_area (
     GEGL_RECTANGLE (0, 0, mask_width, mask_height),
     PIXELS_PER_THREAD,
     [=] (const GeglRectangle *area)
@@ -32,6 +32,7 @@
 #include "gegl/gimp-gegl-loops.h"
 
 #include "core/gimpbrush-header.h"
+#include "core/gimpbrushcache.h"
 #include "core/gimpbrushgenerated.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpdynamics.h"
@@ -156,6 +157,7 @@ gimp_brush_core_class_init (GimpBrushCoreClass *klass)
   klass->handles_changing_brush             = FALSE;
   klass->handles_transforming_brush         = TRUE;
   klass->handles_dynamic_transforming_brush = TRUE;
+  klass->handles_batched_dabs               = FALSE;
 
   klass->set_brush                          = gimp_brush_core_real_set_brush;
   klass->set_dynamics                       = gimp_brush_core_real_set_dynamics;
@@ -701,6 +703,9 @@ gimp_brush_core_interpolate (GimpPaintCore    *paint_core,
         }
     }
 
+  if (GIMP_BRUSH_CORE_GET_CLASS (core)->handles_batched_dabs)
+    gimp_paint_core_begin_batch (paint_core);
+
   for (n = 0; n < num_points; n++)
     {
       gdouble t = t0 + n * dt;
@@ -759,6 +764,9 @@ gimp_brush_core_interpolate (GimpPaintCore    *paint_core,
                              GIMP_PAINT_STATE_MOTION, time);
     }
 
+  if (GIMP_BRUSH_CORE_GET_CLASS (core)->handles_batched_dabs)
+    gimp_paint_core_end_batch (paint_core, drawable);
+
   current_coords.x        = last_coords.x        + delta_vec.x;
   current_coords.y        = last_coords.y        + delta_vec.y;
   current_coords.pressure = last_coords.pressure + delta_pressure;
@@ -1156,10 +1164,8 @@ gimp_brush_core_eval_transform_dynamics (GimpBrushCore     *core,
       core->reflect  = coords->reflect;
     }
 
-  if (! GIMP_IS_DYNAMICS (core->dynamics))
-    return;
-
-  if (GIMP_BRUSH_CORE_GET_CLASS (core)->handles_dynamic_transforming_brush)
+  if (GIMP_IS_DYNAMICS (core->dynamics) &&
+      GIMP_BRUSH_CORE_GET_CLASS (core)->handles_dynamic_transforming_brush)
     {
       gdouble fade_point = 1.0;
 
@@ -1211,6 +1217,13 @@ gimp_brush_core_eval_transform_dynamics (GimpBrushCore     *core,
             core->aspect_ratio *= dyn_aspect;
         }
     }
+
+  /*  snap the transform to the brush cache's tolerance, so that
+   *  similar dabs share their transformed brush
+   */
+  if (core->scale > 0.0)
+    gimp_brush_cache_quantize (&core->scale, &core->aspect_ratio,
+                               &core->angle, &core->hardness);
 }
 
 void
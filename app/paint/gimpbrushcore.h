@@ -85,6 +85,11 @@ struct _GimpBrushCoreClass
   /*  Set for tools that don't mind if the brush scales mid stroke  */
   gboolean            handles_dynamic_transforming_brush;
 
+  /*  Set for tools that fill the paint buffer with a single color in
+   *  constant mode, so that their dabs can be composited in batches
+   */
+  gboolean            handles_batched_dabs;
+
   void (* set_brush)    (GimpBrushCore *core,
                          GimpBrush     *brush);
   void (* set_dynamics) (GimpBrushCore *core,
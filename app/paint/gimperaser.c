@@ -74,6 +74,7 @@ gimp_eraser_class_init (GimpEraserClass *klass)
   paint_core_class->paint = gimp_eraser_paint;
 
   brush_core_class->handles_changing_brush = TRUE;
+  brush_core_class->handles_batched_dabs   = TRUE;
 }
 
 static void
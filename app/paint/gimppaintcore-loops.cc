@@ -19,6 +19,8 @@
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
+#include "libgimpmath/gimpmath.h"
+
 extern "C"
 {
 
@@ -26,6 +28,7 @@ extern "C"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimptempbuf.h"
 
 #include "operations/gimpoperationmaskcomponents.h"
@@ -2173,7 +2176,16 @@ void
 gimp_paint_core_loops_process (const GimpPaintCoreLoopsParams *params,
                                GimpPaintCoreLoopsAlgorithm     algorithms)
 {
-  GeglRectangle roi;
+  GeglRectangle  roi;
+  GeglBuffer    *grid_buffer;
+  gint           shift_x     = 0;
+  gint           shift_y     = 0;
+  gint           tile_width  = 1;
+  gint           tile_height = 1;
+  gint           tile_x1     = 0;
+  gint           tile_y1     = 0;
+  gint           n_tiles_x   = 0;
+  gint           n_tiles_y   = 0;
 
   if (params->paint_buf)
     {
@@ -2192,6 +2204,32 @@ gimp_paint_core_loops_process (const GimpPaintCoreLoopsParams *params,
                    params->paint_mask_offset_y;
     }
 
+  if (roi.width <= 0 || roi.height <= 0)
+    return;
+
+  /* the buffer whose tiles are written; the undo buffer is a copy of
+   * the destination buffer, and shares its tile grid
+   */
+  grid_buffer = params->dest_buffer ? params->dest_buffer :
+                                      params->canvas_buffer;
+
+  if (grid_buffer)
+    {
+      g_object_get (grid_buffer,
+                    "shift-x",     &shift_x,
+                    "shift-y",     &shift_y,
+                    "tile-width",  &tile_width,
+                    "tile-height", &tile_height,
+                    NULL);
+
+      tile_x1   = (gint) floor ((gdouble) (roi.x + shift_x) / tile_width);
+      tile_y1   = (gint) floor ((gdouble) (roi.y + shift_y) / tile_height);
+      n_tiles_x = (gint) floor ((gdouble) (roi.x + roi.width  - 1 + shift_x) /
+                                tile_width)  - tile_x1 + 1;
+      n_tiles_y = (gint) floor ((gdouble) (roi.y + roi.height - 1 + shift_y) /
+                                tile_height) - tile_y1 + 1;
+    }
+
   dispatch (
     [&] (auto algorithm_type)
     {
@@ -2200,56 +2238,96 @@ gimp_paint_core_loops_process (const GimpPaintCoreLoopsParams *params,
 
       Algorithm algorithm (params);
 
-      gegl_parallel_distribute_area (
-        &roi, PIXELS_PER_THREAD,
-        [=] (const GeglRectangle *area)
-        {
-          State state;
-          gint  y;
+      auto process_area = [=] (const GeglRectangle *area)
+      {
+        State state;
+        gint  y;
 
-          if (Algorithm::max_n_iterators > 0)
-            {
-              GeglBufferIterator *iter;
+        if (Algorithm::max_n_iterators > 0)
+          {
+            GeglBufferIterator *iter;
 
-              iter = gegl_buffer_iterator_empty_new (
-                Algorithm::max_n_iterators);
+            iter = gegl_buffer_iterator_empty_new (
+              Algorithm::max_n_iterators);
 
-              algorithm.init (params, &state, iter, &roi, area);
+            algorithm.init (params, &state, iter, &roi, area);
 
-              while (gegl_buffer_iterator_next (iter))
-                {
-                  const GeglRectangle *rect = &iter->items[0].roi;
+            while (gegl_buffer_iterator_next (iter))
+              {
+                const GeglRectangle *rect = &iter->items[0].roi;
 
-                  algorithm.init_step (params, &state, iter, &roi, area, rect);
+                algorithm.init_step (params, &state, iter, &roi, area, rect);
 
-                  for (y = 0; y < rect->height; y++)
-                    {
-                      algorithm.process_row (params, &state,
-                                             iter, &roi, area, rect,
-                                             rect->y + y);
-                    }
+                for (y = 0; y < rect->height; y++)
+                  {
+                    algorithm.process_row (params, &state,
+                                           iter, &roi, area, rect,
+                                           rect->y + y);
+                  }
 
-                  algorithm.finalize_step (params, &state);
-                }
+                algorithm.finalize_step (params, &state);
+              }
 
-              algorithm.finalize (params, &state);
-            }
-          else
-            {
-              algorithm.init      (params, &state, NULL, &roi, area);
-              algorithm.init_step (params, &state, NULL, &roi, area, area);
+            algorithm.finalize (params, &state);
+          }
+        else
+          {
+            algorithm.init      (params, &state, NULL, &roi, area);
+            algorithm.init_step (params, &state, NULL, &roi, area, area);
+
+            for (y = 0; y < area->height; y++)
+              {
+                algorithm.process_row (params, &state,
+                                       NULL, &roi, area, area,
+                                       area->y + y);
+              }
+
+            algorithm.finalize_step (params, &state);
+            algorithm.finalize      (params, &state);
+          }
+      };
 
-              for (y = 0; y < area->height; y++)
+      if (n_tiles_x * n_tiles_y > 1)
+        {
+          /* split footprints spanning several tiles along the tile grid,
+           * so that each thread works on whole tiles, and threads don't
+           * contend over the same tiles of the canvas, undo and
+           * destination buffers.  runs of tiles in the same tile row are
+           * processed as a single area.
+           */
+          gimp_parallel_distribute_range (
+            n_tiles_x * n_tiles_y,
+            PIXELS_PER_THREAD / (tile_width * tile_height),
+            [&] (gsize offset,
+                 gsize size)
+            {
+              while (size > 0)
                 {
-                  algorithm.process_row (params, &state,
-                                         NULL, &roi, area, area,
-                                         area->y + y);
-                }
+                  gint          tile_x = offset % n_tiles_x;
+                  gint          tile_y = offset / n_tiles_x;
+                  gint          n      = MIN (size, (gsize) (n_tiles_x - tile_x));
+                  GeglRectangle tiles;
+                  GeglRectangle area;
+
+                  tiles.x      = (tile_x1 + tile_x) * tile_width  - shift_x;
+                  tiles.y      = (tile_y1 + tile_y) * tile_height - shift_y;
+                  tiles.width  = n * tile_width;
+                  tiles.height = tile_height;
 
-              algorithm.finalize_step (params, &state);
-              algorithm.finalize      (params, &state);
-            }
-        });
+                  gegl_rectangle_intersect (&area, &tiles, &roi);
+
+                  process_area (&area);
+
+                  offset += n;
+                  size   -= n;
+                }
+            });
+        }
+      else
+        {
+          gimp_parallel_distribute_area (&roi, PIXELS_PER_THREAD,
+                                         process_area);
+        }
     },
     params, algorithms, identity<AlgorithmBase> (),
     dispatch_combine_paint_mask_to_canvas_buffer_to_paint_buf_alpha,
@@ -59,6 +59,9 @@
 
 #define STROKE_BUFFER_INIT_SIZE 2000
 
+/*  the most drawable undos a stroke pushes for the tiles it touched  */
+#define MAX_DIRTY_UNDOS 16
+
 enum
 {
   PROP_0,
@@ -117,6 +120,19 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_push_dirty_tiles    (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable);
+
+static gboolean  gimp_paint_core_batch_dab           (GimpPaintCore     *core,
+                                                      GimpDrawable      *drawable,
+                                                      const GimpTempBuf *paint_buf,
+                                                      gdouble            image_opacity,
+                                                      GimpLayerMode      paint_mode);
+static void      gimp_paint_core_break_batch         (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable);
+static void      gimp_paint_core_flush_batch         (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -393,6 +409,20 @@ gimp_paint_core_start (GimpPaintCore     *core,
 
   core->undo_buffer = gegl_buffer_dup (gimp_drawable_get_buffer (drawable));
 
+  /*  Track the tiles touched by the stroke, only those go to the undo  */
+  g_object_get (core->undo_buffer,
+                "tile-width",  &core->tile_width,
+                "tile-height", &core->tile_height,
+                NULL);
+
+  core->n_tiles_x = (gimp_item_get_width  (item) + core->tile_width  - 1) /
+                    core->tile_width;
+  core->n_tiles_y = (gimp_item_get_height (item) + core->tile_height - 1) /
+                    core->tile_height;
+
+  g_free (core->dirty_tiles);
+  core->dirty_tiles = g_new0 (guint8, core->n_tiles_x * core->n_tiles_y);
+
   /*  Allocate the saved proj structure  */
   g_clear_object (&core->saved_proj_buffer);
 
@@ -421,6 +451,12 @@ gimp_paint_core_start (GimpPaintCore     *core,
   core->last_paint.x = -1e6;
   core->last_paint.y = -1e6;
 
+  core->batch         = FALSE;
+  core->batch_rect    = *GEGL_RECTANGLE (0, 0, 0, 0);
+  core->batch_area    = 0;
+  core->batch_invalid = FALSE;
+  core->batch_format  = NULL;
+
   mask = gimp_image_get_mask (image);
 
   /*  don't apply the mask to itself and don't apply an empty mask  */
@@ -518,25 +554,38 @@ gimp_paint_core_finish (GimpPaintCore *core,
 
       GIMP_PAINT_CORE_GET_CLASS (core)->push_undo (core, image, NULL);
 
-      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, rect.width, rect.height),
-                                gimp_drawable_get_format (drawable));
+      if (core->dirty_tiles)
+        {
+          /*  only push the tiles which were touched, as a few
+           *  rectangles, rather than the stroke's whole bounding box
+           */
+          gimp_paint_core_push_dirty_tiles (core, drawable);
+        }
+      else
+        {
+          buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                    rect.width, rect.height),
+                                    gimp_drawable_get_format (drawable));
 
-      gimp_gegl_buffer_copy (core->undo_buffer,
-                             &rect,
-                             GEGL_ABYSS_NONE,
-                             buffer,
-                             GEGL_RECTANGLE (0, 0, 0, 0));
+          gimp_gegl_buffer_copy (core->undo_buffer,
+                                 &rect,
+                                 GEGL_ABYSS_NONE,
+                                 buffer,
+                                 GEGL_RECTANGLE (0, 0, 0, 0));
 
-      gimp_drawable_push_undo (drawable, NULL,
-                               buffer, rect.x, rect.y, rect.width, rect.height);
+          gimp_drawable_push_undo (drawable, NULL,
+                                   buffer,
+                                   rect.x, rect.y, rect.width, rect.height);
 
-      g_object_unref (buffer);
+          g_object_unref (buffer);
+        }
 
       gimp_image_undo_group_end (image);
     }
 
   g_clear_object (&core->undo_buffer);
   g_clear_object (&core->saved_proj_buffer);
+  g_clear_pointer (&core->dirty_tiles, g_free);
 
   gimp_viewable_preview_thaw (GIMP_VIEWABLE (drawable));
 }
@@ -575,6 +624,7 @@ gimp_paint_core_cancel (GimpPaintCore *core,
 
   g_clear_object (&core->undo_buffer);
   g_clear_object (&core->saved_proj_buffer);
+  g_clear_pointer (&core->dirty_tiles, g_free);
 
   gimp_drawable_update (drawable, x, y, width, height);
 
@@ -590,6 +640,8 @@ gimp_paint_core_cleanup (GimpPaintCore *core)
   g_clear_object (&core->saved_proj_buffer);
   g_clear_object (&core->canvas_buffer);
   g_clear_object (&core->paint_buffer);
+
+  g_clear_pointer (&core->dirty_tiles, g_free);
 }
 
 void
@@ -735,6 +787,45 @@ gimp_paint_core_get_paint_buffer (GimpPaintCore    *core,
   return paint_buffer;
 }
 
+void
+gimp_paint_core_expand_undo_extents (GimpPaintCore *core,
+                                     gint           x,
+                                     gint           y,
+                                     gint           width,
+                                     gint           height)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  core->x1 = MIN (core->x1, x);
+  core->y1 = MIN (core->y1, y);
+  core->x2 = MAX (core->x2, x + width);
+  core->y2 = MAX (core->y2, y + height);
+
+  if (core->dirty_tiles)
+    {
+      gint tile_x1 = CLAMP (x, 0, core->n_tiles_x * core->tile_width  - 1) /
+                     core->tile_width;
+      gint tile_y1 = CLAMP (y, 0, core->n_tiles_y * core->tile_height - 1) /
+                     core->tile_height;
+      gint tile_x2 = CLAMP (x + width  - 1,
+                            0, core->n_tiles_x * core->tile_width  - 1) /
+                     core->tile_width;
+      gint tile_y2 = CLAMP (y + height - 1,
+                            0, core->n_tiles_y * core->tile_height - 1) /
+                     core->tile_height;
+      gint tile_y;
+
+      for (tile_y = tile_y1; tile_y <= tile_y2; tile_y++)
+        {
+          memset (core->dirty_tiles + tile_y * core->n_tiles_x + tile_x1,
+                  TRUE, tile_x2 - tile_x1 + 1);
+        }
+    }
+}
+
 GeglBuffer *
 gimp_paint_core_get_orig_image (GimpPaintCore *core)
 {
@@ -773,6 +864,8 @@ gimp_paint_core_paste (GimpPaintCore            *core,
 
   if (core->applicator)
     {
+      gimp_paint_core_break_batch (core, drawable);
+
       /*  If the mode is CONSTANT:
        *   combine the canvas buffer and the paint mask to the paint buffer
        */
@@ -863,6 +956,33 @@ gimp_paint_core_paste (GimpPaintCore            *core,
       if (! params.paint_buf)
         return;
 
+      if (mode == GIMP_PAINT_CONSTANT && paint_mask != NULL)
+        {
+          if (gimp_paint_core_batch_dab (core, drawable, params.paint_buf,
+                                         image_opacity, paint_mode))
+            {
+              /* Only mix the paint mask into canvas_buffer, the pending
+               * dabs are composited at once by gimp_paint_core_end_batch()
+               */
+              params.canvas_buffer       = core->canvas_buffer;
+              params.paint_mask          = paint_mask;
+              params.paint_mask_offset_x = paint_mask_offset_x;
+              params.paint_mask_offset_y = paint_mask_offset_y;
+              params.stipple             = GIMP_IS_AIRBRUSH (core);
+              params.paint_opacity       = paint_opacity;
+
+              gimp_paint_core_loops_process (
+                &params,
+                GIMP_PAINT_CORE_LOOPS_ALGORITHM_COMBINE_PAINT_MASK_TO_CANVAS_BUFFER);
+
+              return;
+            }
+        }
+      else
+        {
+          gimp_paint_core_break_batch (core, drawable);
+        }
+
       params.dest_buffer = gimp_drawable_get_buffer (drawable);
 
       if (mode == GIMP_PAINT_CONSTANT)
@@ -925,10 +1045,10 @@ gimp_paint_core_paste (GimpPaintCore            *core,
     }
 
   /*  Update the undo extents  */
-  core->x1 = MIN (core->x1, core->paint_buffer_x);
-  core->y1 = MIN (core->y1, core->paint_buffer_y);
-  core->x2 = MAX (core->x2, core->paint_buffer_x + width);
-  core->y2 = MAX (core->y2, core->paint_buffer_y + height);
+  gimp_paint_core_expand_undo_extents (core,
+                                       core->paint_buffer_x,
+                                       core->paint_buffer_y,
+                                       width, height);
 
   /*  Update the drawable  */
   gimp_drawable_update (drawable,
@@ -971,6 +1091,8 @@ gimp_paint_core_replace (GimpPaintCore            *core,
       return;
     }
 
+  gimp_paint_core_break_batch (core, drawable);
+
   width  = gegl_buffer_get_width  (core->paint_buffer);
   height = gegl_buffer_get_height (core->paint_buffer);
 
@@ -1181,10 +1303,10 @@ gimp_paint_core_replace (GimpPaintCore            *core,
     }
 
   /*  Update the undo extents  */
-  core->x1 = MIN (core->x1, core->paint_buffer_x);
-  core->y1 = MIN (core->y1, core->paint_buffer_y);
-  core->x2 = MAX (core->x2, core->paint_buffer_x + width);
-  core->y2 = MAX (core->y2, core->paint_buffer_y + height);
+  gimp_paint_core_expand_undo_extents (core,
+                                       core->paint_buffer_x,
+                                       core->paint_buffer_y,
+                                       width, height);
 
   /*  Update the drawable  */
   gimp_drawable_update (drawable,
@@ -1193,6 +1315,35 @@ gimp_paint_core_replace (GimpPaintCore            *core,
                         width, height);
 }
 
+/* Dab batching: in CONSTANT mode, the drawable is always recomposited
+ * from undo_buffer and canvas_buffer, so when every dab of the stroke
+ * fills the paint buffer with the same color, and uses the same image
+ * opacity and paint mode, a run of dabs can be mixed into canvas_buffer
+ * one by one, and composited just once over their bounds, with the
+ * same result as compositing each dab separately.  Brush cores whose
+ * paint buffer is a single color in CONSTANT mode enclose their dabs in
+ * gimp_paint_core_begin_batch() and gimp_paint_core_end_batch().
+ */
+void
+gimp_paint_core_begin_batch (GimpPaintCore *core)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  core->batch = (! core->applicator && ! core->batch_invalid);
+}
+
+void
+gimp_paint_core_end_batch (GimpPaintCore *core,
+                           GimpDrawable  *drawable)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  gimp_paint_core_flush_batch (core, drawable);
+
+  core->batch = FALSE;
+}
+
 /**
  * Smooth and store coords in the stroke buffer
  */
@@ -1259,3 +1410,325 @@ gimp_paint_core_smooth_coords (GimpPaintCore    *core,
         }
     }
 }
+
+
+/*  private functions  */
+
+static void
+gimp_paint_core_push_dirty_tiles (GimpPaintCore *core,
+                                  GimpDrawable  *drawable)
+{
+  GArray *rects;
+  GArray *open;
+  GArray *next_open;
+  gint    tile_y1 = -1;
+  gint    tile_y2 = -1;
+  gint    tile_x;
+  gint    tile_y;
+  guint   i;
+
+  /*  collect runs of touched tiles in each tile row, merging each run
+   *  with the rectangle of an identical run right above it.  the runs
+   *  of each row, and the rectangles which are still open at the row
+   *  above, are both ordered by x, so they are matched in one pass.
+   */
+  rects     = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+  open      = g_array_new (FALSE, FALSE, sizeof (guint));
+  next_open = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (tile_y = 0; tile_y < core->n_tiles_y; tile_y++)
+    {
+      const guint8 *row = core->dirty_tiles + tile_y * core->n_tiles_x;
+      GArray       *tmp;
+
+      i = 0;
+
+      for (tile_x = 0; tile_x < core->n_tiles_x; tile_x++)
+        {
+          GeglRectangle *rect = NULL;
+          guint          index;
+          gint           n    = 1;
+
+          if (! row[tile_x])
+            continue;
+
+          while (tile_x + n < core->n_tiles_x && row[tile_x + n])
+            n++;
+
+          for (; i < open->len; i++)
+            {
+              index = g_array_index (open, guint, i);
+              rect  = &g_array_index (rects, GeglRectangle, index);
+
+              if (rect->x >= tile_x)
+                break;
+            }
+
+          if (i < open->len && rect->x == tile_x && rect->width == n)
+            {
+              rect->height++;
+              i++;
+            }
+          else
+            {
+              GeglRectangle new_rect = { tile_x, tile_y, n, 1 };
+
+              index = rects->len;
+              g_array_append_val (rects, new_rect);
+            }
+
+          g_array_append_val (next_open, index);
+
+          if (tile_y1 < 0)
+            tile_y1 = tile_y;
+
+          tile_y2 = tile_y;
+
+          tile_x += n;
+        }
+
+      tmp       = open;
+      open      = next_open;
+      next_open = tmp;
+
+      g_array_set_size (next_open, 0);
+    }
+
+  g_array_free (open,      TRUE);
+  g_array_free (next_open, TRUE);
+
+  /*  a stroke which touched tiles in a pattern that doesn't merge,
+   *  like a long diagonal, would push an undo for nearly every tile.
+   *  push the touched part of a few horizontal bands instead.
+   */
+  if (rects->len > MAX_DIRTY_UNDOS)
+    {
+      gint band_height;
+
+      band_height = (tile_y2 - tile_y1 + MAX_DIRTY_UNDOS) / MAX_DIRTY_UNDOS;
+
+      g_array_set_size (rects, 0);
+
+      for (tile_y = tile_y1; tile_y <= tile_y2; tile_y += band_height)
+        {
+          GeglRectangle rect = { G_MAXINT, -1, 0, 0 };
+          gint          x2   = -1;
+          gint          y;
+
+          for (y = tile_y; y < MIN (tile_y + band_height, tile_y2 + 1); y++)
+            {
+              const guint8 *row = core->dirty_tiles + y * core->n_tiles_x;
+
+              for (tile_x = 0; tile_x < core->n_tiles_x; tile_x++)
+                {
+                  if (! row[tile_x])
+                    continue;
+
+                  rect.x = MIN (rect.x, tile_x);
+                  x2     = MAX (x2,     tile_x + 1);
+
+                  if (rect.y < 0)
+                    rect.y = y;
+
+                  rect.height = y - rect.y + 1;
+                }
+            }
+
+          if (x2 > rect.x)
+            {
+              rect.width = x2 - rect.x;
+
+              g_array_append_val (rects, rect);
+            }
+        }
+    }
+
+  for (i = 0; i < rects->len; i++)
+    {
+      GeglRectangle *tiles = &g_array_index (rects, GeglRectangle, i);
+      GeglRectangle  rect;
+      GeglBuffer    *buffer;
+
+      rect.x      = tiles->x      * core->tile_width;
+      rect.y      = tiles->y      * core->tile_height;
+      rect.width  = tiles->width  * core->tile_width;
+      rect.height = tiles->height * core->tile_height;
+
+      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, rect.width, rect.height),
+                                gimp_drawable_get_format (drawable));
+
+      gimp_gegl_buffer_copy (core->undo_buffer,
+                             &rect,
+                             GEGL_ABYSS_NONE,
+                             buffer,
+                             GEGL_RECTANGLE (0, 0, 0, 0));
+
+      gimp_drawable_push_undo (drawable, NULL,
+                               buffer, rect.x, rect.y, rect.width, rect.height);
+
+      g_object_unref (buffer);
+    }
+
+  g_array_free (rects, TRUE);
+}
+
+static gboolean
+gimp_paint_core_batch_dab (GimpPaintCore     *core,
+                           GimpDrawable      *drawable,
+                           const GimpTempBuf *paint_buf,
+                           gdouble            image_opacity,
+                           GimpLayerMode      paint_mode)
+{
+  const Babl    *format = gimp_temp_buf_get_format (paint_buf);
+  const guchar  *pixel  = gimp_temp_buf_get_data (paint_buf);
+  gint           bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglRectangle  rect;
+  GeglRectangle  bounds;
+  gint64         area;
+
+  if (core->batch_invalid)
+    return FALSE;
+
+  /*  the pending dabs are composited over their bounding box, which can
+   *  include pixels painted by earlier dabs of the stroke; this is only
+   *  exact as long as all the dabs composite alike
+   */
+  if (! core->batch_format)
+    {
+      if (bpp > (gint) sizeof (core->batch_pixel))
+        {
+          core->batch_invalid = TRUE;
+
+          return FALSE;
+        }
+
+      core->batch_format  = format;
+      core->batch_opacity = image_opacity;
+      core->batch_mode    = paint_mode;
+
+      memcpy (core->batch_pixel, pixel, bpp);
+    }
+  else if (format        != core->batch_format  ||
+           image_opacity != core->batch_opacity ||
+           paint_mode    != core->batch_mode    ||
+           memcmp (pixel, core->batch_pixel, bpp))
+    {
+      gimp_paint_core_break_batch (core, drawable);
+
+      return FALSE;
+    }
+
+  if (! core->batch)
+    return FALSE;
+
+  rect.x      = core->paint_buffer_x;
+  rect.y      = core->paint_buffer_y;
+  rect.width  = gimp_temp_buf_get_width  (paint_buf);
+  rect.height = gimp_temp_buf_get_height (paint_buf);
+
+  area = (gint64) rect.width * rect.height;
+
+  if (! gegl_rectangle_is_empty (&core->batch_rect))
+    {
+      gegl_rectangle_bounding_box (&bounds, &core->batch_rect, &rect);
+
+      /*  don't composite more pixels than the dabs would separately,
+       *  as happens with sparse dabs along a diagonal
+       */
+      if ((gint64) bounds.width * bounds.height > core->batch_area + area)
+        {
+          gimp_paint_core_flush_batch (core, drawable);
+
+          bounds = rect;
+        }
+    }
+  else
+    {
+      bounds = rect;
+    }
+
+  core->batch_rect  = bounds;
+  core->batch_area += area;
+
+  return TRUE;
+}
+
+static void
+gimp_paint_core_break_batch (GimpPaintCore *core,
+                             GimpDrawable  *drawable)
+{
+  gimp_paint_core_flush_batch (core, drawable);
+
+  /*  the rest of the stroke can't be batched  */
+  core->batch_invalid = TRUE;
+  core->batch         = FALSE;
+}
+
+static void
+gimp_paint_core_flush_batch (GimpPaintCore *core,
+                             GimpDrawable  *drawable)
+{
+  GimpPaintCoreLoopsParams     params     = {};
+  GimpPaintCoreLoopsAlgorithm  algorithms = GIMP_PAINT_CORE_LOOPS_ALGORITHM_NONE;
+  GimpComponentMask            affect;
+  GeglRectangle                rect;
+  GimpTempBuf                 *paint_buf;
+  guchar                      *data;
+  gint                         bpp;
+  gint64                       i;
+
+  if (gegl_rectangle_is_empty (&core->batch_rect))
+    return;
+
+  rect = core->batch_rect;
+
+  core->batch_rect = *GEGL_RECTANGLE (0, 0, 0, 0);
+  core->batch_area = 0;
+
+  bpp = babl_format_get_bytes_per_pixel (core->batch_format);
+
+  paint_buf = gimp_temp_buf_new (rect.width, rect.height, core->batch_format);
+  data      = gimp_temp_buf_get_data (paint_buf);
+
+  for (i = 0; i < (gint64) rect.width * rect.height; i++)
+    memcpy (data + i * bpp, core->batch_pixel, bpp);
+
+  params.paint_buf          = paint_buf;
+  params.paint_buf_offset_x = rect.x;
+  params.paint_buf_offset_y = rect.y;
+
+  params.canvas_buffer = core->canvas_buffer;
+
+  /* undo buf -> paint_buf -> dest_buffer */
+  params.src_buffer  = core->undo_buffer;
+  params.dest_buffer = gimp_drawable_get_buffer (drawable);
+
+  params.mask_buffer   = core->mask_buffer;
+  params.mask_offset_x = core->mask_x_offset;
+  params.mask_offset_y = core->mask_y_offset;
+  params.image_opacity = core->batch_opacity;
+  params.paint_mode    = core->batch_mode;
+
+  algorithms |= GIMP_PAINT_CORE_LOOPS_ALGORITHM_CANVAS_BUFFER_TO_PAINT_BUF_ALPHA;
+  algorithms |= GIMP_PAINT_CORE_LOOPS_ALGORITHM_DO_LAYER_BLEND;
+
+  affect = gimp_drawable_get_active_mask (drawable);
+
+  if (affect != GIMP_COMPONENT_MASK_ALL)
+    {
+      params.affect = affect;
+
+      algorithms |= GIMP_PAINT_CORE_LOOPS_ALGORITHM_MASK_COMPONENTS;
+    }
+
+  gimp_paint_core_loops_process (&params, algorithms);
+
+  gimp_temp_buf_unref (paint_buf);
+
+  /*  Update the undo extents  */
+  gimp_paint_core_expand_undo_extents (core,
+                                       rect.x, rect.y, rect.width, rect.height);
+
+  /*  Update the drawable  */
+  gimp_drawable_update (drawable, rect.x, rect.y, rect.width, rect.height);
+}
@@ -53,6 +53,12 @@ struct _GimpPaintCore
   gint         x1, y1;            /*  undo extents in image coords        */
   gint         x2, y2;            /*  undo extents in image coords        */
 
+  guint8      *dirty_tiles;       /*  undo_buffer tiles touched so far    */
+  gint         tile_width;        /*  undo_buffer tile size               */
+  gint         tile_height;
+  gint         n_tiles_x;         /*  number of undo_buffer tiles         */
+  gint         n_tiles_y;
+
   gboolean     use_saved_proj;    /*  keep the unmodified proj around     */
 
   GeglBuffer  *undo_buffer;       /*  pixels which have been modified     */
@@ -69,6 +75,15 @@ struct _GimpPaintCore
   GimpApplicator *applicator;
 
   GArray      *stroke_buffer;
+
+  gboolean       batch;           /*  defer compositing of the dabs        */
+  GeglRectangle  batch_rect;      /*  bounds of the pending dabs           */
+  gint64         batch_area;      /*  summed area of the pending dabs      */
+  gboolean       batch_invalid;   /*  the stroke can't be batched          */
+  const Babl    *batch_format;    /*  the stroke's paint buffer format     */
+  guint8         batch_pixel[16]; /*  the stroke's paint color             */
+  gdouble        batch_opacity;   /*  the stroke's image opacity           */
+  GimpLayerMode  batch_mode;      /*  the stroke's paint mode              */
 };
 
 struct _GimpPaintCoreClass
@@ -176,6 +191,12 @@ GeglBuffer * gimp_paint_core_get_paint_buffer       (GimpPaintCore    *core,
                                                      gint             *paint_width,
                                                      gint             *paint_height);
 
+void         gimp_paint_core_expand_undo_extents    (GimpPaintCore    *core,
+                                                     gint              x,
+                                                     gint              y,
+                                                     gint              width,
+                                                     gint              height);
+
 GeglBuffer * gimp_paint_core_get_orig_image         (GimpPaintCore    *core);
 GeglBuffer * gimp_paint_core_get_orig_proj          (GimpPaintCore    *core);
 
@@ -198,6 +219,10 @@ void      gimp_paint_core_replace           (GimpPaintCore            *core,
                                              gdouble                   image_opacity,
                                              GimpPaintApplicationMode  mode);
 
+void      gimp_paint_core_begin_batch       (GimpPaintCore            *core);
+void      gimp_paint_core_end_batch         (GimpPaintCore            *core,
+                                             GimpDrawable             *drawable);
+
 void      gimp_paint_core_smooth_coords             (GimpPaintCore    *core,
                                                      GimpPaintOptions *paint_options,
                                                      GimpCoords       *coords);
@@ -46,6 +46,7 @@
 #include "gimpplugin-cleanup.h"
 #include "gimpplugin-message.h"
 #include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimpplugindef.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
@@ -63,6 +64,12 @@ static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
+static void gimp_plug_in_handle_region_request   (GimpPlugIn      *plug_in,
+                                                  GPRegionReq     *request);
+static void gimp_plug_in_handle_region_put       (GimpPlugIn      *plug_in,
+                                                  GPRegionReq     *request);
+static void gimp_plug_in_handle_region_get       (GimpPlugIn      *plug_in,
+                                                  GPRegionReq     *request);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
@@ -75,6 +82,7 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
                                                   GPProcUninstall *proc_uninstall);
 static void gimp_plug_in_handle_extension_ack    (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
+static void gimp_plug_in_handle_persist          (GimpPlugIn      *plug_in);
 
 
 /*  public functions  */
@@ -160,6 +168,23 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_REGION_REQ:
+      gimp_plug_in_handle_region_request (plug_in, msg->data);
+      break;
+
+    case GP_REGION_DATA:
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a REGION_DATA message.  This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      break;
+
+    case GP_PERSIST:
+      gimp_plug_in_handle_persist (plug_in);
+      break;
     }
 }
 
@@ -469,6 +494,331 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static void
+gimp_plug_in_handle_region_request (GimpPlugIn  *plug_in,
+                                    GPRegionReq *request)
+{
+  g_return_if_fail (request != NULL);
+
+  if (request->drawable_ID == -1)
+    gimp_plug_in_handle_region_put (plug_in, request);
+  else
+    gimp_plug_in_handle_region_get (plug_in, request);
+}
+
+static GeglBuffer *
+gimp_plug_in_get_region_buffer (GimpPlugIn    *plug_in,
+                                gint32         drawable_ID,
+                                gboolean       shadow,
+                                gboolean       write,
+                                GeglRectangle *rect)
+{
+  GimpDrawable        *drawable;
+  GeglBuffer          *buffer;
+  const GeglRectangle *extent;
+
+  drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
+                                                   drawable_ID);
+
+  if (! GIMP_IS_DRAWABLE (drawable))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried %s invalid drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    write ? "writing to" : "reading from",
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried %s drawable %d which was removed "
+                    "from the image (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    write ? "writing to" : "reading from",
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  if (shadow)
+    {
+      /*  see gimp_plug_in_handle_tile_put() for why we don't check
+       *  for locked or group drawables here
+       */
+      buffer = gimp_drawable_get_shadow_buffer (drawable);
+
+      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
+    }
+  else
+    {
+      if (write && gimp_item_is_content_locked (GIMP_ITEM (drawable)))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "tried writing to a locked drawable %d (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file),
+                        drawable_ID);
+          gimp_plug_in_close (plug_in, TRUE);
+          return NULL;
+        }
+      else if (write && gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "tried writing to a group layer %d (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file),
+                        drawable_ID);
+          gimp_plug_in_close (plug_in, TRUE);
+          return NULL;
+        }
+
+      buffer = gimp_drawable_get_buffer (drawable);
+    }
+
+  extent = gegl_buffer_get_extent (buffer);
+
+  if (rect->width  <= 0         ||
+      rect->height <= 0         ||
+      rect->x      <  extent->x ||
+      rect->y      <  extent->y ||
+      rect->width  >  extent->x + extent->width  - rect->x ||
+      rect->height >  extent->y + extent->height - rect->y)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "requested invalid region (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  return buffer;
+}
+
+static void
+gimp_plug_in_handle_region_put (GimpPlugIn  *plug_in,
+                                GPRegionReq *request)
+{
+  GPRegionData     region_data = { 0, };
+  GPRegionData    *region_info;
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle    rect;
+  gsize            shm_size;
+  gsize            size;
+
+  shm_size = (plug_in->manager->shm ?
+              gimp_plug_in_shm_get_size (plug_in->manager->shm) : 0);
+
+  /*  tell the plug-in it may use the shared memory window now  */
+  region_data.drawable_ID = -1;
+  region_data.use_shm     = (plug_in->manager->shm != NULL);
+
+  if (! gp_region_data_write (plug_in->my_write, &region_data, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (msg.type != GP_REGION_DATA)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected region data and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  region_info = msg.data;
+
+  rect.x      = region_info->x;
+  rect.y      = region_info->y;
+  rect.width  = MIN (region_info->width,  G_MAXINT);
+  rect.height = MIN (region_info->height, G_MAXINT);
+
+  buffer = gimp_plug_in_get_region_buffer (plug_in,
+                                           region_info->drawable_ID,
+                                           region_info->shadow,
+                                           TRUE, &rect);
+
+  if (! buffer)
+    {
+      gimp_wire_destroy (&msg);
+      return;
+    }
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  size = ((gsize) babl_format_get_bytes_per_pixel (format) *
+          rect.width * rect.height);
+
+  if (region_info->bpp != babl_format_get_bytes_per_pixel (format) ||
+      (region_info->use_shm && (! region_data.use_shm || size > shm_size)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent invalid region data (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_wire_destroy (&msg);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (region_info->use_shm)
+    {
+      gegl_buffer_set (buffer, &rect, 0, format,
+                       gimp_plug_in_shm_get_addr (plug_in->manager->shm),
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+  else
+    {
+      gegl_buffer_set (buffer, &rect, 0, format,
+                       region_info->data,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  gimp_wire_destroy (&msg);
+
+  if (! gp_tile_ack_write (plug_in->my_write, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+}
+
+static void
+gimp_plug_in_handle_region_get (GimpPlugIn  *plug_in,
+                                GPRegionReq *request)
+{
+  GPRegionData     region_data;
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle    rect;
+  gsize            size;
+
+  rect.x      = request->x;
+  rect.y      = request->y;
+  rect.width  = MIN (request->width,  G_MAXINT);
+  rect.height = MIN (request->height, G_MAXINT);
+
+  buffer = gimp_plug_in_get_region_buffer (plug_in,
+                                           request->drawable_ID,
+                                           request->shadow,
+                                           FALSE, &rect);
+
+  if (! buffer)
+    return;
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  size = ((gsize) babl_format_get_bytes_per_pixel (format) *
+          rect.width * rect.height);
+
+  region_data.drawable_ID = request->drawable_ID;
+  region_data.shadow      = request->shadow;
+  region_data.x           = rect.x;
+  region_data.y           = rect.y;
+  region_data.width       = rect.width;
+  region_data.height      = rect.height;
+  region_data.bpp         = babl_format_get_bytes_per_pixel (format);
+  region_data.data        = NULL;
+
+  /*  regions which don't fit into the shared memory window are sent
+   *  over the pipe
+   */
+  region_data.use_shm = (plug_in->manager->shm != NULL &&
+                         size <= gimp_plug_in_shm_get_size (plug_in->manager->shm));
+
+  if (region_data.use_shm)
+    {
+      gegl_buffer_get (buffer, &rect, 1.0, format,
+                       gimp_plug_in_shm_get_addr (plug_in->manager->shm),
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+  else
+    {
+      region_data.data = g_try_malloc (size);
+
+      if (! region_data.data)
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "requested a region too large to transfer (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file));
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      gegl_buffer_get (buffer, &rect, 1.0, format,
+                       region_data.data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  if (! gp_region_data_write (plug_in->my_write, &region_data, plug_in))
+    {
+      g_free (region_data.data);
+
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  g_free (region_data.data);
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (msg.type != GP_TILE_ACK)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected tile ack and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  gimp_wire_destroy (&msg);
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
@@ -666,7 +1016,17 @@ gimp_plug_in_handle_proc_return (GimpPlugIn   *plug_in,
                                                    proc_frame->return_vals);
     }
 
-  gimp_plug_in_close (plug_in, FALSE);
+  /*  a synchronous caller collects the return values first, and then
+   *  keeps a persistent plug-in itself
+   */
+  if (! plug_in->persistent)
+    {
+      gimp_plug_in_close (plug_in, FALSE);
+    }
+  else if (! proc_frame->main_loop)
+    {
+      gimp_plug_in_manager_add_persistent (plug_in->manager, plug_in);
+    }
 }
 
 static void
@@ -979,3 +1339,23 @@ gimp_plug_in_handle_has_init (GimpPlugIn *plug_in)
       gimp_plug_in_close (plug_in, TRUE);
     }
 }
+
+static void
+gimp_plug_in_handle_persist (GimpPlugIn *plug_in)
+{
+  if (plug_in->call_mode == GIMP_PLUG_IN_CALL_RUN &&
+      ! plug_in->temp_proc_frames)
+    {
+      plug_in->persistent = TRUE;
+    }
+  else
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a PERSIST message while not in run().  "
+                    "This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+}
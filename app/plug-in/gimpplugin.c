@@ -90,6 +90,7 @@
 #include "gimppluginmanager.h"
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimptemporaryprocedure.h"
 #include "plug-in-params.h"
 
@@ -151,6 +152,7 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->his_write          = NULL;
 
   plug_in->input_id           = 0;
+  plug_in->idle_id            = 0;
   plug_in->write_buffer_index = 0;
 
   plug_in->temp_procedures    = NULL;
@@ -627,6 +629,9 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
 
   plug_in->open = FALSE;
 
+  /* Drop it from the idle plug-ins, in case it was kept running. */
+  gimp_plug_in_manager_remove_persistent (plug_in->manager, plug_in);
+
   if (plug_in->pid)
     {
 #ifndef G_OS_WIN32
@@ -48,6 +48,7 @@ struct _GimpPlugIn
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
   guint                precision : 1;   /*  True drawable precision enabled   */
+  guint                persistent : 1;  /*  Asked to be kept running          */
   GPid                 pid;             /*  Plug-in's process id              */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
@@ -56,6 +57,7 @@ struct _GimpPlugIn
   GIOChannel          *his_write;
 
   guint                input_id;        /*  Id of input proc                  */
+  guint                idle_id;         /*  Id of the idle timeout            */
 
   gchar                write_buffer[WRITE_BUFFER_SIZE]; /* Buffer for writing */
   gint                 write_buffer_index;              /* Buffer index       */
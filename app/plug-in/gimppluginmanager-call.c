@@ -46,6 +46,7 @@
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
 #include "gimppluginmanager-call.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 #include "plug-in-params.h"
@@ -61,86 +62,186 @@ gimp_allow_set_foreground_window (GimpPlugIn *plug_in)
 #endif
 }
 
-/*  public functions  */
-
-void
-gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
-                                 GimpContext       *context,
-                                 GimpPlugInDef     *plug_in_def)
+static gboolean
+gimp_plug_in_manager_call_recv_message (GIOChannel   *channel,
+                                        GIOCondition  cond,
+                                        GimpPlugIn   *plug_in)
 {
-  GimpPlugIn *plug_in;
+#ifdef G_OS_WIN32
+  /* Workaround for GLib bug #137968, see gimp_plug_in_recv_message()
+   */
+  if (cond == 0)
+    return G_SOURCE_CONTINUE;
+#endif
 
-  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
-  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
+  /*  read until reading fails, like the synchronous loop used to,
+   *  so that G_IO_HUP doesn't drop messages still in the pipe
+   */
+  if (cond & (G_IO_IN | G_IO_PRI))
+    {
+      GimpWireMessage msg;
+
+      if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+        {
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+      else
+        {
+          gimp_plug_in_handle_message (plug_in, &msg);
+          gimp_wire_destroy (&msg);
+        }
+    }
+  else if (plug_in->open)
+    {
+      gimp_plug_in_close (plug_in, TRUE);
+    }
 
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->file);
+  return plug_in->open ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
 
-  if (plug_in)
+/*  Runs the query() or init() functions of @plug_in_defs, with up to
+ *  "num-processors" plug-ins running at the same time.  Their messages
+ *  are still handled one at a time from this thread, and every plug-in
+ *  only registers procedures with its own GimpPlugInDef, so the result
+ *  doesn't depend on the order in which the plug-ins finish.
+ */
+static void
+gimp_plug_in_manager_call_defs (GimpPlugInManager  *manager,
+                                GimpContext        *context,
+                                GSList             *plug_in_defs,
+                                GimpPlugInCallMode  call_mode,
+                                GimpInitStatusFunc  status_callback)
+{
+  GimpGeglConfig *gegl_config = GIMP_GEGL_CONFIG (manager->gimp->config);
+  GMainContext   *main_context;
+  GSList         *list;
+  GList          *running     = NULL;
+  gint            n_running   = 0;
+  gint            max_running;
+  gint            n_defs;
+  gint            n_done      = 0;
+
+  n_defs      = g_slist_length (plug_in_defs);
+  max_running = MAX (gegl_config->num_processors, 1);
+
+  /*  a private main context, so nothing else gets dispatched
+   *  while the plug-ins are running
+   */
+  main_context = g_main_context_new ();
+
+  list = plug_in_defs;
+
+  while (list || running)
     {
-      plug_in->plug_in_def = plug_in_def;
+      GList *iter;
 
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_QUERY, TRUE))
+      while (list && n_running < max_running)
         {
-          while (plug_in->open)
+          GimpPlugInDef *plug_in_def = list->data;
+          GimpPlugIn    *plug_in;
+          gchar         *basename;
+
+          list = g_slist_next (list);
+
+          basename =
+            g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
+          status_callback (NULL, basename,
+                           (gdouble) n_done / (gdouble) n_defs);
+          g_free (basename);
+
+          if (manager->gimp->be_verbose)
+            g_print (call_mode == GIMP_PLUG_IN_CALL_QUERY ?
+                     "Querying plug-in: '%s'\n" :
+                     "Initializing plug-in: '%s'\n",
+                     gimp_file_get_utf8_name (plug_in_def->file));
+
+          plug_in = gimp_plug_in_new (manager, context, NULL,
+                                      NULL, plug_in_def->file);
+
+          if (plug_in)
             {
-              GimpWireMessage msg;
+              plug_in->plug_in_def = plug_in_def;
 
-              if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+              if (gimp_plug_in_open (plug_in, call_mode, TRUE))
                 {
-                  gimp_plug_in_close (plug_in, TRUE);
-                }
-              else
-                {
-                  gimp_plug_in_handle_message (plug_in, &msg);
-                  gimp_wire_destroy (&msg);
+                  GSource *source;
+
+                  source = g_io_create_watch (plug_in->my_read,
+                                              G_IO_IN  | G_IO_PRI |
+                                              G_IO_ERR | G_IO_HUP);
+
+                  g_source_set_callback (source,
+                                         (GSourceFunc) gimp_plug_in_manager_call_recv_message,
+                                         plug_in, NULL);
+
+                  g_source_attach (source, main_context);
+                  g_source_unref (source);
+
+                  running = g_list_prepend (running, plug_in);
+                  n_running++;
+
+                  continue;
                 }
+
+              g_object_unref (plug_in);
             }
+
+          n_done++;
         }
 
-      g_object_unref (plug_in);
+      if (running)
+        g_main_context_iteration (main_context, TRUE);
+
+      for (iter = running; iter; )
+        {
+          GimpPlugIn *plug_in = iter->data;
+          GList      *next    = g_list_next (iter);
+
+          if (! plug_in->open)
+            {
+              running = g_list_delete_link (running, iter);
+              n_running--;
+              n_done++;
+
+              g_object_unref (plug_in);
+            }
+
+          iter = next;
+        }
     }
+
+  g_main_context_unref (main_context);
 }
 
+
+/*  public functions  */
+
 void
-gimp_plug_in_manager_call_init (GimpPlugInManager *manager,
-                                GimpContext       *context,
-                                GimpPlugInDef     *plug_in_def)
+gimp_plug_in_manager_call_query (GimpPlugInManager  *manager,
+                                 GimpContext        *context,
+                                 GSList             *plug_in_defs,
+                                 GimpInitStatusFunc  status_callback)
 {
-  GimpPlugIn *plug_in;
-
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
-
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->file);
-
-  if (plug_in)
-    {
-      plug_in->plug_in_def = plug_in_def;
+  g_return_if_fail (status_callback != NULL);
 
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_INIT, TRUE))
-        {
-          while (plug_in->open)
-            {
-              GimpWireMessage msg;
+  gimp_plug_in_manager_call_defs (manager, context, plug_in_defs,
+                                  GIMP_PLUG_IN_CALL_QUERY, status_callback);
+}
 
-              if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
-                {
-                  gimp_plug_in_close (plug_in, TRUE);
-                }
-              else
-                {
-                  gimp_plug_in_handle_message (plug_in, &msg);
-                  gimp_wire_destroy (&msg);
-                }
-            }
-        }
+void
+gimp_plug_in_manager_call_init (GimpPlugInManager  *manager,
+                                GimpContext        *context,
+                                GSList             *plug_in_defs,
+                                GimpInitStatusFunc  status_callback)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
+  g_return_if_fail (status_callback != NULL);
 
-      g_object_unref (plug_in);
-    }
+  gimp_plug_in_manager_call_defs (manager, context, plug_in_defs,
+                                  GIMP_PLUG_IN_CALL_INIT, status_callback);
 }
 
 GimpValueArray *
@@ -162,7 +263,11 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
   g_return_val_if_fail (args != NULL, NULL);
   g_return_val_if_fail (display == NULL || GIMP_IS_OBJECT (display), NULL);
 
-  plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
+  plug_in = gimp_plug_in_manager_take_persistent (manager, context, progress,
+                                                  procedure);
+
+  if (! plug_in)
+    plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
 
   if (plug_in)
     {
@@ -177,7 +282,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       gint               monitor;
       GFile             *icon_theme_dir;
 
-      if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
+      /*  a reused plug-in is still open and waiting in gimp_loop()  */
+      if (! plug_in->open &&
+          ! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
           const gchar *name  = gimp_object_get_name (plug_in);
           GError      *error = g_error_new (GIMP_PLUG_IN_ERROR,
@@ -203,6 +310,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       config.tile_height      = GIMP_PLUG_IN_TILE_HEIGHT;
       config.shm_ID           = (manager->shm ?
                                  gimp_plug_in_shm_get_ID (manager->shm) : -1);
+      config.shm_size         = (manager->shm ?
+                                 gimp_plug_in_shm_get_size (manager->shm) : 0);
       config.check_size       = display_config->transparency_size;
       config.check_type       = display_config->transparency_type;
       config.show_help_button = (gui_config->use_help &&
@@ -229,6 +338,7 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       config.tile_cache_size  = gegl_config->tile_cache_size;
       config.swap_path        = gegl_config->swap_path;
       config.num_processors   = gegl_config->num_processors;
+      config.allow_persistent = core_config->plug_in_pool_size > 0;
 
       proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
       proc_run.nparams = gimp_value_array_length (args);
@@ -295,6 +405,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
           g_clear_pointer (&proc_frame->main_loop, g_main_loop_unref);
 
           return_vals = gimp_plug_in_proc_frame_get_return_values (proc_frame);
+
+          if (plug_in->persistent && plug_in->open)
+            gimp_plug_in_manager_add_persistent (manager, plug_in);
         }
 
       g_object_unref (plug_in);
@@ -0,0 +1,210 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-persistent.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+
+#include "plug-in-types.h"
+
+#include "config/gimpcoreconfig.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugin.h"
+#include "gimpplugin-message.h"
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
+#include "gimppluginprocedure.h"
+
+
+static gboolean   gimp_plug_in_manager_persistent_timeout (GimpPlugIn *plug_in);
+static void       gimp_plug_in_manager_persistent_quit    (GimpPlugIn *plug_in);
+
+
+/*  public functions  */
+
+GimpPlugIn *
+gimp_plug_in_manager_take_persistent (GimpPlugInManager   *manager,
+                                      GimpContext         *context,
+                                      GimpProgress        *progress,
+                                      GimpPlugInProcedure *procedure)
+{
+  GFile *file;
+  GList *list;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure), NULL);
+
+  file = gimp_plug_in_procedure_get_file (procedure);
+
+  for (list = manager->persistent_plug_ins; list; list = g_list_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      if (g_file_equal (plug_in->file, file))
+        {
+          manager->persistent_plug_ins =
+            g_list_delete_link (manager->persistent_plug_ins, list);
+
+          if (plug_in->idle_id)
+            {
+              g_source_remove (plug_in->idle_id);
+              plug_in->idle_id = 0;
+            }
+
+          gimp_plug_in_proc_frame_init (&plug_in->main_proc_frame,
+                                        context, progress, procedure);
+
+          if (manager->gimp->be_verbose)
+            g_print ("Reusing plug-in: '%s'\n",
+                     gimp_file_get_utf8_name (plug_in->file));
+
+          /*  the pool's reference goes to the caller  */
+          return plug_in;
+        }
+    }
+
+  return NULL;
+}
+
+void
+gimp_plug_in_manager_add_persistent (GimpPlugInManager *manager,
+                                     GimpPlugIn        *plug_in)
+{
+  GimpCoreConfig *config;
+  GimpProcedure  *procedure;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  config    = manager->gimp->config;
+  procedure = plug_in->main_proc_frame.procedure;
+
+  /*  a plug-in which left temporary procedures behind, or which was
+   *  not run as an ordinary plug-in procedure, can't be reused
+   */
+  if (config->plug_in_pool_size < 1 ||
+      ! plug_in->open               ||
+      plug_in->temp_procedures      ||
+      ! procedure                   ||
+      procedure->proc_type != GIMP_PLUGIN)
+    {
+      if (plug_in->open)
+        gimp_plug_in_manager_persistent_quit (plug_in);
+
+      return;
+    }
+
+  gimp_plug_in_proc_frame_dispose (&plug_in->main_proc_frame, plug_in);
+
+  plug_in->persistent = FALSE;
+  plug_in->precision  = FALSE;
+
+  manager->persistent_plug_ins =
+    g_list_prepend (manager->persistent_plug_ins, g_object_ref (plug_in));
+
+  plug_in->idle_id =
+    g_timeout_add_seconds (config->plug_in_idle_timeout,
+                           (GSourceFunc) gimp_plug_in_manager_persistent_timeout,
+                           plug_in);
+
+  if (manager->gimp->be_verbose)
+    g_print ("Keeping plug-in: '%s'\n",
+             gimp_file_get_utf8_name (plug_in->file));
+
+  /*  the least recently used plug-ins go first  */
+  while ((gint) g_list_length (manager->persistent_plug_ins) >
+         config->plug_in_pool_size)
+    {
+      GList *last = g_list_last (manager->persistent_plug_ins);
+
+      gimp_plug_in_manager_persistent_quit (last->data);
+    }
+}
+
+void
+gimp_plug_in_manager_remove_persistent (GimpPlugInManager *manager,
+                                        GimpPlugIn        *plug_in)
+{
+  GList *list;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  list = g_list_find (manager->persistent_plug_ins, plug_in);
+
+  if (list)
+    {
+      manager->persistent_plug_ins =
+        g_list_delete_link (manager->persistent_plug_ins, list);
+
+      if (plug_in->idle_id)
+        {
+          g_source_remove (plug_in->idle_id);
+          plug_in->idle_id = 0;
+        }
+
+      g_object_unref (plug_in);
+    }
+}
+
+void
+gimp_plug_in_manager_clear_persistent (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  while (manager->persistent_plug_ins)
+    gimp_plug_in_manager_persistent_quit (manager->persistent_plug_ins->data);
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_manager_persistent_timeout (GimpPlugIn *plug_in)
+{
+  plug_in->idle_id = 0;
+
+  if (plug_in->manager->gimp->be_verbose)
+    g_print ("Idle plug-in timed out: '%s'\n",
+             gimp_file_get_utf8_name (plug_in->file));
+
+  gimp_plug_in_manager_persistent_quit (plug_in);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_plug_in_manager_persistent_quit (GimpPlugIn *plug_in)
+{
+  /*  closing drops the pool's and the open list's references  */
+  g_object_ref (plug_in);
+
+  /*  an idle plug-in sits in gimp_loop(), let it quit on its own  */
+  gp_quit_write (plug_in->my_write, plug_in);
+
+  gimp_plug_in_close (plug_in, FALSE);
+
+  g_object_unref (plug_in);
+}
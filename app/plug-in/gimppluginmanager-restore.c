@@ -47,6 +47,7 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
 
 #include "gimp-intl.h"
 
@@ -56,8 +57,9 @@ static void    gimp_plug_in_manager_search            (GimpPlugInManager    *man
 static void    gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
                                                        GFile                *directory);
 static GFile * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
+static gboolean gimp_plug_in_manager_read_pluginrc    (GimpPlugInManager    *manager,
                                                        GFile                *file,
+                                                       GFile                *cache,
                                                        GimpInitStatusFunc    status_callback);
 static void    gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
                                                        GimpContext          *context,
@@ -89,10 +91,12 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                               GimpContext        *context,
                               GimpInitStatusFunc  status_callback)
 {
-  Gimp   *gimp;
-  GFile  *pluginrc;
-  GSList *list;
-  GError *error = NULL;
+  Gimp     *gimp;
+  GFile    *pluginrc;
+  GFile    *cache;
+  gboolean  cache_valid;
+  GSList   *list;
+  GError   *error = NULL;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -108,8 +112,10 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 
   /* read the pluginrc file for cached data */
   pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  cache    = plug_in_rc_cache_get_file (pluginrc);
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  cache_valid = gimp_plug_in_manager_read_pluginrc (manager, pluginrc, cache,
+                                                    status_callback);
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -140,11 +146,34 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
           gimp_message_literal (gimp,
                                 NULL, GIMP_MESSAGE_ERROR, error->message);
           g_clear_error (&error);
+
+          /*  don't tie the cache to a pluginrc we failed to write  */
+          g_clear_object (&cache);
         }
 
+      cache_valid = FALSE;
+
       manager->write_pluginrc = FALSE;
     }
 
+  /*  write the binary cache if pluginrc changed since it was written  */
+  if (cache && ! cache_valid)
+    {
+      if (gimp->be_verbose)
+        g_print ("Writing '%s'\n", gimp_file_get_utf8_name (cache));
+
+      /*  the cache is only an optimization, don't bother the user  */
+      if (! plug_in_rc_cache_write (manager->plug_in_defs, cache, pluginrc,
+                                    &error))
+        {
+          if (gimp->be_verbose)
+            g_printerr ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+
+  g_clear_object (&cache);
   g_object_unref (pluginrc);
 
   /* create locale and help domain lists */
@@ -383,22 +412,47 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
-/* read the pluginrc file for cached data */
-static void
+/* read the pluginrc file for cached data, returns TRUE if it was read
+ * from an up-to-date binary cache
+ */
+static gboolean
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
                                     GFile              *pluginrc,
+                                    GFile              *cache,
                                     GimpInitStatusFunc  status_callback)
 {
-  GSList *rc_defs;
-  GError *error = NULL;
+  GSList   *rc_defs    = NULL;
+  gboolean  from_cache = FALSE;
+  GError   *error      = NULL;
 
   status_callback (_("Resource configuration"),
                    gimp_file_get_utf8_name (pluginrc), 0.0);
 
-  if (manager->gimp->be_verbose)
-    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+  if (cache)
+    rc_defs = plug_in_rc_cache_parse (manager->gimp, cache, pluginrc, &error);
+
+  if (rc_defs)
+    {
+      if (manager->gimp->be_verbose)
+        g_print ("Using '%s'\n", gimp_file_get_utf8_name (cache));
+
+      from_cache = TRUE;
+    }
+  else
+    {
+      if (error)
+        {
+          if (manager->gimp->be_verbose)
+            g_printerr ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+      rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+    }
 
   if (rc_defs)
     {
@@ -417,6 +471,8 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
 
       g_clear_error (&error);
     }
+
+  return from_cache;
 }
 
 /* query any plug-ins that changed since we last wrote out pluginrc */
@@ -426,45 +482,28 @@ gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
                                 GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GSList *query_defs = NULL;
 
   status_callback (_("Querying new Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->needs_query)
-        n_plugins++;
+        query_defs = g_slist_prepend (query_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (query_defs)
     {
-      gint nth;
-
       manager->write_pluginrc = TRUE;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
-
-          if (plug_in_def->needs_query)
-            {
-              gchar *basename;
-
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      query_defs = g_slist_reverse (query_defs);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
+      gimp_plug_in_manager_call_query (manager, context, query_defs,
+                                       status_callback);
 
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (query_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -477,43 +516,26 @@ gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
                                     GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GSList *init_defs = NULL;
 
   status_callback (_("Initializing Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->has_init)
-        n_plugins++;
+        init_defs = g_slist_prepend (init_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (init_defs)
     {
-      gint nth;
-
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
-
-          if (plug_in_def->has_init)
-            {
-              gchar *basename;
+      init_defs = g_slist_reverse (init_defs);
 
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      gimp_plug_in_manager_call_init (manager, context, init_defs,
+                                      status_callback);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Initializing plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
-
-              gimp_plug_in_manager_call_init (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (init_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -48,6 +48,7 @@
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-menu-branch.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -200,6 +201,7 @@ gimp_plug_in_manager_get_memsize (GimpObject *object,
                                                gimp_object_get_memsize,
                                                gui_size);
   memsize += gimp_g_slist_get_memsize (manager->plug_in_stack, 0);
+  memsize += gimp_g_list_get_memsize (manager->persistent_plug_ins, 0);
 
   memsize += 0; /* FIXME manager->shm */
   memsize += /* FIXME */ gimp_g_object_get_memsize (G_OBJECT (manager->interpreter_db));
@@ -264,6 +266,9 @@ gimp_plug_in_manager_exit (GimpPlugInManager *manager)
 {
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
 
+  /*  idle plug-ins can quit cleanly, don't kill them  */
+  gimp_plug_in_manager_clear_persistent (manager);
+
   while (manager->open_plug_ins)
     gimp_plug_in_close (manager->open_plug_ins->data, TRUE);
 
@@ -73,6 +73,11 @@
 
 #define TILE_MAP_SIZE (GIMP_PLUG_IN_TILE_WIDTH * GIMP_PLUG_IN_TILE_HEIGHT * 32)
 
+/* the segment is a window large enough for region transfers of many
+ * tiles at once, not just for a single tile
+ */
+#define SHM_SIZE      (TILE_MAP_SIZE * 32)
+
 #define ERRMSG_SHM_DISABLE "Disabling shared memory tile transport"
 
 
@@ -103,7 +108,7 @@ gimp_plug_in_shm_new (void)
 
   /* Use SysV shared memory mechanisms for transferring tile data. */
   {
-    shm->shm_ID = shmget (IPC_PRIVATE, TILE_MAP_SIZE, IPC_CREAT | 0600);
+    shm->shm_ID = shmget (IPC_PRIVATE, SHM_SIZE, IPC_CREAT | 0600);
 
     if (shm->shm_ID != -1)
       {
@@ -145,7 +150,7 @@ gimp_plug_in_shm_new (void)
     /* Create the file mapping into paging space */
     shm->shm_handle = CreateFileMapping (INVALID_HANDLE_VALUE, NULL,
                                          PAGE_READWRITE, 0,
-                                         TILE_MAP_SIZE,
+                                         SHM_SIZE,
                                          fileMapName);
 
     if (shm->shm_handle)
@@ -153,7 +158,7 @@ gimp_plug_in_shm_new (void)
         /* Map the shared memory into our address space for use */
         shm->shm_addr = (guchar *) MapViewOfFile (shm->shm_handle,
                                                   FILE_MAP_ALL_ACCESS,
-                                                  0, 0, TILE_MAP_SIZE);
+                                                  0, 0, SHM_SIZE);
 
         /* Verify that we mapped our view */
         if (shm->shm_addr)
@@ -192,10 +197,10 @@ gimp_plug_in_shm_new (void)
 
     if (shm_fd != -1)
       {
-        if (ftruncate (shm_fd, TILE_MAP_SIZE) != -1)
+        if (ftruncate (shm_fd, SHM_SIZE) != -1)
           {
             /* Map the shared memory into our address space for use */
-            shm->shm_addr = (guchar *) mmap (NULL, TILE_MAP_SIZE,
+            shm->shm_addr = (guchar *) mmap (NULL, SHM_SIZE,
                                              PROT_READ | PROT_WRITE, MAP_SHARED,
                                              shm_fd, 0);
 
@@ -269,7 +274,7 @@ gimp_plug_in_shm_free (GimpPlugInShm *shm)
 
       gchar shm_handle[32];
 
-      munmap (shm->shm_addr, TILE_MAP_SIZE);
+      munmap (shm->shm_addr, SHM_SIZE);
 
       g_snprintf (shm_handle, sizeof (shm_handle), "/gimp-shm-%d",
                   shm->shm_ID);
@@ -299,3 +304,11 @@ gimp_plug_in_shm_get_addr (GimpPlugInShm *shm)
 
   return shm->shm_addr;
 }
+
+gsize
+gimp_plug_in_shm_get_size (GimpPlugInShm *shm)
+{
+  g_return_val_if_fail (shm != NULL, 0);
+
+  return SHM_SIZE;
+}
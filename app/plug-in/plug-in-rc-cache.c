@@ -0,0 +1,890 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-cache.h"
+
+#include "gimp-intl.h"
+
+
+/*  The plug-in cache is a binary copy of pluginrc, written right after
+ *  it and mapped into memory on startup, so the procedure definitions
+ *  can be decoded without going through the scanner.  It is only used
+ *  if the modification time and size of pluginrc still match the ones
+ *  recorded in its header, so that editing or replacing pluginrc (or
+ *  deleting it to force a re-query) always takes precedence.
+ *
+ *  All values are stored in host byte order, the cache is never meant
+ *  to be copied between machines.  Bump PLUG_IN_RC_CACHE_VERSION
+ *  whenever the layout changes.
+ */
+
+#define PLUG_IN_RC_CACHE_MAGIC   "GIMPPRC"
+#define PLUG_IN_RC_CACHE_VERSION 1
+
+
+enum
+{
+  PROC_FILE_PROC   = 1 << 0,
+  PROC_HANDLES_URI = 1 << 1,
+  PROC_HANDLES_RAW = 1 << 2
+};
+
+
+typedef struct
+{
+  const guchar *data;
+  gsize         size;
+  gsize         offset;
+  gboolean      error;
+} PlugInRcCacheReader;
+
+
+static gboolean              plug_in_rc_cache_stat         (GFile               *pluginrc,
+                                                            guint64             *mtime,
+                                                            guint32             *mtime_usec,
+                                                            guint64             *size,
+                                                            GError             **error);
+
+static const guchar        * plug_in_rc_cache_read         (PlugInRcCacheReader *reader,
+                                                            gsize                length);
+static gint32                plug_in_rc_cache_read_int     (PlugInRcCacheReader *reader);
+static gint64                plug_in_rc_cache_read_int64   (PlugInRcCacheReader *reader);
+static gchar               * plug_in_rc_cache_read_string  (PlugInRcCacheReader *reader);
+static guint8              * plug_in_rc_cache_read_data    (PlugInRcCacheReader *reader,
+                                                            gint                 length);
+static GimpPlugInDef       * plug_in_rc_cache_read_def     (PlugInRcCacheReader *reader,
+                                                            Gimp                *gimp);
+static GimpPlugInProcedure * plug_in_rc_cache_read_proc    (PlugInRcCacheReader *reader,
+                                                            Gimp                *gimp,
+                                                            GFile               *file);
+static gboolean              plug_in_rc_cache_read_arg     (PlugInRcCacheReader *reader,
+                                                            Gimp                *gimp,
+                                                            GimpProcedure       *procedure,
+                                                            gboolean             return_value);
+
+static void                  plug_in_rc_cache_write_int    (GByteArray          *array,
+                                                            gint32               value);
+static void                  plug_in_rc_cache_write_int64  (GByteArray          *array,
+                                                            gint64               value);
+static void                  plug_in_rc_cache_write_string (GByteArray          *array,
+                                                            const gchar         *str);
+static void                  plug_in_rc_cache_write_data   (GByteArray          *array,
+                                                            const guint8        *data,
+                                                            gint                 length);
+static void                  plug_in_rc_cache_patch_int    (GByteArray          *array,
+                                                            guint                offset,
+                                                            gint32               value);
+static gboolean              plug_in_rc_cache_write_def    (GByteArray          *array,
+                                                            GimpPlugInDef       *plug_in_def);
+static void                  plug_in_rc_cache_write_proc   (GByteArray          *array,
+                                                            GimpPlugInProcedure *proc);
+
+
+/*  public functions  */
+
+GFile *
+plug_in_rc_cache_get_file (GFile *pluginrc)
+{
+  GFile *parent;
+  GFile *file;
+  gchar *basename;
+  gchar *name;
+
+  g_return_val_if_fail (G_IS_FILE (pluginrc), NULL);
+
+  parent = g_file_get_parent (pluginrc);
+
+  if (! parent)
+    return NULL;
+
+  basename = g_file_get_basename (pluginrc);
+  name     = g_strconcat (basename, ".cache", NULL);
+
+  file = g_file_get_child (parent, name);
+
+  g_free (name);
+  g_free (basename);
+  g_object_unref (parent);
+
+  return file;
+}
+
+/*  Returns NULL without setting @error if there is no usable cache for
+ *  @pluginrc, in which case the caller should parse pluginrc itself.
+ */
+GSList *
+plug_in_rc_cache_parse (Gimp    *gimp,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  PlugInRcCacheReader  reader       = { NULL, };
+  GMappedFile         *mapped;
+  GSList              *plug_in_defs = NULL;
+  const guchar        *magic;
+  gchar               *path;
+  guint64              mtime;
+  guint32              mtime_usec;
+  guint64              size;
+  gint                 cache_version    = 0;
+  gint                 protocol_version = 0;
+  guint64              cache_mtime      = 0;
+  guint32              cache_mtime_usec = 0;
+  guint64              cache_size       = 0;
+  gint                 n_plug_in_defs;
+  gint                 i;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! plug_in_rc_cache_stat (pluginrc, &mtime, &mtime_usec, &size, NULL))
+    return NULL;
+
+  path = g_file_get_path (file);
+
+  if (! path)
+    return NULL;
+
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+
+  if (! mapped)
+    return NULL;
+
+  reader.data = (const guchar *) g_mapped_file_get_contents (mapped);
+  reader.size = g_mapped_file_get_length (mapped);
+
+  magic = plug_in_rc_cache_read (&reader, sizeof (PLUG_IN_RC_CACHE_MAGIC));
+
+  if (magic &&
+      ! memcmp (magic, PLUG_IN_RC_CACHE_MAGIC, sizeof (PLUG_IN_RC_CACHE_MAGIC)))
+    {
+      cache_version    = plug_in_rc_cache_read_int   (&reader);
+      protocol_version = plug_in_rc_cache_read_int   (&reader);
+      cache_mtime      = plug_in_rc_cache_read_int64 (&reader);
+      cache_mtime_usec = plug_in_rc_cache_read_int   (&reader);
+      cache_size       = plug_in_rc_cache_read_int64 (&reader);
+    }
+  else
+    {
+      reader.error = TRUE;
+    }
+
+  if (reader.error                                 ||
+      cache_version    != PLUG_IN_RC_CACHE_VERSION ||
+      protocol_version != GIMP_PROTOCOL_VERSION    ||
+      cache_mtime      != mtime                    ||
+      cache_mtime_usec != mtime_usec               ||
+      cache_size       != size)
+    {
+      /*  stale or foreign cache, silently ignore it  */
+      g_mapped_file_unref (mapped);
+
+      return NULL;
+    }
+
+  n_plug_in_defs = plug_in_rc_cache_read_int (&reader);
+
+  for (i = 0; i < n_plug_in_defs && ! reader.error; i++)
+    {
+      GimpPlugInDef *plug_in_def = plug_in_rc_cache_read_def (&reader, gimp);
+
+      if (plug_in_def)
+        plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  g_mapped_file_unref (mapped);
+
+  if (reader.error)
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   _("Skipping '%s': corrupt plug-in cache."),
+                   gimp_file_get_utf8_name (file));
+
+      g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+
+      return NULL;
+    }
+
+  return g_slist_reverse (plug_in_defs);
+}
+
+/*  Must be called right after @pluginrc has been written, the cache
+ *  is tied to its current modification time and size.
+ */
+gboolean
+plug_in_rc_cache_write (GSList  *plug_in_defs,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  GByteArray *array;
+  GSList     *list;
+  guint64     mtime;
+  guint32     mtime_usec;
+  guint64     size;
+  guint       offset;
+  gint        n_plug_in_defs = 0;
+  gboolean    success;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! plug_in_rc_cache_stat (pluginrc, &mtime, &mtime_usec, &size, error))
+    return FALSE;
+
+  array = g_byte_array_new ();
+
+  g_byte_array_append (array,
+                       (const guint8 *) PLUG_IN_RC_CACHE_MAGIC,
+                       sizeof (PLUG_IN_RC_CACHE_MAGIC));
+  plug_in_rc_cache_write_int   (array, PLUG_IN_RC_CACHE_VERSION);
+  plug_in_rc_cache_write_int   (array, GIMP_PROTOCOL_VERSION);
+  plug_in_rc_cache_write_int64 (array, mtime);
+  plug_in_rc_cache_write_int   (array, mtime_usec);
+  plug_in_rc_cache_write_int64 (array, size);
+
+  offset = array->len;
+  plug_in_rc_cache_write_int (array, 0);
+
+  for (list = plug_in_defs; list; list = list->next)
+    {
+      if (plug_in_rc_cache_write_def (array, list->data))
+        n_plug_in_defs++;
+    }
+
+  plug_in_rc_cache_patch_int (array, offset, n_plug_in_defs);
+
+  success = g_file_replace_contents (file,
+                                     (const gchar *) array->data, array->len,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, error);
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static gboolean
+plug_in_rc_cache_stat (GFile    *pluginrc,
+                       guint64  *mtime,
+                       guint32  *mtime_usec,
+                       guint64  *size,
+                       GError  **error)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (pluginrc,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, error);
+
+  if (! info)
+    return FALSE;
+
+  *mtime      = g_file_info_get_attribute_uint64 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  *mtime_usec = g_file_info_get_attribute_uint32 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  *size       = g_file_info_get_size (info);
+
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+static const guchar *
+plug_in_rc_cache_read (PlugInRcCacheReader *reader,
+                       gsize                length)
+{
+  const guchar *data;
+
+  if (reader->error || length > reader->size - reader->offset)
+    {
+      reader->error = TRUE;
+
+      return NULL;
+    }
+
+  data = reader->data + reader->offset;
+
+  reader->offset += length;
+
+  return data;
+}
+
+static gint32
+plug_in_rc_cache_read_int (PlugInRcCacheReader *reader)
+{
+  const guchar *data  = plug_in_rc_cache_read (reader, sizeof (gint32));
+  gint32        value = 0;
+
+  /*  the mapping gives no alignment guarantees  */
+  if (data)
+    memcpy (&value, data, sizeof (gint32));
+
+  return value;
+}
+
+static gint64
+plug_in_rc_cache_read_int64 (PlugInRcCacheReader *reader)
+{
+  const guchar *data  = plug_in_rc_cache_read (reader, sizeof (gint64));
+  gint64        value = 0;
+
+  if (data)
+    memcpy (&value, data, sizeof (gint64));
+
+  return value;
+}
+
+static gchar *
+plug_in_rc_cache_read_string (PlugInRcCacheReader *reader)
+{
+  const guchar *data;
+  gint          length = plug_in_rc_cache_read_int (reader);
+
+  if (length < 0)
+    {
+      if (length != -1)
+        reader->error = TRUE;
+
+      return NULL;
+    }
+
+  data = plug_in_rc_cache_read (reader, length);
+
+  if (! data)
+    return NULL;
+
+  return g_strndup ((const gchar *) data, length);
+}
+
+static guint8 *
+plug_in_rc_cache_read_data (PlugInRcCacheReader *reader,
+                            gint                 length)
+{
+  const guchar *data;
+
+  if (length < 0)
+    {
+      reader->error = TRUE;
+
+      return NULL;
+    }
+
+  data = plug_in_rc_cache_read (reader, length);
+
+  if (! data)
+    return NULL;
+
+  return g_memdup (data, length);
+}
+
+static GimpPlugInDef *
+plug_in_rc_cache_read_def (PlugInRcCacheReader *reader,
+                           Gimp                *gimp)
+{
+  GimpPlugInDef *plug_in_def;
+  GFile         *file;
+  gchar         *path;
+  gchar         *domain_name;
+  gchar         *domain_path;
+  gint           n_procs;
+  gint           i;
+
+  path = plug_in_rc_cache_read_string (reader);
+
+  if (! (path && *path))
+    {
+      g_free (path);
+      reader->error = TRUE;
+
+      return NULL;
+    }
+
+  file = gimp_file_new_for_config_path (path, NULL);
+  g_free (path);
+
+  if (! file)
+    {
+      reader->error = TRUE;
+
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (file);
+  g_object_unref (file);
+
+  plug_in_def->mtime = plug_in_rc_cache_read_int64 (reader);
+
+  n_procs = plug_in_rc_cache_read_int (reader);
+
+  for (i = 0; i < n_procs && ! reader->error; i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = plug_in_rc_cache_read_proc (reader, gimp, plug_in_def->file);
+
+      if (proc)
+        {
+          gimp_plug_in_def_add_procedure (plug_in_def, proc);
+          g_object_unref (proc);
+        }
+    }
+
+  domain_name = plug_in_rc_cache_read_string (reader);
+  domain_path = plug_in_rc_cache_read_string (reader);
+
+  if (domain_name)
+    {
+      gchar *expanded_path = NULL;
+
+      if (domain_path)
+        expanded_path = gimp_config_path_expand (domain_path, TRUE, NULL);
+
+      gimp_plug_in_def_set_locale_domain (plug_in_def,
+                                          domain_name, expanded_path);
+
+      g_free (expanded_path);
+    }
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  domain_name = plug_in_rc_cache_read_string (reader);
+  domain_path = plug_in_rc_cache_read_string (reader);
+
+  if (domain_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  if (plug_in_rc_cache_read_int (reader))
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  if (reader->error)
+    {
+      g_object_unref (plug_in_def);
+
+      return NULL;
+    }
+
+  return plug_in_def;
+}
+
+static GimpPlugInProcedure *
+plug_in_rc_cache_read_proc (PlugInRcCacheReader *reader,
+                            Gimp                *gimp,
+                            GFile               *file)
+{
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  GimpIconType         icon_type;
+  gint                 icon_data_length;
+  guint8              *icon_data;
+  gchar               *str;
+  gint                 proc_type;
+  gint                 flags;
+  gint                 n_menu_paths;
+  gint                 n_args;
+  gint                 n_return_vals;
+  gint                 i;
+
+  str       = plug_in_rc_cache_read_string (reader);
+  proc_type = plug_in_rc_cache_read_int (reader);
+
+  if (! (str && *str) ||
+      (proc_type != GIMP_PLUGIN && proc_type != GIMP_EXTENSION))
+    {
+      g_free (str);
+      reader->error = TRUE;
+
+      return NULL;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, file);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_take_name (GIMP_OBJECT (procedure),
+                         gimp_canonicalize_identifier (str));
+
+  procedure->original_name = str;
+
+  procedure->blurb     = plug_in_rc_cache_read_string (reader);
+  procedure->help      = plug_in_rc_cache_read_string (reader);
+  procedure->author    = plug_in_rc_cache_read_string (reader);
+  procedure->copyright = plug_in_rc_cache_read_string (reader);
+  procedure->date      = plug_in_rc_cache_read_string (reader);
+  proc->menu_label     = plug_in_rc_cache_read_string (reader);
+
+  n_menu_paths = plug_in_rc_cache_read_int (reader);
+
+  for (i = 0; i < n_menu_paths && ! reader->error; i++)
+    {
+      str = plug_in_rc_cache_read_string (reader);
+
+      if (str)
+        proc->menu_paths = g_list_append (proc->menu_paths, str);
+    }
+
+  icon_type        = plug_in_rc_cache_read_int (reader);
+  icon_data_length = plug_in_rc_cache_read_int (reader);
+
+  switch (icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      icon_data_length = -1;
+      icon_data        = (guint8 *) plug_in_rc_cache_read_string (reader);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      icon_data = plug_in_rc_cache_read_data (reader, icon_data_length);
+      break;
+
+    default:
+      icon_data     = NULL;
+      reader->error = TRUE;
+      break;
+    }
+
+  if (! reader->error)
+    gimp_plug_in_procedure_take_icon (proc, icon_type,
+                                      icon_data, icon_data_length);
+  else
+    g_free (icon_data);
+
+  flags = plug_in_rc_cache_read_int (reader);
+
+  if (flags & PROC_FILE_PROC)
+    {
+      proc->file_proc = TRUE;
+
+      proc->extensions = plug_in_rc_cache_read_string (reader);
+      proc->prefixes   = plug_in_rc_cache_read_string (reader);
+      proc->magics     = plug_in_rc_cache_read_string (reader);
+
+      gimp_plug_in_procedure_set_priority (proc,
+                                           plug_in_rc_cache_read_int (reader));
+
+      str = plug_in_rc_cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_mime_types (proc, str);
+      g_free (str);
+
+      str = plug_in_rc_cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_thumb_loader (proc, str);
+      g_free (str);
+
+      if (flags & PROC_HANDLES_URI)
+        gimp_plug_in_procedure_set_handles_uri (proc);
+
+      if (flags & PROC_HANDLES_RAW)
+        gimp_plug_in_procedure_set_handles_raw (proc);
+    }
+
+  str = plug_in_rc_cache_read_string (reader);
+  gimp_plug_in_procedure_set_image_types (proc, str);
+  g_free (str);
+
+  n_args        = plug_in_rc_cache_read_int (reader);
+  n_return_vals = plug_in_rc_cache_read_int (reader);
+
+  for (i = 0; i < n_args && ! reader->error; i++)
+    plug_in_rc_cache_read_arg (reader, gimp, procedure, FALSE);
+
+  for (i = 0; i < n_return_vals && ! reader->error; i++)
+    plug_in_rc_cache_read_arg (reader, gimp, procedure, TRUE);
+
+  if (reader->error)
+    {
+      g_object_unref (proc);
+
+      return NULL;
+    }
+
+  return proc;
+}
+
+static gboolean
+plug_in_rc_cache_read_arg (PlugInRcCacheReader *reader,
+                           Gimp                *gimp,
+                           GimpProcedure       *procedure,
+                           gboolean             return_value)
+{
+  GParamSpec *pspec;
+  gint        arg_type;
+  gchar      *name;
+  gchar      *desc;
+
+  arg_type = plug_in_rc_cache_read_int (reader);
+  name     = plug_in_rc_cache_read_string (reader);
+  desc     = plug_in_rc_cache_read_string (reader);
+
+  if (! name)
+    reader->error = TRUE;
+
+  if (reader->error)
+    {
+      g_free (name);
+      g_free (desc);
+
+      return FALSE;
+    }
+
+  pspec = gimp_pdb_compat_param_spec (gimp, arg_type, name, desc);
+
+  if (return_value)
+    gimp_procedure_add_return_value (procedure, pspec);
+  else
+    gimp_procedure_add_argument (procedure, pspec);
+
+  g_free (name);
+  g_free (desc);
+
+  return TRUE;
+}
+
+static void
+plug_in_rc_cache_write_int (GByteArray *array,
+                            gint32      value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (gint32));
+}
+
+static void
+plug_in_rc_cache_write_int64 (GByteArray *array,
+                              gint64      value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (gint64));
+}
+
+static void
+plug_in_rc_cache_write_string (GByteArray  *array,
+                               const gchar *str)
+{
+  if (str)
+    {
+      gint length = strlen (str);
+
+      plug_in_rc_cache_write_int (array, length);
+      g_byte_array_append (array, (const guint8 *) str, length);
+    }
+  else
+    {
+      plug_in_rc_cache_write_int (array, -1);
+    }
+}
+
+static void
+plug_in_rc_cache_write_data (GByteArray   *array,
+                             const guint8 *data,
+                             gint          length)
+{
+  g_byte_array_append (array, data, length);
+}
+
+static void
+plug_in_rc_cache_patch_int (GByteArray *array,
+                            guint       offset,
+                            gint32      value)
+{
+  memcpy (array->data + offset, &value, sizeof (gint32));
+}
+
+static gboolean
+plug_in_rc_cache_write_def (GByteArray    *array,
+                            GimpPlugInDef *plug_in_def)
+{
+  GSList *list;
+  gchar  *path;
+  guint   offset;
+  gint    n_procs = 0;
+
+  /*  skip the same plug-ins as plug_in_rc_write() does  */
+  if (! plug_in_def->procedures)
+    return FALSE;
+
+  path = gimp_file_get_config_path (plug_in_def->file, NULL);
+
+  if (! path)
+    return FALSE;
+
+  plug_in_rc_cache_write_string (array, path);
+  plug_in_rc_cache_write_int64  (array, plug_in_def->mtime);
+
+  g_free (path);
+
+  offset = array->len;
+  plug_in_rc_cache_write_int (array, 0);
+
+  for (list = plug_in_def->procedures; list; list = list->next)
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (proc->installed_during_init)
+        continue;
+
+      plug_in_rc_cache_write_proc (array, proc);
+      n_procs++;
+    }
+
+  plug_in_rc_cache_patch_int (array, offset, n_procs);
+
+  path = NULL;
+
+  if (plug_in_def->locale_domain_name && plug_in_def->locale_domain_path)
+    path = gimp_config_path_unexpand (plug_in_def->locale_domain_path,
+                                      TRUE, NULL);
+
+  plug_in_rc_cache_write_string (array, plug_in_def->locale_domain_name);
+  plug_in_rc_cache_write_string (array, path);
+
+  g_free (path);
+
+  plug_in_rc_cache_write_string (array, plug_in_def->help_domain_name);
+  plug_in_rc_cache_write_string (array,
+                                 plug_in_def->help_domain_name ?
+                                 plug_in_def->help_domain_uri : NULL);
+
+  plug_in_rc_cache_write_int (array, plug_in_def->has_init);
+
+  return TRUE;
+}
+
+static void
+plug_in_rc_cache_write_proc (GByteArray          *array,
+                             GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  gint           flags     = 0;
+  gint           i;
+
+  plug_in_rc_cache_write_string (array, procedure->original_name);
+  plug_in_rc_cache_write_int    (array, procedure->proc_type);
+
+  plug_in_rc_cache_write_string (array, procedure->blurb);
+  plug_in_rc_cache_write_string (array, procedure->help);
+  plug_in_rc_cache_write_string (array, procedure->author);
+  plug_in_rc_cache_write_string (array, procedure->copyright);
+  plug_in_rc_cache_write_string (array, procedure->date);
+  plug_in_rc_cache_write_string (array, proc->menu_label);
+
+  plug_in_rc_cache_write_int (array, g_list_length (proc->menu_paths));
+
+  for (list = proc->menu_paths; list; list = list->next)
+    plug_in_rc_cache_write_string (array, list->data);
+
+  plug_in_rc_cache_write_int (array, proc->icon_type);
+  plug_in_rc_cache_write_int (array, proc->icon_data_length);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      plug_in_rc_cache_write_string (array, (const gchar *) proc->icon_data);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      plug_in_rc_cache_write_data (array,
+                                   proc->icon_data, proc->icon_data_length);
+      break;
+    }
+
+  if (proc->file_proc)
+    {
+      flags |= PROC_FILE_PROC;
+
+      if (proc->handles_uri)
+        flags |= PROC_HANDLES_URI;
+
+      /*  like pluginrc, only load procedures can handle raw images  */
+      if (proc->handles_raw && ! proc->image_types)
+        flags |= PROC_HANDLES_RAW;
+    }
+
+  plug_in_rc_cache_write_int (array, flags);
+
+  if (proc->file_proc)
+    {
+      plug_in_rc_cache_write_string (array, proc->extensions);
+      plug_in_rc_cache_write_string (array, proc->prefixes);
+      plug_in_rc_cache_write_string (array, proc->magics);
+      plug_in_rc_cache_write_int    (array, proc->priority);
+      plug_in_rc_cache_write_string (array, proc->mime_types);
+      plug_in_rc_cache_write_string (array, proc->thumb_loader);
+    }
+
+  plug_in_rc_cache_write_string (array, proc->image_types);
+
+  plug_in_rc_cache_write_int (array, procedure->num_args);
+  plug_in_rc_cache_write_int (array, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args; i++)
+    {
+      GParamSpec *pspec = procedure->args[i];
+
+      plug_in_rc_cache_write_int (array,
+                                  gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_name (pspec));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_blurb (pspec));
+    }
+
+  for (i = 0; i < procedure->num_values; i++)
+    {
+      GParamSpec *pspec = procedure->values[i];
+
+      plug_in_rc_cache_write_int (array,
+                                  gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_name (pspec));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_blurb (pspec));
+    }
+}
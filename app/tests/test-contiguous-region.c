@@ -0,0 +1,368 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimplayer-new.h"
+#include "core/gimppickable.h"
+#include "core/gimppickable-contiguous-region.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimp-contiguous-region/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              NULL, \
+              function, \
+              NULL);
+
+
+/*  the size of the pattern, and the size of the image it is padded to,
+ *  and where.  the padded image is large enough for any region of the
+ *  pattern to be flood filled, while the large regions of the unpadded
+ *  pattern are labeled instead.
+ */
+#define PATTERN_WIDTH   333
+#define PATTERN_HEIGHT  271
+#define PADDED_WIDTH   1900
+#define PADDED_HEIGHT  1700
+#define PADDED_X        777
+#define PADDED_Y        555
+
+#define INK      0.05
+#define PAPER    0.95
+#define PADDING  0.5
+
+#define THRESHOLD 0.25
+
+
+typedef struct
+{
+  gint dummy;
+} GimpTestFixture;
+
+
+/*  ink on paper: a lattice of one pixel wide diagonal lines, which are
+ *  only connected through diagonal neighbors, on the left; a grid of
+ *  horizontal and vertical lines on the top right; open paper on the
+ *  bottom right; and some discs and noise all over.
+ */
+static gfloat *
+gimp_test_pattern_new (GRand *rand)
+{
+  gfloat *data;
+  gint    i;
+  gint    x, y;
+
+  data = g_new (gfloat, PATTERN_WIDTH * PATTERN_HEIGHT);
+
+  for (y = 0; y < PATTERN_HEIGHT; y++)
+    for (x = 0; x < PATTERN_WIDTH; x++)
+      {
+        gboolean ink;
+
+        if (x < PATTERN_WIDTH / 2)
+          ink = ((x - y) % 19 == 0 || (x + y) % 19 == 0);
+        else if (y < PATTERN_HEIGHT / 2)
+          ink = (x % 23 == 7 || y % 17 == 5);
+        else
+          ink = FALSE;
+
+        data[y * PATTERN_WIDTH + x] = ink ? INK : PAPER;
+      }
+
+  for (i = 0; i < 12; i++)
+    {
+      gint    cx = g_rand_int_range (rand, 0, PATTERN_WIDTH);
+      gint    cy = g_rand_int_range (rand, 0, PATTERN_HEIGHT);
+      gdouble r  = g_rand_double_range (rand, 3.0, 30.0);
+
+      for (y = 0; y < PATTERN_HEIGHT; y++)
+        for (x = 0; x < PATTERN_WIDTH; x++)
+          {
+            if (SQR (x - cx) + SQR (y - cy) < SQR (r))
+              data[y * PATTERN_WIDTH + x] = INK;
+          }
+    }
+
+  for (i = 0; i < PATTERN_WIDTH * PATTERN_HEIGHT; i++)
+    {
+      if (g_rand_double (rand) < 0.01)
+        data[i] = INK + PAPER - data[i];
+
+      /*  keep antialiased masks from being all-or-nothing  */
+      data[i] += g_rand_double_range (rand, -0.05, 0.05);
+    }
+
+  return data;
+}
+
+static GimpLayer *
+gimp_test_layer_new (GimpImage    *image,
+                     const gfloat *data)
+{
+  GimpLayer *layer;
+
+  layer = gimp_layer_new (image,
+                          gimp_image_get_width  (image),
+                          gimp_image_get_height (image),
+                          gimp_image_get_layer_format (image, FALSE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   NULL, 0, babl_format ("Y' float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  return layer;
+}
+
+static gfloat *
+gimp_test_mask_get_data (GeglBuffer          *buffer,
+                         const GeglRectangle *rect)
+{
+  gfloat *data;
+
+  if (! rect)
+    rect = gegl_buffer_get_extent (buffer);
+
+  data = g_new (gfloat, rect->width * rect->height);
+
+  gegl_buffer_get (buffer, rect, 1.0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return data;
+}
+
+/*  selects the region at each corner of the mask's tiles, in the
+ *  unpadded image, where the large regions are labeled, and in the
+ *  padded image, where they are flood filled, and checks that both
+ *  masks agree.
+ */
+static void
+gimp_test_compare_paths (Gimp     *gimp,
+                         gboolean  antialias,
+                         gboolean  diagonal_neighbors)
+{
+  GRand      *rand;
+  gfloat     *pattern;
+  gfloat     *padded;
+  GimpImage  *image;
+  GimpImage  *padded_image;
+  GimpLayer  *layer;
+  GimpLayer  *padded_layer;
+  GeglBuffer *buffer;
+  gint        tile_width  = 1;
+  gint        tile_height = 1;
+  gint        n_labeled   = 0;
+  gint        i;
+  gint        x, y;
+
+  rand = g_rand_new_with_seed (2342);
+
+  pattern = gimp_test_pattern_new (rand);
+
+  padded = g_new (gfloat, PADDED_WIDTH * PADDED_HEIGHT);
+
+  for (i = 0; i < PADDED_WIDTH * PADDED_HEIGHT; i++)
+    padded[i] = PADDING;
+
+  for (y = 0; y < PATTERN_HEIGHT; y++)
+    {
+      memcpy (padded + (PADDED_Y + y) * PADDED_WIDTH + PADDED_X,
+              pattern + y * PATTERN_WIDTH,
+              PATTERN_WIDTH * sizeof (gfloat));
+    }
+
+  image = gimp_image_new (gimp, PATTERN_WIDTH, PATTERN_HEIGHT,
+                          GIMP_RGB, GIMP_PRECISION_FLOAT_GAMMA);
+  padded_image = gimp_image_new (gimp, PADDED_WIDTH, PADDED_HEIGHT,
+                                 GIMP_RGB, GIMP_PRECISION_FLOAT_GAMMA);
+
+  layer        = gimp_test_layer_new (image,        pattern);
+  padded_layer = gimp_test_layer_new (padded_image, padded);
+
+  /*  the tiles that the labeling splits the mask into  */
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, 1, 1),
+                            babl_format ("Y float"));
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+  g_object_unref (buffer);
+
+  g_assert_cmpint (tile_width,  <, PATTERN_WIDTH);
+  g_assert_cmpint (tile_height, <, PATTERN_HEIGHT);
+
+  for (y = tile_height; y < PATTERN_HEIGHT; y += tile_height)
+    for (x = tile_width; x < PATTERN_WIDTH; x += tile_width)
+      for (i = 0; i < 4; i++)
+        {
+          GeglBuffer *mask;
+          GeglBuffer *padded_mask;
+          gfloat     *data;
+          gfloat     *padded_data;
+          gint        seed_x = x - (i % 2);
+          gint        seed_y = y - (i / 2);
+          gint        area   = 0;
+          gdouble     sum    = 0.0;
+          gdouble     padded_sum;
+          gint        j;
+
+          mask = gimp_pickable_contiguous_region_by_seed (
+            GIMP_PICKABLE (layer),
+            antialias, THRESHOLD, FALSE,
+            GIMP_SELECT_CRITERION_COMPOSITE,
+            diagonal_neighbors,
+            seed_x, seed_y);
+
+          padded_mask = gimp_pickable_contiguous_region_by_seed (
+            GIMP_PICKABLE (padded_layer),
+            antialias, THRESHOLD, FALSE,
+            GIMP_SELECT_CRITERION_COMPOSITE,
+            diagonal_neighbors,
+            PADDED_X + seed_x, PADDED_Y + seed_y);
+
+          data        = gimp_test_mask_get_data (mask, NULL);
+          padded_data = gimp_test_mask_get_data (
+            padded_mask,
+            GEGL_RECTANGLE (PADDED_X, PADDED_Y,
+                            PATTERN_WIDTH, PATTERN_HEIGHT));
+
+          for (j = 0; j < PATTERN_WIDTH * PATTERN_HEIGHT; j++)
+            {
+              if (data[j] != padded_data[j])
+                {
+                  g_error ("seed (%d, %d)%s%s: masks differ at (%d, %d): "
+                           "%g labeled, %g flood filled",
+                           seed_x, seed_y,
+                           antialias          ? ", antialias"          : "",
+                           diagonal_neighbors ? ", diagonal neighbors" : "",
+                           j % PATTERN_WIDTH, j / PATTERN_WIDTH,
+                           data[j], padded_data[j]);
+                }
+
+              if (data[j] > 0.0)
+                area++;
+
+              sum += data[j];
+            }
+
+          g_free (padded_data);
+
+          /*  nothing may leak into the padding  */
+          padded_data = gimp_test_mask_get_data (padded_mask, NULL);
+          padded_sum  = 0.0;
+
+          for (j = 0; j < PADDED_WIDTH * PADDED_HEIGHT; j++)
+            padded_sum += padded_data[j];
+
+          g_assert_cmpfloat (fabs (padded_sum - sum), <, 0.5);
+
+          if (area > PATTERN_WIDTH * PATTERN_HEIGHT / 32)
+            n_labeled++;
+
+          g_free (data);
+          g_free (padded_data);
+
+          g_object_unref (mask);
+          g_object_unref (padded_mask);
+        }
+
+  /*  make sure the labeling was actually compared  */
+  g_assert_cmpint (n_labeled, >, 0);
+
+  g_object_unref (image);
+  g_object_unref (padded_image);
+
+  g_free (pattern);
+  g_free (padded);
+
+  g_rand_free (rand);
+}
+
+static void
+four_neighbors (GimpTestFixture *fixture,
+                gconstpointer    data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_test_compare_paths (gimp, FALSE, FALSE);
+  gimp_test_compare_paths (gimp, TRUE,  FALSE);
+}
+
+static void
+eight_neighbors (GimpTestFixture *fixture,
+                 gconstpointer    data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_test_compare_paths (gimp, FALSE, TRUE);
+  gimp_test_compare_paths (gimp, TRUE,  TRUE);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (four_neighbors);
+  ADD_TEST (eight_neighbors);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,630 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-mask-morphology.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimp-mask-morphology/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              NULL, \
+              function, \
+              NULL);
+
+
+typedef struct
+{
+  gint dummy;
+} GimpTestFixture;
+
+typedef struct
+{
+  gint radius_x;
+  gint radius_y;
+} Radius;
+
+
+/*  includes non-square radii, and radii larger than the masks  */
+static const Radius radii[] =
+{
+  {  1,  1 },
+  {  2,  2 },
+  {  1,  4 },
+  {  5,  2 },
+  {  3,  9 },
+  {  7,  3 },
+  { 12, 12 },
+  { 40,  6 }
+};
+
+
+static GeglBuffer *
+gimp_test_mask_new (GRand   *rand,
+                    gint     width,
+                    gint     height,
+                    gint     n_blobs,
+                    gdouble  noise)
+{
+  GeglBuffer *buffer;
+  gfloat     *data;
+  gint        i;
+  gint        x, y;
+
+  data = g_new0 (gfloat, width * height);
+
+  /*  some discs, touching the edges now and then, plus isolated pixels
+   *  and holes
+   */
+  for (i = 0; i < n_blobs; i++)
+    {
+      gint    cx = g_rand_int_range (rand, -5, width  + 5);
+      gint    cy = g_rand_int_range (rand, -5, height + 5);
+      gdouble r  = g_rand_double_range (rand, 1.0, MAX (width, height) / 3.0);
+
+      for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+          {
+            if (SQR (x - cx) + SQR (y - cy) < SQR (r))
+              data[y * width + x] = 1.0;
+          }
+    }
+
+  for (i = 0; i < width * height; i++)
+    {
+      if (g_rand_double (rand) < noise)
+        data[i] = 1.0 - data[i];
+    }
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                            babl_format ("Y float"));
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return buffer;
+}
+
+static GeglBuffer *
+gimp_test_mask_new_like (GeglBuffer *buffer)
+{
+  return gegl_buffer_new (gegl_buffer_get_extent (buffer),
+                          babl_format ("Y float"));
+}
+
+static gfloat *
+gimp_test_mask_get_data (GeglBuffer *buffer)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  gfloat              *data;
+
+  data = g_new (gfloat, extent->width * extent->height);
+
+  gegl_buffer_get (buffer, NULL, 1.0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return data;
+}
+
+/*  maps the mask's values to @scale * value + @offset.  scaling a
+ *  binary mask by 0.5 moves it off the distance transform path of
+ *  gimp:grow and gimp:shrink, without changing what their max and min
+ *  filters select.
+ */
+static GeglBuffer *
+gimp_test_mask_map (GeglBuffer *buffer,
+                    gfloat      scale,
+                    gfloat      offset)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer);
+  GeglBuffer          *result = gimp_test_mask_new_like (buffer);
+  gfloat              *data   = gimp_test_mask_get_data (buffer);
+  gint                 i;
+
+  for (i = 0; i < extent->width * extent->height; i++)
+    data[i] = scale * data[i] + offset;
+
+  gegl_buffer_set (result, NULL, 0, babl_format ("Y float"), data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return result;
+}
+
+static void
+gimp_test_mask_assert_equal (GeglBuffer  *buffer1,
+                             gfloat       factor1,
+                             GeglBuffer  *buffer2,
+                             gfloat       factor2,
+                             gdouble      epsilon,
+                             const gchar *what)
+{
+  const GeglRectangle *extent = gegl_buffer_get_extent (buffer1);
+  gfloat              *data1  = gimp_test_mask_get_data (buffer1);
+  gfloat              *data2  = gimp_test_mask_get_data (buffer2);
+  gint                 i;
+
+  for (i = 0; i < extent->width * extent->height; i++)
+    {
+      gdouble value1 = data1[i] * factor1;
+      gdouble value2 = data2[i] * factor2;
+
+      if (fabs (value1 - value2) > epsilon)
+        {
+          g_error ("%s: %dx%d mask differs at (%d, %d): %g != %g",
+                   what, extent->width, extent->height,
+                   i % extent->width, i / extent->width,
+                   value1, value2);
+        }
+    }
+
+  g_free (data1);
+  g_free (data2);
+}
+
+/*  the rows spanned by the structuring element of gimp:grow and
+ *  gimp:shrink at each column offset, as computed by their
+ *  compute_border()
+ */
+static gint *
+gimp_test_get_circ (gint radius_x,
+                    gint radius_y)
+{
+  gint *circ = g_new (gint, radius_x + 1);
+  gint  i;
+
+  for (i = 0; i <= radius_x; i++)
+    {
+      gdouble tmp = i > 0 ? i - 0.5 : 0.0;
+
+      circ[i] = RINT (radius_y / (gdouble) radius_x *
+                      sqrt (SQR ((gdouble) radius_x) - SQR (tmp)));
+    }
+
+  return circ;
+}
+
+/*  straightforward grow or shrink by testing the structuring element
+ *  against the listed target pixels, which must be sparse
+ */
+static GeglBuffer *
+gimp_test_reference_grow_shrink (GeglBuffer *buffer,
+                                 gint        radius_x,
+                                 gint        radius_y,
+                                 gboolean    shrink,
+                                 gboolean    edge_lock)
+{
+  const GeglRectangle *extent  = gegl_buffer_get_extent (buffer);
+  gint                 width   = extent->width;
+  gint                 height  = extent->height;
+  GeglBuffer          *result  = gimp_test_mask_new_like (buffer);
+  gfloat              *data    = gimp_test_mask_get_data (buffer);
+  gfloat              *out     = g_new (gfloat, width * height);
+  gint                *circ    = gimp_test_get_circ (radius_x, radius_y);
+  GArray              *targets = g_array_new (FALSE, FALSE, sizeof (gint));
+  gint                 i;
+  gint                 x, y;
+
+  /*  grow looks for selected pixels, shrink for unselected ones  */
+  for (i = 0; i < width * height; i++)
+    {
+      if ((data[i] == 1.0) != shrink)
+        g_array_append_val (targets, i);
+    }
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gboolean hit = FALSE;
+
+        /*  without edge-lock, shrink treats the outside as unselected  */
+        if (shrink && ! edge_lock)
+          {
+            hit = x - radius_x < 0 || x + radius_x >= width ||
+                  y - radius_y < 0 || y + radius_y >= height;
+          }
+
+        for (i = 0; i < targets->len && ! hit; i++)
+          {
+            gint index = g_array_index (targets, gint, i);
+            gint dx    = ABS (index % width - x);
+            gint dy    = ABS (index / width - y);
+
+            hit = dx <= radius_x && dy <= circ[dx];
+          }
+
+        out[y * width + x] = hit != shrink ? 1.0 : 0.0;
+      }
+
+  gegl_buffer_set (result, NULL, 0, babl_format ("Y float"), out,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_array_free (targets, TRUE);
+  g_free (circ);
+  g_free (out);
+  g_free (data);
+
+  return result;
+}
+
+/*  straightforward border, from the distance of each pixel to the
+ *  nearest transition pixel, as defined by gimp:border
+ */
+static GeglBuffer *
+gimp_test_reference_border (GeglBuffer *buffer,
+                            gint        radius_x,
+                            gint        radius_y,
+                            gboolean    feather,
+                            gboolean    edge_lock)
+{
+  const GeglRectangle *extent  = gegl_buffer_get_extent (buffer);
+  gint                 width   = extent->width;
+  gint                 height  = extent->height;
+  GeglBuffer          *result  = gimp_test_mask_new_like (buffer);
+  gfloat              *data    = gimp_test_mask_get_data (buffer);
+  gfloat              *out     = g_new (gfloat, width * height);
+  GArray              *targets = g_array_new (FALSE, FALSE, sizeof (gint));
+  gint                 i;
+  gint                 x, y;
+
+  g_assert_cmpint (width, >, 1);
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gboolean transition = FALSE;
+        gint     dx, dy;
+
+        if (data[y * width + x] < 0.5)
+          continue;
+
+        for (dy = -1; dy <= 1; dy++)
+          for (dx = -1; dx <= 1; dx++)
+            {
+              gint     nx = x + dx;
+              gint     ny = y + dy;
+              gboolean selected;
+
+              if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+                selected = edge_lock;
+              else
+                selected = data[ny * width + nx] >= 0.5;
+
+              if (! selected)
+                transition = TRUE;
+            }
+
+        if (transition)
+          {
+            i = y * width + x;
+
+            g_array_append_val (targets, i);
+          }
+      }
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gdouble value = 0.0;
+
+        for (i = 0; i < targets->len; i++)
+          {
+            gint    index = g_array_index (targets, gint, i);
+            gint    dx    = ABS (index % width - x);
+            gint    dy    = ABS (index / width - y);
+            gdouble tx    = dx > 0 ? dx - 0.5 : 0.0;
+            gdouble ty    = dy > 0 ? dy - 0.5 : 0.0;
+            gdouble dist;
+
+            dist = SQR (tx) / SQR ((gdouble) radius_x) +
+                   SQR (ty) / SQR ((gdouble) radius_y);
+
+            if (dist < 1.0)
+              value = MAX (value, feather ? 1.0 - sqrt (dist) : 1.0);
+          }
+
+        out[y * width + x] = value;
+      }
+
+  gegl_buffer_set (result, NULL, 0, babl_format ("Y float"), out,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_array_free (targets, TRUE);
+  g_free (out);
+  g_free (data);
+
+  return result;
+}
+
+/**
+ * grow_shrink_paths:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure gimp:grow and gimp:shrink give the same result on binary
+ * masks, which use the distance transform, as on other masks, which
+ * use the original max and min filters.
+ **/
+static void
+grow_shrink_paths (GimpTestFixture *fixture,
+                   gconstpointer    data)
+{
+  GRand *rand = g_rand_new_with_seed (1);
+  gint   i;
+  gint   j;
+
+  for (i = 0; i < 12; i++)
+    {
+      gint        width  = g_rand_int_range (rand, 1, 150);
+      gint        height = g_rand_int_range (rand, 1, 100);
+      GeglBuffer *mask;
+      GeglBuffer *scaled;
+
+      mask   = gimp_test_mask_new (rand, width, height,
+                                   g_rand_int_range (rand, 0, 6),
+                                   g_rand_double_range (rand, 0.0, 0.05));
+      scaled = gimp_test_mask_map (mask, 0.5, 0.0);
+
+      for (j = 0; j < G_N_ELEMENTS (radii); j++)
+        {
+          GeglBuffer *binary = gimp_test_mask_new_like (mask);
+          GeglBuffer *other  = gimp_test_mask_new_like (mask);
+          gint        edge_lock;
+
+          gimp_gegl_apply_grow (mask, NULL, NULL, binary, NULL,
+                                radii[j].radius_x, radii[j].radius_y);
+          gimp_gegl_apply_grow (scaled, NULL, NULL, other, NULL,
+                                radii[j].radius_x, radii[j].radius_y);
+
+          gimp_test_mask_assert_equal (binary, 1.0, other, 2.0, 0.0,
+                                       "grow");
+
+          for (edge_lock = FALSE; edge_lock <= TRUE; edge_lock++)
+            {
+              gimp_gegl_apply_shrink (mask, NULL, NULL, binary, NULL,
+                                      radii[j].radius_x, radii[j].radius_y,
+                                      edge_lock);
+              gimp_gegl_apply_shrink (scaled, NULL, NULL, other, NULL,
+                                      radii[j].radius_x, radii[j].radius_y,
+                                      edge_lock);
+
+              gimp_test_mask_assert_equal (binary, 1.0, other, 2.0, 0.0,
+                                           "shrink");
+            }
+
+          g_object_unref (binary);
+          g_object_unref (other);
+        }
+
+      g_object_unref (scaled);
+      g_object_unref (mask);
+    }
+
+  g_rand_free (rand);
+}
+
+/**
+ * border_paths:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure gimp:border, which uses the distance transform for radii
+ * larger than 1, matches a straightforward computation of the border.
+ **/
+static void
+border_paths (GimpTestFixture *fixture,
+              gconstpointer    data)
+{
+  GRand *rand = g_rand_new_with_seed (2);
+  gint   i;
+  gint   j;
+
+  for (i = 0; i < 8; i++)
+    {
+      gint        width  = g_rand_int_range (rand, 2, 80);
+      gint        height = g_rand_int_range (rand, 1, 60);
+      GeglBuffer *mask;
+
+      mask = gimp_test_mask_new (rand, width, height,
+                                 g_rand_int_range (rand, 0, 4),
+                                 g_rand_double_range (rand, 0.0, 0.02));
+
+      for (j = 0; j < G_N_ELEMENTS (radii); j++)
+        {
+          GeglBuffer *result = gimp_test_mask_new_like (mask);
+          gint        feather;
+          gint        edge_lock;
+
+          /*  radius 1 is special-cased by gimp:border  */
+          if (radii[j].radius_x == 1 && radii[j].radius_y == 1)
+            continue;
+
+          for (feather = FALSE; feather <= TRUE; feather++)
+            for (edge_lock = FALSE; edge_lock <= TRUE; edge_lock++)
+              {
+                GeglBuffer *reference;
+
+                gimp_gegl_apply_border (mask, NULL, NULL, result, NULL,
+                                        radii[j].radius_x,
+                                        radii[j].radius_y,
+                                        feather ?
+                                        GIMP_CHANNEL_BORDER_STYLE_FEATHERED :
+                                        GIMP_CHANNEL_BORDER_STYLE_HARD,
+                                        edge_lock);
+
+                reference = gimp_test_reference_border (mask,
+                                                        radii[j].radius_x,
+                                                        radii[j].radius_y,
+                                                        feather, edge_lock);
+
+                gimp_test_mask_assert_equal (result, 1.0, reference, 1.0,
+                                             1e-5, "border");
+
+                g_object_unref (reference);
+              }
+
+          g_object_unref (result);
+        }
+
+      g_object_unref (mask);
+    }
+
+  g_rand_free (rand);
+}
+
+/**
+ * large_radius:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure the distance transforms handle vertical radii, and masks,
+ * whose distances don't fit in 16 bits.
+ **/
+static void
+large_radius (GimpTestFixture *fixture,
+              gconstpointer    data)
+{
+  const struct
+  {
+    gint width;
+    gint height;
+    gint radius_x;
+    gint radius_y;
+  } cases[] =
+  {
+    { 13,    29, 3, 100000 },
+    {  3, 70000, 1,  70000 },
+    {  4, 66000, 2,  30000 }
+  };
+
+  GRand *rand = g_rand_new_with_seed (3);
+  gint   i;
+
+  for (i = 0; i < G_N_ELEMENTS (cases); i++)
+    {
+      const GeglRectangle  rect   = { 0, 0, cases[i].width, cases[i].height };
+      gint                 n      = rect.width * rect.height;
+      GeglBuffer          *sparse = gimp_test_mask_new (rand,
+                                                        rect.width,
+                                                        rect.height,
+                                                        0, 5.0 / n);
+      GeglBuffer          *dense  = gimp_test_mask_map (sparse, -1.0, 1.0);
+      GeglBuffer          *result = gimp_test_mask_new_like (sparse);
+      GeglBuffer          *reference;
+      gint                 edge_lock;
+
+      g_assert_true (gimp_gegl_mask_grow (sparse, result, &rect,
+                                          cases[i].radius_x,
+                                          cases[i].radius_y));
+
+      reference = gimp_test_reference_grow_shrink (sparse,
+                                                   cases[i].radius_x,
+                                                   cases[i].radius_y,
+                                                   FALSE, FALSE);
+      gimp_test_mask_assert_equal (result, 1.0, reference, 1.0, 0.0,
+                                   "grow");
+      g_object_unref (reference);
+
+      for (edge_lock = FALSE; edge_lock <= TRUE; edge_lock++)
+        {
+          g_assert_true (gimp_gegl_mask_shrink (dense, result, &rect,
+                                                cases[i].radius_x,
+                                                cases[i].radius_y,
+                                                edge_lock));
+
+          reference = gimp_test_reference_grow_shrink (dense,
+                                                       cases[i].radius_x,
+                                                       cases[i].radius_y,
+                                                       TRUE, edge_lock);
+          gimp_test_mask_assert_equal (result, 1.0, reference, 1.0, 0.0,
+                                       "shrink");
+          g_object_unref (reference);
+
+          gimp_gegl_mask_border (sparse, result, &rect,
+                                 cases[i].radius_x, cases[i].radius_y,
+                                 TRUE, edge_lock);
+
+          reference = gimp_test_reference_border (sparse,
+                                                  cases[i].radius_x,
+                                                  cases[i].radius_y,
+                                                  TRUE, edge_lock);
+          gimp_test_mask_assert_equal (result, 1.0, reference, 1.0, 1e-5,
+                                       "border");
+          g_object_unref (reference);
+        }
+
+      g_object_unref (result);
+      g_object_unref (dense);
+      g_object_unref (sparse);
+    }
+
+  g_rand_free (rand);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (grow_shrink_paths);
+  ADD_TEST (border_paths);
+  ADD_TEST (large_radius);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -59,6 +59,8 @@
 #include "core/gimp-parallel.h"
 #include "core/gimpasync.h"
 #include "core/gimpbacktrace.h"
+#include "core/gimpbrushcache.h"
+#include "core/gimpdrawableundo.h"
 #include "core/gimptempbuf.h"
 #include "core/gimpwaitable.h"
 
@@ -139,8 +141,14 @@ typedef enum
   /* misc */
   VARIABLE_MIPMAPED,
   VARIABLE_ASYNC_RUNNING,
+  VARIABLE_ASYNC_QUEUED,
+  VARIABLE_ASYNC_STOLEN,
   VARIABLE_SCRATCH_TOTAL,
   VARIABLE_TEMP_BUF_TOTAL,
+  VARIABLE_BRUSH_CACHE_TOTAL,
+  VARIABLE_BRUSH_CACHE_HIT_MISS,
+  VARIABLE_UNDO_COLD_TOTAL,
+  VARIABLE_UNDO_COLD_COMPRESSION,
 
 
   N_VARIABLES,
@@ -376,6 +384,11 @@ static void       gimp_dashboard_sample_memory_size             (GimpDashboard
                                                                  Variable             variable);
 #endif /* HAVE_MEMORY_GROUP */
 
+static void       gimp_dashboard_sample_brush_cache_hit_miss    (GimpDashboard       *dashboard,
+                                                                 Variable             variable);
+static void       gimp_dashboard_sample_undo_cold_compression   (GimpDashboard       *dashboard,
+                                                                 Variable             variable);
+
 static void       gimp_dashboard_sample_object                  (GimpDashboard       *dashboard,
                                                                  GObject             *object,
                                                                  Variable             variable);
@@ -698,6 +711,25 @@ static const VariableInfo variables[] =
     .data             = gimp_async_get_n_running
   },
 
+  [VARIABLE_ASYNC_QUEUED] =
+  { .name             = "async-queued",
+    .title            = NC_("dashboard-variable", "Queued"),
+    .description      = N_("Number of queued asynchronous operations"),
+    .type             = VARIABLE_TYPE_INTEGER,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_parallel_run_async_get_n_queued
+  },
+
+  [VARIABLE_ASYNC_STOLEN] =
+  { .name             = "async-stolen",
+    .title            = NC_("dashboard-variable", "Stolen"),
+    .description      = N_("Number of asynchronous operations taken over "
+                           "by idle threads"),
+    .type             = VARIABLE_TYPE_INTEGER,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_parallel_run_async_get_n_stolen
+  },
+
   [VARIABLE_SCRATCH_TOTAL] =
   { .name             = "scratch-total",
     .title            = NC_("dashboard-variable", "Scratch"),
@@ -717,6 +749,40 @@ static const VariableInfo variables[] =
     .type             = VARIABLE_TYPE_SIZE,
     .sample_func      = gimp_dashboard_sample_function,
     .data             = gimp_temp_buf_get_total_memsize
+  },
+
+  [VARIABLE_BRUSH_CACHE_TOTAL] =
+  { .name             = "brush-cache-total",
+    .title            = NC_("dashboard-variable", "Brush cache"),
+    .description      = N_("Total size of cached transformed brushes"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_brush_cache_get_total_memsize
+  },
+
+  [VARIABLE_BRUSH_CACHE_HIT_MISS] =
+  { .name             = "brush-cache-hit-miss",
+    .title            = NC_("dashboard-variable", "Brush hit/miss"),
+    .description      = N_("Transformed brush cache hit/miss ratio"),
+    .type             = VARIABLE_TYPE_INT_RATIO,
+    .sample_func      = gimp_dashboard_sample_brush_cache_hit_miss
+  },
+
+  [VARIABLE_UNDO_COLD_TOTAL] =
+  { .name             = "undo-cold-total",
+    .title            = NC_("dashboard-variable", "Cold undo"),
+    .description      = N_("Total size of compressed undo steps"),
+    .type             = VARIABLE_TYPE_SIZE,
+    .sample_func      = gimp_dashboard_sample_function,
+    .data             = gimp_drawable_undo_get_total_compressed_size
+  },
+
+  [VARIABLE_UNDO_COLD_COMPRESSION] =
+  { .name             = "undo-cold-compression",
+    .title            = NC_("dashboard-variable", "Undo compression"),
+    .description      = N_("Compression ratio of cold undo steps"),
+    .type             = VARIABLE_TYPE_SIZE_RATIO,
+    .sample_func      = gimp_dashboard_sample_undo_cold_compression
   }
 };
 
@@ -915,12 +981,30 @@ static const GroupInfo groups[] =
                           { .variable       = VARIABLE_ASYNC_RUNNING,
                             .default_active = TRUE
                           },
+                          { .variable       = VARIABLE_ASYNC_QUEUED,
+                            .default_active = TRUE
+                          },
+                          { .variable       = VARIABLE_ASYNC_STOLEN,
+                            .default_active = FALSE
+                          },
                           { .variable       = VARIABLE_SCRATCH_TOTAL,
                             .default_active = TRUE
                           },
                           { .variable       = VARIABLE_TEMP_BUF_TOTAL,
                             .default_active = TRUE
                           },
+                          { .variable       = VARIABLE_BRUSH_CACHE_TOTAL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_BRUSH_CACHE_HIT_MISS,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_UNDO_COLD_TOTAL,
+                            .default_active = FALSE
+                          },
+                          { .variable       = VARIABLE_UNDO_COLD_COMPRESSION,
+                            .default_active = FALSE
+                          },
 
                           {}
                         }
@@ -1959,6 +2043,7 @@ gimp_dashboard_sample_function (GimpDashboard *dashboard,
 
     case VARIABLE_TYPE_INTEGER:
       variable_data->value.integer = CALL_FUNC (gint);
+      break;
 
     case VARIABLE_TYPE_SIZE:
       variable_data->value.size = CALL_FUNC (guint64);
@@ -2544,6 +2629,34 @@ gimp_dashboard_sample_memory_size (GimpDashboard *dashboard,
 
 #endif /* HAVE_MEMORY_GROUP */
 
+static void
+gimp_dashboard_sample_brush_cache_hit_miss (GimpDashboard *dashboard,
+                                            Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+
+  variable_data->value.int_ratio.antecedent = gimp_brush_cache_get_n_hits ();
+  variable_data->value.int_ratio.consequent = gimp_brush_cache_get_n_misses ();
+
+  variable_data->available = TRUE;
+}
+
+static void
+gimp_dashboard_sample_undo_cold_compression (GimpDashboard *dashboard,
+                                             Variable       variable)
+{
+  GimpDashboardPrivate *priv          = dashboard->priv;
+  VariableData         *variable_data = &priv->variables[variable];
+
+  variable_data->value.size_ratio.antecedent =
+    gimp_drawable_undo_get_total_compressed_size ();
+  variable_data->value.size_ratio.consequent =
+    gimp_drawable_undo_get_total_uncompressed_size ();
+
+  variable_data->available = TRUE;
+}
+
 static void
 gimp_dashboard_sample_object (GimpDashboard *dashboard,
                               GObject       *object,
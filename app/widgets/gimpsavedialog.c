@@ -61,6 +61,8 @@ static void     gimp_save_dialog_add_extra_widgets (GimpSaveDialog      *dialog)
 static void     gimp_save_dialog_compression_toggled
                                                    (GtkToggleButton     *button,
                                                     GimpSaveDialog      *dialog);
+static void     gimp_save_dialog_zstd_toggled      (GtkToggleButton     *button,
+                                                    GimpSaveDialog      *dialog);
 
 static GimpSaveDialogState
               * gimp_save_dialog_get_state         (GimpSaveDialog      *dialog);
@@ -256,22 +258,26 @@ gimp_save_dialog_set_image (GimpSaveDialog *dialog,
                               NULL, NULL);
   if (rle_version != zlib_version)
     {
-      GtkWidget *label;
-      gchar     *text;
+      gchar *text;
 
       text = g_strdup_printf (_("Keep compression disabled to make the XCF "
                                 "file readable by %s and later."),
                               version_string);
-      label = gtk_label_new (text);
-      gtk_label_set_xalign (GTK_LABEL (label), 0.0);
-      gimp_label_set_attributes (GTK_LABEL (label),
-                                 PANGO_ATTR_STYLE, PANGO_STYLE_ITALIC,
-                                 -1);
-      gtk_container_add (GTK_CONTAINER (dialog->compression_frame),
-                         label);
-      gtk_widget_show (label);
+      gtk_label_set_text (GTK_LABEL (dialog->compression_label), text);
+      gtk_widget_show (dialog->compression_label);
       g_free (text);
     }
+  else
+    {
+      gtk_widget_hide (dialog->compression_label);
+    }
+
+  /*  zstd compression is a choice made for each save, it isn't
+   *  remembered by the dialog, only by the image itself
+   */
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->zstd_toggle),
+                                gimp_image_get_xcf_zstd_compression (image));
+  dialog->zstd_compression = gimp_image_get_xcf_zstd_compression (image);
 
   compression_toggle = gtk_frame_get_label_widget (GTK_FRAME (dialog->compression_frame));
   gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (compression_toggle),
@@ -320,6 +326,7 @@ gimp_save_dialog_add_extra_widgets (GimpSaveDialog *dialog)
   GtkWidget *label;
   GtkWidget *reasons;
   GtkWidget *compression_toggle;
+  GtkWidget *vbox;
 
   /* Compression toggle. */
   compression_toggle =
@@ -335,6 +342,31 @@ gimp_save_dialog_add_extra_widgets (GimpSaveDialog *dialog)
                                      FALSE, FALSE, 0);
   gtk_widget_show (dialog->compression_frame);
 
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+  gtk_container_add (GTK_CONTAINER (dialog->compression_frame), vbox);
+  gtk_widget_show (vbox);
+
+  dialog->compression_label = gtk_label_new (NULL);
+  gtk_label_set_xalign (GTK_LABEL (dialog->compression_label), 0.0);
+  gimp_label_set_attributes (GTK_LABEL (dialog->compression_label),
+                             PANGO_ATTR_STYLE, PANGO_STYLE_ITALIC,
+                             -1);
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->compression_label,
+                      FALSE, FALSE, 0);
+
+  /* zstd compression toggle. */
+  dialog->zstd_toggle =
+    gtk_check_button_new_with_label (_("Use zstd compression (not readable by "
+                                       "older GIMP versions)"));
+  gtk_widget_set_tooltip_text (dialog->zstd_toggle,
+                               _("zstd compression is usually faster and "
+                                 "smaller than the default compression, but "
+                                 "older versions of GIMP can't open the "
+                                 "file.  The compression level can be set "
+                                 "in the preferences."));
+  gtk_box_pack_start (GTK_BOX (vbox), dialog->zstd_toggle, FALSE, FALSE, 0);
+  gtk_widget_show (dialog->zstd_toggle);
+
   /* Additional information explaining file compatibility things */
   dialog->compat_info = gtk_expander_new (NULL);
   label = gtk_label_new ("");
@@ -356,6 +388,9 @@ gimp_save_dialog_add_extra_widgets (GimpSaveDialog *dialog)
   g_signal_connect (compression_toggle, "toggled",
                     G_CALLBACK (gimp_save_dialog_compression_toggled),
                     dialog);
+  g_signal_connect (dialog->zstd_toggle, "toggled",
+                    G_CALLBACK (gimp_save_dialog_zstd_toggled),
+                    dialog);
 }
 
 static void
@@ -375,6 +410,8 @@ gimp_save_dialog_compression_toggled (GtkToggleButton *button,
 
   dialog->compression = gtk_toggle_button_get_active (button);
 
+  gtk_widget_set_sensitive (dialog->zstd_toggle, dialog->compression);
+
   if (dialog->compression)
     gimp_image_get_xcf_version (file_dialog->image, TRUE,  &version,
                                 &version_string, &reason);
@@ -394,10 +431,22 @@ gimp_save_dialog_compression_toggled (GtkToggleButton *button,
     gtk_widget_show (dialog->compat_info);
 
   /* Set the compatibility label. */
-  compat_hint =
-    g_strdup_printf (_("The image uses features from %s and "
-                       "won't be readable by older GIMP versions."),
-                     version_string);
+  if (dialog->compression && dialog->zstd_compression)
+    {
+      /* zstd compression isn't tied to a file version */
+      compat_hint =
+        g_strdup_printf (_("The image uses features from %s, and zstd "
+                           "compression, which older GIMP versions "
+                           "can't read."),
+                         version_string);
+    }
+  else
+    {
+      compat_hint =
+        g_strdup_printf (_("The image uses features from %s and "
+                           "won't be readable by older GIMP versions."),
+                         version_string);
+    }
 
   if (gimp_image_get_metadata (file_dialog->image))
     {
@@ -422,6 +471,22 @@ gimp_save_dialog_compression_toggled (GtkToggleButton *button,
     g_free (reason);
 }
 
+static void
+gimp_save_dialog_zstd_toggled (GtkToggleButton *button,
+                               GimpSaveDialog  *dialog)
+{
+  GtkWidget *compression_toggle;
+
+  dialog->zstd_compression = gtk_toggle_button_get_active (button);
+
+  /* update the compatibility information */
+  compression_toggle =
+    gtk_frame_get_label_widget (GTK_FRAME (dialog->compression_frame));
+
+  gimp_save_dialog_compression_toggled (GTK_TOGGLE_BUTTON (compression_toggle),
+                                        dialog);
+}
+
 static GimpSaveDialogState *
 gimp_save_dialog_get_state (GimpSaveDialog *dialog)
 {
@@ -19,6 +19,7 @@
 
 #include <string.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include <cairo.h>
 #include <gegl.h>
@@ -73,6 +74,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-seek.h"
+#include "xcf-tile-backend.h"
 #include "xcf-utils.h"
 
 #include "gimp-log.h"
@@ -81,6 +83,43 @@
 
 #define MAX_XCF_PARASITE_DATA_LEN (256L * 1024 * 1024)
 
+/* number of tiles read and decoded together by xcf_load_level() */
+#define XCF_LOAD_BATCH_SIZE        256
+/* number of batches in flight between the reader thread and the
+ * decoding threads
+ */
+#define XCF_LOAD_N_BATCHES         2
+#define XCF_LOAD_TILES_PER_THREAD \
+  (/* each thread costs as much as */ 0.5 /* tiles */)
+
+
+typedef struct
+{
+  gint     first_tile;
+  gint     n_tiles;
+  goffset  offset;    /* file offset of the first tile's data */
+  guchar  *data;      /* the data of all the batch tiles      */
+  gsize    data_size; /* number of bytes actually read        */
+} XcfLoadLevelBatch;
+
+typedef struct
+{
+  XcfInfo           *info;
+  GeglBuffer        *buffer;
+  const Babl        *format;
+  gint               max_data_length;
+  goffset           *offset_table;
+  gint               ntiles;
+  gint               batch_size;
+
+  XcfLoadLevelBatch *batch;
+
+  GAsyncQueue       *full_queue;
+  GAsyncQueue       *free_queue;
+
+  gint               failed;
+} XcfLoadLevelData;
+
 /* #define GIMP_XCF_PATH_DEBUG */
 
 
@@ -110,23 +149,61 @@ static GimpChannel   * xcf_load_channel       (XcfInfo       *info,
 static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
                                                GimpImage     *image);
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
+                                               GimpDrawable  *drawable);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
-static gboolean        xcf_load_tile          (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format);
-static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
-static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
+                                               GimpDrawable  *drawable);
+static gboolean        xcf_load_level_lazy    (XcfInfo       *info,
+                                               GimpDrawable  *drawable,
+                                               const goffset *offset_table,
+                                               gint           max_data_length);
+static goffset         xcf_load_level_get_tile_end
+                                              (XcfLoadLevelData  *data,
+                                               gint               tile);
+static XcfLoadLevelBatch *
+                       xcf_load_level_batch_new
+                                              (gint               n_tiles,
+                                               gint               max_data_length);
+static void            xcf_load_level_batch_free
+                                              (XcfLoadLevelBatch *batch);
+static void            xcf_load_level_read_batch
+                                              (XcfLoadLevelData  *data,
+                                               XcfLoadLevelBatch *batch,
+                                               gint               first_tile,
+                                               gint               n_tiles);
+static gpointer        xcf_load_level_reader_thread_func
+                                              (XcfLoadLevelData  *data);
+static void            xcf_load_level_decode_tiles
+                                              (gsize              offset,
+                                               gsize              size,
+                                               XcfLoadLevelData  *data);
+static gboolean        xcf_load_tile          (XcfInfo             *info,
+                                               const GeglRectangle *tile_rect,
+                                               const Babl          *format,
+                                               const guchar        *xcfdata,
+                                               gint                 data_length,
+                                               guchar              *tile_data,
+                                               gboolean            *empty);
+static gboolean        xcf_load_tile_rle      (XcfInfo             *info,
+                                               const GeglRectangle *tile_rect,
+                                               const Babl          *format,
+                                               const guchar        *xcfdata,
+                                               gint                 data_length,
+                                               guchar              *tile_data,
+                                               gboolean            *empty);
+static gboolean        xcf_load_tile_zlib     (XcfInfo             *info,
+                                               const GeglRectangle *tile_rect,
+                                               const Babl          *format,
+                                               const guchar        *xcfdata,
+                                               gint                 data_length,
+                                               guchar              *tile_data,
+                                               gboolean            *empty);
+static gboolean        xcf_load_tile_zstd     (XcfInfo             *info,
+                                               const GeglRectangle *tile_rect,
+                                               const Babl          *format,
+                                               const guchar        *xcfdata,
+                                               gint                 data_length,
+                                               guchar              *tile_data,
+                                               gboolean            *empty);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -736,7 +813,8 @@ xcf_load_image_props (XcfInfo   *info,
             if ((compression != COMPRESS_NONE) &&
                 (compression != COMPRESS_RLE) &&
                 (compression != COMPRESS_ZLIB) &&
-                (compression != COMPRESS_FRACTAL))
+                (compression != COMPRESS_FRACTAL) &&
+                (compression != COMPRESS_ZSTD))
               {
                 gimp_message (info->gimp, G_OBJECT (info->progress),
                               GIMP_MESSAGE_ERROR,
@@ -749,6 +827,8 @@ xcf_load_image_props (XcfInfo   *info,
 
             gimp_image_set_xcf_compression (image,
                                             compression >= COMPRESS_ZLIB);
+            gimp_image_set_xcf_zstd_compression (image,
+                                                 compression == COMPRESS_ZSTD);
 
             GIMP_LOG (XCF, "prop compression=%d", compression);
           }
@@ -1777,8 +1857,7 @@ xcf_load_layer (XcfInfo    *info,
 
       GIMP_LOG (XCF, "loading buffer");
 
-      if (! xcf_load_buffer (info,
-                             gimp_drawable_get_buffer (GIMP_DRAWABLE (layer))))
+      if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer)))
         goto error;
 
       GIMP_LOG (XCF, "buffer loaded");
@@ -1874,8 +1953,7 @@ xcf_load_channel (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (channel))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (channel)))
     goto error;
 
   xcf_progress_update (info);
@@ -1939,8 +2017,7 @@ xcf_load_layer_mask (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer_mask)))
     goto error;
 
   xcf_progress_update (info);
@@ -1957,9 +2034,10 @@ xcf_load_layer_mask (XcfInfo   *info,
 }
 
 static gboolean
-xcf_load_buffer (XcfInfo    *info,
-                 GeglBuffer *buffer)
+xcf_load_buffer (XcfInfo      *info,
+                 GimpDrawable *drawable)
 {
+  GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
   const Babl *format;
   goffset     offset;
   gint        width;
@@ -1987,7 +2065,7 @@ xcf_load_buffer (XcfInfo    *info,
     return FALSE;
 
   /* read in the level */
-  if (! xcf_load_level (info, buffer))
+  if (! xcf_load_level (info, drawable))
     return FALSE;
 
   /* discard levels below first.
@@ -1998,22 +2076,25 @@ xcf_load_buffer (XcfInfo    *info,
 
 
 static gboolean
-xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+xcf_load_level (XcfInfo      *info,
+                GimpDrawable *drawable)
 {
-  const Babl *format;
-  gint        bpp;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     offset2;
-  goffset     max_data_length;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        width;
-  gint        height;
-  gint        i;
-  gint        fail;
+  GeglBuffer        *buffer = gimp_drawable_get_buffer (drawable);
+  const Babl        *format;
+  XcfLoadLevelData   data;
+  XcfLoadLevelBatch *batches[XCF_LOAD_N_BATCHES];
+  GThread           *reader_thread = NULL;
+  goffset           *offset_table;
+  goffset            saved_pos;
+  goffset            offset;
+  gint               bpp;
+  gint               n_tile_rows;
+  gint               n_tile_cols;
+  gint               ntiles;
+  gint               batch_size;
+  gint               width;
+  gint               height;
+  gint               i;
 
   format = gegl_buffer_get_format (buffer);
   bpp    = babl_format_get_bytes_per_pixel (format);
@@ -2025,13 +2106,6 @@ xcf_load_level (XcfInfo    *info,
       height != gegl_buffer_get_height (buffer))
     return FALSE;
 
-  /* maximal allowable size of on-disk tile data.  make it somewhat bigger than
-   * the uncompressed tile size, to allow for the possibility of negative
-   * compression.
-   */
-  max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
-                    XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
-
   /* read in the first tile offset.
    *  if it is '0', then this tile level is empty
    *  and we can simply return.
@@ -2044,158 +2118,492 @@ xcf_load_level (XcfInfo    *info,
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
+
+  /* read in the entire offset table up front, so that the tile data can
+   * be read in large contiguous batches.  the table has ntiles + 1
+   * slots, the last of which must be '0'.
+   */
+  offset_table = g_new0 (goffset, ntiles + 1);
+
+  offset_table[0] = offset;
+  xcf_read_offset (info, offset_table + 1, ntiles);
+
+  /* 'saved_pos' is the end of the offset table */
+  saved_pos = info->cp;
+
+  data.info         = info;
+  data.buffer       = buffer;
+  data.format       = format;
+  data.offset_table = offset_table;
+  data.ntiles       = ntiles;
+  data.full_queue   = NULL;
+  data.free_queue   = NULL;
+  data.failed       = FALSE;
+
+  /* maximal allowable size of on-disk tile data.  make it somewhat bigger than
+   * the uncompressed tile size, to allow for the possibility of negative
+   * compression.
+   */
+  data.max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
+                         XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
+
   for (i = 0; i < ntiles; i++)
     {
-      GeglRectangle rect;
-
-      fail = FALSE;
+      goffset offset2;
 
-      if (offset == 0)
+      if (offset_table[i] == 0)
         {
           gimp_message_literal (info->gimp, G_OBJECT (info->progress),
                                 GIMP_MESSAGE_ERROR,
                                 "not enough tiles found in level");
+          g_free (offset_table);
           return FALSE;
         }
 
-      /* save the current position as it is where the
-       *  next tile offset is stored.
-       */
-      saved_pos = info->cp;
-
-      /* read in the offset of the next tile so we can calculate the amount
-       * of data needed for this tile
-       */
-      xcf_read_offset (info, &offset2, 1);
+      offset2 = xcf_load_level_get_tile_end (&data, i);
 
-      /* if the offset is 0 then we need to read in the maximum possible
-       * allowing for negative compression
-       */
-      if (offset2 == 0)
-        offset2 = offset + max_data_length;
-
-      /* seek to the tile offset */
-      if (! xcf_seek_pos (info, offset, NULL))
-        return FALSE;
-
-      if (offset2 < offset || offset2 - offset > max_data_length)
+      if (offset2 < offset_table[i] ||
+          offset2 - offset_table[i] > data.max_data_length)
         {
           gimp_message (info->gimp, G_OBJECT (info->progress),
                         GIMP_MESSAGE_ERROR,
                         "invalid tile data length: %" G_GOFFSET_FORMAT,
-                        offset2 - offset);
+                        offset2 - offset_table[i]);
+          g_free (offset_table);
           return FALSE;
         }
+    }
 
-      /* get buffer rectangle to write to */
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+  if (offset_table[ntiles] != 0)
+    {
+      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
+                    "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
+                    offset_table[ntiles]);
+      g_free (offset_table);
+      return FALSE;
+    }
+
+  if (info->lazy_load &&
+      xcf_load_level_lazy (info, drawable, offset_table, data.max_data_length))
+    {
+      g_free (offset_table);
+
+      /* restore the position after the offset table */
+      return xcf_seek_pos (info, saved_pos, NULL);
+    }
 
-      GIMP_LOG (XCF, "loading tile %d/%d", i + 1, ntiles);
+  /* the tile data is read in batches of consecutive tiles, each with a
+   * single read, and the tiles of each batch are then decoded in parallel.
+   * when there's more than a single batch, the reading is done by a
+   * separate thread, so that the next batch is prefetched while the
+   * previous one is being decoded.
+   */
+  batch_size = MIN (ntiles, XCF_LOAD_BATCH_SIZE);
+
+  data.batch_size = batch_size;
+
+  for (i = 0; i < XCF_LOAD_N_BATCHES; i++)
+    batches[i] = NULL;
+
+  if (ntiles > batch_size)
+    {
+      data.full_queue = g_async_queue_new ();
+      data.free_queue = g_async_queue_new ();
 
-      /* read in the tile */
-      switch (info->compression)
+      for (i = 0; i < XCF_LOAD_N_BATCHES; i++)
         {
-        case COMPRESS_NONE:
-          if (! xcf_load_tile (info, buffer, &rect, format))
-            fail = TRUE;
-          break;
-        case COMPRESS_RLE:
-          if (! xcf_load_tile_rle (info, buffer, &rect, format,
-                                   offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_ZLIB:
-          if (! xcf_load_tile_zlib (info, buffer, &rect, format,
-                                    offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_FRACTAL:
-          g_printerr ("xcf: fractal compression unimplemented. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
-        default:
-          g_printerr ("xcf: unknown compression. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
+          batches[i] = xcf_load_level_batch_new (batch_size,
+                                                 data.max_data_length);
+
+          g_async_queue_push (data.free_queue, batches[i]);
         }
 
-      if (fail)
-        return FALSE;
+      reader_thread = g_thread_new (
+        "xcf-reader",
+        (GThreadFunc) xcf_load_level_reader_thread_func,
+        &data);
+    }
+  else
+    {
+      batches[0] = xcf_load_level_batch_new (batch_size,
+                                             data.max_data_length);
+    }
 
-      GIMP_LOG (XCF, "loaded tile %d/%d", i + 1, ntiles);
+  for (i = 0; i < ntiles; i += batch_size)
+    {
+      XcfLoadLevelBatch *batch;
 
-      /* restore the saved position so we'll be ready to
-       *  read the next offset.
-       */
-      if (!xcf_seek_pos (info, saved_pos, NULL))
-        return FALSE;
+      if (reader_thread)
+        {
+          batch = g_async_queue_pop (data.full_queue);
+        }
+      else
+        {
+          batch = batches[0];
 
-      /* read in the offset of the next tile */
-      xcf_read_offset (info, &offset, 1);
+          xcf_load_level_read_batch (&data, batch, i, MIN (batch_size,
+                                                           ntiles - i));
+        }
+
+      if (! g_atomic_int_get (&data.failed))
+        {
+          GIMP_LOG (XCF, "loading tiles %d-%d/%d",
+                    batch->first_tile + 1,
+                    batch->first_tile + batch->n_tiles, ntiles);
+
+          data.batch = batch;
+
+          gegl_parallel_distribute_range (
+            batch->n_tiles, XCF_LOAD_TILES_PER_THREAD,
+            (GeglParallelDistributeRangeFunc) xcf_load_level_decode_tiles,
+            &data);
+        }
+
+      if (reader_thread)
+        g_async_queue_push (data.free_queue, batch);
     }
 
-  if (offset != 0)
+  if (reader_thread)
     {
-      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
-                    "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
-                    offset);
-      return FALSE;
+      g_thread_join (reader_thread);
+
+      g_async_queue_unref (data.full_queue);
+      g_async_queue_unref (data.free_queue);
+    }
+
+  for (i = 0; i < XCF_LOAD_N_BATCHES; i++)
+    {
+      if (batches[i])
+        xcf_load_level_batch_free (batches[i]);
     }
 
+  g_free (offset_table);
+
+  if (data.failed)
+    return FALSE;
+
+  /* restore the position after the offset table */
+  if (! xcf_seek_pos (info, saved_pos, NULL))
+    return FALSE;
+
   return TRUE;
 }
 
+/* replaces the drawable's buffer with a buffer whose tiles are read from
+ * the file only when first accessed.  returns FALSE if the file can't be
+ * read on demand, in which case the level is loaded normally.
+ */
 static gboolean
-xcf_load_tile (XcfInfo       *info,
-               GeglBuffer    *buffer,
-               GeglRectangle *tile_rect,
-               const Babl    *format)
+xcf_load_level_lazy (XcfInfo       *info,
+                     GimpDrawable  *drawable,
+                     const goffset *offset_table,
+                     gint           max_data_length)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
+  GeglBuffer      *buffer = gimp_drawable_get_buffer (drawable);
+  GeglTileBackend *backend;
+  GeglBuffer      *lazy_buffer;
 
-  if (info->file_version <= 11)
+  if (! info->tile_file)
     {
-      xcf_read_int8 (info, tile_data, tile_size);
+      GError *error = NULL;
+
+      info->tile_file = xcf_tile_file_new (info->file, info, &error);
+
+      if (! info->tile_file)
+        {
+          GIMP_LOG (XCF, "on-demand loading disabled: %s", error->message);
+          g_clear_error (&error);
+
+          info->lazy_load = FALSE;
+
+          return FALSE;
+        }
     }
-  else
+
+  backend = xcf_tile_backend_new (info->tile_file,
+                                  gegl_buffer_get_format (buffer),
+                                  gegl_buffer_get_width  (buffer),
+                                  gegl_buffer_get_height (buffer),
+                                  offset_table, max_data_length);
+
+  lazy_buffer = gegl_buffer_new_for_backend (
+    GEGL_RECTANGLE (0, 0,
+                    gegl_buffer_get_width  (buffer),
+                    gegl_buffer_get_height (buffer)),
+    backend);
+  g_object_unref (backend);
+
+  GIMP_LOG (XCF, "level will be loaded on demand");
+
+  gimp_drawable_set_buffer (drawable, FALSE, NULL, lazy_buffer);
+  g_object_unref (lazy_buffer);
+
+  return TRUE;
+}
+
+static goffset
+xcf_load_level_get_tile_end (XcfLoadLevelData *data,
+                             gint              tile)
+{
+  goffset offset2 = data->offset_table[tile + 1];
+
+  /* if the offset is 0 then we need to read in the maximum possible
+   * allowing for negative compression
+   */
+  if (offset2 == 0)
+    offset2 = data->offset_table[tile] + data->max_data_length;
+
+  return offset2;
+}
+
+static XcfLoadLevelBatch *
+xcf_load_level_batch_new (gint n_tiles,
+                          gint max_data_length)
+{
+  XcfLoadLevelBatch *batch = g_slice_new0 (XcfLoadLevelBatch);
+
+  /* the data of consecutive tiles is contiguous, and each tile's data is
+   * at most max_data_length bytes long.
+   */
+  batch->data = g_malloc ((gsize) n_tiles * max_data_length);
+
+  return batch;
+}
+
+static void
+xcf_load_level_batch_free (XcfLoadLevelBatch *batch)
+{
+  g_free (batch->data);
+
+  g_slice_free (XcfLoadLevelBatch, batch);
+}
+
+static void
+xcf_load_level_read_batch (XcfLoadLevelData  *data,
+                           XcfLoadLevelBatch *batch,
+                           gint               first_tile,
+                           gint               n_tiles)
+{
+  XcfInfo *info = data->info;
+  goffset  end;
+  gsize    bytes_read = 0;
+
+  batch->first_tile = first_tile;
+  batch->n_tiles    = n_tiles;
+  batch->offset     = data->offset_table[first_tile];
+  batch->data_size  = 0;
+
+  if (g_atomic_int_get (&data->failed))
+    return;
+
+  end = xcf_load_level_get_tile_end (data, first_tile + n_tiles - 1);
+
+  /* seek to the first tile offset */
+  if (! xcf_seek_pos (info, batch->offset, NULL))
     {
-      gint n_components = babl_format_get_n_components (format);
+      g_atomic_int_set (&data->failed, TRUE);
+      return;
+    }
 
-      xcf_read_component (info, bpp / n_components, tile_data,
-                          tile_size / bpp * n_components);
+  /* we have to read directly instead of xcf_read_* because we may be
+   * reading past the end of the file here
+   */
+  if (end > batch->offset)
+    {
+      g_input_stream_read_all (info->input, batch->data, end - batch->offset,
+                               &bytes_read, NULL, NULL);
+      info->cp += bytes_read;
     }
 
-  if (! xcf_data_is_zero (tile_data, tile_size))
+  batch->data_size = bytes_read;
+}
+
+static gpointer
+xcf_load_level_reader_thread_func (XcfLoadLevelData *data)
+{
+  gint first_tile = 0;
+
+  while (first_tile < data->ntiles)
+    {
+      XcfLoadLevelBatch *batch = g_async_queue_pop (data->free_queue);
+
+      xcf_load_level_read_batch (data, batch, first_tile,
+                                 MIN (data->batch_size,
+                                      data->ntiles - first_tile));
+
+      g_async_queue_push (data->full_queue, batch);
+
+      first_tile += data->batch_size;
+    }
+
+  return NULL;
+}
+
+static void
+xcf_load_level_decode_tiles (gsize             offset,
+                             gsize             size,
+                             XcfLoadLevelData *data)
+{
+  XcfLoadLevelBatch *batch     = data->batch;
+  XcfInfo           *info      = data->info;
+  gint               bpp       = babl_format_get_bytes_per_pixel (data->format);
+  guchar            *tile_data = g_alloca (XCF_TILE_WIDTH * XCF_TILE_HEIGHT *
+                                           bpp);
+  gsize              i;
+
+  for (i = offset; i < offset + size; i++)
     {
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+      GeglRectangle  rect;
+      gint           tile        = batch->first_tile + i;
+      goffset        start       = data->offset_table[tile] - batch->offset;
+      goffset        data_length;
+      const guchar  *tile_xcfdata;
+      gboolean       empty;
+
+      if (g_atomic_int_get (&data->failed))
+        break;
+
+      data_length = xcf_load_level_get_tile_end (data, tile) -
+                    data->offset_table[tile];
+
+      /* the last tiles may be cut short by the end of the file */
+      data_length = CLAMP ((goffset) batch->data_size - start, 0, data_length);
+
+      tile_xcfdata = batch->data + start;
+
+      /* get buffer rectangle to write to */
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      tile, &rect);
+
+      /* decode the tile */
+      if (! xcf_load_tile_decode (info, &rect, data->format,
+                                  tile_xcfdata, data_length, tile_data,
+                                  &empty))
+        {
+          g_atomic_int_set (&data->failed, TRUE);
+        }
+      else if (! empty)
+        {
+          gegl_buffer_set (data->buffer, &rect, 0, data->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
     }
+}
+
+/**
+ * xcf_load_tile_decode:
+ * @info:        the #XcfInfo of the file the tile belongs to.
+ * @tile_rect:   the tile rectangle.
+ * @format:      the pixel format of the tile.
+ * @xcfdata:     the on-disk tile data.
+ * @data_length: the length of @xcfdata.
+ * @tile_data:   a buffer receiving the decoded tile pixels.
+ * @empty:       returns whether the tile is empty.
+ *
+ * Decodes a single level tile, according to the compression type and
+ * file version of @info, which is not modified, so this function may be
+ * called concurrently from multiple threads.  When @empty is set to
+ * %TRUE, the tile is all zeros, and @tile_data is left undefined.
+ *
+ * Returns: %TRUE on success, %FALSE if the tile data is invalid.
+ **/
+gboolean
+xcf_load_tile_decode (XcfInfo             *info,
+                      const GeglRectangle *tile_rect,
+                      const Babl          *format,
+                      const guchar        *xcfdata,
+                      gint                 data_length,
+                      guchar              *tile_data,
+                      gboolean            *empty)
+{
+  switch (info->compression)
+    {
+    case COMPRESS_NONE:
+      return xcf_load_tile (info, tile_rect, format,
+                            xcfdata, data_length, tile_data, empty);
+
+    case COMPRESS_RLE:
+      return xcf_load_tile_rle (info, tile_rect, format,
+                                xcfdata, data_length, tile_data, empty);
+
+    case COMPRESS_ZLIB:
+      return xcf_load_tile_zlib (info, tile_rect, format,
+                                 xcfdata, data_length, tile_data, empty);
+
+    case COMPRESS_ZSTD:
+      return xcf_load_tile_zstd (info, tile_rect, format,
+                                 xcfdata, data_length, tile_data, empty);
+
+    case COMPRESS_FRACTAL:
+      g_printerr ("xcf: fractal compression unimplemented. "
+                  "Possibly corrupt XCF file.");
+      break;
+
+    default:
+      g_printerr ("xcf: unknown compression. "
+                  "Possibly corrupt XCF file.");
+      break;
+    }
+
+  return FALSE;
+}
+
+/* the tile decoders below decode 'data_length' bytes of on-disk tile data
+ * from 'xcfdata' into the 'tile_data' buffer, and set 'empty' if the
+ * tile is all zeros.  they are called concurrently from multiple
+ * threads, and therefore must not modify 'info'.
+ */
+
+static gboolean
+xcf_load_tile (XcfInfo             *info,
+               const GeglRectangle *tile_rect,
+               const Babl          *format,
+               const guchar        *xcfdata,
+               gint                 data_length,
+               guchar              *tile_data,
+               gboolean            *empty)
+{
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
+
+  *empty = TRUE;
+
+  data_length = MIN (data_length, tile_size);
+
+  memcpy (tile_data, xcfdata, data_length);
+  memset (tile_data + data_length, 0, tile_size - data_length);
+
+  if (info->file_version >= 12)
+    {
+      gint n_components = babl_format_get_n_components (format);
+
+      xcf_read_from_be (bpp / n_components, tile_data,
+                        tile_size / bpp * n_components);
+    }
+
+  *empty = xcf_data_is_zero (tile_data, tile_size);
 
   return TRUE;
 }
 
 static gboolean
-xcf_load_tile_rle (XcfInfo       *info,
-                   GeglBuffer    *buffer,
-                   GeglRectangle *tile_rect,
-                   const Babl    *format,
-                   gint           data_length)
+xcf_load_tile_rle (XcfInfo             *info,
+                   const GeglRectangle *tile_rect,
+                   const Babl          *format,
+                   const guchar        *xcfodata,
+                   gint                 data_length,
+                   guchar              *tile_data,
+                   gboolean            *empty)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  guchar  nonzero   = FALSE;
-  gsize   bytes_read;
-  gint    i;
-  guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
+  gint          bpp       = babl_format_get_bytes_per_pixel (format);
+  gint          tile_size = bpp * tile_rect->width * tile_rect->height;
+  guchar        nonzero   = FALSE;
+  gint          i;
+  const guchar *xcfdata;
+  const guchar *xcfdatalimit;
+
+  *empty = TRUE;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
    * this tile (return TRUE without storing data) as if it did not
@@ -2206,19 +2614,8 @@ xcf_load_tile_rle (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = xcfodata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
-
-  xcfdatalimit = &xcfodata[bytes_read - 1];
+  xcfdata      = xcfodata;
+  xcfdatalimit = &xcfodata[data_length - 1];
 
   for (i = 0; i < bpp; i++)
     {
@@ -2322,8 +2719,7 @@ xcf_load_tile_rle (XcfInfo       *info,
                             tile_size / bpp * n_components);
         }
 
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+      *empty = FALSE;
     }
 
   return TRUE;
@@ -2333,20 +2729,21 @@ xcf_load_tile_rle (XcfInfo       *info,
 }
 
 static gboolean
-xcf_load_tile_zlib (XcfInfo       *info,
-                    GeglBuffer    *buffer,
-                    GeglRectangle *tile_rect,
-                    const Babl    *format,
-                    gint           data_length)
+xcf_load_tile_zlib (XcfInfo             *info,
+                    const GeglRectangle *tile_rect,
+                    const Babl          *format,
+                    const guchar        *xcfdata,
+                    gint                 data_length,
+                    guchar              *tile_data,
+                    gboolean            *empty)
 {
   z_stream  strm;
   int       action;
   int       status;
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
   gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  gsize     bytes_read;
-  guchar   *xcfdata;
+
+  *empty = TRUE;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
    * this tile (return TRUE without storing data) as if it did not
@@ -2357,26 +2754,14 @@ xcf_load_tile_zlib (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
-
   strm.next_out  = tile_data;
   strm.avail_out = tile_size;
 
   strm.zalloc    = Z_NULL;
   strm.zfree     = Z_NULL;
   strm.opaque    = Z_NULL;
-  strm.next_in   = xcfdata;
-  strm.avail_in  = bytes_read;
+  strm.next_in   = (guchar *) xcfdata;
+  strm.avail_in  = data_length;
 
   /* Initialize the stream decompression. */
   status = inflateInit (&strm);
@@ -2423,8 +2808,7 @@ xcf_load_tile_zlib (XcfInfo       *info,
                             tile_size / bpp * n_components);
         }
 
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+      *empty = FALSE;
     }
 
   inflateEnd (&strm);
@@ -2432,6 +2816,90 @@ xcf_load_tile_zlib (XcfInfo       *info,
   return TRUE;
 }
 
+static gboolean
+xcf_load_tile_zstd (XcfInfo             *info,
+                    const GeglRectangle *tile_rect,
+                    const Babl          *format,
+                    const guchar        *xcfdata,
+                    gint                 data_length,
+                    guchar              *tile_data,
+                    gboolean            *empty)
+{
+  static GPrivate  dctx_private = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeDCtx);
+  ZSTD_DCtx       *dctx;
+  gint             bpp          = babl_format_get_bytes_per_pixel (format);
+  gint             bpc          = bpp / babl_format_get_n_components (format);
+  gint             tile_size    = bpp * tile_rect->width * tile_rect->height;
+  guchar          *dest         = tile_data;
+  gsize            frame_length;
+  gsize            length;
+
+  *empty = TRUE;
+
+  /* see xcf_load_tile_zlib() */
+  if (data_length <= 0)
+    return TRUE;
+
+  /* the last tile of a level is read up to the maximal data length, and
+   * may therefore be followed by unrelated data
+   */
+  frame_length = ZSTD_findFrameCompressedSize (xcfdata, data_length);
+
+  if (ZSTD_isError (frame_length))
+    {
+      g_printerr ("xcf: tile decompression failed: %s\n",
+                  ZSTD_getErrorName (frame_length));
+      return FALSE;
+    }
+
+  /* high bit-depth data is stored in byte planes, see
+   * xcf_save_tile_zstd()
+   */
+  if (bpc > 1)
+    dest = g_alloca (tile_size);
+
+  dctx = g_private_get (&dctx_private);
+
+  if (! dctx)
+    {
+      dctx = ZSTD_createDCtx ();
+
+      if (! dctx)
+        return FALSE;
+
+      g_private_set (&dctx_private, dctx);
+    }
+
+  length = ZSTD_decompressDCtx (dctx,
+                                dest,    tile_size,
+                                xcfdata, frame_length);
+
+  if (ZSTD_isError (length))
+    {
+      g_printerr ("xcf: tile decompression failed: %s\n",
+                  ZSTD_getErrorName (length));
+      return FALSE;
+    }
+  else if (length != tile_size)
+    {
+      g_printerr ("xcf: decompressed tile size doesn't match the "
+                  "expected size.\n");
+      return FALSE;
+    }
+
+  if (! xcf_data_is_zero (dest, tile_size))
+    {
+      if (bpc > 1)
+        xcf_data_unshuffle (dest, tile_data, bpc, tile_size);
+
+      xcf_read_from_be (bpc, tile_data, tile_size / bpc);
+
+      *empty = FALSE;
+    }
+
+  return TRUE;
+}
+
 static GimpParasite *
 xcf_load_parasite (XcfInfo *info)
 {
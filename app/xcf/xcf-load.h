@@ -19,9 +19,17 @@
 #define __XCF_LOAD_H__
 
 
-GimpImage * xcf_load_image (Gimp     *gimp,
-                            XcfInfo  *info,
-                            GError  **error);
+GimpImage * xcf_load_image       (Gimp                *gimp,
+                                  XcfInfo             *info,
+                                  GError             **error);
+
+gboolean    xcf_load_tile_decode (XcfInfo             *info,
+                                  const GeglRectangle *tile_rect,
+                                  const Babl          *format,
+                                  const guchar        *xcfdata,
+                                  gint                 data_length,
+                                  guchar              *tile_data,
+                                  gboolean            *empty);
 
 
 #endif  /* __XCF_LOAD_H__ */
@@ -72,7 +72,8 @@ typedef enum
   COMPRESS_NONE              =  0,
   COMPRESS_RLE               =  1,
   COMPRESS_ZLIB              =  2,  /* unused */
-  COMPRESS_FRACTAL           =  3   /* unused */
+  COMPRESS_FRACTAL           =  3,  /* unused */
+  COMPRESS_ZSTD              =  4
 } XcfCompressionType;
 
 typedef enum
@@ -92,7 +93,8 @@ typedef enum
   XCF_GROUP_ITEM_EXPANDED      = 1
 } XcfGroupItemFlagsType;
 
-typedef struct _XcfInfo  XcfInfo;
+typedef struct _XcfInfo     XcfInfo;
+typedef struct _XcfTileFile XcfTileFile;
 
 struct _XcfInfo
 {
@@ -111,7 +113,10 @@ struct _XcfInfo
   GimpLayer          *floating_sel;
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
+  gint                compression_level;
   gint                file_version;
+  gboolean            lazy_load;
+  XcfTileFile        *tile_file;
 };
 
 
@@ -19,6 +19,7 @@
 
 #include <string.h>
 #include <zlib.h>
+#include <zstd.h>
 
 #include <cairo.h>
 #include <gegl.h>
@@ -68,11 +69,50 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 #include "xcf-seek.h"
+#include "xcf-utils.h"
 #include "xcf-write.h"
 
 #include "gimp-intl.h"
 
 
+/* number of tiles fetched and compressed together by xcf_save_level() */
+#define XCF_SAVE_BATCH_SIZE        256
+/* number of batches in flight between the compressing threads and the
+ * writer thread
+ */
+#define XCF_SAVE_N_BATCHES         2
+#define XCF_SAVE_TILES_PER_THREAD \
+  (/* each thread costs as much as */ 0.5 /* tiles */)
+
+
+typedef struct
+{
+  gint    first_tile;
+  gint    n_tiles;
+  guchar *data;        /* n_tiles slots of max_data_length bytes */
+  gint   *data_length; /* encoded length of each tile, or -1       */
+} XcfSaveLevelBatch;
+
+typedef struct
+{
+  XcfInfo           *info;
+  GeglBuffer        *buffer;
+  const Babl        *format;
+  gint               max_data_length;
+  goffset           *offset_table;
+
+  XcfSaveLevelBatch *batch;
+
+  GAsyncQueue       *full_queue;
+  GAsyncQueue       *free_queue;
+
+  gint               failed;
+  gint               bad_tile;
+  gint               bad_length;
+  GError            *error;
+} XcfSaveLevelData;
+
+
 static gboolean xcf_save_image_props   (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
@@ -103,22 +143,47 @@ static gboolean xcf_save_buffer        (XcfInfo           *info,
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
+static XcfSaveLevelBatch *
+                xcf_save_level_batch_new
+                                       (gint               n_tiles,
+                                        gint               max_data_length);
+static void     xcf_save_level_batch_free
+                                       (XcfSaveLevelBatch *batch);
+static void     xcf_save_level_encode_tiles
+                                       (gsize              offset,
+                                        gsize              size,
+                                        XcfSaveLevelData  *data);
+static void     xcf_save_level_write_batch
+                                       (XcfSaveLevelData  *data,
+                                        XcfSaveLevelBatch *batch);
+static gpointer xcf_save_level_writer_thread_func
+                                       (XcfSaveLevelData  *data);
+static gint     xcf_save_tile          (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
+                                        guchar            *tile_data,
+                                        guchar            *dest);
+static gint     xcf_save_tile_rle      (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
-                                        guchar            *rlebuf,
-                                        GError           **error);
-static gboolean xcf_save_tile_zlib     (XcfInfo           *info,
+                                        guchar            *tile_data,
+                                        guchar            *rlebuf);
+static gint     xcf_save_tile_zlib     (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
-                                        GError           **error);
+                                        guchar            *tile_data,
+                                        guchar            *dest,
+                                        gint               max_data_length);
+static gint     xcf_save_tile_zstd     (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *tile_data,
+                                        guchar            *dest,
+                                        gint               max_data_length);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
                                         GError           **error);
@@ -1581,21 +1646,23 @@ xcf_save_level (XcfInfo     *info,
                 GeglBuffer  *buffer,
                 GError     **error)
 {
-  const Babl *format;
-  goffset    *offset_table;
-  goffset    *next_offset;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     max_data_length;
-  guint32     width;
-  guint32     height;
-  gint        bpp;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        i;
-  guchar     *rlebuf    = NULL;
-  GError     *tmp_error = NULL;
+  const Babl        *format;
+  XcfSaveLevelData   data;
+  XcfSaveLevelBatch *batches[XCF_SAVE_N_BATCHES];
+  XcfSaveLevelBatch  quit_batch    = { 0, };
+  GThread           *writer_thread = NULL;
+  goffset           *offset_table;
+  goffset            saved_pos;
+  goffset            offset;
+  guint32            width;
+  guint32            height;
+  gint               bpp;
+  gint               n_tile_rows;
+  gint               n_tile_cols;
+  gint               ntiles;
+  gint               batch_size;
+  gint               i;
+  GError            *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1606,142 +1673,340 @@ xcf_save_level (XcfInfo     *info,
   xcf_write_int32_check_error (info, (guint32 *) &width,  1);
   xcf_write_int32_check_error (info, (guint32 *) &height, 1);
 
+  n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
+  n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
+
+  ntiles = n_tile_rows * n_tile_cols;
+
+  /* 'saved_pos' is the offset of the tile offset table  */
   saved_pos = info->cp;
 
+  /* write an empty offset table */
+  xcf_write_zero_offset_check_error (info, ntiles + 1);
+
+  /* allocate an offset table so we don't have to seek back after each
+   * tile, see bug #686862. allocate ntiles + 1 slots because a zero
+   * offset indicates the offset table's end.
+   */
+  offset_table = g_new0 (goffset, ntiles + 1);
+
+  data.info         = info;
+  data.buffer       = buffer;
+  data.format       = format;
+  data.offset_table = offset_table;
+  data.full_queue   = NULL;
+  data.free_queue   = NULL;
+  data.failed       = FALSE;
+  data.bad_tile     = -1;
+  data.bad_length   = -1;
+  data.error        = NULL;
+
   /* maximal allowable size of on-disk tile data.  make it somewhat bigger than
    * the uncompressed tile size, to allow for the possibility of negative
    * compression.  xcf_load_level() enforces this limit.
    */
-  max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
-                    XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
-
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
+  data.max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
+                         XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
+
+  /* tiles are fetched and compressed in batches, in parallel, into
+   * per-tile memory buffers, and are then written to the file in order.
+   * when there's more than a single batch, the writing is done by a
+   * separate thread, so that the next batch can be compressed while the
+   * previous one is being written.
    */
-  if (info->compression == COMPRESS_RLE)
-    rlebuf = g_alloca (max_data_length);
+  batch_size = MIN (ntiles, XCF_SAVE_BATCH_SIZE);
 
-  n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
-  n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
+  for (i = 0; i < XCF_SAVE_N_BATCHES; i++)
+    batches[i] = NULL;
 
-  ntiles = n_tile_rows * n_tile_cols;
+  if (ntiles > batch_size)
+    {
+      data.full_queue = g_async_queue_new ();
+      data.free_queue = g_async_queue_new ();
 
-  /* allocate an offset table so we don't have to seek back after each
-   * tile, see bug #686862. allocate ntiles + 1 slots because a zero
-   * offset indicates the offset table's end.
-   */
-  offset_table = g_alloca ((ntiles + 1) * sizeof (goffset));
-  memset (offset_table, 0, (ntiles + 1) * sizeof (goffset));
-  next_offset = offset_table;
+      for (i = 0; i < XCF_SAVE_N_BATCHES; i++)
+        {
+          batches[i] = xcf_save_level_batch_new (batch_size,
+                                                 data.max_data_length);
 
-  /* 'saved_pos' is the offset of the tile offset table  */
-  saved_pos = info->cp;
+          g_async_queue_push (data.free_queue, batches[i]);
+        }
 
-  /* write an empty offset table */
-  xcf_write_zero_offset_check_error (info, ntiles + 1);
+      writer_thread = g_thread_new (
+        "xcf-writer",
+        (GThreadFunc) xcf_save_level_writer_thread_func,
+        &data);
+    }
+  else
+    {
+      batches[0] = xcf_save_level_batch_new (batch_size,
+                                             data.max_data_length);
+    }
+
+  for (i = 0; i < ntiles && ! g_atomic_int_get (&data.failed); i += batch_size)
+    {
+      XcfSaveLevelBatch *batch;
 
-  /* 'offset' is where we will write the next tile */
+      if (writer_thread)
+        batch = g_async_queue_pop (data.free_queue);
+      else
+        batch = batches[0];
+
+      batch->first_tile = i;
+      batch->n_tiles    = MIN (batch_size, ntiles - i);
+
+      data.batch = batch;
+
+      gegl_parallel_distribute_range (
+        batch->n_tiles, XCF_SAVE_TILES_PER_THREAD,
+        (GeglParallelDistributeRangeFunc) xcf_save_level_encode_tiles,
+        &data);
+
+      if (writer_thread)
+        g_async_queue_push (data.full_queue, batch);
+      else
+        xcf_save_level_write_batch (&data, batch);
+    }
+
+  if (writer_thread)
+    {
+      /* an empty batch tells the writer thread to quit */
+      g_async_queue_push (data.full_queue, &quit_batch);
+
+      g_thread_join (writer_thread);
+
+      g_async_queue_unref (data.full_queue);
+      g_async_queue_unref (data.free_queue);
+    }
+
+  for (i = 0; i < XCF_SAVE_N_BATCHES; i++)
+    {
+      if (batches[i])
+        xcf_save_level_batch_free (batches[i]);
+    }
+
+  if (data.failed)
+    {
+      g_free (offset_table);
+
+      if (data.error)
+        {
+          g_propagate_error (error, data.error);
+        }
+      else if (data.bad_length >= 0)
+        {
+          /* make sure the on-disk tile data didn't end up being too big.
+           * xcf_load_level() would refuse to load the file if it did.
+           */
+          g_message ("xcf: invalid tile data length: %d", data.bad_length);
+        }
+      else
+        {
+          g_printerr ("xcf: failed to compress tile %d\n", data.bad_tile);
+        }
+
+      return FALSE;
+    }
+
+  /* 'offset' is the end of the level data */
   offset = info->cp;
 
-  for (i = 0; i < ntiles; i++)
+  /* seek back to the offset table and write it  */
+  if (! xcf_seek_pos (info, saved_pos, error))
+    {
+      g_free (offset_table);
+      return FALSE;
+    }
+
+  xcf_write_offset (info, offset_table, ntiles + 1, &tmp_error);
+
+  g_free (offset_table);
+
+  if (tmp_error)
+    {
+      g_propagate_error (error, tmp_error);
+      return FALSE;
+    }
+
+  /* seek to the end of the file */
+  xcf_check_error (xcf_seek_pos (info, offset, error));
+
+  return TRUE;
+}
+
+static XcfSaveLevelBatch *
+xcf_save_level_batch_new (gint n_tiles,
+                          gint max_data_length)
+{
+  XcfSaveLevelBatch *batch = g_slice_new0 (XcfSaveLevelBatch);
+
+  batch->data        = g_malloc ((gsize) n_tiles * max_data_length);
+  batch->data_length = g_new (gint, n_tiles);
+
+  return batch;
+}
+
+static void
+xcf_save_level_batch_free (XcfSaveLevelBatch *batch)
+{
+  g_free (batch->data);
+  g_free (batch->data_length);
+
+  g_slice_free (XcfSaveLevelBatch, batch);
+}
+
+static void
+xcf_save_level_encode_tiles (gsize             offset,
+                             gsize             size,
+                             XcfSaveLevelData *data)
+{
+  XcfSaveLevelBatch *batch     = data->batch;
+  gint               bpp       = babl_format_get_bytes_per_pixel (data->format);
+  guchar            *tile_data = g_alloca (XCF_TILE_WIDTH * XCF_TILE_HEIGHT *
+                                           bpp);
+  gsize              i;
+
+  for (i = offset; i < offset + size; i++)
     {
-      GeglRectangle rect;
+      GeglRectangle  rect;
+      guchar        *dest = batch->data + i * data->max_data_length;
+      gint           length;
 
-      /* store the offset in the table and increment the next pointer */
-      *next_offset++ = offset;
+      if (g_atomic_int_get (&data->failed))
+        {
+          batch->data_length[i] = -1;
+          continue;
+        }
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
                                       XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+                                      batch->first_tile + i, &rect);
 
-      /* write out the tile. */
-      switch (info->compression)
+      switch (data->info->compression)
         {
         case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
+          length = xcf_save_tile (data->info, data->buffer, &rect,
+                                  data->format, tile_data, dest);
           break;
         case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
+          length = xcf_save_tile_rle (data->info, data->buffer, &rect,
+                                      data->format, tile_data, dest);
           break;
         case COMPRESS_ZLIB:
-          xcf_check_error (xcf_save_tile_zlib (info, buffer, &rect, format,
-                                               error));
+          length = xcf_save_tile_zlib (data->info, data->buffer, &rect,
+                                       data->format, tile_data, dest,
+                                       data->max_data_length);
+          break;
+        case COMPRESS_ZSTD:
+          length = xcf_save_tile_zstd (data->info, data->buffer, &rect,
+                                       data->format, tile_data, dest,
+                                       data->max_data_length);
           break;
         case COMPRESS_FRACTAL:
-          g_warning ("xcf: fractal compression unimplemented");
-          return FALSE;
+        default:
+          length = -1;
+          break;
         }
 
-      /* make sure the on-disk tile data didn't end up being too big.
-       * xcf_load_level() would refuse to load the file if it did.
-       */
-      if (info->cp < offset || info->cp - offset > max_data_length)
+      batch->data_length[i] = length;
+    }
+}
+
+static void
+xcf_save_level_write_batch (XcfSaveLevelData  *data,
+                            XcfSaveLevelBatch *batch)
+{
+  XcfInfo *info = data->info;
+  gint     i;
+
+  for (i = 0; i < batch->n_tiles && ! data->failed; i++)
+    {
+      gint length = batch->data_length[i];
+
+      if (length < 0)
         {
-          g_message ("xcf: invalid tile data length: %" G_GOFFSET_FORMAT,
-                     info->cp - offset);
-          return FALSE;
+          data->bad_tile = batch->first_tile + i;
         }
+      else if (length > data->max_data_length)
+        {
+          data->bad_length = length;
+        }
+      else
+        {
+          /* store the offset in the table */
+          data->offset_table[batch->first_tile + i] = info->cp;
 
-      /* the next tile's offset is after the tile we just wrote */
-      offset = info->cp;
+          xcf_write_int8 (info, batch->data + i * data->max_data_length,
+                          length, &data->error);
+
+          if (! data->error)
+            continue;
+        }
+
+      g_atomic_int_set (&data->failed, TRUE);
     }
+}
 
-  /* seek back to the offset table and write it  */
-  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_offset_check_error (info, offset_table, ntiles + 1);
+static gpointer
+xcf_save_level_writer_thread_func (XcfSaveLevelData *data)
+{
+  XcfSaveLevelBatch *batch;
 
-  /* seek to the end of the file */
-  xcf_check_error (xcf_seek_pos (info, offset, error));
+  while ((batch = g_async_queue_pop (data->full_queue))->n_tiles > 0)
+    {
+      xcf_save_level_write_batch (data, batch);
 
-  return TRUE;
+      g_async_queue_push (data->free_queue, batch);
+    }
+
+  return NULL;
 }
 
-static gboolean
+/* the tile encoders below fetch 'tile_rect' from 'buffer' into the
+ * 'tile_data' scratch buffer, and encode it into 'dest', which is large
+ * enough to hold the maximal allowable on-disk tile data.  they return
+ * the length of the encoded data, or -1 on failure.  they are called
+ * concurrently from multiple threads, and therefore must not modify
+ * 'info'.
+ */
+
+static gint
 xcf_save_tile (XcfInfo        *info,
                GeglBuffer     *buffer,
                GeglRectangle  *tile_rect,
                const Babl     *format,
-               GError        **error)
+               guchar         *tile_data,
+               guchar         *dest)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, dest,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  if (info->file_version <= 11)
-    {
-      xcf_write_int8_check_error (info, tile_data, tile_size);
-    }
-  else
+  if (info->file_version >= 12)
     {
       gint n_components = babl_format_get_n_components (format);
 
-      xcf_write_component_check_error (info, bpp / n_components, tile_data,
-                                       tile_size / bpp * n_components);
+      xcf_write_to_be (bpp / n_components, dest,
+                       tile_size / bpp * n_components);
     }
 
-  return TRUE;
+  return tile_size;
 }
 
-static gboolean
+static gint
 xcf_save_tile_rle (XcfInfo        *info,
                    GeglBuffer     *buffer,
                    GeglRectangle  *tile_rect,
                    const Babl     *format,
-                   guchar         *rlebuf,
-                   GError        **error)
+                   guchar         *tile_data,
+                   guchar         *rlebuf)
 {
   gint    bpp       = babl_format_get_bytes_per_pixel (format);
   gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
   gint    len       = 0;
   gint    i, j;
-  GError *tmp_error  = NULL;
 
   gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
@@ -1854,29 +2119,24 @@ xcf_save_tile_rle (XcfInfo        *info,
         }
 
       if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
+        g_printerr ("xcf: uh oh! xcf rle tile saving error: %d\n", count);
     }
 
-  xcf_write_int8_check_error (info, rlebuf, len);
-
-  return TRUE;
+  return len;
 }
 
-static gboolean
+static gint
 xcf_save_tile_zlib (XcfInfo        *info,
                     GeglBuffer     *buffer,
                     GeglRectangle  *tile_rect,
                     const Babl     *format,
-                    GError        **error)
+                    guchar         *tile_data,
+                    guchar         *dest,
+                    gint            max_data_length)
 {
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
   gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  /* The buffer for compressed data. */
-  guchar   *buf       = g_alloca (tile_size);
-  GError   *tmp_error = NULL;
   z_stream  strm;
-  int       action;
   int       status;
 
   gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
@@ -1897,45 +2157,105 @@ xcf_save_tile_zlib (XcfInfo        *info,
 
   status = deflateInit (&strm, Z_DEFAULT_COMPRESSION);
   if (status != Z_OK)
-    return FALSE;
+    return -1;
 
   strm.next_in   = tile_data;
   strm.avail_in  = tile_size;
-  strm.next_out  = buf;
-  strm.avail_out = tile_size;
+  strm.next_out  = dest;
+  strm.avail_out = max_data_length;
 
-  action = Z_NO_FLUSH;
+  /* the output buffer is as big as the maximal allowable on-disk tile
+   * data, so the stream is finished in a single Z_FINISH call, unless the
+   * tile doesn't compress well enough.
+   */
+  status = deflate (&strm, Z_NO_FLUSH);
+
+  if (status == Z_OK)
+    status = deflate (&strm, Z_FINISH);
+
+  deflateEnd (&strm);
 
-  while (status == Z_OK || status == Z_BUF_ERROR)
+  if (status == Z_STREAM_END)
     {
-      if (strm.avail_in == 0)
-        {
-          /* Finish the encoding. */
-          action = Z_FINISH;
-        }
+      return max_data_length - strm.avail_out;
+    }
+  else if (status == Z_OK || status == Z_BUF_ERROR)
+    {
+      /* out of output space */
+      return max_data_length + 1;
+    }
+  else
+    {
+      g_printerr ("xcf: tile compression failed: %s\n", zError (status));
 
-      status = deflate (&strm, action);
+      return -1;
+    }
+}
 
-      if (status == Z_STREAM_END || status == Z_BUF_ERROR)
-        {
-          size_t write_size = tile_size - strm.avail_out;
+static gint
+xcf_save_tile_zstd (XcfInfo        *info,
+                    GeglBuffer     *buffer,
+                    GeglRectangle  *tile_rect,
+                    const Babl     *format,
+                    guchar         *tile_data,
+                    guchar         *dest,
+                    gint            max_data_length)
+{
+  static GPrivate  cctx_private = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeCCtx);
+  ZSTD_CCtx       *cctx;
+  gint             bpp          = babl_format_get_bytes_per_pixel (format);
+  gint             bpc          = bpp / babl_format_get_n_components (format);
+  gint             tile_size    = bpp * tile_rect->width * tile_rect->height;
+  const guchar    *src          = tile_data;
+  gsize            length;
 
-          xcf_write_int8_check_error (info, buf, write_size);
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-          /* Reset next_out and avail_out. */
-          strm.next_out  = buf;
-          strm.avail_out = tile_size;
-        }
-      else if (status != Z_OK)
-        {
-          g_printerr ("xcf: tile compression failed: %s", zError (status));
-          deflateEnd (&strm);
-          return FALSE;
-        }
+  /* the data is always stored big-endian; data deeper than 8 bits per
+   * channel implies file version >= 12 anyway
+   */
+  xcf_write_to_be (bpc, tile_data, tile_size / bpc);
+
+  /* shuffle high bit-depth data into byte planes, which compress much
+   * better than interleaved bytes
+   */
+  if (bpc > 1)
+    {
+      guchar *shuffled = g_alloca (tile_size);
+
+      xcf_data_shuffle (tile_data, shuffled, bpc, tile_size);
+
+      src = shuffled;
     }
 
-  deflateEnd (&strm);
-  return TRUE;
+  /* compression contexts are expensive to create, keep one per thread */
+  cctx = g_private_get (&cctx_private);
+
+  if (! cctx)
+    {
+      cctx = ZSTD_createCCtx ();
+
+      if (! cctx)
+        return -1;
+
+      g_private_set (&cctx_private, cctx);
+    }
+
+  length = ZSTD_compressCCtx (cctx,
+                              dest, max_data_length,
+                              src,  tile_size,
+                              info->compression_level);
+
+  if (ZSTD_isError (length))
+    {
+      g_printerr ("xcf: tile compression failed: %s\n",
+                  ZSTD_getErrorName (length));
+
+      return -1;
+    }
+
+  return length;
 }
 
 static gboolean
@@ -0,0 +1,923 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * xcf-tile-backend.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "xcf-private.h"
+#include "xcf-load.h"
+#include "xcf-seek.h"
+#include "xcf-tile-backend.h"
+
+#include "gimp-intl.h"
+
+
+/* XcfTileBackend is a tile backend which reads and decodes the tiles of
+ * an XCF level directly from the file, only when they are first
+ * requested.  tiles which are modified are stored in a regular,
+ * swap-backed buffer, and take precedence over the file data
+ * afterwards.
+ *
+ * all the backends created while loading an image share a single
+ * XcfTileFile, holding the input stream they read from.  before the
+ * file is overwritten, xcf_tile_file_release() reads all the remaining
+ * tiles into the backends' stores, and detaches them from the file.
+ */
+
+
+typedef enum
+{
+  XCF_TILE_STATE_FILE,   /* the tile data is read from the file */
+  XCF_TILE_STATE_STORED, /* the tile was modified, and is stored in memory */
+  XCF_TILE_STATE_VOID    /* the tile was voided */
+} XcfTileState;
+
+
+struct _XcfTileFile
+{
+  gint      ref_count;
+
+  GMutex    mutex;
+  XcfInfo   info;
+  gchar    *id;
+
+  GMutex    backends_mutex;
+  GList    *backends;
+
+  gboolean  failed;
+};
+
+struct _XcfTileBackendPrivate
+{
+  XcfTileFile *tile_file;
+
+  gint         width;
+  gint         height;
+  gint         n_tile_cols;
+  gint         n_tile_rows;
+  goffset     *offset_table;
+  gint         max_data_length;
+
+  GMutex       mutex;
+  guint8      *tile_state;
+  GeglBuffer  *store;
+};
+
+typedef struct
+{
+  Gimp  *gimp;
+  gchar *filename;
+} XcfTileFileError;
+
+
+/*  local function prototypes  */
+
+static void       xcf_tile_backend_finalize  (GObject         *object);
+
+static gpointer   xcf_tile_backend_command   (GeglTileSource  *source,
+                                              GeglTileCommand  command,
+                                              gint             x,
+                                              gint             y,
+                                              gint             z,
+                                              gpointer         data);
+
+static GeglTile * xcf_tile_backend_get_tile  (XcfTileBackend  *backend,
+                                              gint             x,
+                                              gint             y);
+static GeglTile * xcf_tile_backend_load_tile (XcfTileBackend  *backend,
+                                              XcfTileFile     *tile_file,
+                                              gint             x,
+                                              gint             y,
+                                              gboolean        *success);
+static void       xcf_tile_backend_store     (XcfTileBackend  *backend,
+                                              gint             x,
+                                              gint             y,
+                                              GeglTile        *tile);
+static void       xcf_tile_backend_set_tile  (XcfTileBackend  *backend,
+                                              gint             x,
+                                              gint             y,
+                                              GeglTile        *tile);
+static void       xcf_tile_backend_void_tile (XcfTileBackend  *backend,
+                                              gint             x,
+                                              gint             y);
+static gboolean   xcf_tile_backend_exist     (XcfTileBackend  *backend,
+                                              gint             x,
+                                              gint             y);
+static gboolean   xcf_tile_backend_detach    (XcfTileBackend  *backend,
+                                              XcfTileFile     *tile_file,
+                                              GError         **error);
+
+static gsize      xcf_tile_file_read         (XcfTileFile     *tile_file,
+                                              goffset          offset,
+                                              guchar          *data,
+                                              gsize            size);
+static void       xcf_tile_file_error        (XcfTileFile     *tile_file);
+static gboolean   xcf_tile_file_error_idle   (XcfTileFileError *data);
+static gboolean   xcf_tile_file_matches      (XcfTileFile     *tile_file,
+                                              GFile           *file,
+                                              const gchar     *id);
+
+
+G_DEFINE_TYPE_WITH_PRIVATE (XcfTileBackend, xcf_tile_backend,
+                            GEGL_TYPE_TILE_BACKEND)
+
+#define parent_class xcf_tile_backend_parent_class
+
+
+/*  all the open tile files, so that they can be released before the
+ *  files they read from are overwritten
+ */
+static GMutex  tile_files_mutex;
+static GList  *tile_files = NULL;
+
+
+/*  private functions  */
+
+static void
+xcf_tile_backend_class_init (XcfTileBackendClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xcf_tile_backend_finalize;
+}
+
+static void
+xcf_tile_backend_init (XcfTileBackend *backend)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (backend);
+
+  backend->priv = xcf_tile_backend_get_instance_private (backend);
+
+  source->command = xcf_tile_backend_command;
+
+  g_mutex_init (&backend->priv->mutex);
+}
+
+static void
+xcf_tile_backend_finalize (GObject *object)
+{
+  XcfTileBackend *backend = XCF_TILE_BACKEND (object);
+  XcfTileFile    *tile_file;
+
+  /* the backend may be detached from the file concurrently */
+  g_mutex_lock (&backend->priv->mutex);
+  tile_file = backend->priv->tile_file;
+  backend->priv->tile_file = NULL;
+  g_mutex_unlock (&backend->priv->mutex);
+
+  if (tile_file)
+    {
+      g_mutex_lock (&tile_file->backends_mutex);
+      tile_file->backends = g_list_remove (tile_file->backends, backend);
+      g_mutex_unlock (&tile_file->backends_mutex);
+
+      xcf_tile_file_unref (tile_file);
+    }
+
+  g_clear_pointer (&backend->priv->offset_table, g_free);
+  g_clear_pointer (&backend->priv->tile_state, g_free);
+  g_clear_object (&backend->priv->store);
+
+  g_mutex_clear (&backend->priv->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gpointer
+xcf_tile_backend_command (GeglTileSource  *source,
+                          GeglTileCommand  command,
+                          gint             x,
+                          gint             y,
+                          gint             z,
+                          gpointer         data)
+{
+  XcfTileBackend *backend = XCF_TILE_BACKEND (source);
+
+  switch (command)
+    {
+    case GEGL_TILE_GET:
+      /* mipmapped tiles are rendered locally from the level-0 tiles */
+      if (z == 0)
+        return xcf_tile_backend_get_tile (backend, x, y);
+
+      return NULL;
+
+    case GEGL_TILE_SET:
+      if (z == 0)
+        xcf_tile_backend_set_tile (backend, x, y, data);
+
+      gegl_tile_mark_as_stored (data);
+
+      return NULL;
+
+    case GEGL_TILE_VOID:
+      if (z == 0)
+        xcf_tile_backend_void_tile (backend, x, y);
+
+      return NULL;
+
+    case GEGL_TILE_EXIST:
+      if (z == 0)
+        return GINT_TO_POINTER (xcf_tile_backend_exist (backend, x, y));
+
+      return GINT_TO_POINTER (FALSE);
+
+    default:
+      return gegl_tile_backend_command (GEGL_TILE_BACKEND (source),
+                                        command, x, y, z, data);
+    }
+}
+
+static GeglTile *
+xcf_tile_backend_get_tile (XcfTileBackend *backend,
+                           gint            x,
+                           gint            y)
+{
+  XcfTileBackendPrivate *priv      = backend->priv;
+  XcfTileFile           *tile_file = NULL;
+  GeglTile              *tile      = NULL;
+  gint                   index;
+
+  if (x < 0 || x >= priv->n_tile_cols ||
+      y < 0 || y >= priv->n_tile_rows)
+    {
+      return NULL;
+    }
+
+  index = y * priv->n_tile_cols + x;
+
+  g_mutex_lock (&priv->mutex);
+
+  switch (priv->tile_state[index])
+    {
+    case XCF_TILE_STATE_FILE:
+      /* the backend may be detached from the file meanwhile */
+      tile_file = xcf_tile_file_ref (priv->tile_file);
+      break;
+
+    case XCF_TILE_STATE_STORED:
+      {
+        GeglTileBackend *tile_backend = GEGL_TILE_BACKEND (backend);
+        gint             bpp;
+
+        bpp  = babl_format_get_bytes_per_pixel (
+                 gegl_tile_backend_get_format (tile_backend));
+        tile = gegl_tile_new (gegl_tile_backend_get_tile_size (tile_backend));
+
+        gegl_buffer_get (priv->store,
+                         GEGL_RECTANGLE (x * XCF_TILE_WIDTH,
+                                         y * XCF_TILE_HEIGHT,
+                                         XCF_TILE_WIDTH, XCF_TILE_HEIGHT),
+                         1.0, NULL, gegl_tile_get_data (tile),
+                         XCF_TILE_WIDTH * bpp, GEGL_ABYSS_NONE);
+      }
+      break;
+
+    case XCF_TILE_STATE_VOID:
+      break;
+    }
+
+  g_mutex_unlock (&priv->mutex);
+
+  if (tile_file)
+    {
+      gboolean success;
+
+      tile = xcf_tile_backend_load_tile (backend, tile_file, x, y, &success);
+
+      /* there is no way to fail a tile request, so the tile reads as
+       * empty; make sure the user knows the pixels are missing
+       */
+      if (! success)
+        xcf_tile_file_error (tile_file);
+
+      xcf_tile_file_unref (tile_file);
+    }
+
+  if (tile)
+    gegl_tile_mark_as_stored (tile);
+
+  return tile;
+}
+
+static GeglTile *
+xcf_tile_backend_load_tile (XcfTileBackend *backend,
+                            XcfTileFile    *tile_file,
+                            gint            x,
+                            gint            y,
+                            gboolean       *success)
+{
+  XcfTileBackendPrivate *priv         = backend->priv;
+  GeglTileBackend       *tile_backend = GEGL_TILE_BACKEND (backend);
+  const Babl            *format;
+  GeglTile              *tile         = NULL;
+  GeglRectangle          rect;
+  gint                   index;
+  gint                   bpp;
+  goffset                offset;
+  goffset                offset2;
+  gsize                  data_length;
+  guchar                *xcfdata;
+  guchar                *tile_data;
+  gboolean               empty;
+
+  format = gegl_tile_backend_get_format (tile_backend);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  index = y * priv->n_tile_cols + x;
+
+  rect.x      = x * XCF_TILE_WIDTH;
+  rect.y      = y * XCF_TILE_HEIGHT;
+  rect.width  = MIN (XCF_TILE_WIDTH,  priv->width  - rect.x);
+  rect.height = MIN (XCF_TILE_HEIGHT, priv->height - rect.y);
+
+  offset  = priv->offset_table[index];
+  offset2 = priv->offset_table[index + 1];
+
+  /* if the offset is 0 then we need to read in the maximum possible
+   * allowing for negative compression
+   */
+  if (offset2 == 0)
+    offset2 = offset + priv->max_data_length;
+
+  xcfdata   = g_malloc (offset2 - offset);
+  tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+  data_length = xcf_tile_file_read (tile_file, offset,
+                                    xcfdata, offset2 - offset);
+
+  *success = xcf_load_tile_decode (&tile_file->info, &rect, format,
+                                   xcfdata, data_length, tile_data, &empty);
+
+  if (*success && ! empty)
+    {
+      guchar *dest;
+      gint    row;
+
+      tile = gegl_tile_new (gegl_tile_backend_get_tile_size (tile_backend));
+      dest = gegl_tile_get_data (tile);
+
+      if (rect.width  < XCF_TILE_WIDTH ||
+          rect.height < XCF_TILE_HEIGHT)
+        {
+          memset (dest, 0, XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+        }
+
+      for (row = 0; row < rect.height; row++)
+        {
+          memcpy (dest      + row * XCF_TILE_WIDTH * bpp,
+                  tile_data + row * rect.width     * bpp,
+                  rect.width * bpp);
+        }
+
+    }
+
+  g_free (tile_data);
+  g_free (xcfdata);
+
+  /* an empty tile is returned as NULL, letting the buffer use its shared
+   * empty tile
+   */
+  return tile;
+}
+
+static void
+xcf_tile_backend_set_tile (XcfTileBackend *backend,
+                           gint            x,
+                           gint            y,
+                           GeglTile       *tile)
+{
+  XcfTileBackendPrivate *priv = backend->priv;
+  gint                   index;
+
+  if (x < 0 || x >= priv->n_tile_cols ||
+      y < 0 || y >= priv->n_tile_rows)
+    {
+      return;
+    }
+
+  index = y * priv->n_tile_cols + x;
+
+  g_mutex_lock (&priv->mutex);
+
+  xcf_tile_backend_store (backend, x, y, tile);
+
+  priv->tile_state[index] = XCF_TILE_STATE_STORED;
+
+  g_mutex_unlock (&priv->mutex);
+}
+
+/* copies the tile to the store, which is swapped out like any other
+ * buffer.  called with the backend's mutex held.
+ */
+static void
+xcf_tile_backend_store (XcfTileBackend *backend,
+                        gint            x,
+                        gint            y,
+                        GeglTile       *tile)
+{
+  XcfTileBackendPrivate *priv         = backend->priv;
+  GeglTileBackend       *tile_backend = GEGL_TILE_BACKEND (backend);
+  const Babl            *format;
+
+  format = gegl_tile_backend_get_format (tile_backend);
+
+  if (! priv->store)
+    {
+      priv->store = g_object_new (GEGL_TYPE_BUFFER,
+                                  "x",           0,
+                                  "y",           0,
+                                  "width",       priv->width,
+                                  "height",      priv->height,
+                                  "tile-width",  XCF_TILE_WIDTH,
+                                  "tile-height", XCF_TILE_HEIGHT,
+                                  "format",      format,
+                                  NULL);
+    }
+
+  gegl_buffer_set (priv->store,
+                   GEGL_RECTANGLE (x * XCF_TILE_WIDTH,
+                                   y * XCF_TILE_HEIGHT,
+                                   XCF_TILE_WIDTH, XCF_TILE_HEIGHT),
+                   0, NULL, gegl_tile_get_data (tile),
+                   XCF_TILE_WIDTH * babl_format_get_bytes_per_pixel (format));
+}
+
+static void
+xcf_tile_backend_void_tile (XcfTileBackend *backend,
+                            gint            x,
+                            gint            y)
+{
+  XcfTileBackendPrivate *priv = backend->priv;
+  gint                   index;
+
+  if (x < 0 || x >= priv->n_tile_cols ||
+      y < 0 || y >= priv->n_tile_rows)
+    {
+      return;
+    }
+
+  index = y * priv->n_tile_cols + x;
+
+  g_mutex_lock (&priv->mutex);
+
+  priv->tile_state[index] = XCF_TILE_STATE_VOID;
+
+  g_mutex_unlock (&priv->mutex);
+}
+
+static gboolean
+xcf_tile_backend_exist (XcfTileBackend *backend,
+                        gint            x,
+                        gint            y)
+{
+  XcfTileBackendPrivate *priv = backend->priv;
+  gboolean               exist;
+
+  if (x < 0 || x >= priv->n_tile_cols ||
+      y < 0 || y >= priv->n_tile_rows)
+    {
+      return FALSE;
+    }
+
+  g_mutex_lock (&priv->mutex);
+
+  exist = priv->tile_state[y * priv->n_tile_cols + x] != XCF_TILE_STATE_VOID;
+
+  g_mutex_unlock (&priv->mutex);
+
+  return exist;
+}
+
+/* reads all the tiles which are still in the file into the store, and
+ * drops the backend's reference to the file.  called with the file's
+ * backends mutex held, which keeps the backend alive.
+ */
+static gboolean
+xcf_tile_backend_detach (XcfTileBackend  *backend,
+                         XcfTileFile     *tile_file,
+                         GError         **error)
+{
+  XcfTileBackendPrivate *priv = backend->priv;
+  gboolean               owned;
+  gint                   n_tiles;
+  gint                   index;
+
+  n_tiles = priv->n_tile_cols * priv->n_tile_rows;
+
+  for (index = 0; index < n_tiles; index++)
+    {
+      gint      x = index % priv->n_tile_cols;
+      gint      y = index / priv->n_tile_cols;
+      GeglTile *tile;
+      gboolean  success;
+
+      g_mutex_lock (&priv->mutex);
+
+      if (priv->tile_state[index] != XCF_TILE_STATE_FILE)
+        {
+          g_mutex_unlock (&priv->mutex);
+
+          continue;
+        }
+
+      g_mutex_unlock (&priv->mutex);
+
+      tile = xcf_tile_backend_load_tile (backend, tile_file, x, y, &success);
+
+      if (! success)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Could not read the pixels of an image from '%s', "
+                         "which was modified or damaged since it was "
+                         "opened.  Save the image to a different file."),
+                       gimp_file_get_utf8_name (tile_file->info.file));
+
+          return FALSE;
+        }
+
+      g_mutex_lock (&priv->mutex);
+
+      /* the tile may have been written meanwhile */
+      if (priv->tile_state[index] == XCF_TILE_STATE_FILE)
+        {
+          if (tile)
+            {
+              xcf_tile_backend_store (backend, x, y, tile);
+
+              priv->tile_state[index] = XCF_TILE_STATE_STORED;
+            }
+          else
+            {
+              priv->tile_state[index] = XCF_TILE_STATE_VOID;
+            }
+        }
+
+      g_mutex_unlock (&priv->mutex);
+
+      if (tile)
+        gegl_tile_unref (tile);
+    }
+
+  /* unless the backend is being finalized, and already took it */
+  g_mutex_lock (&priv->mutex);
+  owned = (priv->tile_file == tile_file);
+  if (owned)
+    priv->tile_file = NULL;
+  g_mutex_unlock (&priv->mutex);
+
+  tile_file->backends = g_list_remove (tile_file->backends, backend);
+
+  if (owned)
+    xcf_tile_file_unref (tile_file);
+
+  return TRUE;
+}
+
+static gsize
+xcf_tile_file_read (XcfTileFile *tile_file,
+                    goffset      offset,
+                    guchar      *data,
+                    gsize        size)
+{
+  gsize bytes_read = 0;
+
+  g_mutex_lock (&tile_file->mutex);
+
+  if (xcf_seek_pos (&tile_file->info, offset, NULL))
+    {
+      /* we have to read directly instead of xcf_read_* because we may be
+       * reading past the end of the file here
+       */
+      g_input_stream_read_all (tile_file->info.input, data, size,
+                               &bytes_read, NULL, NULL);
+      tile_file->info.cp += bytes_read;
+    }
+  else
+    {
+      /* force seeking again on the next read */
+      tile_file->info.cp = -1;
+    }
+
+  g_mutex_unlock (&tile_file->mutex);
+
+  return bytes_read;
+}
+
+static void
+xcf_tile_file_error (XcfTileFile *tile_file)
+{
+  XcfTileFileError *data;
+
+  /* only report the first failure of each file */
+  if (! g_atomic_int_compare_and_exchange (&tile_file->failed, FALSE, TRUE))
+    return;
+
+  data = g_slice_new (XcfTileFileError);
+
+  data->gimp     = tile_file->info.gimp;
+  data->filename = g_strdup (gimp_file_get_utf8_name (tile_file->info.file));
+
+  /* tiles are requested from any thread */
+  g_idle_add ((GSourceFunc) xcf_tile_file_error_idle, data);
+}
+
+static gboolean
+xcf_tile_file_error_idle (XcfTileFileError *data)
+{
+  gimp_message (data->gimp, NULL, GIMP_MESSAGE_ERROR,
+                _("Could not read the pixels of an image from '%s', which "
+                  "was modified or damaged since it was opened.  Parts of "
+                  "the image are missing; don't save it over the damaged "
+                  "file."),
+                data->filename);
+
+  g_free (data->filename);
+  g_slice_free (XcfTileFileError, data);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+xcf_tile_file_matches (XcfTileFile *tile_file,
+                       GFile       *file,
+                       const gchar *id)
+{
+  if (g_file_equal (tile_file->info.file, file))
+    return TRUE;
+
+  /* the same file through a different path, a symbolic or hard link */
+  return id && tile_file->id && ! strcmp (id, tile_file->id);
+}
+
+
+/*  public functions  */
+
+/**
+ * xcf_tile_backend_new:
+ * @tile_file:       the #XcfTileFile to read the tiles from.
+ * @format:          the pixel format of the level.
+ * @width:           the level width.
+ * @height:          the level height.
+ * @offset_table:    the level's tile offset table, including its
+ *                   terminating zero offset.
+ * @max_data_length: the maximal allowable size of on-disk tile data.
+ *
+ * Creates a tile backend for an XCF level, whose tiles are read and
+ * decoded from @tile_file only when they are first requested.  The
+ * offset table must have already been validated.
+ *
+ * Returns: the new tile backend.
+ **/
+GeglTileBackend *
+xcf_tile_backend_new (XcfTileFile   *tile_file,
+                      const Babl    *format,
+                      gint           width,
+                      gint           height,
+                      const goffset *offset_table,
+                      gint           max_data_length)
+{
+  GeglTileBackend       *backend;
+  XcfTileBackendPrivate *priv;
+  gint                   ntiles;
+
+  g_return_val_if_fail (tile_file != NULL, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (offset_table != NULL, NULL);
+
+  backend = g_object_new (XCF_TYPE_TILE_BACKEND,
+                          "tile-width",  XCF_TILE_WIDTH,
+                          "tile-height", XCF_TILE_HEIGHT,
+                          "format",      format,
+                          NULL);
+
+  priv = XCF_TILE_BACKEND (backend)->priv;
+
+  priv->tile_file       = xcf_tile_file_ref (tile_file);
+  priv->width           = width;
+  priv->height          = height;
+  priv->n_tile_cols     = (width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH;
+  priv->n_tile_rows     = (height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT;
+  priv->max_data_length = max_data_length;
+
+  ntiles = priv->n_tile_cols * priv->n_tile_rows;
+
+  priv->offset_table = g_memdup (offset_table, (ntiles + 1) * sizeof (goffset));
+  priv->tile_state   = g_new0 (guint8, ntiles);
+
+  g_mutex_lock (&tile_file->backends_mutex);
+  tile_file->backends = g_list_prepend (tile_file->backends, backend);
+  g_mutex_unlock (&tile_file->backends_mutex);
+
+  gegl_tile_backend_set_extent (backend,
+                                GEGL_RECTANGLE (0, 0, width, height));
+
+  return backend;
+}
+
+/**
+ * xcf_tile_file_new:
+ * @file:  the XCF file.
+ * @info:  the #XcfInfo of the file being loaded.
+ * @error: return location for errors.
+ *
+ * Opens a separate input stream for @file, which remains open, and is
+ * shared by the tile backends reading from it, until the last reference
+ * to the returned #XcfTileFile is dropped.  The compression type and
+ * file version are copied from @info.
+ *
+ * Returns: the new #XcfTileFile, or %NULL on error.
+ **/
+XcfTileFile *
+xcf_tile_file_new (GFile    *file,
+                   XcfInfo  *info,
+                   GError  **error)
+{
+  XcfTileFile  *tile_file;
+  GInputStream *input;
+  GFileInfo    *file_info;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+
+  if (! input)
+    return NULL;
+
+  if (! G_IS_SEEKABLE (input) || ! g_seekable_can_seek (G_SEEKABLE (input)))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                           _("Could not seek in XCF file"));
+      g_object_unref (input);
+
+      return NULL;
+    }
+
+  tile_file = g_slice_new0 (XcfTileFile);
+
+  tile_file->ref_count = 1;
+
+  g_mutex_init (&tile_file->mutex);
+  g_mutex_init (&tile_file->backends_mutex);
+
+  /* identifies the file we actually read from, whichever path leads
+   * to it
+   */
+  file_info = g_file_input_stream_query_info (G_FILE_INPUT_STREAM (input),
+                                              G_FILE_ATTRIBUTE_ID_FILE,
+                                              NULL, NULL);
+
+  if (file_info)
+    {
+      tile_file->id = g_strdup (g_file_info_get_attribute_string (
+                                  file_info, G_FILE_ATTRIBUTE_ID_FILE));
+
+      g_object_unref (file_info);
+    }
+
+  tile_file->info.gimp             = info->gimp;
+  tile_file->info.input            = input;
+  tile_file->info.seekable         = G_SEEKABLE (input);
+  tile_file->info.cp               = 0;
+  tile_file->info.bytes_per_offset = info->bytes_per_offset;
+  tile_file->info.file             = g_object_ref (file);
+  tile_file->info.compression      = info->compression;
+  tile_file->info.file_version     = info->file_version;
+
+  g_mutex_lock (&tile_files_mutex);
+  tile_files = g_list_prepend (tile_files, tile_file);
+  g_mutex_unlock (&tile_files_mutex);
+
+  return tile_file;
+}
+
+XcfTileFile *
+xcf_tile_file_ref (XcfTileFile *tile_file)
+{
+  g_return_val_if_fail (tile_file != NULL, NULL);
+
+  g_atomic_int_inc (&tile_file->ref_count);
+
+  return tile_file;
+}
+
+void
+xcf_tile_file_unref (XcfTileFile *tile_file)
+{
+  g_return_if_fail (tile_file != NULL);
+
+  if (g_atomic_int_dec_and_test (&tile_file->ref_count))
+    {
+      g_mutex_lock (&tile_files_mutex);
+      tile_files = g_list_remove (tile_files, tile_file);
+      g_mutex_unlock (&tile_files_mutex);
+
+      g_input_stream_close (tile_file->info.input, NULL, NULL);
+
+      g_object_unref (tile_file->info.input);
+      g_object_unref (tile_file->info.file);
+      g_free (tile_file->id);
+
+      g_mutex_clear (&tile_file->mutex);
+      g_mutex_clear (&tile_file->backends_mutex);
+
+      g_slice_free (XcfTileFile, tile_file);
+    }
+}
+
+/**
+ * xcf_tile_file_release:
+ * @file:  a file about to be overwritten.
+ * @error: return location for errors.
+ *
+ * Reads all the tiles which are still only in @file, or in the file
+ * behind it if it's a link, into memory or swap, and detaches their
+ * backends from it, so that the file can be overwritten safely.
+ *
+ * Returns: %FALSE if the pixels couldn't be read, in which case @file
+ *          must not be overwritten.
+ **/
+gboolean
+xcf_tile_file_release (GFile   *file,
+                       GError **error)
+{
+  GFileInfo *file_info;
+  gchar     *id       = NULL;
+  GList     *matching = NULL;
+  GList     *list;
+  gboolean   success  = TRUE;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  file_info = g_file_query_info (file, G_FILE_ATTRIBUTE_ID_FILE,
+                                 G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+  if (file_info)
+    {
+      id = g_strdup (g_file_info_get_attribute_string (
+                       file_info, G_FILE_ATTRIBUTE_ID_FILE));
+
+      g_object_unref (file_info);
+    }
+
+  g_mutex_lock (&tile_files_mutex);
+
+  for (list = tile_files; list; list = g_list_next (list))
+    {
+      if (xcf_tile_file_matches (list->data, file, id))
+        matching = g_list_prepend (matching, xcf_tile_file_ref (list->data));
+    }
+
+  g_mutex_unlock (&tile_files_mutex);
+
+  for (list = matching; list; list = g_list_next (list))
+    {
+      XcfTileFile *tile_file = list->data;
+
+      g_mutex_lock (&tile_file->backends_mutex);
+
+      while (success && tile_file->backends)
+        {
+          success = xcf_tile_backend_detach (tile_file->backends->data,
+                                             tile_file, error);
+        }
+
+      g_mutex_unlock (&tile_file->backends_mutex);
+
+      xcf_tile_file_unref (tile_file);
+    }
+
+  g_list_free (matching);
+  g_free (id);
+
+  return success;
+}
@@ -0,0 +1,72 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * xcf-tile-backend.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_BACKEND_H__
+#define __XCF_TILE_BACKEND_H__
+
+
+#include <gegl-buffer-backend.h>
+
+
+#define XCF_TYPE_TILE_BACKEND            (xcf_tile_backend_get_type ())
+#define XCF_TILE_BACKEND(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XCF_TYPE_TILE_BACKEND, XcfTileBackend))
+#define XCF_TILE_BACKEND_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  XCF_TYPE_TILE_BACKEND, XcfTileBackendClass))
+#define XCF_IS_TILE_BACKEND(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XCF_TYPE_TILE_BACKEND))
+#define XCF_IS_TILE_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  XCF_TYPE_TILE_BACKEND))
+#define XCF_TILE_BACKEND_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  XCF_TYPE_TILE_BACKEND, XcfTileBackendClass))
+
+
+typedef struct _XcfTileBackend        XcfTileBackend;
+typedef struct _XcfTileBackendClass   XcfTileBackendClass;
+typedef struct _XcfTileBackendPrivate XcfTileBackendPrivate;
+
+struct _XcfTileBackend
+{
+  GeglTileBackend        parent_instance;
+
+  XcfTileBackendPrivate *priv;
+};
+
+struct _XcfTileBackendClass
+{
+  GeglTileBackendClass  parent_class;
+};
+
+
+GType             xcf_tile_backend_get_type (void) G_GNUC_CONST;
+
+GeglTileBackend * xcf_tile_backend_new      (XcfTileFile   *tile_file,
+                                             const Babl    *format,
+                                             gint           width,
+                                             gint           height,
+                                             const goffset *offset_table,
+                                             gint           max_data_length);
+
+
+XcfTileFile     * xcf_tile_file_new         (GFile         *file,
+                                             XcfInfo       *info,
+                                             GError       **error);
+XcfTileFile     * xcf_tile_file_ref         (XcfTileFile   *tile_file);
+void              xcf_tile_file_unref       (XcfTileFile   *tile_file);
+
+gboolean          xcf_tile_file_release     (GFile         *file,
+                                             GError       **error);
+
+
+#endif  /*  __XCF_TILE_BACKEND_H__  */
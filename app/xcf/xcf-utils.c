@@ -51,3 +51,48 @@ xcf_data_is_zero (const void *data,
 
   return TRUE;
 }
+
+/* splits 'size' bytes of 'bpc'-byte values into 'bpc' byte planes, the
+ * first holding the first byte of each value, the second holding the
+ * second byte, and so on.
+ */
+void
+xcf_data_shuffle (const void *src,
+                  void       *dest,
+                  gint        bpc,
+                  gint        size)
+{
+  const guint8 *s = src;
+  gint          n = size / bpc;
+  gint          b;
+
+  for (b = 0; b < bpc; b++)
+    {
+      guint8 *d = (guint8 *) dest + b * n;
+      gint    i;
+
+      for (i = 0; i < n; i++)
+        d[i] = s[i * bpc + b];
+    }
+}
+
+/* reverses xcf_data_shuffle() */
+void
+xcf_data_unshuffle (const void *src,
+                    void       *dest,
+                    gint        bpc,
+                    gint        size)
+{
+  guint8 *d = dest;
+  gint    n = size / bpc;
+  gint    b;
+
+  for (b = 0; b < bpc; b++)
+    {
+      const guint8 *s = (const guint8 *) src + b * n;
+      gint          i;
+
+      for (i = 0; i < n; i++)
+        d[i * bpc + b] = s[i];
+    }
+}
@@ -19,8 +19,17 @@
 #define __XCF_UTILS_H__
 
 
-gboolean   xcf_data_is_zero (const void *data,
-                             gint        size);
+gboolean   xcf_data_is_zero   (const void *data,
+                               gint        size);
+
+void       xcf_data_shuffle   (const void *src,
+                               void       *dest,
+                               gint        bpc,
+                               gint        size);
+void       xcf_data_unshuffle (const void *src,
+                               void       *dest,
+                               gint        bpc,
+                               gint        size);
 
 
 #endif  /* __XCF_UTILS_H__ */
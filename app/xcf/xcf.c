@@ -29,6 +29,8 @@
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
 #include "core/gimpimage.h"
 #include "core/gimpparamspecs.h"
@@ -42,6 +44,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-tile-backend.h"
 
 #include "gimp-intl.h"
 
@@ -247,6 +250,19 @@ xcf_exit (Gimp *gimp)
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 }
 
+/*  images loaded on demand keep reading pixels from the file they were
+ *  loaded from, this has to be called before that file is overwritten
+ */
+gboolean
+xcf_release_file (GFile   *file,
+                  GError **error)
+{
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  return xcf_tile_file_release (file, error);
+}
+
 GimpImage *
 xcf_load_stream (Gimp          *gimp,
                  GInputStream  *input,
@@ -279,6 +295,12 @@ xcf_load_stream (Gimp          *gimp,
   info.file             = input_file;
   info.compression      = COMPRESS_NONE;
 
+  /* pixel data can only be read on demand from local files, which stay
+   * accessible after loading
+   */
+  info.lazy_load = (GIMP_CORE_CONFIG (gimp->config)->xcf_lazy_load &&
+                    input_file && g_file_is_native (input_file));
+
   if (progress)
     gimp_progress_start (progress, FALSE, _("Opening '%s'"), filename);
 
@@ -318,6 +340,9 @@ xcf_load_stream (Gimp          *gimp,
             success = FALSE;
 
           g_input_stream_close (info.input, NULL, NULL);
+
+          /* the tile backends keep their own reference */
+          g_clear_pointer (&info.tile_file, xcf_tile_file_unref);
         }
       else
         {
@@ -368,13 +393,29 @@ xcf_save_stream (Gimp           *gimp,
   info.file             = output_file;
 
   if (gimp_image_get_xcf_compression (image))
-    info.compression = COMPRESS_ZLIB;
+    {
+      /*  zstd compression is only used when explicitly chosen for the
+       *  image, since older versions of GIMP can't read it
+       */
+      if (gimp_image_get_xcf_zstd_compression (image))
+        {
+          info.compression       = COMPRESS_ZSTD;
+          info.compression_level =
+            GIMP_CORE_CONFIG (gimp->config)->xcf_zstd_level;
+        }
+      else
+        {
+          info.compression = COMPRESS_ZLIB;
+        }
+    }
   else
-    info.compression = COMPRESS_RLE;
+    {
+      info.compression = COMPRESS_RLE;
+    }
 
   info.file_version = gimp_image_get_xcf_version (image,
-                                                  info.compression ==
-                                                  COMPRESS_ZLIB,
+                                                  info.compression !=
+                                                  COMPRESS_RLE,
                                                   NULL, NULL, NULL);
 
   if (info.file_version >= 11)
@@ -488,9 +529,12 @@ xcf_save_invoker (GimpProcedure         *procedure,
   uri   = g_value_get_string (gimp_value_array_index (args, 3));
   file  = g_file_new_for_uri (uri);
 
-  output = G_OUTPUT_STREAM (g_file_replace (file,
-                                            NULL, FALSE, G_FILE_CREATE_NONE,
-                                            NULL, &my_error));
+  if (! xcf_release_file (file, error))
+    output = NULL;
+  else
+    output = G_OUTPUT_STREAM (g_file_replace (file,
+                                              NULL, FALSE, G_FILE_CREATE_NONE,
+                                              NULL, &my_error));
 
   if (output)
     {
@@ -498,7 +542,7 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
       g_object_unref (output);
     }
-  else
+  else if (my_error)
     {
       g_propagate_prefixed_error (error, my_error,
                                   _("Error creating '%s': "),
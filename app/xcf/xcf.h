@@ -35,4 +35,7 @@ gboolean    xcf_save_stream (Gimp           *gimp,
                              GimpProgress   *progress,
                              GError        **error);
 
+gboolean    xcf_release_file (GFile          *file,
+                              GError        **error);
+
 #endif /* __XCF_H__ */
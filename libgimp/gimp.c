@@ -185,7 +185,7 @@ static gboolean   gimp_flush                   (GIOChannel      *channel,
                                                 gpointer         user_data);
 static void       gimp_loop                    (void);
 static void       gimp_config                  (GPConfig        *config);
-static void       gimp_proc_run                (GPProcRun       *proc_run);
+static gboolean   gimp_proc_run                (GPProcRun       *proc_run);
 static void       gimp_temp_proc_run           (GPProcRun       *proc_run);
 static void       gimp_process_message         (GimpWireMessage *msg);
 static void       gimp_single_message          (void);
@@ -213,6 +213,7 @@ static gint           _tile_width        = -1;
 static gint           _tile_height       = -1;
 static gint           _shm_ID            = -1;
 static guchar        *_shm_addr          = NULL;
+static gsize          _shm_size          = 0;
 static gboolean       _show_tool_tips    = TRUE;
 static gboolean       _show_help_button  = TRUE;
 static gboolean       _export_profile    = FALSE;
@@ -228,6 +229,7 @@ static gchar         *_display_name      = NULL;
 static gint           _monitor_number    = 0;
 static guint32        _timestamp         = 0;
 static gchar         *_icon_theme_dir    = NULL;
+static gboolean       _allow_persistent  = FALSE;
 static const gchar   *progname           = NULL;
 
 static gchar          write_buffer[WRITE_BUFFER_SIZE];
@@ -237,6 +239,8 @@ static GimpStackTraceMode stack_trace_mode = GIMP_STACK_TRACE_NEVER;
 
 static GHashTable    *temp_proc_ht       = NULL;
 
+static gboolean       persistent         = FALSE;
+
 static guint          gimp_debug_flags   = 0;
 
 static const GDebugKey gimp_debug_keys[] =
@@ -1115,6 +1119,15 @@ gimp_run_procedure (const gchar *name,
   return return_vals;
 }
 
+/* the size of the shared memory window, which is at least large
+ * enough for a single tile and usually spans many.
+ */
+gsize
+_gimp_shm_size (void)
+{
+  return _shm_size;
+}
+
 void
 gimp_read_expect_msg (GimpWireMessage *msg,
                       gint             type)
@@ -1185,6 +1198,9 @@ gimp_run_procedure2 (const gchar     *name,
   gimp_read_expect_msg (&msg, GP_PROC_RETURN);
   gp_unlock ();
 
+  /*  the procedure may have changed any drawable  */
+  _gimp_tile_pdb_called ();
+
   proc_return = msg.data;
 
   *n_return_vals = proc_return->nparams;
@@ -1796,6 +1812,28 @@ gimp_extension_process (guint timeout)
 #endif
 }
 
+/**
+ * gimp_persistent_enable:
+ *
+ * Asks GIMP to keep the plug-in running after the procedure it is
+ * running returns, instead of starting it again for the next call to
+ * one of its procedures.
+ *
+ * Plug-ins calling this function must be able to run any of their
+ * procedures several times in the same process, without relying on
+ * state left over from a previous run. GIMP asks idle plug-ins to
+ * quit after a while, or when too many of them are kept running, and
+ * never keeps plug-ins that still have temporary procedures
+ * installed.
+ *
+ * Since: 2.10.12
+ **/
+void
+gimp_persistent_enable (void)
+{
+  persistent = TRUE;
+}
+
 /**
  * gimp_parasite_find:
  * @name: The name of the parasite to find.
@@ -1914,7 +1952,7 @@ gimp_close (void)
 #elif defined(USE_POSIX_SHM)
 
   if ((_shm_ID != -1) && (_shm_addr != MAP_FAILED))
-    munmap (_shm_addr, TILE_MAP_SIZE);
+    munmap (_shm_addr, _shm_size);
 
 #endif
 
@@ -2263,8 +2301,19 @@ gimp_loop (void)
           g_warning ("unexpected tile message received (should not happen)");
           break;
 
+        case GP_REGION_REQ:
+        case GP_REGION_DATA:
+          g_warning ("unexpected region message received (should not happen)");
+          break;
+
         case GP_PROC_RUN:
-          gimp_proc_run (msg.data);
+          if (gimp_proc_run (msg.data))
+            {
+              /*  keep serving GP_PROC_RUN until GIMP sends GP_QUIT  */
+              gimp_wire_destroy (&msg);
+              continue;
+            }
+
           gimp_wire_destroy (&msg);
           gimp_close ();
           return;
@@ -2288,6 +2337,10 @@ gimp_loop (void)
         case GP_HAS_INIT:
           g_warning ("unexpected has init message received (should not happen)");
           break;
+
+        case GP_PERSIST:
+          g_warning ("unexpected persist message received (should not happen)");
+          break;
         }
 
       gimp_wire_destroy (&msg);
@@ -2297,8 +2350,9 @@ gimp_loop (void)
 static void
 gimp_config (GPConfig *config)
 {
-  GFile *file;
-  gchar *path;
+  static gboolean  configured = FALSE;
+  GFile           *file;
+  gchar           *path;
 
   if (config->version < GIMP_PROTOCOL_VERSION)
     {
@@ -2322,6 +2376,7 @@ gimp_config (GPConfig *config)
   _tile_width       = config->tile_width;
   _tile_height      = config->tile_height;
   _shm_ID           = config->shm_ID;
+  _shm_size         = config->shm_size ? config->shm_size : TILE_MAP_SIZE;
   _check_size       = config->check_size;
   _check_type       = config->check_type;
   _show_tool_tips   = config->show_tooltips    ? TRUE : FALSE;
@@ -2332,13 +2387,20 @@ gimp_config (GPConfig *config)
   _export_iptc      = config->export_iptc      ? TRUE : FALSE;
   _min_colors       = config->min_colors;
   _gdisp_ID         = config->gdisp_ID;
-  _wm_class         = g_strdup (config->wm_class);
-  _display_name     = g_strdup (config->display_name);
   _monitor_number   = config->monitor_number;
   _timestamp        = config->timestamp;
+  _allow_persistent = config->allow_persistent ? TRUE : FALSE;
+
+  /*  persistent plug-ins get a new config before each run  */
+  g_free (_wm_class);
+  g_free (_display_name);
+  g_free (_icon_theme_dir);
+
+  _wm_class         = g_strdup (config->wm_class);
+  _display_name     = g_strdup (config->display_name);
   _icon_theme_dir   = g_strdup (config->icon_theme_dir);
 
-  if (config->app_name)
+  if (config->app_name && ! configured)
     g_set_application_name (config->app_name);
 
   gimp_cpu_accel_set_use (config->use_cpu_accel);
@@ -2357,7 +2419,7 @@ gimp_config (GPConfig *config)
   g_free (path);
   g_object_unref (file);
 
-  if (_shm_ID != -1)
+  if (_shm_ID != -1 && ! configured)
     {
 #if defined(USE_SYSV_SHM)
 
@@ -2388,7 +2450,7 @@ gimp_config (GPConfig *config)
           /* Map the shared memory into our address space for use */
           _shm_addr = (guchar *) MapViewOfFile (shm_handle,
                                                 FILE_MAP_ALL_ACCESS,
-                                                0, 0, TILE_MAP_SIZE);
+                                                0, 0, _shm_size);
 
           /* Verify that we mapped our view */
           if (!_shm_addr)
@@ -2419,7 +2481,7 @@ gimp_config (GPConfig *config)
       if (shm_fd != -1)
         {
           /* Map the shared memory into our address space for use */
-          _shm_addr = (guchar *) mmap (NULL, TILE_MAP_SIZE,
+          _shm_addr = (guchar *) mmap (NULL, _shm_size,
                                        PROT_READ | PROT_WRITE, MAP_SHARED,
                                        shm_fd, 0);
 
@@ -2440,11 +2502,15 @@ gimp_config (GPConfig *config)
 
 #endif
     }
+
+  configured = TRUE;
 }
 
-static void
+static gboolean
 gimp_proc_run (GPProcRun *proc_run)
 {
+  gboolean keep_running = FALSE;
+
   if (PLUG_IN_INFO.run_proc)
     {
       GPProcReturn  proc_return;
@@ -2456,6 +2522,15 @@ gimp_proc_run (GPProcRun *proc_run)
                                  (GimpParam *) proc_run->params,
                                  &n_return_vals, &return_vals);
 
+      /*  GIMP must know before the return values arrive, it closes
+       *  the plug-in as soon as it got them otherwise
+       */
+      keep_running = (persistent && _allow_persistent &&
+                      g_hash_table_size (temp_proc_ht) == 0);
+
+      if (keep_running && ! gp_persist_write (_writechannel, NULL))
+        gimp_quit ();
+
       proc_return.name    = proc_run->name;
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
@@ -2463,6 +2538,8 @@ gimp_proc_run (GPProcRun *proc_run)
       if (! gp_proc_return_write (_writechannel, &proc_return, NULL))
         gimp_quit ();
     }
+
+  return keep_running;
 }
 
 static void
@@ -2514,6 +2591,10 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_TILE_DATA:
       g_warning ("unexpected tile message received (should not happen)");
       break;
+    case GP_REGION_REQ:
+    case GP_REGION_DATA:
+      g_warning ("unexpected region message received (should not happen)");
+      break;
     case GP_PROC_RUN:
       g_warning ("unexpected proc run message received (should not happen)");
       break;
@@ -2532,6 +2613,10 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_HAS_INIT:
       g_warning ("unexpected has init message received (should not happen)");
       break;
+
+    case GP_PERSIST:
+      g_warning ("unexpected persist message received (should not happen)");
+      break;
     }
 }
 
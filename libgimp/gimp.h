@@ -282,6 +282,10 @@ void           gimp_extension_enable    (void);
  */
 void           gimp_extension_process   (guint            timeout);
 
+/* Keep the plug-in running between calls to its procedures
+ */
+void           gimp_persistent_enable   (void);
+
 /* Run a procedure in the procedure database. The parameters are
  *  specified via the variable length argument list. The return
  *  values are returned in the 'GimpParam*' array.
@@ -57,6 +57,11 @@ static void  gimp_tile_put          (GimpTile        *tile);
 static void  gimp_tile_cache_insert (GimpTile        *tile);
 static void  gimp_tile_cache_flush  (GimpTile        *tile);
 
+static gint  gimp_tile_region_band  (gint             width,
+                                     gint             bpp);
+static void  gimp_tile_changed      (GimpDrawable    *drawable,
+                                     gboolean         shadow);
+
 
 /*  private variables  */
 
@@ -67,6 +72,13 @@ static gulong       max_tile_size   = 0;
 static gulong       cur_cache_size  = 0;
 static gulong       max_cache_size  = 0;
 
+/*  the number of PDB calls, and of puts per drawable and shadow, made
+ *  so far.  any of them may change the drawable's pixels in the core.
+ */
+static volatile gint  pdb_generation   = 0;
+static GHashTable   * put_generations  = NULL;
+G_LOCK_DEFINE_STATIC (put_generations);
+
 
 /*  public functions  */
 
@@ -206,6 +218,202 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
     }
 }
 
+/* Returns a value which changes whenever the pixels of the drawable, or
+ * of its shadow, may have been changed in the core since the last call:
+ * after every tile or region put to it, and after every PDB call.
+ * Callers keeping pixels around have to drop them when it changes.
+ */
+gint
+_gimp_tile_get_generation (GimpDrawable *drawable,
+                           gboolean      shadow)
+{
+  gint generation;
+
+  g_return_val_if_fail (drawable != NULL, 0);
+
+  generation = g_atomic_int_get (&pdb_generation);
+
+  G_LOCK (put_generations);
+
+  if (put_generations)
+    {
+      generation += GPOINTER_TO_INT (
+        g_hash_table_lookup (put_generations,
+                             GINT_TO_POINTER (drawable->drawable_id * 2 +
+                                              (shadow ? 1 : 0))));
+    }
+
+  G_UNLOCK (put_generations);
+
+  return generation;
+}
+
+void
+_gimp_tile_pdb_called (void)
+{
+  g_atomic_int_inc (&pdb_generation);
+}
+
+/* Transfers the pixels of an arbitrary rectangle of the drawable in as
+ * few round trips as possible, bypassing the tile cache.  Rectangles
+ * larger than the shared memory window are split into bands of rows.
+ */
+void
+_gimp_tile_region_get (GimpDrawable *drawable,
+                       gboolean      shadow,
+                       gint          x,
+                       gint          y,
+                       gint          width,
+                       gint          height,
+                       guchar       *dest,
+                       gint          rowstride)
+{
+  extern GIOChannel *_writechannel;
+
+  gint bpp;
+  gint band;
+  gint row;
+
+  g_return_if_fail (drawable != NULL);
+  g_return_if_fail (dest != NULL);
+
+  bpp  = drawable->bpp;
+  band = gimp_tile_region_band (width, bpp);
+
+  for (row = 0; row < height; row += band)
+    {
+      GPRegionReq      region_req;
+      GPRegionData    *region_data;
+      GimpWireMessage  msg;
+      const guchar    *src;
+      gint             n_rows = MIN (band, height - row);
+      gint             i;
+
+      region_req.drawable_ID = drawable->drawable_id;
+      region_req.shadow      = shadow ? TRUE : FALSE;
+      region_req.x           = x;
+      region_req.y           = y + row;
+      region_req.width       = width;
+      region_req.height      = n_rows;
+
+      gp_lock ();
+      if (! gp_region_req_write (_writechannel, &region_req, NULL))
+        gimp_quit ();
+
+      gimp_read_expect_msg (&msg, GP_REGION_DATA);
+
+      region_data = msg.data;
+      if (region_data->drawable_ID != region_req.drawable_ID ||
+          region_data->shadow      != region_req.shadow      ||
+          region_data->x           != region_req.x           ||
+          region_data->y           != region_req.y           ||
+          region_data->width       != region_req.width       ||
+          region_data->height      != region_req.height      ||
+          region_data->bpp         != drawable->bpp)
+        {
+          g_message ("received region info did not match requested region info");
+          gimp_quit ();
+        }
+
+      if (region_data->use_shm)
+        src = gimp_shm_addr ();
+      else
+        src = region_data->data;
+
+      for (i = 0; i < n_rows; i++)
+        {
+          memcpy (dest + (row + i) * rowstride,
+                  src + i * width * bpp,
+                  width * bpp);
+        }
+
+      if (! gp_tile_ack_write (_writechannel, NULL))
+        gimp_quit ();
+      gp_unlock ();
+
+      gimp_wire_destroy (&msg);
+    }
+}
+
+void
+_gimp_tile_region_put (GimpDrawable *drawable,
+                       gboolean      shadow,
+                       gint          x,
+                       gint          y,
+                       gint          width,
+                       gint          height,
+                       const guchar *src,
+                       gint          rowstride)
+{
+  extern GIOChannel *_writechannel;
+
+  gint bpp;
+  gint band;
+  gint row;
+
+  g_return_if_fail (drawable != NULL);
+  g_return_if_fail (src != NULL);
+
+  bpp  = drawable->bpp;
+  band = gimp_tile_region_band (width, bpp);
+
+  for (row = 0; row < height; row += band)
+    {
+      GPRegionReq      region_req = { -1, 0, };
+      GPRegionData     region_data;
+      GPRegionData    *region_info;
+      GimpWireMessage  msg;
+      guchar          *dest;
+      gint             n_rows = MIN (band, height - row);
+      gsize            size   = (gsize) width * n_rows * bpp;
+      gint             i;
+
+      gp_lock ();
+      if (! gp_region_req_write (_writechannel, &region_req, NULL))
+        gimp_quit ();
+
+      gimp_read_expect_msg (&msg, GP_REGION_DATA);
+
+      region_info = msg.data;
+
+      region_data.drawable_ID = drawable->drawable_id;
+      region_data.shadow      = shadow ? TRUE : FALSE;
+      region_data.x           = x;
+      region_data.y           = y + row;
+      region_data.width       = width;
+      region_data.height      = n_rows;
+      region_data.bpp         = bpp;
+      region_data.use_shm     = (region_info->use_shm &&
+                                 size <= _gimp_shm_size ());
+      region_data.data        = NULL;
+
+      if (region_data.use_shm)
+        dest = gimp_shm_addr ();
+      else
+        dest = region_data.data = g_malloc (size);
+
+      for (i = 0; i < n_rows; i++)
+        {
+          memcpy (dest + i * width * bpp,
+                  src + (row + i) * rowstride,
+                  width * bpp);
+        }
+
+      if (! gp_region_data_write (_writechannel, &region_data, NULL))
+        gimp_quit ();
+
+      g_free (region_data.data);
+
+      gimp_wire_destroy (&msg);
+
+      gimp_read_expect_msg (&msg, GP_TILE_ACK);
+      gp_unlock ();
+      gimp_wire_destroy (&msg);
+    }
+
+  gimp_tile_changed (drawable, shadow);
+}
+
 
 /*  private functions  */
 
@@ -307,6 +515,8 @@ gimp_tile_put (GimpTile *tile)
   gimp_read_expect_msg (&msg, GP_TILE_ACK);
   gp_unlock ();
   gimp_wire_destroy (&msg);
+
+  gimp_tile_changed (tile->drawable, tile->shadow);
 }
 
 /* This function is nearly identical to the function 'tile_cache_insert'
@@ -434,3 +644,30 @@ gimp_tile_cache_flush (GimpTile *tile)
       gimp_tile_unref (tile, FALSE);
     }
 }
+
+static gint
+gimp_tile_region_band (gint width,
+                       gint bpp)
+{
+  gsize row_size = (gsize) MAX (width, 1) * bpp;
+
+  return MAX (1, MIN (_gimp_shm_size () / row_size, G_MAXINT));
+}
+
+static void
+gimp_tile_changed (GimpDrawable *drawable,
+                   gboolean      shadow)
+{
+  gpointer key = GINT_TO_POINTER (drawable->drawable_id * 2 + (shadow ? 1 : 0));
+
+  G_LOCK (put_generations);
+
+  if (! put_generations)
+    put_generations = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  g_hash_table_insert (put_generations, key,
+                       GINT_TO_POINTER (GPOINTER_TO_INT (
+                         g_hash_table_lookup (put_generations, key)) + 1));
+
+  G_UNLOCK (put_generations);
+}
@@ -67,6 +67,29 @@ G_GNUC_INTERNAL void _gimp_tile_ref_nocache          (GimpTile     *tile,
 
 G_GNUC_INTERNAL void _gimp_tile_cache_flush_drawable (GimpDrawable *drawable);
 
+G_GNUC_INTERNAL gsize _gimp_shm_size                (void);
+
+G_GNUC_INTERNAL gint _gimp_tile_get_generation       (GimpDrawable *drawable,
+                                                      gboolean      shadow);
+G_GNUC_INTERNAL void _gimp_tile_pdb_called           (void);
+
+G_GNUC_INTERNAL void _gimp_tile_region_get           (GimpDrawable *drawable,
+                                                      gboolean      shadow,
+                                                      gint          x,
+                                                      gint          y,
+                                                      gint          width,
+                                                      gint          height,
+                                                      guchar       *dest,
+                                                      gint          rowstride);
+G_GNUC_INTERNAL void _gimp_tile_region_put           (GimpDrawable *drawable,
+                                                      gboolean      shadow,
+                                                      gint          x,
+                                                      gint          y,
+                                                      gint          width,
+                                                      gint          height,
+                                                      const guchar *src,
+                                                      gint          rowstride);
+
 
 G_END_DECLS
 
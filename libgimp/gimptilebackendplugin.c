@@ -37,6 +37,12 @@ struct _GimpTileBackendPluginPrivate
   GimpDrawable *drawable;
   gboolean      shadow;
   gint          mul;
+
+  /* tiles fetched ahead of time, along with the one requested, and the
+   * drawable's generation they were fetched at
+   */
+  GHashTable   *prefetched;
+  gint          prefetched_generation;
 };
 
 
@@ -77,6 +83,27 @@ static GeglTile * gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
                                       gint                   x,
                                       gint                   y);
 
+static gint       gimp_tile_n_cols        (GimpTileBackendPlugin *backend_plugin);
+static gpointer   gimp_tile_key           (GimpTileBackendPlugin *backend_plugin,
+                                           gint                   x,
+                                           gint                   y);
+static gboolean   gimp_tile_is_inside     (GimpTileBackendPlugin *backend_plugin,
+                                           gint                   x,
+                                           gint                   y);
+static gboolean   gimp_tile_is_referenced (GimpTileBackendPlugin *backend_plugin,
+                                           gint                   x,
+                                           gint                   y,
+                                           gint                   n_cols);
+static GeglTile * gimp_tile_read_row      (GimpTileBackendPlugin *backend_plugin,
+                                           gint                   x,
+                                           gint                   y);
+static void       gimp_tile_write_region  (GimpTileBackendPlugin *backend_plugin,
+                                           gint                   x,
+                                           gint                   y,
+                                           guchar                *source);
+static void       gimp_tile_validate_prefetched
+                                          (GimpTileBackendPlugin *backend_plugin);
+
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
                             GEGL_TYPE_TILE_BACKEND)
@@ -102,6 +129,10 @@ _gimp_tile_backend_plugin_init (GimpTileBackendPlugin *backend)
 
   backend->priv = _gimp_tile_backend_plugin_get_instance_private (backend);
 
+  backend->priv->prefetched =
+    g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                           NULL, (GDestroyNotify) gegl_tile_unref);
+
   source->command = gimp_tile_backend_plugin_command;
 }
 
@@ -113,6 +144,8 @@ gimp_tile_backend_plugin_finalize (GObject *object)
   if (backend->priv->drawable) /* This also causes a flush */
     gimp_drawable_detach (backend->priv->drawable);
 
+  g_clear_pointer (&backend->priv->prefetched, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -124,8 +157,12 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
                                   gint             z,
                                   gpointer         data)
 {
-  GimpTileBackendPlugin *backend_plugin = GIMP_TILE_BACKEND_PLUGIN (tile_store);
-  gpointer               result         = NULL;
+  GimpTileBackendPlugin        *backend_plugin;
+  GimpTileBackendPluginPrivate *priv;
+  gpointer                      result = NULL;
+
+  backend_plugin = GIMP_TILE_BACKEND_PLUGIN (tile_store);
+  priv           = backend_plugin->priv;
 
   switch (command)
     {
@@ -137,7 +174,25 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
         {
           g_mutex_lock (&backend_plugin_mutex);
 
-          result = gimp_tile_read_mul (backend_plugin, x, y);
+          gimp_tile_validate_prefetched (backend_plugin);
+
+          result = g_hash_table_lookup (priv->prefetched,
+                                        gimp_tile_key (backend_plugin, x, y));
+
+          if (result)
+            {
+              g_hash_table_steal (priv->prefetched,
+                                  gimp_tile_key (backend_plugin, x, y));
+            }
+          else if (! gimp_tile_is_inside (backend_plugin, x, y) ||
+                   gimp_tile_is_referenced (backend_plugin, x, y, 1))
+            {
+              result = gimp_tile_read_mul (backend_plugin, x, y);
+            }
+          else
+            {
+              result = gimp_tile_read_row (backend_plugin, x, y);
+            }
 
           g_mutex_unlock (&backend_plugin_mutex);
         }
@@ -149,7 +204,34 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
         {
           g_mutex_lock (&backend_plugin_mutex);
 
-          gimp_tile_write_mul (backend_plugin, x, y, gegl_tile_get_data (data));
+          gimp_tile_validate_prefetched (backend_plugin);
+
+          g_hash_table_remove (priv->prefetched,
+                               gimp_tile_key (backend_plugin, x, y));
+
+          if (! gimp_tile_is_inside (backend_plugin, x, y) ||
+              gimp_tile_is_referenced (backend_plugin, x, y, 1))
+            {
+              gimp_tile_write_mul (backend_plugin, x, y,
+                                   gegl_tile_get_data (data));
+            }
+          else
+            {
+              gint generation = priv->prefetched_generation;
+
+              gimp_tile_write_region (backend_plugin, x, y,
+                                      gegl_tile_get_data (data));
+
+              /*  if nothing but our own put changed the drawable, it
+               *  only changed the tile we just dropped, so keep the
+               *  rest of the prefetched tiles
+               */
+              if (_gimp_tile_get_generation (priv->drawable, priv->shadow) ==
+                  generation + 1)
+                {
+                  priv->prefetched_generation = generation + 1;
+                }
+            }
 
           g_mutex_unlock (&backend_plugin_mutex);
         }
@@ -157,10 +239,30 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
       gegl_tile_mark_as_stored (data);
       break;
 
+    case GEGL_TILE_VOID:
+      if (z == 0)
+        {
+          g_mutex_lock (&backend_plugin_mutex);
+
+          g_hash_table_remove (priv->prefetched,
+                               gimp_tile_key (backend_plugin, x, y));
+
+          g_mutex_unlock (&backend_plugin_mutex);
+        }
+
+      result = gegl_tile_backend_command (GEGL_TILE_BACKEND (tile_store),
+                                          command, x, y, z, data);
+      break;
+
     case GEGL_TILE_FLUSH:
       g_mutex_lock (&backend_plugin_mutex);
 
-      gimp_drawable_flush (backend_plugin->priv->drawable);
+      /*  the drawable may be changed by the core after a flush, don't
+       *  hand out tiles which were fetched before it
+       */
+      g_hash_table_remove_all (priv->prefetched);
+
+      gimp_drawable_flush (priv->drawable);
 
       g_mutex_unlock (&backend_plugin_mutex);
       break;
@@ -281,6 +383,206 @@ gimp_tile_write_mul (GimpTileBackendPlugin *backend_plugin,
     }
 }
 
+static gint
+gimp_tile_n_cols (GimpTileBackendPlugin *backend_plugin)
+{
+  GeglTileBackend *backend    = GEGL_TILE_BACKEND (backend_plugin);
+  gint             tile_width = gegl_tile_backend_get_tile_width (backend);
+
+  return ((gint) backend_plugin->priv->drawable->width + tile_width - 1) /
+         tile_width;
+}
+
+static gpointer
+gimp_tile_key (GimpTileBackendPlugin *backend_plugin,
+               gint                   x,
+               gint                   y)
+{
+  return GINT_TO_POINTER (y * gimp_tile_n_cols (backend_plugin) + x);
+}
+
+static gboolean
+gimp_tile_is_inside (GimpTileBackendPlugin *backend_plugin,
+                     gint                   x,
+                     gint                   y)
+{
+  GeglTileBackend *backend     = GEGL_TILE_BACKEND (backend_plugin);
+  GimpDrawable    *drawable    = backend_plugin->priv->drawable;
+  gint             tile_width  = gegl_tile_backend_get_tile_width  (backend);
+  gint             tile_height = gegl_tile_backend_get_tile_height (backend);
+
+  return (x >= 0 && x * tile_width  < (gint) drawable->width &&
+          y >= 0 && y * tile_height < (gint) drawable->height);
+}
+
+/*  whether any of the plug-in tiles covered by the backend tiles
+ *  [x, x + n_cols) of row y is currently referenced through the
+ *  legacy tile API, in which case their pixels have to go through the
+ *  GimpTile of the drawable to stay consistent.
+ */
+static gboolean
+gimp_tile_is_referenced (GimpTileBackendPlugin *backend_plugin,
+                         gint                   x,
+                         gint                   y,
+                         gint                   n_cols)
+{
+  GimpTileBackendPluginPrivate *priv     = backend_plugin->priv;
+  GimpDrawable                 *drawable = priv->drawable;
+  GimpTile                     *tiles;
+  gint                          mul      = priv->mul;
+  gint                          row, col;
+
+  tiles = priv->shadow ? drawable->shadow_tiles : drawable->tiles;
+
+  if (! tiles)
+    return FALSE;
+
+  for (row = y * mul;
+       row < MIN ((y + 1) * mul, drawable->ntile_rows);
+       row++)
+    {
+      for (col = x * mul;
+           col < MIN ((x + n_cols) * mul, (gint) drawable->ntile_cols);
+           col++)
+        {
+          if (tiles[row * drawable->ntile_cols + col].ref_count > 0)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/*  fetches the backend tile (x, y) together with as many of the
+ *  following tiles of the same row as fit into the shared memory
+ *  window, using a single region transfer.  the extra tiles are kept
+ *  around until they are requested.
+ */
+static GeglTile *
+gimp_tile_read_row (GimpTileBackendPlugin *backend_plugin,
+                    gint                   x,
+                    gint                   y)
+{
+  GimpTileBackendPluginPrivate *priv     = backend_plugin->priv;
+  GeglTileBackend              *backend  = GEGL_TILE_BACKEND (backend_plugin);
+  GimpDrawable                 *drawable = priv->drawable;
+  GeglTile                     *result   = NULL;
+  guchar                       *row_data;
+  gint                          tile_width;
+  gint                          tile_height;
+  gint                          tile_size;
+  gint                          bpp      = drawable->bpp;
+  gint                          n_cols;
+  gint                          n_tiles;
+  gint                          width;
+  gint                          height;
+  gint                          rowstride;
+  gint                          i;
+
+  tile_width  = gegl_tile_backend_get_tile_width  (backend);
+  tile_height = gegl_tile_backend_get_tile_height (backend);
+  tile_size   = gegl_tile_backend_get_tile_size   (backend);
+
+  n_cols = gimp_tile_n_cols (backend_plugin);
+
+  height  = MIN (tile_height, (gint) drawable->height - y * tile_height);
+
+  n_tiles = _gimp_shm_size () / ((gsize) tile_width * height * bpp);
+  n_tiles = CLAMP (n_tiles, 1, n_cols - x);
+
+  while (n_tiles > 1 &&
+         gimp_tile_is_referenced (backend_plugin, x, y, n_tiles))
+    {
+      n_tiles /= 2;
+    }
+
+  width     = MIN (n_tiles * tile_width, (gint) drawable->width - x * tile_width);
+  rowstride = width * bpp;
+
+  row_data = g_malloc ((gsize) rowstride * height);
+
+  priv->prefetched_generation =
+    _gimp_tile_get_generation (drawable, priv->shadow);
+
+  _gimp_tile_region_get (drawable, priv->shadow,
+                         x * tile_width, y * tile_height, width, height,
+                         row_data, rowstride);
+
+  /*  only keep the tiles of the most recent row around, so a plug-in
+   *  which doesn't read the whole row doesn't accumulate them
+   */
+  g_hash_table_remove_all (priv->prefetched);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GeglTile *tile        = gegl_tile_new (tile_size);
+      guchar   *tile_data   = gegl_tile_get_data (tile);
+      gint      tile_x      = i * tile_width;
+      gint      tile_ewidth = MIN (tile_width, width - tile_x);
+      gint      row;
+
+      if (tile_ewidth < tile_width || height < tile_height)
+        memset (tile_data, 0, tile_size);
+
+      for (row = 0; row < height; row++)
+        {
+          memcpy (tile_data + row * tile_width * bpp,
+                  row_data + row * rowstride + tile_x * bpp,
+                  tile_ewidth * bpp);
+        }
+
+      if (i == 0)
+        result = tile;
+      else
+        g_hash_table_insert (priv->prefetched,
+                             gimp_tile_key (backend_plugin, x + i, y), tile);
+    }
+
+  g_free (row_data);
+
+  return result;
+}
+
+/*  writes the backend tile (x, y) using a single region transfer  */
+static void
+gimp_tile_write_region (GimpTileBackendPlugin *backend_plugin,
+                        gint                   x,
+                        gint                   y,
+                        guchar                *source)
+{
+  GimpTileBackendPluginPrivate *priv     = backend_plugin->priv;
+  GeglTileBackend              *backend  = GEGL_TILE_BACKEND (backend_plugin);
+  GimpDrawable                 *drawable = priv->drawable;
+  gint                          tile_width;
+  gint                          tile_height;
+
+  tile_width  = gegl_tile_backend_get_tile_width  (backend);
+  tile_height = gegl_tile_backend_get_tile_height (backend);
+
+  _gimp_tile_region_put (drawable, priv->shadow,
+                         x * tile_width, y * tile_height,
+                         MIN (tile_width,  (gint) drawable->width  - x * tile_width),
+                         MIN (tile_height, (gint) drawable->height - y * tile_height),
+                         source, tile_width * drawable->bpp);
+}
+
+/*  drops the prefetched tiles if the drawable may have been changed
+ *  since they were fetched, by a PDB call, or by a put through any
+ *  other path.
+ */
+static void
+gimp_tile_validate_prefetched (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+
+  if (g_hash_table_size (priv->prefetched) > 0 &&
+      _gimp_tile_get_generation (priv->drawable, priv->shadow) !=
+      priv->prefetched_generation)
+    {
+      g_hash_table_remove_all (priv->prefetched);
+    }
+}
+
 GeglTileBackend *
 _gimp_tile_backend_plugin_new (GimpDrawable *drawable,
                                gint          shadow)
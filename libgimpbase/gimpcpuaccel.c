@@ -127,9 +127,15 @@ enum
   ARCH_X86_INTEL_FEATURE_SSSE3    = 1 << 9,
   ARCH_X86_INTEL_FEATURE_SSE4_1   = 1 << 19,
   ARCH_X86_INTEL_FEATURE_SSE4_2   = 1 << 20,
+  ARCH_X86_INTEL_FEATURE_OSXSAVE  = 1 << 27,
   ARCH_X86_INTEL_FEATURE_AVX      = 1 << 28
 };
 
+enum
+{
+  ARCH_X86_INTEL_FEATURE_AVX2     = 1 << 5
+};
+
 #if !defined(ARCH_X86_64) && (defined(PIC) || defined(__PIC__))
 #define cpuid(op,eax,ebx,ecx,edx)  \
   __asm__ ("movl %%ebx, %%esi\n\t" \
@@ -140,6 +146,16 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("movl %%ebx, %%esi\n\t"            \
+           "cpuid\n\t"                        \
+           "xchgl %%ebx,%%esi"                \
+           : "=a" (eax),                      \
+             "=S" (ebx),                      \
+             "=c" (ecx),                      \
+             "=d" (edx)                       \
+           : "0" (op),                        \
+             "2" (count))
 #else
 #define cpuid(op,eax,ebx,ecx,edx)  \
   __asm__ ("cpuid"                 \
@@ -148,8 +164,23 @@ enum
              "=c" (ecx),           \
              "=d" (edx)            \
            : "0" (op))
+#define cpuid_count(op,count,eax,ebx,ecx,edx) \
+  __asm__ ("cpuid"                            \
+           : "=a" (eax),                      \
+             "=b" (ebx),                      \
+             "=c" (ecx),                      \
+             "=d" (edx)                       \
+           : "0" (op),                        \
+             "2" (count))
 #endif
 
+/* xgetbv, spelled out for assemblers that don't know it */
+#define xgetbv(index,eax,edx)                   \
+  __asm__ (".byte 0x0f, 0x01, 0xd0"             \
+           : "=a" (eax),                        \
+             "=d" (edx)                         \
+           : "c" (index))
+
 
 static X86Vendor
 arch_get_vendor (void)
@@ -261,6 +292,22 @@ arch_accel_intel (void)
 
     if (ecx & ARCH_X86_INTEL_FEATURE_AVX)
       caps |= GIMP_CPU_ACCEL_X86_AVX;
+
+    if ((ecx & ARCH_X86_INTEL_FEATURE_AVX) &&
+        (ecx & ARCH_X86_INTEL_FEATURE_OSXSAVE))
+      {
+        guint32 max_op;
+
+        cpuid (0, max_op, ebx, ecx, edx);
+
+        if (max_op >= 7)
+          {
+            cpuid_count (7, 0, eax, ebx, ecx, edx);
+
+            if (ebx & ARCH_X86_INTEL_FEATURE_AVX2)
+              caps |= GIMP_CPU_ACCEL_X86_AVX2;
+          }
+      }
 #endif /* USE_SSE */
   }
 #endif /* USE_MMX */
@@ -389,6 +436,19 @@ arch_accel_sse_os_support (void)
 
   return TRUE;
 }
+
+static gboolean
+arch_accel_avx_os_support (void)
+{
+  guint32 eax, edx;
+
+  /* make sure the OS saves the xmm and ymm registers on context switches.
+   * only call this function if OSXSAVE is set.
+   */
+  xgetbv (0, eax, edx);
+
+  return (eax & 0x06) == 0x06;
+}
 #endif /* USE_SSE */
 
 static guint32
@@ -427,6 +487,9 @@ arch_accel (void)
 #ifdef USE_SSE
   if ((caps & GIMP_CPU_ACCEL_X86_SSE) && !arch_accel_sse_os_support ())
     caps &= ~(GIMP_CPU_ACCEL_X86_SSE | GIMP_CPU_ACCEL_X86_SSE2);
+
+  if ((caps & GIMP_CPU_ACCEL_X86_AVX2) && !arch_accel_avx_os_support ())
+    caps &= ~GIMP_CPU_ACCEL_X86_AVX2;
 #endif
 
   return caps;
@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0019
+#define GIMP_PROTOCOL_VERSION  0x001D
 
 
 enum
@@ -43,7 +43,10 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_REGION_REQ,
+  GP_REGION_DATA,
+  GP_PERSIST
 };
 
 
@@ -51,6 +54,8 @@ typedef struct _GPConfig        GPConfig;
 typedef struct _GPTileReq       GPTileReq;
 typedef struct _GPTileAck       GPTileAck;
 typedef struct _GPTileData      GPTileData;
+typedef struct _GPRegionReq     GPRegionReq;
+typedef struct _GPRegionData    GPRegionData;
 typedef struct _GPParam         GPParam;
 typedef struct _GPParamDef      GPParamDef;
 typedef struct _GPProcRun       GPProcRun;
@@ -90,6 +95,12 @@ struct _GPConfig
   guint64  tile_cache_size;
   gchar   *swap_path;
   gint32   num_processors;
+
+  /* since protocol version 0x001A: */
+  guint32  shm_size;
+
+  /* since protocol version 0x001C: */
+  gint8    allow_persistent;
 };
 
 struct _GPTileReq
@@ -111,6 +122,29 @@ struct _GPTileData
   guchar  *data;
 };
 
+struct _GPRegionReq
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  gint32   x;
+  gint32   y;
+  guint32  width;
+  guint32  height;
+};
+
+struct _GPRegionData
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  gint32   x;
+  gint32   y;
+  guint32  width;
+  guint32  height;
+  guint32  bpp;
+  guint32  use_shm;
+  guchar  *data;
+};
+
 struct _GPParam
 {
   guint32 type;
@@ -210,6 +244,12 @@ gboolean  gp_tile_ack_write         (GIOChannel      *channel,
 gboolean  gp_tile_data_write        (GIOChannel      *channel,
                                      GPTileData      *tile_data,
                                      gpointer         user_data);
+gboolean  gp_region_req_write       (GIOChannel      *channel,
+                                     GPRegionReq     *region_req,
+                                     gpointer         user_data);
+gboolean  gp_region_data_write      (GIOChannel      *channel,
+                                     GPRegionData    *region_data,
+                                     gpointer         user_data);
 gboolean  gp_proc_run_write         (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
@@ -232,6 +272,8 @@ gboolean  gp_extension_ack_write    (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_has_init_write         (GIOChannel      *channel,
                                      gpointer         user_data);
+gboolean  gp_persist_write          (GIOChannel      *channel,
+                                     gpointer         user_data);
 
 void      gp_params_destroy         (GPParam         *params,
                                      gint             nparams);